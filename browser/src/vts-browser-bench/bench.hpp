@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BENCH_HPP_r8b2m5xk0q
+#define BENCH_HPP_r8b2m5xk0q
+
+#include <string>
+
+#include <vts-browser/foundation.hpp>
+
+// compares the queues used between the browser threads
+//   under synthetic producer load
+void benchQueues(uint32 producers, uint32 items);
+
+// compares the label collision resolution with and without the grid
+//   on synthetic labels, returns false if the results differ
+bool benchCollisions(uint32 labels, uint32 width, uint32 height);
+
+// compares the batched frustum and coarseness tests with the scalar ones
+//   on random boxes, returns false if the results differ
+bool benchCulling(uint32 boxes);
+
+// compares a global lock around the resources with per task touch buffers
+//   and the fork depth on a synthetic quadtree down to this lod,
+//   returns false if the results differ
+bool benchTraversal(uint32 maxLod);
+
+// measures throughput and quality of the texture transcoding
+//   into gpu compressed formats
+void benchCompression(const std::string &image);
+
+// compares the full resolution decoding followed by the vertical flip
+//   with the scaled bottom-up decoding of real tiles
+void benchDecode(const std::string &listPath);
+
+#endif
@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <chrono>
+#include <random>
+
+#include "bench.hpp"
+#include "../vts-librenderer/collision.hpp"
+
+using vts::vec2f;
+using namespace vts::renderer;
+
+namespace
+{
+
+// labels and icons scattered over the screen, similar to a dense city
+std::vector<CollisionItem> generate(uint32 labels,
+    uint32 width, uint32 height)
+{
+    std::mt19937 rng(4242);
+    std::uniform_real_distribution<float> pos(-1.1f, 1.1f);
+    std::uniform_real_distribution<float> len(40, 240);
+    std::uniform_real_distribution<float> tall(12, 28);
+    std::uniform_int_distribution<int> kind(0, 3);
+    std::vector<CollisionItem> result;
+    result.reserve(labels);
+    for (uint32 i = 0; i < labels; i++)
+    {
+        vec2f a(pos(rng), pos(rng));
+        vec2f s(len(rng) / width, tall(rng) / height);
+        CollisionItem c;
+        if (kind(rng) == 0)
+        {
+            // icon only
+            s[0] = s[1] * height / width;
+            c.assign(Rect(a, a + s), width, height);
+        }
+        else
+        {
+            c.assign(Rect(a, a + s), width, height);
+            uint32 glyphs = std::max(
+                uint32(s[0] / s[1] * width / height), 1u);
+            vec2f g(s[0] / glyphs, s[1]);
+            for (uint32 j = 0; j < glyphs; j++)
+            {
+                vec2f p = a + vec2f(g[0] * j, 0);
+                c.addGlyph(Rect(p, p + g), width, height);
+            }
+        }
+        result.push_back(std::move(c));
+    }
+    return result;
+}
+
+double now()
+{
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+bool benchCollisions(uint32 labels, uint32 width, uint32 height)
+{
+    printf("collisions: %u labels, %u x %u\n", labels, width, height);
+    const std::vector<CollisionItem> items
+        = generate(labels, width, height);
+    const uint32 iterations = 10;
+
+    // reference greedy resolution, each against all accepted
+    std::vector<bool> expected(items.size());
+    double t = now();
+    for (uint32 iter = 0; iter < iterations; iter++)
+    {
+        std::vector<const CollisionItem *> accepted;
+        for (uint32 i = 0; i < items.size(); i++)
+        {
+            bool ok = true;
+            for (const CollisionItem *r : accepted)
+            {
+                if (collides(items[i], *r))
+                {
+                    ok = false;
+                    break;
+                }
+            }
+            if (ok)
+                accepted.push_back(&items[i]);
+            expected[i] = ok;
+        }
+    }
+    double bruteforce = (now() - t) / iterations;
+
+    std::vector<bool> results(items.size());
+    CollisionGrid grid;
+    t = now();
+    for (uint32 iter = 0; iter < iterations; iter++)
+    {
+        grid.clear(width, height);
+        for (uint32 i = 0; i < items.size(); i++)
+        {
+            bool ok = !grid.test(items[i]);
+            if (ok)
+                grid.insert(CollisionItem(items[i]));
+            results[i] = ok;
+        }
+    }
+    double indexed = (now() - t) / iterations;
+
+    uint32 mismatches = 0;
+    for (uint32 i = 0; i < items.size(); i++)
+        mismatches += expected[i] != results[i];
+    printf("accepted: %u\n", grid.size());
+    printf("all pairs: %10.3f ms\n", bruteforce * 1000);
+    printf("grid:      %10.3f ms\n", indexed * 1000);
+    if (mismatches)
+        printf("error: %u mismatched results\n", mismatches);
+    return mismatches == 0;
+}
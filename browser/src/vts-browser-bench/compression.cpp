@@ -0,0 +1,132 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#include <vts-browser/resources.hpp>
+
+#include "bench.hpp"
+
+using namespace vts;
+
+namespace
+{
+
+// smooth gradients with noise and sharp edges, similar to orthophotos
+GpuTextureSpec generate(uint32 width, uint32 height, uint32 components)
+{
+    std::mt19937 rng(4242);
+    std::uniform_int_distribution<int> noise(-12, 12);
+    GpuTextureSpec spec;
+    spec.width = width;
+    spec.height = height;
+    spec.components = components;
+    spec.buffer.allocate(spec.expectedSize());
+    unsigned char *p = (unsigned char *)spec.buffer.data();
+    for (uint32 y = 0; y < height; y++)
+    {
+        for (uint32 x = 0; x < width; x++)
+        {
+            bool edge = ((x / 37) + (y / 23)) % 5 == 0;
+            int v[4] = {
+                (int)(x * 255 / width) + noise(rng),
+                (int)(y * 255 / height) + noise(rng),
+                edge ? 220 : 60 + noise(rng),
+                edge ? 128 : 255,
+            };
+            for (uint32 c = 0; c < components; c++)
+                *p++ = (unsigned char)std::min(std::max(v[c], 0), 255);
+        }
+    }
+    return spec;
+}
+
+GpuTextureSpec copy(const GpuTextureSpec &spec)
+{
+    GpuTextureSpec r;
+    r.width = spec.width;
+    r.height = spec.height;
+    r.components = spec.components;
+    r.type = spec.type;
+    r.filterMode = spec.filterMode;
+    r.buffer = spec.buffer.copy();
+    return r;
+}
+
+double psnr(const GpuTextureSpec &a, const GpuTextureSpec &b)
+{
+    double sum = 0;
+    const unsigned char *pa = (const unsigned char *)a.buffer.data();
+    const unsigned char *pb = (const unsigned char *)b.buffer.data();
+    for (uint32 i = 0; i < a.buffer.size(); i++)
+        sum += (pa[i] - pb[i]) * (pa[i] - pb[i]);
+    double mse = sum / a.buffer.size();
+    if (mse == 0)
+        return INFINITY;
+    return 10 * std::log10(255.0 * 255.0 / mse);
+}
+
+double now()
+{
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void bench(const GpuTextureSpec &original, GpuTextureSpec::Compression c,
+    const char *name)
+{
+    GpuTextureSpec spec = copy(original);
+    double t = now();
+    spec.compress(c);
+    double duration = now() - t;
+    uint32 size = spec.buffer.size();
+    uint32 levels = spec.mipmapLevels;
+    spec.decompress();
+    printf("%-5s %3u levels %10u bytes %8.2f MPix/s %7.2f dB\n",
+        name, levels, size,
+        original.width * original.height / duration * 1e-6,
+        psnr(original, spec));
+}
+
+} // namespace
+
+void benchCompression(const std::string &image)
+{
+    GpuTextureSpec spec;
+    if (image == "synthetic")
+        spec = generate(1024, 1024, 3);
+    else
+        spec = GpuTextureSpec(readLocalFileBuffer(image));
+    spec.filterMode = GpuTextureSpec::FilterMode::LinearMipmapLinear;
+    printf("compression: %ux%u, %u components, %u bytes raw\n",
+        spec.width, spec.height, spec.components, spec.expectedSize());
+    bench(spec, GpuTextureSpec::Compression::Bc, "bc");
+    bench(spec, GpuTextureSpec::Compression::Etc2, "etc2");
+}
@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <vts-browser/math.hpp>
+#include "../vts-libbrowser/utilities/culling.hpp"
+
+#include "bench.hpp"
+
+using namespace vts;
+
+namespace
+{
+
+struct Box
+{
+    vec3 aabb[2];
+    vec3 corners[8];
+    double texelSize = 0;
+};
+
+// boxes of random sizes scattered around the camera,
+//   some of them degenerate or containing nans
+std::vector<Box> generate(uint32 count)
+{
+    std::mt19937 rng(4242);
+    std::uniform_real_distribution<double> pos(-1e6, 1e6);
+    std::uniform_real_distribution<double> size(0, 1e5);
+    std::uniform_int_distribution<int> kind(0, 31);
+    std::vector<Box> result(count);
+    for (Box &b : result)
+    {
+        vec3 a(pos(rng), pos(rng), pos(rng));
+        vec3 s(size(rng), size(rng), size(rng));
+        switch (kind(rng))
+        {
+        case 0:
+            s = vec3(0, 0, 0);
+            break;
+        case 1:
+            a[0] = nan1();
+            break;
+        }
+        b.aabb[0] = a;
+        b.aabb[1] = a + s;
+        for (uint32 i = 0; i < 8; i++)
+        {
+            vec3 f((i >> 0) % 2, (i >> 1) % 2, (i >> 2) % 2);
+            b.corners[i] = a + s.cwiseProduct(f);
+        }
+        b.texelSize = size(rng) * 0.001;
+    }
+    return result;
+}
+
+double now()
+{
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+bool benchCulling(uint32 boxes)
+{
+    printf("culling: %u boxes\n", boxes);
+    const std::vector<Box> items = generate(boxes);
+    const uint32 iterations = 10;
+    uint32 mismatches = 0;
+
+    mat4 view = lookAt(vec3(1e4, 2e4, 3e4), vec3(0, 0, 0), vec3(0, 0, 1));
+    mat4 viewProj = perspectiveMatrix(60, 16.0 / 9, 100, 3e6) * view;
+    vec4 planes[6];
+    frustumPlanes(viewProj, planes);
+    vec3 up = vec3(0, 0, 1);
+
+    std::vector<const vec3 *> aabbs(items.size());
+    std::vector<const vec3 *> corners(items.size());
+    std::vector<double> scales(items.size());
+    for (uint32 i = 0; i < items.size(); i++)
+    {
+        aabbs[i] = items[i].aabb;
+        corners[i] = items[i].corners;
+        scales[i] = items[i].texelSize;
+    }
+
+    // frustum tests
+    {
+        std::unique_ptr<bool[]> expected(new bool[items.size()]);
+        std::unique_ptr<bool[]> results(new bool[items.size()]);
+        double t = now();
+        for (uint32 iter = 0; iter < iterations; iter++)
+            for (uint32 i = 0; i < items.size(); i++)
+                expected[i] = aabbTest(items[i].aabb, planes);
+        double scalar = (now() - t) / iterations;
+        t = now();
+        for (uint32 iter = 0; iter < iterations; iter++)
+        {
+            // batches of four, as the childs of a node
+            for (uint32 i = 0; i < items.size(); i += 4)
+                aabbTest(aabbs.data() + i,
+                    std::min<uint32>(4, items.size() - i),
+                    planes, results.get() + i);
+        }
+        double batched = (now() - t) / iterations;
+        uint32 visible = 0;
+        for (uint32 i = 0; i < items.size(); i++)
+        {
+            mismatches += expected[i] != results[i];
+            visible += expected[i];
+        }
+        printf("visible: %u\n", visible);
+        printf("frustum scalar:      %10.3f ms\n", scalar * 1000);
+        printf("frustum batched:     %10.3f ms\n", batched * 1000);
+    }
+
+    // coarseness
+    {
+        std::vector<double> expected(items.size());
+        std::vector<double> results(items.size());
+        double t = now();
+        for (uint32 iter = 0; iter < iterations; iter++)
+            for (uint32 i = 0; i < items.size(); i++)
+                expected[i] = cornersHeight(viewProj, items[i].corners,
+                                            up * items[i].texelSize);
+        double scalar = (now() - t) / iterations;
+        t = now();
+        for (uint32 iter = 0; iter < iterations; iter++)
+            cornersHeight(viewProj, corners.data(), items.size(),
+                          up, scales.data(), results.data());
+        double batched = (now() - t) / iterations;
+        for (uint32 i = 0; i < items.size(); i++)
+        {
+            // bitwise comparison, nans included
+            mismatches += std::memcmp(&expected[i], &results[i],
+                                      sizeof(double)) != 0;
+        }
+        printf("coarseness scalar:   %10.3f ms\n", scalar * 1000);
+        printf("coarseness batched:  %10.3f ms\n", batched * 1000);
+    }
+
+    if (mismatches)
+        printf("error: %u mismatched results\n", mismatches);
+    return mismatches == 0;
+}
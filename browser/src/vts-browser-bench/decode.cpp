@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+#include <vts-browser/resources.hpp>
+
+#include "bench.hpp"
+
+using namespace vts;
+
+namespace
+{
+
+double now()
+{
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void measure(const std::vector<Buffer> &images, const char *name,
+    const std::function<GpuTextureSpec(const Buffer &)> &decode)
+{
+    // best of several rounds to reduce noise
+    double best = 0;
+    uint64 pixels = 0;
+    for (uint32 round = 0; round < 3; round++)
+    {
+        pixels = 0;
+        double t = now();
+        for (const Buffer &b : images)
+        {
+            GpuTextureSpec spec = decode(b);
+            pixels += spec.width * spec.height;
+        }
+        double d = now() - t;
+        if (round == 0 || d < best)
+            best = d;
+    }
+    printf("%-18s %9.3f ms/image %9.2f images/s %9.2f MPix/s out\n",
+        name, best * 1e3 / images.size(), images.size() / best,
+        pixels / best * 1e-6);
+}
+
+} // namespace
+
+void benchDecode(const std::string &listPath)
+{
+    std::vector<Buffer> images;
+    {
+        std::ifstream f(listPath);
+        std::string line;
+        while (std::getline(f, line))
+        {
+            if (!line.empty())
+                images.push_back(readLocalFileBuffer(line));
+        }
+    }
+    if (images.empty())
+    {
+        printf("decode: no images listed in <%s>\n", listPath.c_str());
+        return;
+    }
+    printf("decode: %u images\n", (uint32)images.size());
+
+    measure(images, "full + flip", [](const Buffer &b) {
+        GpuTextureSpec spec(b);
+        spec.verticalFlip();
+        return spec;
+    });
+    for (uint32 scale : { 1, 2, 4, 8 })
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "bottom-up 1/%u", scale);
+        measure(images, name, [scale](const Buffer &b) {
+            return GpuTextureSpec(b, scale, true);
+        });
+    }
+}
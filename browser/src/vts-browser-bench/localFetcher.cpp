@@ -0,0 +1,237 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <vts-browser/log.hpp>
+#include <vts-browser/buffer.hpp>
+
+#include <random>
+
+#include "localFetcher.hpp"
+
+std::string urlToPath(const std::string &url)
+{
+    std::string s = url;
+    auto p = s.find("://");
+    if (p != std::string::npos)
+        s = s.substr(p + 3);
+    std::string res;
+    res.reserve(s.size() + 6);
+    for (char c : s)
+    {
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+            || (c >= '0' && c <= '9') || c == '.' || c == '-' || c == '/')
+            res += c;
+        else
+            res += '_';
+    }
+    while (res.find("..") != std::string::npos)
+        res.replace(res.find(".."), 2, "__");
+    if (res.empty() || res.back() == '/')
+        res += "index";
+    return res;
+}
+
+namespace
+{
+
+std::string contentType(const std::string &path)
+{
+    struct Ext
+    {
+        const char *ext;
+        const char *type;
+    };
+    static const Ext exts[] = {
+        { ".json", "application/json" },
+        { ".jpg", "image/jpeg" },
+        { ".jpeg", "image/jpeg" },
+        { ".png", "image/png" },
+        { ".bin", "application/octet-stream" },
+    };
+    for (const Ext &e : exts)
+    {
+        std::string x = e.ext;
+        if (path.size() >= x.size()
+            && path.compare(path.size() - x.size(), x.size(), x) == 0)
+            return e.type;
+    }
+    return "";
+}
+
+} // namespace
+
+LocalFetcher::LocalFetcher(const LocalFetcherOptions &options)
+    : options(options)
+{}
+
+LocalFetcher::~LocalFetcher()
+{
+    finalize();
+}
+
+void LocalFetcher::initialize()
+{
+    stop = false;
+    for (uint32 i = 0; i < std::max(options.threads, 1u); i++)
+        threads.emplace_back(&LocalFetcher::entry, this);
+}
+
+void LocalFetcher::finalize()
+{
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        stop = true;
+    }
+    con.notify_all();
+    for (std::thread &t : threads)
+        t.join();
+    threads.clear();
+}
+
+void LocalFetcher::fetch(const std::shared_ptr<vts::FetchTask> &task)
+{
+    Item item;
+    item.task = task;
+    item.due = Clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        uint32 latency = options.latency;
+        if (options.latencyJitter)
+        {
+            // deterministic jitter, independent of timing
+            std::minstd_rand rnd(counter++);
+            latency += rnd() % (options.latencyJitter + 1);
+        }
+        item.due += std::chrono::milliseconds(latency);
+        queue.push(item);
+    }
+    con.notify_one();
+}
+
+void LocalFetcher::entry()
+{
+    vts::setLogThreadName("local fetcher");
+    while (true)
+    {
+        std::shared_ptr<vts::FetchTask> task;
+        {
+            std::unique_lock<std::mutex> lock(mut);
+            while (!stop)
+            {
+                if (queue.empty())
+                    con.wait(lock);
+                else if (queue.top().due > Clock::now())
+                    con.wait_until(lock, queue.top().due);
+                else
+                    break;
+            }
+            if (stop)
+                return;
+            task = queue.top().task;
+            queue.pop();
+        }
+        process(task.get());
+    }
+}
+
+void LocalFetcher::process(vts::FetchTask *task)
+{
+    std::string path = options.root + "/" + urlToPath(task->query.url);
+    try
+    {
+        task->reply.content = vts::readLocalFileBuffer(path);
+        task->reply.contentType = contentType(path);
+        task->reply.code = 200;
+    }
+    catch (...)
+    {
+        task->reply.code = 404;
+    }
+    task->reply.expires = -1;
+    task->fetchDone();
+}
+
+namespace
+{
+
+class RecordingTask : public vts::FetchTask
+{
+public:
+    RecordingTask(const std::shared_ptr<vts::FetchTask> &task,
+        const std::string &root) :
+        vts::FetchTask(task->query), task(task), root(root)
+    {}
+
+    void fetchDone() override
+    {
+        if (reply.code == 200)
+        {
+            try
+            {
+                vts::writeLocalFileBuffer(root + "/"
+                    + urlToPath(query.url), reply.content);
+            }
+            catch (...)
+            {
+                vts::log(vts::LogLevel::warn3, "Failed to record <"
+                    + query.url + ">");
+            }
+        }
+        task->reply = std::move(reply);
+        task->fetchDone();
+    }
+
+private:
+    const std::shared_ptr<vts::FetchTask> task;
+    const std::string root;
+};
+
+} // namespace
+
+RecordingFetcher::RecordingFetcher(
+    const std::shared_ptr<vts::Fetcher> &fetcher, const std::string &root)
+    : fetcher(fetcher), root(root)
+{}
+
+void RecordingFetcher::initialize()
+{
+    fetcher->initialize();
+}
+
+void RecordingFetcher::finalize()
+{
+    fetcher->finalize();
+}
+
+void RecordingFetcher::update()
+{
+    fetcher->update();
+}
+
+void RecordingFetcher::fetch(const std::shared_ptr<vts::FetchTask> &task)
+{
+    fetcher->fetch(std::make_shared<RecordingTask>(task, root));
+}
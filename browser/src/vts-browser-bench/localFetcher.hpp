@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LOCALFETCHER_HPP_h4k2s9dvm1
+#define LOCALFETCHER_HPP_h4k2s9dvm1
+
+#include <vts-browser/fetcher.hpp>
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+struct LocalFetcherOptions
+{
+    // directory with the recorded resources
+    std::string root = "recording";
+
+    // simulated latency of each download, in milliseconds
+    uint32 latency = 0;
+    uint32 latencyJitter = 0;
+
+    uint32 threads = 4;
+};
+
+// path of the file, relative to the root, for the resource url
+std::string urlToPath(const std::string &url);
+
+// serves resources from a local directory, no network is involved
+class LocalFetcher : public vts::Fetcher
+{
+public:
+    explicit LocalFetcher(const LocalFetcherOptions &options);
+    ~LocalFetcher();
+
+    void initialize() override;
+    void finalize() override;
+    void fetch(const std::shared_ptr<vts::FetchTask> &task) override;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Item
+    {
+        Clock::time_point due;
+        std::shared_ptr<vts::FetchTask> task;
+        bool operator < (const Item &other) const
+        {
+            return due > other.due; // earliest first
+        }
+    };
+
+    void entry();
+    void process(vts::FetchTask *task);
+
+    const LocalFetcherOptions options;
+    std::priority_queue<Item> queue;
+    std::vector<std::thread> threads;
+    std::mutex mut;
+    std::condition_variable con;
+    uint32 counter = 0;
+    bool stop = false;
+};
+
+// downloads the resources with another fetcher
+//   and stores them in a directory for later use with LocalFetcher
+class RecordingFetcher : public vts::Fetcher
+{
+public:
+    RecordingFetcher(const std::shared_ptr<vts::Fetcher> &fetcher,
+        const std::string &root);
+
+    void initialize() override;
+    void finalize() override;
+    void update() override;
+    void fetch(const std::shared_ptr<vts::FetchTask> &task) override;
+
+private:
+    const std::shared_ptr<vts::Fetcher> fetcher;
+    const std::string root;
+};
+
+#endif
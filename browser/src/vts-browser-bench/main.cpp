@@ -0,0 +1,626 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <vts-browser/log.hpp>
+#include <vts-browser/map.hpp>
+#include <vts-browser/mapOptions.hpp>
+#include <vts-browser/mapCallbacks.hpp>
+#include <vts-browser/mapStatistics.hpp>
+#include <vts-browser/camera.hpp>
+#include <vts-browser/cameraOptions.hpp>
+#include <vts-browser/cameraStatistics.hpp>
+#include <vts-browser/navigation.hpp>
+#include <vts-browser/navigationOptions.hpp>
+#include <vts-browser/position.hpp>
+#include <vts-browser/resources.hpp>
+#include <vts-browser/geodata.hpp>
+#include <vts-browser/fetcher.hpp>
+#include <vts-browser/boostProgramOptions.hpp>
+
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#include "localFetcher.hpp"
+#include "bench.hpp"
+
+namespace po = boost::program_options;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+struct BenchOptions
+{
+    std::string mapconfig;
+    std::string script;
+    std::string csv;
+    std::string record;
+    LocalFetcherOptions fetcher;
+    uint32 width = 1920;
+    uint32 height = 1080;
+    uint32 maxSettleFrames = 3000;
+    uint32 queueProducers = 0;
+    uint32 queueItems = 100000;
+    uint32 collisionLabels = 0;
+    uint32 cullingBoxes = 0;
+    uint32 traversalLods = 0;
+    std::string compressionImage;
+    std::string decodeList;
+    bool batchUploads = false;
+};
+
+struct Keyframe
+{
+    vts::Position position;
+    uint32 frames = 0; // transition from the previous keyframe
+};
+
+struct KeyframeResult
+{
+    uint32 frames = 0;
+    double seconds = 0;
+    bool complete = false;
+};
+
+double seconds(Clock::time_point a, Clock::time_point b)
+{
+    return std::chrono::duration<double>(b - a).count();
+}
+
+double percentile(std::vector<double> v, double p)
+{
+    if (v.empty())
+        return 0;
+    std::sort(v.begin(), v.end());
+    uint32 i = std::min<uint32>(v.size() - 1, (uint32)(p * v.size()));
+    return v[i];
+}
+
+std::vector<Keyframe> loadScript(const std::string &path)
+{
+    std::vector<Keyframe> res;
+    std::ifstream f(path);
+    if (!f)
+        throw std::runtime_error("Failed to open script <" + path + ">");
+    std::string line;
+    while (std::getline(f, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream ss(line);
+        Keyframe k;
+        std::string pos;
+        ss >> k.frames >> pos;
+        if (pos.empty())
+            throw std::runtime_error("Invalid script line <" + line + ">");
+        k.position = vts::Position(pos);
+        res.push_back(k);
+    }
+    return res;
+}
+
+vts::Position interpolate(const vts::Position &a,
+    const vts::Position &b, double t)
+{
+    vts::Position r = b;
+    for (int i = 0; i < 3; i++)
+    {
+        r.point[i] = a.point[i] + (b.point[i] - a.point[i]) * t;
+        double d = b.orientation[i] - a.orientation[i];
+        d -= 360 * std::round(d / 360); // shortest rotation
+        r.orientation[i] = a.orientation[i] + d * t;
+    }
+    r.viewExtent = a.viewExtent + (b.viewExtent - a.viewExtent) * t;
+    r.fov = a.fov + (b.fov - a.fov) * t;
+    return r;
+}
+
+void headlessCallbacks(vts::MapCallbacks &c, bool batched)
+{
+    // no gpu, the resources only report their sizes
+    c.loadTexture = [](vts::ResourceInfo &info, vts::GpuTextureSpec &spec,
+        const std::string &) {
+        info.userData = std::make_shared<uint32>(0);
+        info.gpuMemoryCost = spec.buffer.size();
+    };
+    c.loadMesh = [](vts::ResourceInfo &info, vts::GpuMeshSpec &spec,
+        const std::string &) {
+        info.userData = std::make_shared<uint32>(0);
+        info.gpuMemoryCost = spec.vertices.size() + spec.indices.size();
+    };
+    if (batched)
+    {
+        c.loadTextures = [](const std::vector<vts::GpuTextureUpload> &items) {
+            for (const auto &it : items)
+            {
+                it.info->userData = std::make_shared<uint32>(0);
+                it.info->gpuMemoryCost = it.spec->buffer.size();
+            }
+        };
+        c.loadMeshes = [](const std::vector<vts::GpuMeshUpload> &items) {
+            for (const auto &it : items)
+            {
+                it.info->userData = std::make_shared<uint32>(0);
+                it.info->gpuMemoryCost = it.spec->vertices.size()
+                    + it.spec->indices.size();
+            }
+        };
+    }
+    c.loadFont = [](vts::ResourceInfo &info, vts::GpuFontSpec &,
+        const std::string &) {
+        info.userData = std::make_shared<uint32>(0);
+    };
+    c.loadGeodata = [](vts::ResourceInfo &info, vts::GpuGeodataSpec &,
+        const std::string &) {
+        info.userData = std::make_shared<uint32>(0);
+    };
+}
+
+class Bench
+{
+public:
+    Bench(vts::Map &map, vts::Camera &cam, vts::Navigation &nav,
+        const BenchOptions &options) :
+        map(map), cam(cam), nav(nav), options(options)
+    {
+        if (!options.csv.empty())
+        {
+            csv.open(options.csv);
+            csv << "frame,keyframe,mapUpdateMs,cameraUpdateMs,"
+                "nodesRendered,metaNodesTraversed,"
+                "resourcesActive,resourcesPreparing,resourcesDownloading,"
+                "resourcesDecoded,queueCacheRead,queueCacheWrite,"
+                "queueDownload,queueDecode,queueUpload,queueGeodata,"
+                "ramMemKB,gpuMemKB,complete\n";
+        }
+    }
+
+    // returns whether the map finished rendering
+    bool frame(uint32 keyframe)
+    {
+        auto a = Clock::now();
+        map.renderUpdate(1.0 / 60);
+        auto b = Clock::now();
+        cam.renderUpdate();
+        auto c = Clock::now();
+        bool complete = map.getMapRenderComplete();
+
+        double mapMs = seconds(a, b) * 1000;
+        double camMs = seconds(b, c) * 1000;
+        mapTimes.push_back(mapMs);
+        camTimes.push_back(camMs);
+
+        const vts::MapStatistics &ms = map.statistics();
+        const vts::CameraStatistics &cs = cam.statistics();
+        maxQueueDecode = std::max(maxQueueDecode, ms.resourcesQueueDecode);
+        maxQueueUpload = std::max(maxQueueUpload, ms.resourcesQueueUpload);
+        maxQueueDownload = std::max(maxQueueDownload,
+            ms.resourcesQueueDownload);
+        if (csv.is_open())
+        {
+            csv << frames << ',' << keyframe << ','
+                << mapMs << ',' << camMs << ','
+                << cs.nodesRenderedTotal << ','
+                << cs.metaNodesTraversedTotal << ','
+                << ms.resourcesActive << ','
+                << ms.resourcesPreparing << ','
+                << ms.resourcesDownloading << ','
+                << ms.resourcesDecoded << ','
+                << ms.resourcesQueueCacheRead << ','
+                << ms.resourcesQueueCacheWrite << ','
+                << ms.resourcesQueueDownload << ','
+                << ms.resourcesQueueDecode << ','
+                << ms.resourcesQueueUpload << ','
+                << ms.resourcesQueueGeodata << ','
+                << ms.currentRamMemUseKB << ','
+                << ms.currentGpuMemUseKB << ','
+                << complete << '\n';
+        }
+        frames++;
+        return complete;
+    }
+
+    // waits until the current view is fully rendered
+    KeyframeResult settle(uint32 keyframe, Clock::time_point start)
+    {
+        KeyframeResult r;
+        while (r.frames < options.maxSettleFrames)
+        {
+            r.frames++;
+            if (frame(keyframe))
+            {
+                r.complete = true;
+                break;
+            }
+            std::this_thread::yield();
+        }
+        r.seconds = seconds(start, Clock::now());
+        return r;
+    }
+
+    void run(const std::vector<Keyframe> &script)
+    {
+        auto start = Clock::now();
+
+        // wait for the mapconfig
+        while (!map.getMapconfigReady())
+        {
+            frame(0);
+            if (seconds(start, Clock::now()) > 60)
+                throw std::runtime_error("Mapconfig was not loaded");
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        mapconfigSeconds = seconds(start, Clock::now());
+
+        if (script.empty())
+            results.push_back(settle(0, Clock::now()));
+        for (uint32 i = 0; i < script.size(); i++)
+        {
+            auto kfStart = Clock::now();
+            const Keyframe &k = script[i];
+            if (i == 0 || k.frames == 0)
+                nav.setPosition(k.position);
+            else
+            {
+                const vts::Position &p = script[i - 1].position;
+                for (uint32 f = 1; f <= k.frames; f++)
+                {
+                    nav.setPosition(interpolate(p, k.position,
+                        (double)f / k.frames));
+                    frame(i);
+                }
+            }
+            results.push_back(settle(i, kfStart));
+        }
+
+        totalSeconds = seconds(start, Clock::now());
+    }
+
+    void report()
+    {
+        const vts::MapStatistics &ms = map.statistics();
+        printf("mapconfig ready: %.3f s\n", mapconfigSeconds);
+        for (uint32 i = 0; i < results.size(); i++)
+        {
+            const KeyframeResult &r = results[i];
+            printf("keyframe %u: %s after %u frames, %.3f s\n", i,
+                r.complete ? "complete" : "incomplete",
+                r.frames, r.seconds);
+        }
+        printf("frames: %u, total: %.3f s\n", frames, totalSeconds);
+        printf("renderUpdate (ms): map p50 %.3f p95 %.3f max %.3f,"
+            " camera p50 %.3f p95 %.3f max %.3f\n",
+            percentile(mapTimes, 0.5), percentile(mapTimes, 0.95),
+            percentile(mapTimes, 1), percentile(camTimes, 0.5),
+            percentile(camTimes, 0.95), percentile(camTimes, 1));
+        double busy = 0;
+        for (uint32 i = 0; i < ms.decodeThreads; i++)
+            busy += ms.decodeThreadsBusyTimeMs[i] * 1e-3;
+        printf("decoded: %u resources, %.1f per second,"
+            " %.3f s busy in %u threads\n", ms.resourcesDecoded,
+            ms.resourcesDecoded / std::max(totalSeconds, 1e-6),
+            busy, ms.decodeThreads);
+        printf("resources: created %u, downloaded %u, disk loaded %u,"
+            " failed %u, released %u\n", ms.resourcesCreated,
+            ms.resourcesDownloaded, ms.resourcesDiskLoaded,
+            ms.resourcesFailed, ms.resourcesReleased);
+        printf("max queues: download %u, decode %u, upload %u\n",
+            maxQueueDownload, maxQueueDecode, maxQueueUpload);
+        printf("memory: ram %u KB, gpu %u KB\n",
+            ms.currentRamMemUseKB, ms.currentGpuMemUseKB);
+    }
+
+private:
+    vts::Map &map;
+    vts::Camera &cam;
+    vts::Navigation &nav;
+    const BenchOptions &options;
+    std::ofstream csv;
+    std::vector<double> mapTimes, camTimes;
+    std::vector<KeyframeResult> results;
+    double mapconfigSeconds = 0;
+    double totalSeconds = 0;
+    uint32 frames = 0;
+    uint32 maxQueueDecode = 0;
+    uint32 maxQueueUpload = 0;
+    uint32 maxQueueDownload = 0;
+};
+
+bool programOptions(vts::MapCreateOptions &createOptions,
+    vts::MapRuntimeOptions &mapOptions,
+    vts::FetcherOptions &fetcherOptions,
+    vts::CameraOptions &camOptions,
+    vts::NavigationOptions &navOptions,
+    BenchOptions &benchOptions,
+    int argc, char *argv[])
+{
+    po::options_description desc("Options");
+    desc.add_options()
+            ("help", "Show this help.")
+            ("url",
+                po::value<std::string>(&benchOptions.mapconfig),
+                "Mapconfig URL."
+            )
+            ("script",
+                po::value<std::string>(&benchOptions.script),
+                "Camera path. Each line contains number of frames "
+                "for the transition from the previous line "
+                "and position in url format, eg.:\n"
+                "120 obj,long,lat,fix,height,pitch,yaw,roll,extent,fov\n"
+                "Empty lines and lines starting with # are ignored."
+            )
+            ("csv",
+                po::value<std::string>(&benchOptions.csv),
+                "Write per-frame statistics to this file."
+            )
+            ("recording",
+                po::value<std::string>(&benchOptions.fetcher.root)
+                ->default_value(benchOptions.fetcher.root),
+                "Directory with recorded resources."
+            )
+            ("record",
+                po::value<std::string>(&benchOptions.record),
+                "Download the resources from network and store them "
+                "into this directory."
+            )
+            ("latency",
+                po::value<uint32>(&benchOptions.fetcher.latency)
+                ->default_value(benchOptions.fetcher.latency),
+                "Simulated latency of each download, in milliseconds."
+            )
+            ("latencyJitter",
+                po::value<uint32>(&benchOptions.fetcher.latencyJitter)
+                ->default_value(benchOptions.fetcher.latencyJitter),
+                "Maximum random latency added to each download."
+            )
+            ("localThreads",
+                po::value<uint32>(&benchOptions.fetcher.threads)
+                ->default_value(benchOptions.fetcher.threads),
+                "Number of threads serving the recorded resources."
+            )
+            ("batchUploads",
+                po::value<bool>(&benchOptions.batchUploads)
+                ->default_value(benchOptions.batchUploads)
+                ->implicit_value(!benchOptions.batchUploads),
+                "Use the batched texture and mesh upload callbacks."
+            )
+            ("width",
+                po::value<uint32>(&benchOptions.width)
+                ->default_value(benchOptions.width),
+                "Viewport width."
+            )
+            ("height",
+                po::value<uint32>(&benchOptions.height)
+                ->default_value(benchOptions.height),
+                "Viewport height."
+            )
+            ("maxSettleFrames",
+                po::value<uint32>(&benchOptions.maxSettleFrames)
+                ->default_value(benchOptions.maxSettleFrames),
+                "Maximum number of frames to wait for each "
+                "keyframe to render completely."
+            )
+            ("queues",
+                po::value<uint32>(&benchOptions.queueProducers)
+                ->implicit_value(25),
+                "Only run the queues microbenchmark "
+                "with this many producers."
+            )
+            ("queueItems",
+                po::value<uint32>(&benchOptions.queueItems)
+                ->default_value(benchOptions.queueItems),
+                "Items pushed by each producer in the queues microbenchmark."
+            )
+            ("collisions",
+                po::value<uint32>(&benchOptions.collisionLabels)
+                ->implicit_value(8000),
+                "Only run the label collisions microbenchmark "
+                "with this many labels."
+            )
+            ("culling",
+                po::value<uint32>(&benchOptions.cullingBoxes)
+                ->implicit_value(100000),
+                "Only run the frustum and coarseness tests microbenchmark "
+                "with this many boxes."
+            )
+            ("traversal",
+                po::value<uint32>(&benchOptions.traversalLods)
+                ->implicit_value(8),
+                "Only run the concurrent traversal microbenchmark "
+                "on a quadtree down to this lod."
+            )
+            ("compression",
+                po::value<std::string>(&benchOptions.compressionImage)
+                ->implicit_value("synthetic"),
+                "Only run the texture compression microbenchmark "
+                "on this jpg or png image (or a synthetic one)."
+            )
+            ("decode",
+                po::value<std::string>(&benchOptions.decodeList),
+                "Only run the image decoding microbenchmark "
+                "on the images listed in this file (one path per line)."
+            )
+            ;
+
+    po::positional_options_description popts;
+    popts.add("url", 1);
+
+    vts::optionsConfigLog(desc);
+    vts::optionsConfigMapCreate(desc, &createOptions);
+    vts::optionsConfigMapRuntime(desc, &mapOptions);
+    vts::optionsConfigCamera(desc, &camOptions);
+    vts::optionsConfigNavigation(desc, &navOptions);
+    vts::optionsConfigFetcherOptions(desc, &fetcherOptions);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).
+          options(desc).positional(popts).run(), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        std::cout << "Usage: " << argv[0] << " [options] [--] url"
+                  << std::endl << desc << std::endl;
+        return false;
+    }
+
+    if (benchOptions.mapconfig.empty() && !benchOptions.queueProducers
+        && !benchOptions.collisionLabels && !benchOptions.cullingBoxes
+        && !benchOptions.traversalLods
+        && benchOptions.compressionImage.empty()
+        && benchOptions.decodeList.empty())
+    {
+        std::cout << "Mapconfig url is required" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        vts::setLogThreadName("main");
+        vts::setLogMask("W2E2");
+
+        vts::MapCreateOptions createOptions;
+        createOptions.clientId = "vts-browser-bench";
+        createOptions.diskCache = false; // measure the whole pipeline
+        vts::MapRuntimeOptions mapOptions;
+        mapOptions.targetResourcesMemoryKB = 512 * 1024;
+        vts::FetcherOptions fetcherOptions;
+        vts::CameraOptions camOptions;
+        vts::NavigationOptions navOptions;
+        navOptions.type = vts::NavigationType::Instant;
+        BenchOptions benchOptions;
+        if (!programOptions(createOptions, mapOptions, fetcherOptions,
+                            camOptions, navOptions, benchOptions, argc, argv))
+            return 0;
+
+        if (benchOptions.queueProducers)
+        {
+            benchQueues(benchOptions.queueProducers, benchOptions.queueItems);
+            return 0;
+        }
+
+        if (benchOptions.collisionLabels)
+        {
+            if (!benchCollisions(benchOptions.collisionLabels,
+                benchOptions.width, benchOptions.height))
+                return 1;
+            return 0;
+        }
+
+        if (benchOptions.cullingBoxes)
+        {
+            if (!benchCulling(benchOptions.cullingBoxes))
+                return 1;
+            return 0;
+        }
+
+        if (benchOptions.traversalLods)
+        {
+            if (!benchTraversal(benchOptions.traversalLods))
+                return 1;
+            return 0;
+        }
+
+        if (!benchOptions.compressionImage.empty())
+        {
+            benchCompression(benchOptions.compressionImage);
+            return 0;
+        }
+
+        if (!benchOptions.decodeList.empty())
+        {
+            benchDecode(benchOptions.decodeList);
+            return 0;
+        }
+
+        std::vector<Keyframe> script;
+        if (!benchOptions.script.empty())
+            script = loadScript(benchOptions.script);
+
+        std::shared_ptr<vts::Fetcher> fetcher;
+        if (benchOptions.record.empty())
+            fetcher = std::make_shared<LocalFetcher>(benchOptions.fetcher);
+        else
+        {
+            fetcher = std::make_shared<RecordingFetcher>(
+                vts::Fetcher::create(fetcherOptions), benchOptions.record);
+        }
+
+        vts::Map map(createOptions, fetcher);
+        map.options() = mapOptions;
+        headlessCallbacks(map.callbacks(), benchOptions.batchUploads);
+        bool ok = true;
+        std::thread dataThread([&]() {
+            vts::setLogThreadName("data");
+            map.dataAllRun();
+        });
+        {
+            auto cam = map.createCamera();
+            auto nav = cam->createNavigation();
+            cam->options() = camOptions;
+            nav->options() = navOptions;
+            cam->setViewportSize(benchOptions.width, benchOptions.height);
+            map.setMapconfigPath(benchOptions.mapconfig);
+            Bench bench(map, *cam, *nav, benchOptions);
+            try
+            {
+                bench.run(script);
+                bench.report();
+            }
+            catch (const std::exception &e)
+            {
+                std::stringstream s;
+                s << "Exception <" << e.what() << ">";
+                vts::log(vts::LogLevel::err4, s.str());
+                ok = false;
+            }
+        }
+        map.renderFinalize();
+        dataThread.join();
+        return ok ? 0 : 1;
+    }
+    catch(const std::exception &e)
+    {
+        std::stringstream s;
+        s << "Exception <" << e.what() << ">";
+        vts::log(vts::LogLevel::err4, s.str());
+        return 1;
+    }
+}
@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <chrono>
+#include <string>
+
+#include "bench.hpp"
+#include "../vts-libbrowser/utilities/threadQueue.hpp"
+
+namespace
+{
+
+// payload similar to CacheData
+struct Payload
+{
+    std::string name;
+    uint64 value = 0;
+};
+
+template<class Queue>
+double run(Queue &q, uint32 producers, uint32 items)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> thrs;
+    for (uint32 p = 0; p < producers; p++)
+    {
+        thrs.emplace_back([&q, p, items]() {
+            for (uint32 i = 0; i < items; i++)
+            {
+                Payload d;
+                d.name = "resource";
+                d.value = (uint64)p * items + i;
+                while (!q.push(std::move(d)))
+                    std::this_thread::yield();
+            }
+        });
+    }
+    uint64 sum = 0;
+    uint64 total = (uint64)producers * items;
+    for (uint64 i = 0; i < total; i++)
+    {
+        Payload d;
+        q.waitPop(d);
+        sum += d.value;
+    }
+    for (std::thread &t : thrs)
+        t.join();
+    double duration = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    if (sum != total * (total - 1) / 2)
+        printf("error: lost items\n");
+    return total / duration;
+}
+
+// adapts ThreadQueue to the bounded interface
+template<class T>
+class UnboundedQueue : public vts::ThreadQueue<T>
+{
+public:
+    bool push(T &&v)
+    {
+        vts::ThreadQueue<T>::push(std::move(v));
+        return true;
+    }
+};
+
+} // namespace
+
+void benchQueues(uint32 producers, uint32 items)
+{
+    printf("queues: %u producers, %u items each\n", producers, items);
+    {
+        UnboundedQueue<Payload> q;
+        double r = run(q, producers, items);
+        printf("ThreadQueue:     %10.0f items/s\n", r);
+    }
+    {
+        vts::ThreadRingQueue<Payload> q;
+        double r = run(q, producers, items);
+        printf("ThreadRingQueue: %10.0f items/s\n", r);
+    }
+}
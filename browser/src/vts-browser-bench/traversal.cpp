@@ -0,0 +1,347 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../vts-libbrowser/utilities/taskPool.hpp"
+
+#include "bench.hpp"
+
+using namespace vts;
+
+namespace
+{
+
+// a model of the traversal of a full quadtree
+//   each node looks up its resources by name (the first frame creates them),
+//   converts its corners (determine, the first frame only)
+//   and touches its resources for the eviction (every frame)
+
+struct Resource
+{
+    std::atomic<uint32> lastAccessTick {0};
+    std::list<Resource *>::iterator it;
+    bool linked = false;
+};
+
+typedef std::vector<Resource *> Touches;
+
+thread_local Touches *currentTouches = nullptr;
+
+struct Node
+{
+    uint32 lod = 0, x = 0, y = 0;
+    Resource *resources[3] = {};
+    std::vector<std::unique_ptr<Node>> childs;
+};
+
+struct Task
+{
+    Touches touches;
+    uint64 checksum = 0;
+    uint32 nodes = 0;
+
+    void merge(Task &other)
+    {
+        touches.insert(touches.end(),
+            other.touches.begin(), other.touches.end());
+        other.touches.clear();
+        checksum ^= other.checksum;
+        nodes += other.nodes;
+    }
+};
+
+enum class Mode
+{
+    GlobalLock, // the whole determine step and the touches locked
+    Buffered, // lookups locked, touches collected in the tasks
+};
+
+class Traversal
+{
+public:
+    Traversal(TaskPool &pool, Mode mode, uint32 forkLod, uint32 maxLod)
+        : pool(pool), mode(mode), forkLod(forkLod), maxLod(maxLod)
+    {}
+
+    std::unordered_map<std::string, std::unique_ptr<Resource>> resources;
+    std::list<Resource *> lru;
+    std::mutex resourcesMut;
+    std::recursive_mutex globalMut;
+    TaskPool &pool;
+    const Mode mode;
+    const uint32 forkLod; // nodes above this lod fork their childs
+    const uint32 maxLod;
+    uint32 tick = 0;
+    uint32 lruTouches = 0;
+
+    void lruTouch(Resource *r)
+    {
+        if (r->linked)
+            lru.splice(lru.begin(), lru, r->it);
+        else
+        {
+            lru.push_front(r);
+            r->it = lru.begin();
+            r->linked = true;
+        }
+        lruTouches++;
+    }
+
+    void touch(Resource *r)
+    {
+        if (mode == Mode::GlobalLock)
+        {
+            std::lock_guard<std::recursive_mutex> lock(globalMut);
+            if (r->lastAccessTick == tick)
+                return;
+            r->lastAccessTick = tick;
+            lruTouch(r);
+            return;
+        }
+        if (r->lastAccessTick.exchange(tick) == tick)
+            return;
+        if (currentTouches)
+            currentTouches->push_back(r);
+        else
+            lruTouch(r);
+    }
+
+    Resource *get(const std::string &name)
+    {
+        Resource *r = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(resourcesMut);
+            auto &p = resources[name];
+            if (!p)
+                p = std::make_unique<Resource>();
+            r = p.get();
+        }
+        touch(r);
+        return r;
+    }
+
+    uint64 determine(Task &out, Node *n)
+    {
+        std::unique_lock<std::recursive_mutex> lock(globalMut,
+            std::defer_lock);
+        if (mode == Mode::GlobalLock)
+            lock.lock();
+
+        // the metatile is shared by the nodes of a metatile
+        char name[64];
+        uint32 ml = n->lod - n->lod % 5;
+        uint32 ms = n->lod - ml;
+        snprintf(name, sizeof(name), "meta-%u-%u-%u",
+            ml, n->x >> ms, n->y >> ms);
+        n->resources[0] = get(name);
+        snprintf(name, sizeof(name), "mesh-%u-%u-%u", n->lod, n->x, n->y);
+        n->resources[1] = get(name);
+        snprintf(name, sizeof(name), "tex-%u-%u-%u", n->lod, n->x, n->y);
+        n->resources[2] = get(name);
+
+        // geographic to geocentric conversion of 8 corners and 3 disk points
+        static const double deg = 3.14159265358979323846 / 180;
+        double size = 360.0 / (1u << n->lod);
+        uint64 h = 0;
+        for (uint32 i = 0; i < 11; i++)
+        {
+            double lon = (n->x + (i >> 0) % 2) * size - 180;
+            double lat = (n->y + (i >> 1) % 2) * size * 0.5 - 90;
+            double alt = (i >> 2) % 2 * 1000.0;
+            double a = 6378137, e2 = 0.00669437999014;
+            double sl = std::sin(lat * deg);
+            double cl = std::cos(lat * deg);
+            double nn = a / std::sqrt(1 - e2 * sl * sl);
+            double p[3] = {
+                (nn + alt) * cl * std::cos(lon * deg),
+                (nn + alt) * cl * std::sin(lon * deg),
+                (nn * (1 - e2) + alt) * sl };
+            for (double d : p)
+            {
+                uint64 b;
+                std::memcpy(&b, &d, sizeof(b));
+                h = h * 1099511628211ull + b;
+            }
+        }
+
+        // prepare children
+        if (n->lod < maxLod)
+        {
+            for (uint32 i = 0; i < 4; i++)
+            {
+                std::unique_ptr<Node> c = std::make_unique<Node>();
+                c->lod = n->lod + 1;
+                c->x = n->x * 2 + i % 2;
+                c->y = n->y * 2 + i / 2;
+                n->childs.push_back(std::move(c));
+            }
+        }
+        out.nodes++;
+        return h;
+    }
+
+    void traverse(Task &out, Node *n, bool first)
+    {
+        if (first)
+            out.checksum ^= determine(out, n);
+        else
+        {
+            for (Resource *r : n->resources)
+                touch(r);
+            out.nodes++;
+        }
+        if (n->childs.empty())
+            return;
+        if (n->lod >= forkLod)
+        {
+            for (auto &c : n->childs)
+                traverse(out, c.get(), first);
+            return;
+        }
+        Task tasks[4];
+        pool.run(4, [&](uint32 i) {
+            Touches *previous = currentTouches;
+            currentTouches = &tasks[i].touches;
+            traverse(tasks[i], n->childs[i].get(), first);
+            currentTouches = previous;
+        });
+        for (Task &t : tasks)
+            out.merge(t);
+    }
+
+    // returns the frame time in seconds
+    double frame(Node *root, bool first, Task &result)
+    {
+        auto a = std::chrono::steady_clock::now();
+        tick++;
+        Task task;
+        {
+            Touches *previous = currentTouches;
+            currentTouches = &task.touches;
+            traverse(task, root, first);
+            currentTouches = previous;
+        }
+        for (Resource *r : task.touches)
+            lruTouch(r);
+        task.touches.clear();
+        auto b = std::chrono::steady_clock::now();
+        result = std::move(task);
+        return std::chrono::duration<double>(b - a).count();
+    }
+};
+
+struct Result
+{
+    double first = 0; // seconds
+    double touches = 0; // seconds, average of the other frames
+    uint64 checksum = 0;
+    uint32 nodes = 0;
+    bool consistent = true;
+};
+
+Result run(TaskPool &pool, Mode mode, uint32 forkLod, uint32 maxLod)
+{
+    const uint32 frames = 10;
+    Traversal t(pool, mode, forkLod, maxLod);
+    Node root;
+    Result res;
+    Task task;
+    res.first = t.frame(&root, true, task);
+    res.checksum = task.checksum;
+    res.nodes = task.nodes;
+    res.consistent = t.lruTouches == t.resources.size();
+    for (uint32 i = 0; i < frames; i++)
+    {
+        t.lruTouches = 0;
+        res.touches += t.frame(&root, false, task) / frames;
+        // every resource is touched exactly once per frame
+        res.consistent = res.consistent && task.nodes == res.nodes
+            && t.lruTouches == t.resources.size()
+            && t.lru.size() == t.resources.size();
+    }
+    return res;
+}
+
+} // namespace
+
+bool benchTraversal(uint32 maxLod)
+{
+    uint32 threads = std::max(std::thread::hardware_concurrency(), 1u);
+    printf("traversal: down to lod %u, %u threads\n", maxLod, threads);
+    TaskPool pool;
+    std::vector<std::thread> workers;
+    for (uint32 i = 1; i < threads; i++)
+        workers.push_back(std::thread([&]() { pool.workerEntry(); }));
+
+    struct Variant
+    {
+        const char *name;
+        Mode mode;
+        uint32 forkLod;
+    };
+    static const Variant variants[] = {
+        { "sequential", Mode::Buffered, 0 },
+        { "global lock, forks at root", Mode::GlobalLock, 1 },
+        { "global lock, forks to lod 5", Mode::GlobalLock, 6 },
+        { "buffered, forks at root", Mode::Buffered, 1 },
+        { "buffered, forks to lod 5", Mode::Buffered, 6 },
+    };
+    uint32 mismatches = 0;
+    Result reference;
+    for (const Variant &v : variants)
+    {
+        Result r = run(pool, v.mode, v.forkLod, maxLod);
+        if (&v == variants)
+            reference = r;
+        bool ok = r.consistent && r.checksum == reference.checksum
+            && r.nodes == reference.nodes;
+        mismatches += !ok;
+        printf("%-30s first %10.3f ms, touches %10.3f ms%s\n", v.name,
+            r.first * 1000, r.touches * 1000, ok ? "" : " MISMATCH");
+    }
+    printf("nodes: %u\n", reference.nodes);
+
+    pool.terminate();
+    for (std::thread &t : workers)
+        t.join();
+
+    if (mismatches)
+        printf("error: %u mismatched results\n", mismatches);
+    return mismatches == 0;
+}
@@ -218,6 +218,7 @@ void applyRenderOptions(const std::string &json, renderer::RenderOptions &opt)
             AJ(renderPolygonEdges, asBool);
             AJ(geodataHysteresis, asBool);
             AJ(debugDepthFeedback, asBool);
+            AJ(batchSurfaces, asBool);
         }
     };
     T t = (T&)opt;
@@ -239,6 +240,7 @@ std::string getRenderOptions(const renderer::RenderOptions &opt)
             TJ(renderPolygonEdges, asBool);
             TJ(geodataHysteresis, asBool);
             TJ(debugDepthFeedback, asBool);
+            TJ(batchSurfaces, asBool);
             return jsonToString(v);
         }
     };
@@ -53,12 +53,16 @@ namespace vts
         [MarshalAs(UnmanagedType.R4)] public float blendingCoverage;
         [MarshalAs(UnmanagedType.I1)] public bool externalUv;
         [MarshalAs(UnmanagedType.I1)] public bool flatShading;
+        public IntPtr meshPtr;
+        public IntPtr texColorPtr;
+        public IntPtr texMaskPtr;
     }
 
     [StructLayout(LayoutKind.Sequential)]
     public struct DrawColliderBase
     {
         [MarshalAs(UnmanagedType.ByValArray, SizeConst = 16)] public float[] mv;
+        public IntPtr meshPtr;
     }
 
     public struct DrawSurfaceTask
@@ -104,6 +104,19 @@ public static extern void vtsCameraSuggestedNearFar(IntPtr cam, ref double near_
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern void vtsCameraRenderUpdate(IntPtr cam);
 
+[DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
+public static extern IntPtr vtsCameraSurfaceAltitudes(IntPtr cam, IntPtr points, uint count, double sampleSize);
+
+[DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
+public static extern void vtsAltitudesDestroy(IntPtr altitudes);
+
+[DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
+[return: MarshalAs(UnmanagedType.I1)]
+public static extern bool vtsAltitudesGetDone(IntPtr altitudes);
+
+[DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
+public static extern IntPtr vtsAltitudesGetResults(IntPtr altitudes);
+
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern IntPtr vtsCameraGetCredits(IntPtr cam);
 
@@ -398,6 +411,9 @@ public static extern uint vtsTextureGetType(IntPtr resource);
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern uint vtsTextureGetInternalFormat(IntPtr resource);
 
+[DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
+public static extern uint vtsTextureGetMipmapLevels(IntPtr resource);
+
 [DllImport(LibName, CallingConvention = CallingConvention.Cdecl)]
 public static extern uint vtsTextureGetFilterMode(IntPtr resource);
 
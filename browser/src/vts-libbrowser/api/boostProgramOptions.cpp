@@ -112,6 +112,31 @@ void optionsConfigMapCreate(
         ->implicit_value(!opts->diskCache),
         "Use disk cache.")
 
+    ((section + "packedCache").c_str(),
+        po::value<bool>(&opts->packedCache)
+        ->implicit_value(!opts->packedCache),
+        "Store disk cache in few large segment files.")
+
+    ((section + "packedCacheSizeLimitMB").c_str(),
+        po::value<uint32>(&opts->packedCacheSizeLimitMB),
+        "Maximum size (in MB) of the packed disk cache.")
+
+    ((section + "decodeThreads").c_str(),
+        po::value<uint32>(&opts->decodeThreads),
+        "Number of threads that decode resources, "
+        "0 to use half of the available hardware threads.")
+
+    ((section + "geodataThreads").c_str(),
+        po::value<uint32>(&opts->geodataThreads),
+        "Number of threads that process geodata, "
+        "0 to use half of the available hardware threads.")
+
+    ((section + "traverseThreads").c_str(),
+        po::value<uint32>(&opts->traverseThreads),
+        "Number of threads that traverse the map layers, "
+        "including the rendering thread, "
+        "0 to use half of the available hardware threads.")
+
     FILE_OPTIONS;
 }
 
@@ -133,6 +158,16 @@ void optionsConfigMapRuntime(
         "Target memory (in KB) used by resources "
         "before they begin to unload.")
 
+    ((section + "targetResourcesRamMemoryKB").c_str(),
+        po::value<uint32>(&opts->targetResourcesRamMemoryKB),
+        "Target ram memory (in KB) used by resources "
+        "before they begin to unload. Zero to disable.")
+
+    ((section + "targetResourcesGpuMemoryKB").c_str(),
+        po::value<uint32>(&opts->targetResourcesGpuMemoryKB),
+        "Target gpu memory (in KB) used by resources "
+        "before they begin to unload. Zero to disable.")
+
     ((section + "maxConcurrentDownloads").c_str(),
         po::value<uint32>(&opts->maxConcurrentDownloads),
         "Maximum size of the queue for the resources to be downloaded.")
@@ -32,11 +32,19 @@
 #include <unistd.h> // getpid
 #endif
 
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define VTS_BUFFER_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
 #include <boost/filesystem.hpp>
 #include <dbglog/dbglog.hpp>
 
 #include <cstring>
 #include <map>
+#include <algorithm>
 
 void initializeBrowserData();
 namespace
@@ -79,6 +87,23 @@ std::string uniqueName()
 typedef std::map<std::string, std::pair<uint32, const unsigned char *>>
     dataMapType;
 
+#ifdef VTS_BUFFER_MMAP
+class MappedFile
+{
+public:
+    MappedFile(void *ptr, size_t size) : ptr(ptr), size(size)
+    {}
+
+    ~MappedFile()
+    {
+        munmap(ptr, size);
+    }
+
+    void *const ptr;
+    const size_t size;
+};
+#endif
+
 dataMapType &dataMap()
 {
     static dataMapType data;
@@ -101,12 +126,19 @@ Buffer::Buffer(const std::string &str) : data_(nullptr), size_(0)
     memcpy(data_, str.data(), size_);
 }
 
+Buffer::Buffer(const std::shared_ptr<void> &owner, char *data, uint32 size)
+    : data_(data), size_(size), owner_(owner)
+{
+    assert(owner_);
+}
+
 Buffer::~Buffer()
 {
     this->free();
 }
 
-Buffer::Buffer(Buffer &&other) noexcept : data_(other.data_), size_(other.size_)
+Buffer::Buffer(Buffer &&other) noexcept : data_(other.data_),
+    size_(other.size_), owner_(std::move(other.owner_))
 {
     other.data_ = nullptr;
     other.size_ = 0;
@@ -118,6 +150,7 @@ Buffer &Buffer::operator = (Buffer &&other) noexcept
     this->free();
     size_ = other.size_;
     data_ = other.data_;
+    owner_ = std::move(other.owner_);
     other.data_ = nullptr;
     other.size_ = 0;
     return *this;
@@ -135,6 +168,18 @@ std::string Buffer::str() const
     return std::string(data_, size_);
 }
 
+Buffer Buffer::slice(uint32 offset, uint32 size) const
+{
+    if ((uint64)offset + size > size_)
+        LOGTHROW(err2, std::runtime_error)
+                << "Buffer slice out of range";
+    if (owner_)
+        return Buffer(owner_, data_ + offset, size);
+    Buffer r(size);
+    memcpy(r.data(), data_ + offset, size);
+    return r;
+}
+
 void Buffer::allocate(uint32 size)
 {
     this->free();
@@ -148,6 +193,13 @@ void Buffer::allocate(uint32 size)
 
 void Buffer::resize(uint32 size)
 {
+    if (owner_)
+    {
+        Buffer tmp(size);
+        memcpy(tmp.data(), data_, std::min(size, size_));
+        *this = std::move(tmp);
+        return;
+    }
     char *tmp = (char*)realloc(data_, size);
     if (!tmp)
     {
@@ -161,12 +213,17 @@ void Buffer::resize(uint32 size)
 
 void Buffer::zero()
 {
+    if (owner_)
+        allocate(size_);
     memset(data_, 0, size_);
 }
 
 void Buffer::free()
 {
-    ::free(data_);
+    if (owner_)
+        owner_.reset();
+    else
+        ::free(data_);
     data_ = nullptr;
     size_ = 0;
 }
@@ -221,6 +278,37 @@ Buffer readLocalFileBuffer(const std::string &path)
     }
 }
 
+Buffer mapLocalFileBuffer(const std::string &path)
+{
+#ifdef VTS_BUFFER_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        LOGTHROW(err1, std::runtime_error) << "Failed to read file <"
+                                           << path << ">";
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        LOGTHROW(err1, std::runtime_error) << "Failed to read file <"
+                                           << path << ">";
+    }
+    if (st.st_size == 0)
+    {
+        close(fd);
+        return Buffer();
+    }
+    void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+        LOGTHROW(err1, std::runtime_error) << "Failed to map file <"
+                                           << path << ">";
+    auto m = std::make_shared<MappedFile>(ptr, st.st_size);
+    return Buffer(m, (char*)ptr, st.st_size);
+#else
+    return readLocalFileBuffer(path);
+#endif
+}
+
 Buffer readInternalMemoryBuffer(const std::string &path)
 {
     auto it = dataMap().find(path);
@@ -24,6 +24,7 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "../include/vts-browser/altitudes.hpp"
 #include "../include/vts-browser/buffer.hpp"
 #include "../include/vts-browser/callbacks.h"
 #include "../include/vts-browser/camera.h"
@@ -145,6 +146,11 @@ typedef struct vtsCSearch
     std::shared_ptr<vts::SearchTask> p;
 } vtsCSearch;
 
+typedef struct vtsCAltitudes
+{
+    std::shared_ptr<vts::AltitudesTask> p;
+} vtsCAltitudes;
+
 typedef struct vtsCFetcher
 {
     std::shared_ptr<vts::Fetcher> p;
@@ -568,6 +574,40 @@ void vtsCameraRenderUpdate(vtsHCamera cam)
     C_END
 }
 
+vtsHAltitudes vtsCameraSurfaceAltitudes(vtsHCamera cam,
+    const double points[], uint32 count, double sampleSize)
+{
+    C_BEGIN
+    vtsHAltitudes r = new vtsCAltitudes();
+    r->p = cam->p->surfaceAltitudes(points, count, sampleSize);
+    return r;
+    C_END
+    return nullptr;
+}
+
+void vtsAltitudesDestroy(vtsHAltitudes altitudes)
+{
+    C_BEGIN
+    delete altitudes;
+    C_END
+}
+
+bool vtsAltitudesGetDone(vtsHAltitudes altitudes)
+{
+    C_BEGIN
+    return altitudes->p->done;
+    C_END
+    return false;
+}
+
+const double *vtsAltitudesGetResults(vtsHAltitudes altitudes)
+{
+    C_BEGIN
+    return altitudes->p->altitudes.data();
+    C_END
+    return nullptr;
+}
+
 // credits
 
 const char *vtsCameraGetCredits(vtsHCamera cam)
@@ -669,9 +709,9 @@ void vtsDrawsSurfaceTask(void *group, uint32 index,
 {
     C_BEGIN
     vts::DrawSurfaceTask *t = (vts::DrawSurfaceTask *)group + index;
-    *mesh = t->mesh.get();
-    *texColor = t->texColor.get();
-    *texMask = t->texMask.get();
+    *mesh = t->meshPtr ? t->meshPtr : t->mesh.get();
+    *texColor = t->texColorPtr ? t->texColorPtr : t->texColor.get();
+    *texMask = t->texMaskPtr ? t->texMaskPtr : t->texMask.get();
     *baseStruct = (vtsCDrawSurfaceBase*)t;
     C_END
 }
@@ -682,7 +722,7 @@ void vtsDrawsColliderTask(void *group, uint32 index,
 {
     C_BEGIN
     vts::DrawColliderTask *t = (vts::DrawColliderTask *)group + index;
-    *mesh = t->mesh.get();
+    *mesh = t->meshPtr ? t->meshPtr : t->mesh.get();
     *baseStruct = (vtsCDrawColliderBase*)t;
     C_END
 }
@@ -996,6 +1036,14 @@ uint32 vtsTextureGetInternalFormat(vtsHResource resource)
     return 0;
 }
 
+uint32 vtsTextureGetMipmapLevels(vtsHResource resource)
+{
+    C_BEGIN
+    return resource->ptr.t->mipmapLevels;
+    C_END
+    return 0;
+}
+
 uint32 vtsTextureGetFilterMode(vtsHResource resource)
 {
     C_BEGIN
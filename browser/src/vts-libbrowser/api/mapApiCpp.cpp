@@ -34,6 +34,7 @@
 #include "../coordsManip.hpp"
 #include "../credits.hpp"
 #include "../geodata.hpp"
+#include "../geodataFeatures.hpp"
 #include "../position.hpp"
 
 #include <vts-libs/registry/json.hpp>
@@ -217,6 +218,7 @@ double Map::getMapRenderProgress() const
 
 void Map::dataUpdate()
 {
+    ScopedTimer timer(impl->timings.dataUpdate);
     impl->resourcesDataUpdate();
 }
 
@@ -233,9 +235,17 @@ void Map::dataFinalize()
 
 void Map::renderUpdate(double elapsedTime)
 {
-    impl->statistics.renderTicks = ++impl->renderTickIndex;
-    impl->resourcesRenderUpdate();
-    impl->renderUpdate(elapsedTime);
+    {
+        ScopedTimer timer(impl->timings.renderUpdate);
+        impl->statistics.renderTicks = ++impl->renderTickIndex;
+        {
+            ScopedTimer timer(impl->timings.resourcesUpdate);
+            impl->resourcesRenderUpdate();
+        }
+        impl->renderUpdate(elapsedTime);
+    }
+    impl->timings.summarize(impl->statistics);
+    impl->counters.summarize(impl->statistics);
 }
 
 void Map::renderFinalize()
@@ -386,13 +396,27 @@ void Map::setResourceFreeLayerGeodata(const std::string &name,
         LOGTHROW(err4, std::logic_error)
                 << "Map is not yet available.";
     }
-    auto &v = impl->mapconfig->getFreeInfo(name)->overrideGeodata;
-    if (!v || *v != value)
+    FreeInfo *info = impl->mapconfig->getFreeInfo(name);
+    auto &v = info->overrideGeodata;
+    if (!v || info->overrideGeodataSource != value)
     {
+        info->overrideGeodataSource = value;
         if (value.empty())
             v.reset();
         else
-            v = std::make_shared<const std::string>(value);
+        {
+            // convert once, instead of parsing the json on every restyle
+            //   invalid geodata are kept as is and reported when processed
+            try
+            {
+                v = std::make_shared<const std::string>(
+                    convertGeodataFeaturesToBinary(value, false));
+            }
+            catch (const std::exception &)
+            {
+                v = std::make_shared<const std::string>(value);
+            }
+        }
     }
     purgeViewCache();
 }
@@ -340,7 +340,8 @@ bool aabbTest(const vec3 aabb[2], const vec4 planes[6])
                 aabb[!!(p[0] > 0)](0),
                 aabb[!!(p[1] > 0)](1),
                 aabb[!!(p[2] > 0)](2));
-        double d = dot(vec4to3(p), pv);
+        // explicit order of operations, same as in the batched culling
+        double d = p[0] * pv[0] + p[1] * pv[1] + p[2] * pv[2];
         if (d < -p[3])
             return false;
     }
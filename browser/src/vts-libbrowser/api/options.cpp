@@ -68,9 +68,16 @@ void MapCreateOptions::applyJson(const std::string &json)
     AJ(customSrs2, asString);
     AJ(diskCache, asBool);
     AJ(hashCachePaths, asBool);
+    AJ(packedCache, asBool);
+    AJ(packedCacheSizeLimitMB, asUInt);
+    AJ(decodeThreads, asUInt);
+    AJ(geodataThreads, asUInt);
+    AJ(traverseThreads, asUInt);
     AJ(searchUrlFallbackOutsideEarth, asBool);
     AJ(browserOptionsSearchUrls, asBool);
     AJ(atmosphereDensityTexture, asBool);
+    AJ(textureCompression, asUInt);
+    AJ(textureDecodeScale, asUInt);
     AJ(debugUseExtraThreads, asBool);
 }
 
@@ -86,9 +93,16 @@ std::string MapCreateOptions::toJson() const
     TJ(customSrs2, asString);
     TJ(diskCache, asBool);
     TJ(hashCachePaths, asBool);
+    TJ(packedCache, asBool);
+    TJ(packedCacheSizeLimitMB, asUInt);
+    TJ(decodeThreads, asUInt);
+    TJ(geodataThreads, asUInt);
+    TJ(traverseThreads, asUInt);
     TJ(searchUrlFallbackOutsideEarth, asBool);
     TJ(browserOptionsSearchUrls, asBool);
     TJ(atmosphereDensityTexture, asBool);
+    TJ(textureCompression, asUInt);
+    TJ(textureDecodeScale, asUInt);
     TJ(debugUseExtraThreads, asBool);
     return jsonToString(v);
 }
@@ -112,9 +126,14 @@ void MapRuntimeOptions::applyJson(const std::string &json)
     AJ(pixelsPerInch, asDouble);
     AJ(renderTilesScale, asDouble);
     AJ(targetResourcesMemoryKB, asUInt);
+    AJ(targetResourcesRamMemoryKB, asUInt);
+    AJ(targetResourcesGpuMemoryKB, asUInt);
     AJ(maxConcurrentDownloads, asUInt);
     AJ(maxCacheWriteQueueLength, asUInt);
     AJ(maxResourceProcessesPerTick, asUInt);
+    AJ(maxUploadBatchResources, asUInt);
+    AJ(maxUploadBatchSizeKB, asUInt);
+    AJ(maxUploadBatchDelay, asDouble);
     AJ(maxFetchRedirections, asUInt);
     AJ(maxFetchRetries, asUInt);
     AJ(fetchFirstRetryTimeOffset, asUInt);
@@ -134,9 +153,14 @@ std::string MapRuntimeOptions::toJson() const
     TJ(pixelsPerInch, asDouble);
     TJ(renderTilesScale, asDouble);
     TJ(targetResourcesMemoryKB, asUInt);
+    TJ(targetResourcesRamMemoryKB, asUInt);
+    TJ(targetResourcesGpuMemoryKB, asUInt);
     TJ(maxConcurrentDownloads, asUInt);
     TJ(maxCacheWriteQueueLength, asUInt);
     TJ(maxResourceProcessesPerTick, asUInt);
+    TJ(maxUploadBatchResources, asUInt);
+    TJ(maxUploadBatchSizeKB, asUInt);
+    TJ(maxUploadBatchDelay, asDouble);
     TJ(maxFetchRedirections, asUInt);
     TJ(maxFetchRetries, asUInt);
     TJ(fetchFirstRetryTimeOffset, asUInt);
@@ -176,6 +200,7 @@ void CameraOptions::applyJson(const std::string &json)
     AJE(traverseModeSurfaces, TraverseMode);
     AJE(traverseModeGeodata, TraverseMode);
     AJ(lodBlendingTransparent, asBool);
+    AJ(lightweightDraws, asBool);
     AJ(debugDetachedCamera, asBool);
     AJ(debugFlatShading, asBool);
     AJ(debugRenderSurrogates, asBool);
@@ -211,6 +236,7 @@ std::string CameraOptions::toJson() const
     TJE(traverseModeSurfaces, TraverseMode);
     TJE(traverseModeGeodata, TraverseMode);
     TJ(lodBlendingTransparent, asBool);
+    TJ(lightweightDraws, asBool);
     TJ(debugDetachedCamera, asBool);
     TJ(debugFlatShading, asBool);
     TJ(debugRenderSurrogates, asBool);
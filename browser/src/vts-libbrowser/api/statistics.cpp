@@ -25,12 +25,34 @@
  */
 
 #include "../utilities/json.hpp"
+#include "../include/vts-browser/timingStatistics.hpp"
 #include "../include/vts-browser/mapStatistics.hpp"
 #include "../include/vts-browser/cameraStatistics.hpp"
 
 namespace vts
 {
 
+namespace
+{
+
+Json::Value timingToJson(const TimingStatistics &t)
+{
+    Json::Value v;
+    v["p50"] = t.p50;
+    v["p95"] = t.p95;
+    v["max"] = t.max;
+    v["samples"] = t.samples;
+    return v;
+}
+
+} // namespace
+
+#define TJT(NAME) v[#NAME] = timingToJson(NAME);
+
+TimingStatistics::TimingStatistics() :
+    p50(0), p95(0), max(0), samples(0)
+{}
+
 MapStatistics::MapStatistics() :
     resourcesCreated(0),
     resourcesDownloaded(0),
@@ -51,8 +73,14 @@ MapStatistics::MapStatistics() :
     resourcesQueueAtmosphere(0),
     currentGpuMemUseKB(0),
     currentRamMemUseKB(0),
+    decodeThreads(0),
+    geodataThreads(0),
+    traverseThreads(0),
     renderTicks(0)
-{}
+{
+    for (uint32 i = 0; i < MaxDecodeThreads; i++)
+        decodeThreadsBusyTimeMs[i] = 0;
+}
 
 std::string MapStatistics::toJson() const
 {
@@ -76,7 +104,22 @@ std::string MapStatistics::toJson() const
     TJ(resourcesQueueAtmosphere, asUint);
     TJ(currentGpuMemUseKB, asUint);
     TJ(currentRamMemUseKB, asUint);
+    TJ(decodeThreads, asUint);
+    for (uint32 i = 0; i < decodeThreads; i++)
+        v["decodeThreadsBusyTimeMs"].append(decodeThreadsBusyTimeMs[i]);
+    TJ(geodataThreads, asUint);
+    TJ(traverseThreads, asUint);
     TJ(renderTicks, asUint);
+    TJT(timeRenderUpdate);
+    TJT(timeResourcesUpdate);
+    TJT(timeTraverseClearing);
+    TJT(timeDataUpdate);
+    TJT(timeCacheRead);
+    TJT(timeCacheWrite);
+    TJT(timeDecode);
+    TJT(timeGeodata);
+    TJT(timeUpload);
+    TJT(timeUploadFlush);
     return jsonToString(v);
 }
 
@@ -106,6 +149,11 @@ std::string CameraStatistics::toJson() const
     TJ(currentNodeMetaUpdates, asUInt);
     TJ(currentNodeDrawsUpdates, asUInt);
     TJ(currentGridNodes, asUInt);
+    TJT(timeRenderUpdate);
+    TJT(timeTraversal);
+    TJT(timeBlending);
+    TJT(timeSubtiles);
+    TJT(timeSort);
     return jsonToString(v);
 }
 
@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CACHE_HPP_sdf4g5h7jkl
+#define CACHE_HPP_sdf4g5h7jkl
+
+#include <string>
+#include <memory>
+
+#include "include/vts-browser/foundation.hpp"
+
+namespace vts
+{
+
+class MapCreateOptions;
+class CacheData;
+
+class Cache : private Immovable
+{
+public:
+    explicit Cache(const MapCreateOptions &options);
+    virtual ~Cache();
+
+    virtual void write(CacheData &&cd) = 0;
+    virtual CacheData read(const std::string &name) = 0;
+    virtual void purge();
+
+    static std::shared_ptr<Cache> create(const MapCreateOptions &options);
+    static std::string stripScheme(const std::string &name);
+
+    std::string root;
+    const bool disabled;
+};
+
+std::shared_ptr<Cache> createPackedCache(const MapCreateOptions &options);
+
+} // namespace vts
+
+#endif
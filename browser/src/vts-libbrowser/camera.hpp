@@ -31,6 +31,7 @@
 #include <vector>
 #include <unordered_map>
 #include <map>
+#include <list>
 
 #include <vts-libs/registry/referenceframe.hpp>
 
@@ -40,7 +41,10 @@
 #include "include/vts-browser/cameraStatistics.hpp"
 #include "include/vts-browser/math.hpp"
 
+#include "resource.hpp"
 #include "subtileMerger.hpp"
+#include "traverseNode.hpp"
+#include "utilities/timing.hpp"
 
 namespace vtslibs { namespace vts {
 class NodeInfo;
@@ -54,7 +58,10 @@ enum class Validity;
 class MapImpl;
 class Camera;
 class TraverseNode;
+class NavTile;
 class NavigationImpl;
+class AltitudesTask;
+class Mapconfig;
 class RenderSurfaceTask;
 class RenderInfographicsTask;
 class RenderColliderTask;
@@ -83,7 +90,11 @@ class OldDraw
 public:
     TileId trav;
     TileId orig;
+    // the nodes are searched from the root only after the handles expire
+    TraverseNodeHandle travNode;
+    TraverseNodeHandle origNode;
     double age = 0;
+    bool resolved = false; // the nodes are valid in this update
 
     OldDraw(const CurrentDraw &current);
     OldDraw(const TileId &id);
@@ -95,6 +106,56 @@ public:
     std::vector<OldDraw> blendDraws;
 };
 
+// outputs of a single traversal task
+// layers and subtrees near the roots are traversed concurrently
+//   and the tasks are merged in a fixed order afterwards
+class TraverseTask
+{
+public:
+    CameraDraws draws;
+    CameraStatistics statistics; // increments only
+    std::vector<CurrentDraw> currentDraws;
+    std::unordered_map<TraverseNode*, SubtilesMerger> opaqueSubtiles;
+    std::vector<TileId> gridLoadRequests;
+    std::vector<TraverseNode*> creditsHits; // rendered nodes
+    ResourceTouches touches;
+    double timeTraversal = 0; // milliseconds
+    double timeBlending = 0;
+    double timeSubtiles = 0;
+
+    void merge(TraverseTask &other);
+};
+
+// the childs of the node are traversed in concurrent tasks
+bool travForks(const TraverseNode *trav);
+
+// cpu time of the main operations, summarized into the statistics
+class CameraTimings
+{
+public:
+    TimingHistogram renderUpdate;
+    TimingHistogram traversal;
+    TimingHistogram blending;
+    TimingHistogram subtiles;
+    TimingHistogram sort;
+
+    void summarize(CameraStatistics &statistics) const;
+};
+
+class AltitudesTaskImpl
+{
+public:
+    struct Point
+    {
+        vec2 sds;
+        uint32 division = (uint32)-1; // reference division node index
+    };
+
+    std::shared_ptr<Mapconfig> mapconfig; // points converted for
+    std::vector<Point> points;
+    std::vector<uint32> pending; // indices to points
+};
+
 class CameraImpl : private Immovable
 {
 public:
@@ -105,11 +166,10 @@ public:
     CameraDraws draws;
     CameraOptions options;
     CameraStatistics statistics;
-    std::vector<TileId> gridLoadRequests;
-    std::vector<CurrentDraw> currentDraws;
-    std::unordered_map<TraverseNode*, SubtilesMerger> opaqueSubtiles;
+    CameraTimings timings;
     std::map<std::weak_ptr<MapLayer>, CameraMapLayer,
             std::owner_less<std::weak_ptr<MapLayer>>> layers;
+    std::list<std::weak_ptr<AltitudesTask>> altitudesTasks;
     // *Actual = corresponds to current camera settings
     // *Render, *Culling, updated only when camera is NOT detached
     mat4 viewProjActual;
@@ -124,6 +184,7 @@ public:
     vec3 focusPosPhys;
     vec3 eye, target, up;
     double diskNominalDistance = 0;
+    uint32 cullingStamp = 0; // identifies culling results of this update
     uint32 windowWidth = 0;
     uint32 windowHeight = 0;
 
@@ -133,19 +194,26 @@ public:
         std::vector<BoundParamInfo> &boundList,
         double priority);
     void touchDraws(TraverseNode *trav);
+    void cullingBatch(TraverseNode *trav);
     bool visibilityTest(TraverseNode *trav);
+    bool obbTest(TraverseNode *trav);
     bool coarsenessTest(TraverseNode *trav);
     double coarsenessValue(TraverseNode *trav);
+    double coarsenessDisk(TraverseNode *trav);
     float getTextSize(float size, const std::string &text);
-    void renderText(TraverseNode *trav, float x, float y, const vec4f &color,
-                   float size, const std::string &text, bool centerText = true);
-    void renderNodeBox(TraverseNode *trav, const vec4f &color);
-    void renderNode(TraverseNode *trav, TraverseNode *orig);
-    void renderNode(TraverseNode *trav);
-    void renderNodeCoarser(TraverseNode *trav, TraverseNode *orig);
-    void renderNodeCoarser(TraverseNode *trav);
-    void renderNodeDraws(TraverseNode *trav, TraverseNode *orig,
-                            float blendingCoverage);
+    void renderText(TraverseTask &out, TraverseNode *trav,
+                    float x, float y, const vec4f &color, float size,
+                    const std::string &text, bool centerText = true);
+    void renderNodeBox(TraverseTask &out, TraverseNode *trav,
+                       const vec4f &color);
+    void renderNode(TraverseTask &out, TraverseNode *trav,
+                    TraverseNode *orig);
+    void renderNode(TraverseTask &out, TraverseNode *trav);
+    void renderNodeCoarser(TraverseTask &out, TraverseNode *trav,
+                           TraverseNode *orig);
+    void renderNodeCoarser(TraverseTask &out, TraverseNode *trav);
+    void renderNodeDraws(TraverseTask &out, TraverseNode *trav,
+                         TraverseNode *orig, float blendingCoverage);
     DrawSurfaceTask convert(const RenderSurfaceTask &task);
     DrawSurfaceTask convert(const RenderSurfaceTask &task,
                             const vec4f &uvClip, float blendingCoverage);
@@ -154,32 +222,45 @@ public:
     bool generateMonolithicGeodataTrav(TraverseNode *trav);
     std::shared_ptr<GpuTexture> travInternalTexture(TraverseNode *trav,
                                                   uint32 subMeshIndex);
-    bool travDetermineMeta(TraverseNode *trav);
+    bool travDetermineMeta(TraverseTask &out, TraverseNode *trav);
     void travDetermineMetaImpl(TraverseNode *trav);
-    bool travDetermineDraws(TraverseNode *trav);
+    bool travDetermineDraws(TraverseTask &out, TraverseNode *trav);
     bool travDetermineDrawsSurface(TraverseNode *trav);
     bool travDetermineDrawsGeodata(TraverseNode *trav);
     double travDistance(TraverseNode *trav, const vec3 pointPhys);
     void updateNodePriority(TraverseNode *trav);
-    bool travInit(TraverseNode *trav);
-    void travModeHierarchical(TraverseNode *trav, bool loadOnly);
-    void travModeFlat(TraverseNode *trav);
-    bool travModeStable(TraverseNode *trav, int mode);
-    bool travModeBalanced(TraverseNode *trav, bool renderOnly);
-    void travModeFixed(TraverseNode *trav);
-    void traverseRender(TraverseNode *trav);
-    void gridPreloadRequest(TraverseNode *trav);
-    void gridPreloadProcess(TraverseNode *root);
-    void gridPreloadProcess(TraverseNode *trav,
+    bool travInit(TraverseTask &out, TraverseNode *trav);
+    bool travInit(TraverseNode *trav); // outside of the traversal
+    void travModeHierarchical(TraverseTask &out, TraverseNode *trav,
+                              bool loadOnly);
+    void travModeFlat(TraverseTask &out, TraverseNode *trav);
+    bool travModeStable(TraverseTask &out, TraverseNode *trav, int mode);
+    bool travModeBalanced(TraverseTask &out, TraverseNode *trav,
+                          bool renderOnly);
+    void travModeFixed(TraverseTask &out, TraverseNode *trav);
+    void traverseRender(TraverseTask &out, TraverseNode *trav);
+    void traverseLayer(TraverseTask &out, TraverseNode *root,
+                       CameraMapLayer &layer);
+    void gridPreloadRequest(TraverseTask &out, TraverseNode *trav);
+    void gridPreloadProcess(TraverseTask &out, TraverseNode *root);
+    void gridPreloadProcess(TraverseTask &out, TraverseNode *trav,
                             const std::vector<TileId> &requests);
-    void resolveBlending(TraverseNode *root,
-                CameraMapLayer &layer);
+    void resolveBlending(TraverseTask &out, TraverseNode *root,
+                         CameraMapLayer &layer);
+    void applyTraverseTask(TraverseTask &out);
     void sortOpaqueFrontToBack();
     void renderUpdate();
     void suggestedNearFar(double &near_, double &far_);
     bool getSurfaceOverEllipsoid(double &result, const vec3 &navPos,
         double sampleSize = -1, bool renderDebug = false);
     double getSurfaceAltitudeSamples();
+    std::shared_ptr<AltitudesTask> surfaceAltitudes(
+        const double *points, uint32 count, double sampleSize);
+    void updateAltitudesTasks();
+    bool updateAltitudesTask(AltitudesTask &task);
+    bool resolveAltitude(AltitudesTask &task, uint32 index,
+        TraverseNode *root, std::unordered_map<const TraverseNode *,
+        std::shared_ptr<NavTile>> &navtiles);
 };
 
 void updateNavigation(std::weak_ptr<NavigationImpl> &nav, double elapsedTime);
@@ -24,6 +24,7 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "../include/vts-browser/altitudes.hpp"
 #include "../camera.hpp"
 #include "../navigation.hpp"
 #include "../traverseNode.hpp"
@@ -33,6 +34,7 @@
 #include "../map.hpp"
 #include "../gpuResource.hpp"
 #include "../renderTasks.hpp"
+#include "../navTile.hpp"
 
 #include <optick.h>
 
@@ -185,6 +187,95 @@ TraverseNode *findTravSds(CameraImpl *camera, TraverseNode *where,
     return where;
 }
 
+// bilinear interpolation of the navtile raster
+double navtileAltitude(const NavTile &navtile, const TraverseNode *trav,
+    const vec2 &pointSds)
+{
+    assert(navtile.data.size() == 256 * 256);
+    vec2 px = NavTile::sds2px(pointSds, trav->nodeInfo.extents());
+    px[0] = clamp(px[0], 0.0, 255.0);
+    px[1] = clamp(px[1], 0.0, 255.0);
+    uint32 x = std::min(uint32(px[0]), 254u);
+    uint32 y = std::min(uint32(px[1]), 254u);
+    const unsigned char *d = navtile.data.data() + y * 256 + x;
+    double v = bilinearInterpolation(px[0] - x, px[1] - y,
+        d[0], d[1], d[256], d[257]) / 255;
+    const auto &r = trav->meta->heightRange;
+    return interpolate(double(r.min), double(r.max), v);
+}
+
+// assign the points to reference division nodes
+void initializeAltitudesTask(MapImpl *map, AltitudesTask &task,
+    AltitudesTaskImpl &impl)
+{
+    uint32 count = task.altitudes.size();
+    impl.mapconfig = map->mapconfig;
+    impl.points.clear();
+    impl.points.resize(count);
+    impl.pending.clear();
+    std::fill(task.altitudes.begin(), task.altitudes.end(), nan1());
+    std::vector<uint32> unassigned;
+    unassigned.reserve(count);
+    for (uint32 i = 0; i < count; i++)
+        unassigned.push_back(i);
+    std::vector<vec3> tmp;
+    std::vector<bool> valid;
+    uint32 index = 0;
+    for (auto &it : map->mapconfig->referenceFrame.division.nodes)
+    {
+        const uint32 division = index++;
+        if (it.second.partitioning.mode
+                != vtslibs::registry::PartitioningMode::bisection)
+            continue;
+        if (unassigned.empty())
+            break;
+        const NodeInfo &ni
+            = map->mapconfig->referenceDivisionNodeInfos[division];
+        tmp.clear();
+        for (uint32 i : unassigned)
+            tmp.push_back(vec3(task.points[i * 2], task.points[i * 2 + 1], 0));
+        valid.assign(tmp.size(), true);
+        try
+        {
+            map->convertor->convert(tmp.data(), tmp.size(),
+                Srs::Navigation, it.second);
+        }
+        catch (const std::exception &)
+        {
+            // find the points that failed
+            for (uint32 j = 0; j < tmp.size(); j++)
+            {
+                uint32 i = unassigned[j];
+                try
+                {
+                    tmp[j] = map->convertor->convert(vec3(task.points[i * 2],
+                        task.points[i * 2 + 1], 0),
+                        Srs::Navigation, it.second);
+                }
+                catch (const std::exception &)
+                {
+                    valid[j] = false;
+                }
+            }
+        }
+        std::vector<uint32> remaining;
+        for (uint32 j = 0; j < tmp.size(); j++)
+        {
+            uint32 i = unassigned[j];
+            vec2 sds = vec3to2(tmp[j]);
+            if (valid[j] && ni.inside(vecToUblas<math::Point2>(sds)))
+            {
+                impl.points[i].sds = sds;
+                impl.points[i].division = division;
+                impl.pending.push_back(i);
+            }
+            else
+                remaining.push_back(i);
+        }
+        unassigned.swap(remaining);
+    }
+}
+
 } // namespace
 
 bool CameraImpl::getSurfaceOverEllipsoid(
@@ -337,4 +428,130 @@ double CameraImpl::getSurfaceAltitudeSamples()
     return result;
 }
 
+bool CameraImpl::resolveAltitude(AltitudesTask &task, uint32 index,
+    TraverseNode *root, std::unordered_map<const TraverseNode *,
+    std::shared_ptr<NavTile>> &navtiles)
+{
+    const AltitudesTaskImpl::Point &p = task.impl->points[index];
+    const NodeInfo &ni
+        = map->mapconfig->referenceDivisionNodeInfos[p.division];
+
+    // desired lod, navtile has 256 samples along each side
+    uint32 maxLod = -1;
+    if (task.sampleSize > 0)
+        maxLod = ni.nodeId().lod + std::max(0.0,
+            std::log2(ni.extents().size() / (task.sampleSize * 255)));
+
+    // find the finest node with navtile
+    TraverseNode *t = findTravById(root, ni.nodeId());
+    if (!t)
+        return false;
+    const math::Point2 ublasSds = vecToUblas<math::Point2>(p.sds);
+    TraverseNode *nav = nullptr;
+    while (true)
+    {
+        if (!travInit(t))
+            return false;
+        if (t->meta->flags() & vtslibs::vts::MetaNode::Flag::navtile)
+            nav = t;
+        if (t->id().lod >= maxLod)
+            break;
+        TraverseNode *next = nullptr;
+        for (const auto &c : t->childs)
+        {
+            if (c->nodeInfo.inside(ublasSds))
+            {
+                next = c.get();
+                break;
+            }
+        }
+        if (!next)
+            break;
+        t = next;
+    }
+
+    double &result = task.altitudes[index];
+    if (nav && nav->surface)
+    {
+        std::shared_ptr<NavTile> &n = navtiles[nav];
+        if (!n)
+        {
+            n = map->getNavTile(nav->surface->urlNav,
+                UrlTemplate::Vars(map->roundId(nav->id())));
+            n->updatePriority(nav->priority);
+        }
+        switch (map->getResourceValidity(n))
+        {
+        case Validity::Indeterminate:
+            return false;
+        case Validity::Invalid:
+            break;
+        case Validity::Valid:
+            result = navtileAltitude(*n, nav, p.sds);
+            return true;
+        }
+    }
+
+    // fallback to the surrogate
+    if (t->surrogateNav)
+        result = *t->surrogateNav;
+    return true;
+}
+
+std::shared_ptr<AltitudesTask> CameraImpl::surfaceAltitudes(
+    const double *points, uint32 count, double sampleSize)
+{
+    auto t = std::make_shared<AltitudesTask>(points, count, sampleSize);
+    t->impl = std::make_shared<AltitudesTaskImpl>();
+    altitudesTasks.push_back(t);
+    return t;
+}
+
+bool CameraImpl::updateAltitudesTask(AltitudesTask &task)
+{
+    AltitudesTaskImpl &impl = *task.impl;
+    if (impl.mapconfig != map->mapconfig)
+        initializeAltitudesTask(map, task, impl);
+    TraverseNode *root = map->layers[0]->traverseRoot.get();
+    if (!root || !root->meta)
+        return false;
+    std::unordered_map<const TraverseNode *,
+        std::shared_ptr<NavTile>> navtiles;
+    std::vector<uint32> pending;
+    for (uint32 i : impl.pending)
+        if (!resolveAltitude(task, i, root, navtiles))
+            pending.push_back(i);
+    impl.pending.swap(pending);
+    return impl.pending.empty();
+}
+
+void CameraImpl::updateAltitudesTasks()
+{
+    OPTICK_EVENT();
+    auto it = altitudesTasks.begin();
+    while (it != altitudesTasks.end())
+    {
+        std::shared_ptr<AltitudesTask> t = it->lock();
+        if (t)
+        {
+            if (!updateAltitudesTask(*t))
+            {
+                it++;
+                continue;
+            }
+            t->done = true;
+        }
+        it = altitudesTasks.erase(it);
+    }
+}
+
+AltitudesTask::AltitudesTask(const double *points, uint32 count,
+    double sampleSize) :
+    points(points, points + count * 2), sampleSize(sampleSize),
+    altitudes(count, nan1()), done(false)
+{}
+
+AltitudesTask::~AltitudesTask()
+{}
+
 } // namespace vts
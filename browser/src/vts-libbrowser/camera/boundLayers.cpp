@@ -80,7 +80,11 @@ mat3f BoundParamInfo::uvMatrix() const
 Validity BoundParamInfo::prepare(const NodeInfo &nodeInfo, CameraImpl *impl,
                 uint32 subMeshIndex, double priority)
 {
-    bound = impl->map->mapconfig->getBoundInfo(id);
+    {
+        // external bound layers are resolved lazily
+        std::lock_guard<std::recursive_mutex> lock(impl->map->traverseMut);
+        bound = impl->map->mapconfig->getBoundInfo(id);
+    }
     if (!bound)
         return Validity::Indeterminate;
 
@@ -145,9 +149,8 @@ Validity BoundParamInfo::prepareDepth(CameraImpl *impl, double priority)
         v.tileId.y &= ~255;
         v.localId.x &= ~255;
         v.localId.y &= ~255;
-        std::string boundName = bound->urlMeta(v);
         std::shared_ptr<BoundMetaTile> bmt
-                = impl->map->getBoundMetaTile(boundName);
+                = impl->map->getBoundMetaTile(bound->urlMeta, v);
         bmt->updatePriority(priority);
         switch (impl->map->getResourceValidity(bmt))
         {
@@ -169,7 +172,8 @@ Validity BoundParamInfo::prepareDepth(CameraImpl *impl, double priority)
 
     transparent = bound->isTransparent || (!!alpha && *alpha < 1);
 
-    textureColor = impl->map->getTexture(bound->urlExtTex(vars));
+    textureColor = impl->map->getTexture(bound->urlExtTex, vars);
+    textureColor->transcode = true;
     textureColor->updatePriority(priority);
     textureColor->updateAvailability(bound->availability);
     switch (impl->map->getResourceValidity(textureColor))
@@ -183,7 +187,7 @@ Validity BoundParamInfo::prepareDepth(CameraImpl *impl, double priority)
     }
     if (!watertight)
     {
-        textureMask = impl->map->getTexture(bound->urlMask(vars));
+        textureMask = impl->map->getTexture(bound->urlMask, vars);
         textureMask->updatePriority(priority);
         switch (impl->map->getResourceValidity(textureMask))
         {
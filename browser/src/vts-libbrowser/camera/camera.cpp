@@ -36,8 +36,8 @@
 #include "../coordsManip.hpp"
 #include "../hashTileId.hpp"
 #include "../geodata.hpp"
+#include "../utilities/culling.hpp"
 
-#include <unordered_set>
 #include <optick.h>
 
 namespace vts
@@ -49,12 +49,78 @@ CurrentDraw::CurrentDraw(TraverseNode *trav, TraverseNode *orig) :
 
 OldDraw::OldDraw(const CurrentDraw &current) :
     trav(current.trav->id()),
-    orig(current.orig->id())
+    orig(current.orig->id()),
+    travNode(current.trav->layer->traverseNodes.handle(current.trav)),
+    origNode(current.orig->layer->traverseNodes.handle(current.orig)),
+    resolved(true)
 {}
 
 OldDraw::OldDraw(const TileId &id) : trav(id), orig(id)
 {}
 
+namespace
+{
+
+template<class T>
+void append(std::vector<T> &dst, std::vector<T> &src)
+{
+    dst.insert(dst.end(), std::make_move_iterator(src.begin()),
+        std::make_move_iterator(src.end()));
+    src.clear();
+}
+
+void append(CameraStatistics &dst, const CameraStatistics &src)
+{
+    for (uint32 i = 0; i < CameraStatistics::MaxLods; i++)
+    {
+        dst.metaNodesTraversedPerLod[i] += src.metaNodesTraversedPerLod[i];
+        dst.nodesRenderedPerLod[i] += src.nodesRenderedPerLod[i];
+    }
+    dst.metaNodesTraversedTotal += src.metaNodesTraversedTotal;
+    dst.nodesRenderedTotal += src.nodesRenderedTotal;
+    dst.currentNodeMetaUpdates += src.currentNodeMetaUpdates;
+    dst.currentNodeDrawsUpdates += src.currentNodeDrawsUpdates;
+    dst.currentGridNodes += src.currentGridNodes;
+}
+
+void append(CameraDraws &dst, CameraDraws &src)
+{
+    append(dst.opaque, src.opaque);
+    append(dst.transparent, src.transparent);
+    append(dst.geodata, src.geodata);
+    append(dst.infographics, src.infographics);
+    append(dst.colliders, src.colliders);
+}
+
+} // namespace
+
+void TraverseTask::merge(TraverseTask &other)
+{
+    append(draws, other.draws);
+    append(statistics, other.statistics);
+    other.statistics = CameraStatistics();
+    append(currentDraws, other.currentDraws);
+    for (auto &it : other.opaqueSubtiles)
+        append(opaqueSubtiles[it.first].subtiles, it.second.subtiles);
+    other.opaqueSubtiles.clear();
+    append(gridLoadRequests, other.gridLoadRequests);
+    append(creditsHits, other.creditsHits);
+    append(touches, other.touches);
+    timeTraversal += other.timeTraversal;
+    timeBlending += other.timeBlending;
+    timeSubtiles += other.timeSubtiles;
+    other.timeTraversal = other.timeBlending = other.timeSubtiles = 0;
+}
+
+void CameraTimings::summarize(CameraStatistics &statistics) const
+{
+    renderUpdate.summarize(statistics.timeRenderUpdate);
+    traversal.summarize(statistics.timeTraversal);
+    blending.summarize(statistics.timeBlending);
+    subtiles.summarize(statistics.timeSubtiles);
+    sort.summarize(statistics.timeSort);
+}
+
 CameraImpl::CameraImpl(MapImpl *map, Camera *cam) :
     map(map), camera(cam),
     viewProjActual(identityMatrix4()),
@@ -108,6 +174,22 @@ void CameraImpl::clear()
 namespace
 {
 
+// internal resources used by debug renders
+std::shared_ptr<GpuMesh> internalMesh(MapImpl *map, const std::string &name)
+{
+    auto r = map->getMesh(name);
+    r->priority = std::numeric_limits<float>::infinity();
+    return r;
+}
+
+std::shared_ptr<GpuTexture> internalTexture(MapImpl *map,
+    const std::string &name)
+{
+    auto r = map->getTexture(name);
+    r->priority = std::numeric_limits<float>::infinity();
+    return r;
+}
+
 void touchDraws(MapImpl *map, const RenderSurfaceTask &task)
 {
     if (task.mesh)
@@ -137,37 +219,11 @@ void CameraImpl::touchDraws(TraverseNode *trav)
         map->touchResource(trav->geodataAgg);
 }
 
-bool CameraImpl::visibilityTest(TraverseNode *trav)
-{
-    assert(trav->meta);
-    // aabb test
-    if (!aabbTest(trav->aabbPhys, cullingPlanes))
-        return false;
-    // additional obb test
-    if (trav->obb)
-    {
-        TraverseNode::Obb &obb = *trav->obb;
-        vec4 planes[6];
-        vts::frustumPlanes(viewProjCulling * obb.rotInv, planes);
-        if (!aabbTest(obb.points, planes))
-            return false;
-    }
-    // all tests passed
-    return true;
-}
-
-bool CameraImpl::coarsenessTest(TraverseNode *trav)
-{
-    assert(trav->meta);
-    return coarsenessValue(trav)
-        < (trav->layer->isGeodata()
-        ? options.targetPixelRatioGeodata
-        : options.targetPixelRatioSurfaces);
-}
-
 namespace
 {
 
+std::atomic<uint32> cullingStamps {0};
+
 double distanceToDisk(const vec3 &diskNormal,
     const vec2 &diskHeights, double diskHalfAngle,
     const vec3 &point)
@@ -185,41 +241,131 @@ double distanceToDisk(const vec3 &diskNormal,
 
 } // namespace
 
+// tests the node together with its siblings in a batch
+//   the results are kept in the hot data for the rest of the update
+void CameraImpl::cullingBatch(TraverseNode *trav)
+{
+    TraverseNode *nodes[4];
+    uint32 cnt = 0;
+    // forked siblings are tested by their own tasks
+    if (trav->parent && !travForks(trav->parent))
+    {
+        for (auto &it : trav->parent->childs)
+            if (it->meta && it->hot->cullingStamp[it->slot] != cullingStamp)
+                nodes[cnt++] = it.get();
+    }
+    else
+        nodes[cnt++] = trav;
+    assert(cnt > 0);
+
+    // frustum
+    const vec3 *aabbs[4];
+    bool visible[4];
+    for (uint32 i = 0; i < cnt; i++)
+        aabbs[i] = nodes[i]->hot->aabbPhys[nodes[i]->slot];
+    aabbTest(aabbs, cnt, cullingPlanes, visible);
+
+    // coarseness of visible nodes
+    TraverseNode *boxes[4];
+    const vec3 *corners[4];
+    double scales[4];
+    double heights[4];
+    uint32 boxesCnt = 0;
+    for (uint32 i = 0; i < cnt; i++)
+    {
+        TraverseNode *t = nodes[i];
+        TraverseNodeHot &h = *t->hot;
+        const uint32 s = t->slot;
+        h.cullingStamp[s] = cullingStamp;
+        h.cullingVisible[s] = visible[i] && (!t->obb || obbTest(t));
+        h.cullingCoarseness[s] = nan1();
+        if (!h.cullingVisible[s])
+            continue;
+        h.cullingCoarseness[s] = coarsenessDisk(t);
+        if (!std::isnan(h.cullingCoarseness[s]))
+            continue;
+        boxes[boxesCnt] = t;
+        corners[boxesCnt] = h.cornersPhys[s];
+        scales[boxesCnt] = h.texelSize[s];
+        boxesCnt++;
+    }
+    cornersHeight(viewProjRender, corners, boxesCnt,
+                  perpendicularUnitVector, scales, heights);
+    for (uint32 i = 0; i < boxesCnt; i++)
+    {
+        boxes[i]->hot->cullingCoarseness[boxes[i]->slot]
+            = heights[i] * windowHeight * 0.5;
+    }
+}
+
+bool CameraImpl::visibilityTest(TraverseNode *trav)
+{
+    assert(trav->meta);
+    const TraverseNodeHot &h = *trav->hot;
+    if (h.cullingStamp[trav->slot] != cullingStamp)
+        cullingBatch(trav);
+    assert(h.cullingStamp[trav->slot] == cullingStamp);
+    return h.cullingVisible[trav->slot];
+}
+
+bool CameraImpl::obbTest(TraverseNode *trav)
+{
+    TraverseNode::Obb &obb = *trav->obb;
+    vec4 planes[6];
+    vts::frustumPlanes(viewProjCulling * obb.rotInv, planes);
+    return aabbTest(obb.points, planes);
+}
+
+bool CameraImpl::coarsenessTest(TraverseNode *trav)
+{
+    assert(trav->meta);
+    return coarsenessValue(trav)
+        < (trav->layer->isGeodata()
+        ? options.targetPixelRatioGeodata
+        : options.targetPixelRatioSurfaces);
+}
+
 double CameraImpl::coarsenessValue(TraverseNode *trav)
 {
     assert(trav->meta);
-    assert(!std::isnan(trav->texelSize));
+    const TraverseNodeHot &h = *trav->hot;
+    const uint32 s = trav->slot;
+
+    if (h.cullingStamp[s] == cullingStamp && h.cullingVisible[s])
+        return h.cullingCoarseness[s];
+
+    double v = coarsenessDisk(trav);
+    if (!std::isnan(v))
+        return v;
 
-    if (trav->texelSize == std::numeric_limits<double>::infinity())
-        return trav->texelSize;
+    // test the value on all corners of node bounding box
+    return cornersHeight(viewProjRender, h.cornersPhys[s],
+        perpendicularUnitVector * h.texelSize[s]) * windowHeight * 0.5;
+}
+
+// returns nan if the corners are to be tested instead
+double CameraImpl::coarsenessDisk(TraverseNode *trav)
+{
+    const TraverseNodeHot &h = *trav->hot;
+    const uint32 s = trav->slot;
+    assert(!std::isnan(h.texelSize[s]));
+
+    if (h.texelSize[s] == std::numeric_limits<double>::infinity())
+        return h.texelSize[s];
 
     if (map->options.debugCoarsenessDisks
-        && !std::isnan(trav->diskHalfAngle))
+        && !std::isnan(h.diskHalfAngle[s]))
     {
         // test the value at point at the distance from the disk
-        double dist = distanceToDisk(trav->diskNormalPhys,
-            trav->diskHeightsPhys, trav->diskHalfAngle,
+        double dist = distanceToDisk(h.diskNormalPhys[s],
+            h.diskHeightsPhys[s], h.diskHalfAngle[s],
             cameraPosPhys);
-        double v = trav->texelSize * diskNominalDistance / dist;
+        double v = h.texelSize[s] * diskNominalDistance / dist;
         assert(!std::isnan(v) && v > 0);
         return v;
     }
-    else
-    {
-        // test the value on all corners of node bounding box
-        double result = 0;
-        for (const vec3 &c : trav->cornersPhys)
-        {
-            vec3 up = perpendicularUnitVector * trav->texelSize;
-            vec3 c1 = c - up * 0.5;
-            vec3 c2 = c1 + up;
-            c1 = vec4to3(vec4(viewProjRender * vec3to4(c1, 1)), true);
-            c2 = vec4to3(vec4(viewProjRender * vec3to4(c2, 1)), true);
-            double len = std::abs(c2[1] - c1[1]);
-            result = std::max(result, len);
-        }
-        return result * windowHeight * 0.5;
-    }
+
+    return nan1();
 }
 
 float CameraImpl::getTextSize(float size, const std::string &text)
@@ -256,20 +402,18 @@ float CameraImpl::getTextSize(float size, const std::string &text)
     return x;
 }
 
-void CameraImpl::renderText(TraverseNode *trav, float x, float y,
-    const vec4f &color, float size,
+void CameraImpl::renderText(TraverseTask &out, TraverseNode *trav,
+    float x, float y, const vec4f &color, float size,
     const std::string &text, bool centerText)
 {
     assert(trav);
     assert(trav->meta);
 
     RenderInfographicsTask task;
-    task.mesh = map->getMesh("internal://data/meshes/rect.obj");
-    task.mesh->priority = std::numeric_limits<float>::infinity();
+    task.mesh = internalMesh(map, "internal://data/meshes/rect.obj");
 
-    task.textureColor =
-        map->getTexture("internal://data/textures/debugFont2.png");
-    task.textureColor->priority = std::numeric_limits<float>::infinity();
+    task.textureColor = internalTexture(map,
+        "internal://data/textures/debugFont2.png");
 
     task.model = translationMatrix(*trav->surrogatePhys);
     task.color = color;
@@ -295,7 +439,7 @@ void CameraImpl::renderText(TraverseNode *trav, float x, float y,
             ctask.data2[2] = x - 1;
             ctask.data2[3] = y - 1;
             ctask.type = 1;
-            draws.infographics.emplace_back(ctask);
+            out.draws.infographics.emplace_back(ctask);
         }
 
         for (uint32 i = 0, li = text.size(); i < li; i++)
@@ -337,19 +481,19 @@ void CameraImpl::renderText(TraverseNode *trav, float x, float y,
             }
 
             ctask.type = 1;
-            draws.infographics.emplace_back(ctask);
+            out.draws.infographics.emplace_back(ctask);
         }
     }
 }
 
-void CameraImpl::renderNodeBox(TraverseNode *trav, const vec4f &color)
+void CameraImpl::renderNodeBox(TraverseTask &out, TraverseNode *trav,
+    const vec4f &color)
 {
     assert(trav);
     assert(trav->meta);
 
     RenderInfographicsTask task;
-    task.mesh = map->getMesh("internal://data/meshes/line.obj");
-    task.mesh->priority = std::numeric_limits<float>::infinity();
+    task.mesh = internalMesh(map, "internal://data/meshes/line.obj");
     if (!task.ready())
         return;
 
@@ -360,16 +504,18 @@ void CameraImpl::renderNodeBox(TraverseNode *trav, const vec4f &color)
     static const uint32 corb[] = {
         1, 2, 3, 3, 5, 6, 7, 7, 4, 5, 6, 7
     };
+    const vec3 *corners = trav->hot->cornersPhys[trav->slot];
     for (uint32 i = 0; i < 12; i++)
     {
-        vec3 a = trav->cornersPhys[cora[i]];
-        vec3 b = trav->cornersPhys[corb[i]];
+        vec3 a = corners[cora[i]];
+        vec3 b = corners[corb[i]];
         task.model = lookAt(a, b);
-        draws.infographics.emplace_back(convert(task));
+        out.draws.infographics.emplace_back(convert(task));
     }
 }
 
-void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
+void CameraImpl::renderNode(TraverseTask &out, TraverseNode *trav,
+    TraverseNode *orig)
 {
     assert(trav && orig);
     assert(trav->meta);
@@ -383,22 +529,21 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
         return;
 
     // statistics
-    statistics.nodesRenderedTotal++;
-    statistics.nodesRenderedPerLod[std::min<uint32>(
+    out.statistics.nodesRenderedTotal++;
+    out.statistics.nodesRenderedPerLod[std::min<uint32>(
         trav->id().lod, CameraStatistics::MaxLods - 1)]++;
 
     // credits
-    for (auto &it : trav->credits)
-        map->credits->hit(trav->layer->creditScope, it,
-            trav->nodeInfo.distanceFromRoot());
+    if (!trav->credits.empty())
+        out.creditsHits.push_back(trav);
 
     bool isSubNode = trav != orig;
 
     // surfaces
     if (options.lodBlending)
-        currentDraws.emplace_back(trav, orig);
+        out.currentDraws.emplace_back(trav, orig);
     else
-        renderNodeDraws(trav, orig, nan1());
+        renderNodeDraws(out, trav, orig, nan1());
 
     // geodata & colliders
     if (!isSubNode)
@@ -410,24 +555,23 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
                 DrawGeodataTask t;
                 t.geodata = std::shared_ptr<void>(
                             trav->geodataAgg, r.userData.get());
-                draws.geodata.emplace_back(t);
+                out.draws.geodata.emplace_back(t);
             }
         }
         for (const RenderColliderTask &r : trav->colliders)
-            draws.colliders.emplace_back(convert(r));
+            out.draws.colliders.emplace_back(convert(r));
     }
 
     // surrogate
     if (options.debugRenderSurrogates && trav->surrogatePhys)
     {
         RenderInfographicsTask task;
-        task.mesh = map->getMesh("internal://data/meshes/sphere.obj");
-        task.mesh->priority = std::numeric_limits<float>::infinity();
+        task.mesh = internalMesh(map, "internal://data/meshes/sphere.obj");
         task.model = translationMatrix(*trav->surrogatePhys)
             * scaleMatrix(trav->nodeInfo.extents().size() * 0.03);
         task.color = vec3to4(trav->surface->color, task.color(3));
         if (task.ready())
-            draws.infographics.emplace_back(convert(task));
+            out.draws.infographics.emplace_back(convert(task));
     }
 
     // mesh box
@@ -437,11 +581,10 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
         {
             RenderInfographicsTask task;
             task.model = r.model;
-            task.mesh = map->getMesh("internal://data/meshes/aabb.obj");
-            task.mesh->priority = std::numeric_limits<float>::infinity();
+            task.mesh = internalMesh(map, "internal://data/meshes/aabb.obj");
             task.color = vec3to4(trav->surface->color, task.color(3));
             if (task.ready())
-                draws.infographics.emplace_back(convert(task));
+                out.draws.infographics.emplace_back(convert(task));
         }
     }
 
@@ -471,19 +614,19 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
         }
 
         if (options.debugRenderTileBoxes && !isSubNode)
-            renderNodeBox(trav, color);
+            renderNodeBox(out, trav, color);
 
         for (int i = 0; i < 3; i++)
             color[i] *= 0.5;
         if (options.debugRenderSubtileBoxes && isSubNode)
-            renderNodeBox(orig, color);
+            renderNodeBox(out, orig, color);
     }
 
     // tile options
     if (!(options.debugRenderTileGeodataOnly && !trav->layer->isGeodata())
         && options.debugRenderTileDiagnostics && !isSubNode)
     {
-        renderNodeBox(trav, vec4f(0, 0, 1, 1));
+        renderNodeBox(out, trav, vec4f(0, 0, 1, 1));
 
         char stmp[1024];
         auto id = trav->nodeInfo.nodeId();
@@ -492,20 +635,22 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
         if (options.debugRenderTileLod)
         {
             sprintf(stmp, "%d", id.lod);
-            renderText(trav, 0, 0, vec4f(1, 0, 0, 1), size, stmp);
+            renderText(out, trav, 0, 0, vec4f(1, 0, 0, 1), size, stmp);
         }
 
         if (options.debugRenderTileIndices)
         {
             sprintf(stmp, "%d %d", id.x, id.y);
-            renderText(trav, 0, -(size + 2), vec4f(0, 1, 1, 1), size, stmp);
+            renderText(out, trav, 0, -(size + 2),
+                vec4f(0, 1, 1, 1), size, stmp);
         }
 
         if (options.debugRenderTileTexelSize)
         {
             sprintf(stmp, "%.2f %.2f",
-                trav->texelSize, coarsenessValue(trav));
-            renderText(trav, 0, (size + 2), vec4f(1, 0, 1, 1), size, stmp);
+                trav->hot->texelSize[trav->slot], coarsenessValue(trav));
+            renderText(out, trav, 0, (size + 2),
+                vec4f(1, 0, 1, 1), size, stmp);
         }
 
         if (options.debugRenderTileFaces)
@@ -516,7 +661,7 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
                 if (r.mesh.get())
                 {
                     sprintf(stmp, "[%d] %d", i++, r.mesh->faces);
-                    renderText(trav, 0, (size + 2) * i,
+                    renderText(out, trav, 0, (size + 2) * i,
                         vec4f(1, 0, 1, 1), size, stmp);
                 }
             }
@@ -525,7 +670,7 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
                 if (r.mesh.get())
                 {
                     sprintf(stmp, "[%d] %d", i++, r.mesh->faces);
-                    renderText(trav, 0, (size + 2) * i,
+                    renderText(out, trav, 0, (size + 2) * i,
                         vec4f(1, 0, 1, 1), size, stmp);
                 }
             }
@@ -540,7 +685,7 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
                 {
                     sprintf(stmp, "[%d] %dx%d", i++,
                         r.textureColor->width, r.textureColor->height);
-                    renderText(trav, 0, (size + 2) * i,
+                    renderText(out, trav, 0, (size + 2) * i,
                         vec4f(1, 1, 1, 1), size, stmp);
                 }
             }
@@ -550,7 +695,7 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
                 {
                     sprintf(stmp, "[%d] %dx%d", i++,
                         r.textureColor->width, r.textureColor->height);
-                    renderText(trav, 0, (size + 2) * i,
+                    renderText(out, trav, 0, (size + 2) * i,
                         vec4f(1, 1, 1, 1), size, stmp);
                 }
             }
@@ -561,14 +706,14 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
             std::string stmp2;
             if (trav->surface->alien)
             {
-                renderText(trav, 0, (size + 2),
+                renderText(out, trav, 0, (size + 2),
                     vec4f(1, 1, 1, 1), size, "<Alien>");
             }
             const auto &names = trav->surface->name;
             for (uint32 i = 0, li = names.size(); i < li; i++)
             {
                 sprintf(stmp, "[%d] %s", i, names[i].c_str());
-                renderText(trav, 0,
+                renderText(out, trav, 0,
                     (size + 2) * (i + (trav->surface->alien ? 1 : 0)),
                     vec4f(1, 1, 1, 1), size, stmp);
             }
@@ -582,7 +727,7 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
                 if (!r.boundLayerId.empty())
                 {
                     sprintf(stmp, "[%d] %s", i, r.boundLayerId.c_str());
-                    renderText(trav, 0, (size + 2) * (i++),
+                    renderText(out, trav, 0, (size + 2) * (i++),
                         vec4f(1, 1, 1, 1), size, stmp);
                 }
             }
@@ -592,7 +737,7 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
                 if (!r.boundLayerId.empty())
                 {
                     sprintf(stmp, "[%d] %s", i, r.boundLayerId.c_str());
-                    renderText(trav, 0, (size + 2) * (i++),
+                    renderText(out, trav, 0, (size + 2) * (i++),
                         vec4f(1, 1, 1, 1), size, stmp);
                 }
             }
@@ -603,18 +748,23 @@ void CameraImpl::renderNode(TraverseNode *trav, TraverseNode *orig)
             uint32 i = 0;
             for (auto &it : trav->credits)
             {
-                sprintf(stmp, "[%d] %s", i,
-                    map->credits->findId(it).c_str());
-                renderText(trav, 0, (size + 2) * (i++),
+                {
+                    // credits may be merged from other traversal tasks
+                    std::lock_guard<std::recursive_mutex> lock(
+                        map->traverseMut);
+                    sprintf(stmp, "[%d] %s", i,
+                        map->credits->findId(it).c_str());
+                }
+                renderText(out, trav, 0, (size + 2) * (i++),
                     vec4f(1, 1, 1, 1), size, stmp);
             }
         }
     }
 }
 
-void CameraImpl::renderNode(TraverseNode *trav)
+void CameraImpl::renderNode(TraverseTask &out, TraverseNode *trav)
 {
-    renderNode(trav, trav);
+    renderNode(out, trav, trav);
 }
 
 namespace
@@ -633,15 +783,16 @@ bool findNodeCoarser(TraverseNode *&trav, TraverseNode *orig)
 
 } // namespace
 
-void CameraImpl::renderNodeCoarser(TraverseNode *trav, TraverseNode *orig)
+void CameraImpl::renderNodeCoarser(TraverseTask &out, TraverseNode *trav,
+    TraverseNode *orig)
 {
     if (findNodeCoarser(trav, orig))
-        renderNode(trav, orig);
+        renderNode(out, trav, orig);
 }
 
-void CameraImpl::renderNodeCoarser(TraverseNode *trav)
+void CameraImpl::renderNodeCoarser(TraverseTask &out, TraverseNode *trav)
 {
-    renderNodeCoarser(trav, trav);
+    renderNodeCoarser(out, trav, trav);
 }
 
 namespace
@@ -660,7 +811,7 @@ void updateRangeToHalf(float &a, float &b, int which)
 
 } // namespace
 
-void CameraImpl::renderNodeDraws(TraverseNode *trav,
+void CameraImpl::renderNodeDraws(TraverseTask &out, TraverseNode *trav,
     TraverseNode *orig, float blendingCoverage)
 {
     assert(trav && orig);
@@ -696,7 +847,7 @@ void CameraImpl::renderNodeDraws(TraverseNode *trav,
     {
         // some neighboring subtiles may be merged together
         //   this will reduce gpu overhead on rasterization
-        opaqueSubtiles[trav].subtiles.emplace_back(orig, uvClip);
+        out.opaqueSubtiles[trav].subtiles.emplace_back(orig, uvClip);
     }
     else if (options.lodBlendingTransparent
         && !std::isnan(blendingCoverage))
@@ -704,7 +855,7 @@ void CameraImpl::renderNodeDraws(TraverseNode *trav,
         // if lod blending is considered transparent
         //   move blending draws into transparent group
         for (const RenderSurfaceTask &r : trav->opaque)
-            draws.transparent.emplace_back(convert(r, uvClip,
+            out.draws.transparent.emplace_back(convert(r, uvClip,
                 blendingCoverage));
     }
     else
@@ -713,14 +864,14 @@ void CameraImpl::renderNodeDraws(TraverseNode *trav,
         //   move blending draws into opaque group
         // fully opaque draws (no blending) remain in opaque group
         for (const RenderSurfaceTask &r : trav->opaque)
-            draws.opaque.emplace_back(convert(r, uvClip,
+            out.draws.opaque.emplace_back(convert(r, uvClip,
                 blendingCoverage));
     }
 
     // transparent draws always remain in transparent group
     //   irrespective of any blending
     for (const RenderSurfaceTask &r : trav->transparent)
-        draws.transparent.emplace_back(convert(r, uvClip,
+        out.draws.transparent.emplace_back(convert(r, uvClip,
             blendingCoverage));
 }
 
@@ -747,23 +898,69 @@ double timeToBlendingCoverage(double age, double duration)
     return nan1(); // full opacity is signaled by nan
 }
 
-struct OldHash
+// resets the blending state of the node from previous updates
+TraverseNode *blendTouch(TraverseNode *node, uint32 stamp)
 {
-    size_t operator() (const OldDraw &d) const
+    if (node->blendStamp != stamp)
     {
-        std::hash<TileId> h;
-        return (h(d.orig) << 1) ^ h(d.trav);
+        node->blendStamp = stamp;
+        node->blendCurrent = nullptr;
+        node->blendOpaque = false;
+        node->blendCoveredKnown = false;
     }
-};
+    return node;
+}
 
-} // namespace
+// whether a fully visible draw covers the node or any of its ancestors
+//   (excluding the root)
+//   the results are remembered in the nodes for the stamp
+bool blendCovered(TraverseNode *node, uint32 stamp)
+{
+    TraverseNode *t = node;
+    bool covered = false;
+    for (; t->parent; t = t->parent)
+    {
+        blendTouch(t, stamp);
+        if (t->blendCoveredKnown)
+        {
+            covered = t->blendCovered;
+            break;
+        }
+        if (t->blendOpaque)
+        {
+            covered = true;
+            break;
+        }
+    }
+    for (TraverseNode *u = node; u != t; u = u->parent)
+    {
+        u->blendCoveredKnown = true;
+        u->blendCovered = covered;
+    }
+    return covered;
+}
 
-bool operator == (const OldDraw &l, const OldDraw &r)
+// find the nodes of the draw
+//   the search from the root is needed only after they were released
+void resolveOldDraw(TraverseNode *root, OldDraw &b, uint32 stamp)
 {
-    return l.orig == r.orig && l.trav == r.trav;
+    TraverseNodePool &pool = root->layer->traverseNodes;
+    b.resolved = pool.resolve(b.travNode, stamp)
+        && pool.resolve(b.origNode, stamp);
+    if (b.resolved)
+        return;
+    TraverseNode *trav = findTravById(root, b.trav);
+    TraverseNode *orig = findTravById(trav, b.orig);
+    if (!orig)
+        return;
+    b.travNode = pool.handle(trav);
+    b.origNode = pool.handle(orig);
+    b.resolved = true;
 }
 
-void CameraImpl::resolveBlending(TraverseNode *root,
+} // namespace
+
+void CameraImpl::resolveBlending(TraverseTask &out, TraverseNode *root,
                         CameraMapLayer &layer)
 {
     if (options.lodBlending == 0)
@@ -782,26 +979,40 @@ void CameraImpl::resolveBlending(TraverseNode *root,
         }), old.end());
     }
 
+    // the state of the nodes is reset lazily using the stamp
+    const uint32 stamp = cullingStamp;
+
+    // resolve nodes of blendDraws
+    for (auto &b : layer.blendDraws)
+        resolveOldDraw(root, b, stamp);
+
     // apply current draws
     {
         double halfDuration = options.lodBlendingDuration / 2;
-        std::unordered_set<OldDraw, OldHash> currentSet(currentDraws.begin(),
-            currentDraws.end());
+        for (auto &c : out.currentDraws)
+            blendTouch(c.orig, stamp)->blendCurrent = c.trav;
         for (auto &b : layer.blendDraws)
         {
-            auto it = currentSet.find(b);
-            if (it != currentSet.end())
+            if (!b.resolved)
+                continue;
+            TraverseNode *orig = blendTouch(b.origNode.node, stamp);
+            if (orig->blendCurrent == b.travNode.node)
             {
                 // prevent the draw from disappearing
                 b.age = std::min(b.age, halfDuration);
                 // prevent the draw from adding to blendDraws
-                currentSet.erase(it);
+                orig->blendCurrent = nullptr;
             }
         }
         // add new currentDraws to blendDraws
-        for (auto &c : currentSet)
+        for (auto &c : out.currentDraws)
+        {
+            if (c.orig->blendCurrent != c.trav)
+                continue;
             layer.blendDraws.emplace_back(c);
-        currentDraws.clear();
+            c.orig->blendCurrent = nullptr;
+        }
+        out.currentDraws.clear();
     }
 
     // detect appearing draws that have nothing to blend with
@@ -809,26 +1020,16 @@ void CameraImpl::resolveBlending(TraverseNode *root,
     {
         double halfDuration = options.lodBlendingDuration / 2;
         double duration = options.lodBlendingDuration;
-        std::unordered_set<TileId> opaqueTiles;
         for (auto &b : layer.blendDraws)
-            if (b.age >= halfDuration && b.age <= duration)
-                opaqueTiles.insert(b.orig);
+            if (b.resolved && b.age >= halfDuration && b.age <= duration)
+                blendTouch(b.origNode.node, stamp)->blendOpaque = true;
         for (auto &b : layer.blendDraws)
         {
             if (b.age >= halfDuration)
                 continue; // this draw has already fully appeared
-            bool ok = false;
-            TileId id = b.orig;
-            while (id.lod > 0)
-            {
-                if (opaqueTiles.count(id))
-                {
-                    ok = true;
-                    break;
-                }
-                id = vtslibs::vts::parent(id);
-            }
-            if (!ok)
+            if (!b.resolved)
+                continue;
+            if (!blendCovered(b.origNode.node, stamp))
                 b.age = halfDuration; // skip the appearing phase
         }
     }
@@ -836,11 +1037,9 @@ void CameraImpl::resolveBlending(TraverseNode *root,
     // render blend draws
     for (auto &b : layer.blendDraws)
     {
-        TraverseNode *trav = findTravById(root, b.trav);
-        TraverseNode *orig = findTravById(trav, b.orig);
-        if (!orig || !trav->determined)
+        if (!b.resolved || !b.travNode.node->determined)
             continue;
-        renderNodeDraws(trav, orig,
+        renderNodeDraws(out, b.travNode.node, b.origNode.node,
             timeToBlendingCoverage(b.age, options.lodBlendingDuration));
     }
 }
@@ -879,8 +1078,7 @@ void CameraImpl::renderUpdate()
     {
         // render original camera
         RenderInfographicsTask task;
-        task.mesh = map->getMesh("internal://data/meshes/line.obj");
-        task.mesh->priority = std::numeric_limits<float>::infinity();
+        task.mesh = internalMesh(map, "internal://data/meshes/line.obj");
         task.color = vec4f(0, 1, 0, 1);
         if (task.ready())
         {
@@ -930,32 +1128,38 @@ void CameraImpl::renderUpdate()
     }
 
     // traverse and generate draws
-    for (auto &it : map->layers)
+    //   each layer is traversed in a separate task
     {
-        if (it->surfaceStack.surfaces.empty())
-            continue;
-        {
-            OPTICK_EVENT("traversal");
-            OPTICK_TAG("freeLayerName", it->freeLayerName.c_str());
-            traverseRender(it->traverseRoot.get());
-        }
-        // resolve blending
-        resolveBlending(it->traverseRoot.get(), layers[it]);
-        // resolve subtile merging
+        cullingStamp = ++cullingStamps;
+        std::vector<std::pair<TraverseNode *, CameraMapLayer *>> roots;
+        for (auto &it : map->layers)
         {
-            OPTICK_EVENT("subtileMerging");
-            for (auto &os : opaqueSubtiles)
-                os.second.resolve(os.first, this);
-            opaqueSubtiles.clear();
+            if (it->surfaceStack.surfaces.empty())
+                continue;
+            roots.emplace_back(it->traverseRoot.get(), &layers[it]);
         }
-        // resolve grid preload
+        std::vector<TraverseTask> tasks(roots.size());
+        map->traversePool.run(roots.size(), [&](uint32 i) {
+            ResourceTouchesScope touches(tasks[i].touches);
+            traverseLayer(tasks[i], roots[i].first, *roots[i].second);
+        });
+        double traversal = 0, blending = 0, subtiles = 0;
+        for (TraverseTask &t : tasks)
         {
-            OPTICK_EVENT("gridPreloadProcess");
-            gridPreloadProcess(it->traverseRoot.get());
+            traversal += t.timeTraversal;
+            blending += t.timeBlending;
+            subtiles += t.timeSubtiles;
+            applyTraverseTask(t);
         }
+        timings.traversal.add(traversal);
+        timings.blending.add(blending);
+        timings.subtiles.add(subtiles);
     }
     sortOpaqueFrontToBack();
 
+    // surface altitudes queries
+    updateAltitudesTasks();
+
     // update camera credits
     map->credits->tick(credits);
 }
@@ -1003,9 +1207,58 @@ void CameraImpl::suggestedNearFar(double &near_, double &far_)
         projected, eye, target - eye);
 }
 
+void CameraImpl::traverseLayer(TraverseTask &out, TraverseNode *root,
+    CameraMapLayer &layer)
+{
+    {
+        OPTICK_EVENT("traversal");
+        OPTICK_TAG("freeLayerName", root->layer->freeLayerName.c_str());
+        ScopedTimer timer(out.timeTraversal);
+        traverseRender(out, root);
+    }
+    // resolve blending
+    {
+        ScopedTimer timer(out.timeBlending);
+        resolveBlending(out, root, layer);
+    }
+    // resolve subtile merging
+    {
+        OPTICK_EVENT("subtileMerging");
+        ScopedTimer timer(out.timeSubtiles);
+        for (auto &os : out.opaqueSubtiles)
+            os.second.resolve(os.first, this, out);
+        out.opaqueSubtiles.clear();
+    }
+    // resolve grid preload
+    {
+        OPTICK_EVENT("gridPreloadProcess");
+        gridPreloadProcess(out, root);
+    }
+}
+
+void CameraImpl::applyTraverseTask(TraverseTask &task)
+{
+    append(draws, task.draws);
+    append(statistics, task.statistics);
+    task.statistics = CameraStatistics();
+    for (TraverseNode *trav : task.creditsHits)
+    {
+        for (auto &it : trav->credits)
+            map->credits->hit(trav->layer->creditScope, it,
+                trav->nodeInfo.distanceFromRoot());
+    }
+    task.creditsHits.clear();
+    map->touchResources(task.touches);
+    task.touches.clear();
+    assert(task.currentDraws.empty());
+    assert(task.opaqueSubtiles.empty());
+    assert(task.gridLoadRequests.empty());
+}
+
 void CameraImpl::sortOpaqueFrontToBack()
 {
     OPTICK_EVENT();
+    ScopedTimer timer(timings.sort);
     vec3 e = rawToVec3(draws.camera.eye);
     std::sort(draws.opaque.begin(), draws.opaque.end(), [e](
         const DrawSurfaceTask &a, const DrawSurfaceTask &b) {
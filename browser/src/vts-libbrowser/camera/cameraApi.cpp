@@ -26,6 +26,7 @@
 
 #include "../include/vts-browser/map.hpp"
 #include "../include/vts-browser/camera.hpp"
+#include "../include/vts-browser/altitudes.hpp"
 
 #include "../camera.hpp"
 #include "../map.hpp"
@@ -124,7 +125,11 @@ void Camera::suggestedNearFar(double &near_, double &far_)
 
 void Camera::renderUpdate()
 {
-    impl->renderUpdate();
+    {
+        ScopedTimer timer(impl->timings.renderUpdate);
+        impl->renderUpdate();
+    }
+    impl->timings.summarize(impl->statistics);
 }
 
 CameraStatistics &Camera::statistics()
@@ -152,4 +157,17 @@ Map *Camera::map()
     return impl->map->map;
 }
 
+std::shared_ptr<AltitudesTask> Camera::surfaceAltitudes(
+    const double *points, uint32 count, double sampleSize)
+{
+    return impl->surfaceAltitudes(points, count, sampleSize);
+}
+
+std::shared_ptr<AltitudesTask> Camera::surfaceAltitudes(
+    const std::vector<std::array<double, 2>> &points, double sampleSize)
+{
+    return surfaceAltitudes(points.empty() ? nullptr : points[0].data(),
+        points.size(), sampleSize);
+}
+
 } // namespace vts
@@ -116,15 +116,26 @@ bool RenderColliderTask::ready() const
 namespace
 {
 
+// the raw pointer is always set
+//   the shared pointer only if the draws are not lightweight
+template<class R>
+void userData(CameraImpl *impl, R &resource,
+    std::shared_ptr<void> &shared, void *&raw)
+{
+    if (!resource)
+        return;
+    raw = resource->getUserDataPinned();
+    if (!impl->options.lightweightDraws)
+        shared = resource->getUserData();
+}
+
 template<class D, class R>
 D convert(CameraImpl *impl, const R &task)
 {
     assert(task.ready());
     D result;
-    if (task.mesh)
-        result.mesh = task.mesh->getUserData();
-    if (task.textureColor)
-        result.texColor = task.textureColor->getUserData();
+    userData(impl, task.mesh, result.mesh, result.meshPtr);
+    userData(impl, task.textureColor, result.texColor, result.texColorPtr);
     mat4f mv = mat4(impl->viewActual * task.model).cast<float>();
     matToRaw(mv, result.mv);
     vecToRaw(task.color, result.color);
@@ -137,8 +148,7 @@ DrawSurfaceTask CameraImpl::convert(const RenderSurfaceTask &task)
 {
     DrawSurfaceTask result = vts::convert<DrawSurfaceTask,
         RenderSurfaceTask>(this, task);
-    if (task.textureMask)
-        result.texMask = task.textureMask->getUserData();
+    userData(this, task.textureMask, result.texMask, result.texMaskPtr);
     matToRaw(task.uvm, result.uvm);
     vecToRaw(vec4f(0, 0, 1, 1), result.uvClip);
     vec3f c = vec4to3(vec4(task.model * vec4(0, 0, 0, 1))).cast<float>();
@@ -167,8 +177,7 @@ DrawColliderTask CameraImpl::convert(const RenderColliderTask &task)
 {
     assert(task.ready());
     DrawColliderTask result;
-    if (task.mesh)
-        result.mesh = task.mesh->getUserData();
+    userData(this, task.mesh, result.mesh, result.meshPtr);
     mat4f mv = mat4(viewActual * task.model).cast<float>();
     matToRaw(mv, result.mv);
     return result;
@@ -68,7 +68,8 @@ SubtilesMerger::Subtile::Subtile(TraverseNode *orig, const vec4f &uvClip)
     : orig(orig), uvClip(uvClip)
 {}
 
-void SubtilesMerger::resolve(TraverseNode *trav, CameraImpl *impl)
+void SubtilesMerger::resolve(TraverseNode *trav, CameraImpl *impl,
+    TraverseTask &out)
 {
     assert(!subtiles.empty());
     std::sort(subtiles.begin(), subtiles.end(),
@@ -97,13 +98,13 @@ void SubtilesMerger::resolve(TraverseNode *trav, CameraImpl *impl)
         if (it.orig)
         {
             for (auto &r : trav->opaque)
-                impl->draws.opaque.emplace_back(impl->convert(r,
+                out.draws.opaque.emplace_back(impl->convert(r,
                         it.uvClip, nan1()));
         }
     }
 }
 
-void CameraImpl::gridPreloadRequest(TraverseNode *trav)
+void CameraImpl::gridPreloadRequest(TraverseTask &out, TraverseNode *trav)
 {
     assert(trav);
     if (options.balancedGridLodOffset == (uint32)-1)
@@ -127,27 +128,27 @@ void CameraImpl::gridPreloadRequest(TraverseNode *trav)
             TileId t = base;
             tileWrap(m, t.x, x);
             tileWrap(m, t.y, y);
-            gridLoadRequests.push_back(t);
+            out.gridLoadRequests.push_back(t);
         }
     }
 }
 
-void CameraImpl::gridPreloadProcess(TraverseNode *root)
+void CameraImpl::gridPreloadProcess(TraverseTask &out, TraverseNode *root)
 {
-    auto &glr = gridLoadRequests;
+    auto &glr = out.gridLoadRequests;
     std::sort(glr.begin(), glr.end());
     glr.erase(std::unique(glr.begin(), glr.end()), glr.end());
-    statistics.currentGridNodes += glr.size();
-    gridPreloadProcess(root, glr);
+    out.statistics.currentGridNodes += glr.size();
+    gridPreloadProcess(out, root, glr);
     glr.clear();
 }
 
-void CameraImpl::gridPreloadProcess(TraverseNode *trav,
+void CameraImpl::gridPreloadProcess(TraverseTask &out, TraverseNode *trav,
     const std::vector<TileId> &requests)
 {
     if (requests.empty())
         return;
-    if (!travInit(trav))
+    if (!travInit(out, trav))
         return;
 
     TileId myId = trav->id();
@@ -160,15 +161,15 @@ void CameraImpl::gridPreloadProcess(TraverseNode *trav,
         if (t.lod == myId.lod)
         {
             assert(t == myId);
-            travDetermineDraws(trav);
-            trav->lastRenderTime = trav->lastAccessTime;
+            travDetermineDraws(out, trav);
+            trav->lastRenderTime = trav->lastAccessTime.load();
         }
         else
             childRequests[childIndex(myId, t)].push_back(t);
     }
 
     for (const auto &c : trav->childs)
-        gridPreloadProcess(c.get(), childRequests[
+        gridPreloadProcess(out, c.get(), childRequests[
             childIndex(myId, c->id())]);
 }
 
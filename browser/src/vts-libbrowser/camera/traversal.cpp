@@ -50,14 +50,52 @@ vec3 lowerUpperCombine(uint32 i)
     return res;
 }
 
+bool allTrue(const Array<bool, 4> &oks)
+{
+    for (uint32 i = 0; i < oks.size(); i++)
+        if (!oks[i])
+            return false;
+    return true;
+}
+
+// calls fnc(out, child, index) for all childs of the node
+//   subtrees near the roots are independent and are traversed concurrently,
+//   each with a task of its own, the tasks are merged in the childs order
+template<class F>
+void travChilds(CameraImpl *impl, TraverseTask &out, TraverseNode *trav,
+    F fnc)
+{
+    uint32 cnt = trav->childs.size();
+    if (!travForks(trav))
+    {
+        for (uint32 i = 0; i < cnt; i++)
+            fnc(out, trav->childs[i].get(), i);
+        return;
+    }
+    TraverseTask tasks[4];
+    impl->map->traversePool.run(cnt, [&](uint32 i) {
+        ResourceTouchesScope touches(tasks[i].touches);
+        fnc(tasks[i], trav->childs[i].get(), i);
+    });
+    for (uint32 i = 0; i < cnt; i++)
+        out.merge(tasks[i]);
+}
+
 } // namespace
 
+bool travForks(const TraverseNode *trav)
+{
+    // deeper subtrees are too small to pay for the tasks
+    static const uint32 maxLod = 5;
+    return trav->childs.size() >= 2 && trav->id().lod <= maxLod;
+}
+
 double CameraImpl::travDistance(TraverseNode *trav, const vec3 pointPhys)
 {
     // checking the distance in node srs may be more accurate,
     //   but the resulting distance is in different units
-    return aabbPointDist(pointPhys, trav->aabbPhys[0],
-            trav->aabbPhys[1]);
+    const vec3 *aabb = trav->hot->aabbPhys[trav->slot];
+    return aabbPointDist(pointPhys, aabb[0], aabb[1]);
 }
 
 void CameraImpl::updateNodePriority(TraverseNode *trav)
@@ -79,7 +117,8 @@ std::shared_ptr<GpuTexture> CameraImpl::travInternalTexture(
     UrlTemplate::Vars vars(trav->id(),
             vtslibs::vts::local(trav->nodeInfo), subMeshIndex);
     std::shared_ptr<GpuTexture> res = map->getTexture(
-                trav->surface->urlIntTex(vars));
+                trav->surface->urlIntTex, vars);
+    res->transcode = true;
     map->touchResource(res);
     res->updatePriority(trav->priority);
     return res;
@@ -98,6 +137,7 @@ bool CameraImpl::generateMonolithicGeodataTrav(TraverseNode *trav)
 
     // extents
     {
+        vec3 *aabb = trav->hot->aabbPhys[trav->slot];
         if (g.extents.ll != g.extents.ur)
         {
             vec3 el = vecFromUblas<vec3>
@@ -110,15 +150,15 @@ bool CameraImpl::generateMonolithicGeodataTrav(TraverseNode *trav)
                 (vecFromUblas<vec3>(g.extents.ll) - el).cwiseProduct(ed));
             trav->meta->extents.ur = vecToUblas<math::Point3>(
                 (vecFromUblas<vec3>(g.extents.ur) - el).cwiseProduct(ed));
-            trav->aabbPhys[0] = vecFromUblas<vec3>(g.extents.ll);
-            trav->aabbPhys[1] = vecFromUblas<vec3>(g.extents.ur);
+            aabb[0] = vecFromUblas<vec3>(g.extents.ll);
+            aabb[1] = vecFromUblas<vec3>(g.extents.ur);
         }
         else
         {
             const auto &e = map->mapconfig->referenceFrame.division.extents;
             trav->meta->extents = e;
-            trav->aabbPhys[0] = vecFromUblas<vec3>(e.ll);
-            trav->aabbPhys[1] = vecFromUblas<vec3>(e.ur);
+            aabb[0] = vecFromUblas<vec3>(e.ll);
+            aabb[1] = vecFromUblas<vec3>(e.ur);
         }
     }
 
@@ -131,7 +171,7 @@ bool CameraImpl::generateMonolithicGeodataTrav(TraverseNode *trav)
     return true;
 }
 
-bool CameraImpl::travDetermineMeta(TraverseNode *trav)
+bool CameraImpl::travDetermineMeta(TraverseTask &out, TraverseNode *trav)
 {
     assert(trav->layer);
     assert(!trav->meta);
@@ -141,7 +181,7 @@ bool CameraImpl::travDetermineMeta(TraverseNode *trav)
     assert(!trav->parent || trav->parent->meta);
 
     // statistics
-    statistics.currentNodeMetaUpdates++;
+    out.statistics.currentNodeMetaUpdates++;
 
     // handle non-tiled geodata
     if (trav->layer->freeLayer
@@ -172,7 +212,7 @@ bool CameraImpl::travDetermineMeta(TraverseNode *trav)
                 continue;
         }
         auto m = map->getMetaTile(trav->layer->surfaceStack.surfaces[i]
-                             .urlMeta(tileIdVars));
+                             .urlMeta, tileIdVars);
         // metatiles have higher priority than other resources
         m->updatePriority(trav->priority * 2);
         switch (map->getResourceValidity(m))
@@ -243,7 +283,7 @@ bool CameraImpl::travDetermineMeta(TraverseNode *trav)
     for (uint32 i = 0; i < 4; i++)
     {
         if (childsAvailable[i])
-            trav->childs.push_back(std::make_unique<TraverseNode>(
+            trav->childs.push_back(trav->layer->traverseNodes.acquire(
                     trav->layer, trav, trav->nodeInfo.child(childs[i])));
     }
 
@@ -256,6 +296,9 @@ bool CameraImpl::travDetermineMeta(TraverseNode *trav)
 void CameraImpl::travDetermineMetaImpl(TraverseNode *trav)
 {
     assert(trav->meta);
+    TraverseNodeHot &h = *trav->hot;
+    vec3 *corners = h.cornersPhys[trav->slot];
+    vec3 *aabb = h.aabbPhys[trav->slot];
 
     // corners
     if (!vtslibs::vts::empty(trav->meta->geomExtents)
@@ -266,14 +309,23 @@ void CameraImpl::travDetermineMetaImpl(TraverseNode *trav)
         vec3 el = vec2to3(fl, double(trav->meta->geomExtents.z.min));
         vec3 eu = vec2to3(fu, double(trav->meta->geomExtents.z.max));
         vec3 ed = eu - el;
-        vec3 *corners = trav->cornersPhys;
+
+        // convert all points at once: 8 corners and 3 disk points
+        vec3 points[11];
         for (uint32 i = 0; i < 8; i++)
+            points[i] = lowerUpperCombine(i).cwiseProduct(ed) + el;
+        bool disks = trav->id().lod > 4;
+        if (disks)
         {
-            vec3 f = lowerUpperCombine(i).cwiseProduct(ed) + el;
-            f = map->convertor->convert(f,
-                    trav->nodeInfo.node(), Srs::Physical);
-            corners[i] = f;
+            vec2 sds2 = vec2((fu + fl) * 0.5);
+            points[8] = vec2to3(sds2, double(trav->meta->geomExtents.z.min));
+            points[9] = vec2to3(sds2, double(trav->meta->geomExtents.z.max));
+            points[10] = vec2to3(fu, double(trav->meta->geomExtents.z.min));
         }
+        map->convertor->convert(points, disks ? 11 : 8,
+                trav->nodeInfo.node(), Srs::Physical);
+        for (uint32 i = 0; i < 8; i++)
+            corners[i] = points[i];
 
         // obb
         if (trav->id().lod > 4)
@@ -305,23 +357,16 @@ void CameraImpl::travDetermineMetaImpl(TraverseNode *trav)
         }
 
         // disks
-        if (trav->id().lod > 4)
+        if (disks)
         {
-            vec2 sds2 = vec2((fu + fl) * 0.5);
-            vec3 sds = vec2to3(sds2, double(trav->meta->geomExtents.z.min));
-            vec3 vn1 = map->convertor->convert(sds,
-                trav->nodeInfo.node(), Srs::Physical);
-            trav->diskNormalPhys = vn1.normalized();
-            trav->diskHeightsPhys[0] = vn1.norm();
-            sds = vec2to3(sds2, double(trav->meta->geomExtents.z.max));
-            vec3 vn2 = map->convertor->convert(sds,
-                trav->nodeInfo.node(), Srs::Physical);
-            trav->diskHeightsPhys[1] = vn2.norm();
-            sds = vec2to3(fu, double(trav->meta->geomExtents.z.min));
-            vec3 vc = map->convertor->convert(sds,
-                trav->nodeInfo.node(), Srs::Physical);
-            trav->diskHalfAngle = std::acos(dot(trav->diskNormalPhys,
-                                                vc.normalized()));
+            const vec3 &vn1 = points[8];
+            h.diskNormalPhys[trav->slot] = vn1.normalized();
+            h.diskHeightsPhys[trav->slot][0] = vn1.norm();
+            const vec3 &vn2 = points[9];
+            h.diskHeightsPhys[trav->slot][1] = vn2.norm();
+            const vec3 &vc = points[10];
+            h.diskHalfAngle[trav->slot] = std::acos(dot(
+                h.diskNormalPhys[trav->slot], vc.normalized()));
         }
     }
     else if (trav->meta->extents.ll != trav->meta->extents.ur)
@@ -337,7 +382,7 @@ void CameraImpl::travDetermineMetaImpl(TraverseNode *trav)
         for (uint32 i = 0; i < 8; i++)
         {
             vec3 f = lowerUpperCombine(i).cwiseProduct(fd) + fl;
-            trav->cornersPhys[i] = f.cwiseProduct(ed) + el;
+            corners[i] = f.cwiseProduct(ed) + el;
         }
     }
     else
@@ -349,11 +394,11 @@ void CameraImpl::travDetermineMetaImpl(TraverseNode *trav)
     // aabb
     if (trav->id().lod > 2)
     {
-        trav->aabbPhys[0] = trav->aabbPhys[1] = trav->cornersPhys[0];
-        for (const vec3 &it : trav->cornersPhys)
+        aabb[0] = aabb[1] = corners[0];
+        for (uint32 i = 0; i < 8; i++)
         {
-            trav->aabbPhys[0] = min(trav->aabbPhys[0], it);
-            trav->aabbPhys[1] = max(trav->aabbPhys[1], it);
+            aabb[0] = min(aabb[0], corners[i]);
+            aabb[1] = max(aabb[1], corners[i]);
         }
     }
 
@@ -380,23 +425,24 @@ void CameraImpl::travDetermineMetaImpl(TraverseNode *trav)
 
         if (applyTexelSize)
         {
-            trav->texelSize = trav->meta->texelSize;
+            h.texelSize[trav->slot] = trav->meta->texelSize;
         }
         else if (applyDisplaySize)
         {
-            vec3 s = trav->aabbPhys[1] - trav->aabbPhys[0];
+            vec3 s = aabb[1] - aabb[0];
             double m = std::max(s[0], std::max(s[1], s[2]));
-            trav->texelSize = m / trav->meta->displaySize;
+            h.texelSize[trav->slot] = m / trav->meta->displaySize;
         }
         else
         {
             // the test fails by default
-            trav->texelSize = std::numeric_limits<double>::infinity();
+            h.texelSize[trav->slot]
+                = std::numeric_limits<double>::infinity();
         }
     }
 }
 
-bool CameraImpl::travDetermineDraws(TraverseNode *trav)
+bool CameraImpl::travDetermineDraws(TraverseTask &out, TraverseNode *trav)
 {
     assert(trav->meta);
     touchDraws(trav);
@@ -405,7 +451,7 @@ bool CameraImpl::travDetermineDraws(TraverseNode *trav)
     assert(trav->rendersEmpty());
 
     // statistics
-    statistics.currentNodeDrawsUpdates++;
+    out.statistics.currentNodeDrawsUpdates++;
 
     // update priority
     updateNodePriority(trav);
@@ -423,9 +469,8 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
     // aggregate mesh
     if (!trav->meshAgg)
     {
-        std::string name = trav->surface->urlMesh(
+        trav->meshAgg = map->getMeshAggregate(trav->surface->urlMesh,
             UrlTemplate::Vars(nodeId, vtslibs::vts::local(trav->nodeInfo)));
-        trav->meshAgg = map->getMeshAggregate(name);
 
         // prefetch internal textures
         if (trav->meta->geometry())
@@ -491,6 +536,10 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
                 {
                     const BoundInfo *l = b.bound;
                     assert(l);
+                    // credits are merged by other tasks resolving
+                    //   external bound layers
+                    std::lock_guard<std::recursive_mutex> lock(
+                        map->traverseMut);
                     for (auto &it : l->credits)
                     {
                         auto c = map->credits->find(it.first);
@@ -578,6 +627,9 @@ bool CameraImpl::travDetermineDrawsSurface(TraverseNode *trav)
 
 bool CameraImpl::travDetermineDrawsGeodata(TraverseNode *trav)
 {
+    // styles and features are shared by the traversal tasks
+    std::lock_guard<std::recursive_mutex> lock(map->traverseMut);
+
     const TileId nodeId = trav->id();
     std::string geoName = trav->surface->urlGeodata(
             UrlTemplate::Vars(nodeId, vtslibs::vts::local(trav->nodeInfo)));
@@ -599,7 +651,7 @@ bool CameraImpl::travDetermineDrawsGeodata(TraverseNode *trav)
     geo->updatePriority(trav->priority);
     geo->update(style.second, features.second,
         map->mapconfig->browserOptions.value,
-        trav->aabbPhys, trav->id());
+        trav->hot->aabbPhys[trav->slot], trav->id());
     switch (map->getResourceValidity(geo))
     {
     case Validity::Invalid:
@@ -621,12 +673,12 @@ bool CameraImpl::travDetermineDrawsGeodata(TraverseNode *trav)
     return true;
 }
 
-bool CameraImpl::travInit(TraverseNode *trav)
+bool CameraImpl::travInit(TraverseTask &out, TraverseNode *trav)
 {
     // statistics
     {
-        statistics.metaNodesTraversedTotal++;
-        statistics.metaNodesTraversedPerLod[
+        out.statistics.metaNodesTraversedTotal++;
+        out.statistics.metaNodesTraversedPerLod[
                 std::min<uint32>(trav->id().lod,
                                  CameraStatistics::MaxLods-1)]++;
     }
@@ -637,20 +689,29 @@ bool CameraImpl::travInit(TraverseNode *trav)
 
     // prepare meta data
     if (!trav->meta)
-        return travDetermineMeta(trav);
+        return travDetermineMeta(out, trav);
 
     return true;
 }
 
-void CameraImpl::travModeHierarchical(TraverseNode *trav, bool loadOnly)
+bool CameraImpl::travInit(TraverseNode *trav)
+{
+    TraverseTask out;
+    bool res = travInit(out, trav);
+    applyTraverseTask(out);
+    return res;
+}
+
+void CameraImpl::travModeHierarchical(TraverseTask &out, TraverseNode *trav,
+    bool loadOnly)
 {
-    if (!travInit(trav))
+    if (!travInit(out, trav))
         return;
 
     // the resources may not be unloaded
-    trav->lastRenderTime = trav->lastAccessTime;
+    trav->lastRenderTime = trav->lastAccessTime.load();
 
-    travDetermineDraws(trav);
+    travDetermineDraws(out, trav);
 
     if (loadOnly)
         return;
@@ -661,7 +722,7 @@ void CameraImpl::travModeHierarchical(TraverseNode *trav, bool loadOnly)
     if (coarsenessTest(trav) || trav->childs.empty())
     {
         if (trav->determined)
-            renderNode(trav);
+            renderNode(out, trav);
         return;
     }
 
@@ -677,16 +738,18 @@ void CameraImpl::travModeHierarchical(TraverseNode *trav, bool loadOnly)
             ok = false;
     }
 
-    for (auto &t : trav->childs)
-        travModeHierarchical(t.get(), !ok);
+    travChilds(this, out, trav, [&](TraverseTask &sub,
+        TraverseNode *t, uint32) {
+        travModeHierarchical(sub, t, !ok);
+    });
 
     if (!ok && trav->determined)
-        renderNode(trav);
+        renderNode(out, trav);
 }
 
-void CameraImpl::travModeFlat(TraverseNode *trav)
+void CameraImpl::travModeFlat(TraverseTask &out, TraverseNode *trav)
 {
-    if (!travInit(trav))
+    if (!travInit(out, trav))
         return;
 
     if (!visibilityTest(trav))
@@ -694,19 +757,22 @@ void CameraImpl::travModeFlat(TraverseNode *trav)
 
     if (coarsenessTest(trav) || trav->childs.empty())
     {
-        if (travDetermineDraws(trav))
-            renderNode(trav);
+        if (travDetermineDraws(out, trav))
+            renderNode(out, trav);
         return;
     }
 
-    for (auto &t : trav->childs)
-        travModeFlat(t.get());
+    travChilds(this, out, trav, [&](TraverseTask &sub,
+        TraverseNode *t, uint32) {
+        travModeFlat(sub, t);
+    });
 }
 
 // mode == 0 -> default
 // mode == 1 -> load only -> returns true if loaded
 // mode == 2 -> render only
-bool CameraImpl::travModeStable(TraverseNode *trav, int mode)
+bool CameraImpl::travModeStable(TraverseTask &out, TraverseNode *trav,
+    int mode)
 {
     if (mode == 2)
     {
@@ -716,7 +782,7 @@ bool CameraImpl::travModeStable(TraverseNode *trav, int mode)
     }
     else
     {
-        if (!travInit(trav))
+        if (!travInit(out, trav))
             return false;
     }
 
@@ -728,50 +794,57 @@ bool CameraImpl::travModeStable(TraverseNode *trav, int mode)
         if (trav->determined)
         {
             touchDraws(trav);
-            renderNode(trav);
+            renderNode(out, trav);
         }
         else for (auto &t : trav->childs)
-            travModeStable(t.get(), 2);
+            travModeStable(out, t.get(), 2);
         return true;
     }
 
     if (coarsenessTest(trav) || trav->childs.empty())
     {
-        travDetermineDraws(trav);
+        travDetermineDraws(out, trav);
         if (mode == 1)
         {
             trav->lastRenderTime = map->renderTickIndex;
             return trav->determined;
         }
         if (trav->determined)
-            renderNode(trav);
+            renderNode(out, trav);
         else for (auto &t : trav->childs)
-            travModeStable(t.get(), 2);
+            travModeStable(out, t.get(), 2);
         return true;
     }
 
     if (mode == 0 && trav->determined)
     {
-        bool ok = true;
-        for (auto &t : trav->childs)
-            ok = travModeStable(t.get(), 1) && ok;
-        if (!ok)
+        Array<bool, 4> oks;
+        oks.resize(trav->childs.size());
+        travChilds(this, out, trav, [&](TraverseTask &sub,
+            TraverseNode *t, uint32 i) {
+            oks[i] = travModeStable(sub, t, 1);
+        });
+        if (!allTrue(oks))
         {
             touchDraws(trav);
-            renderNode(trav);
+            renderNode(out, trav);
             return true;
         }
     }
 
     {
-        bool ok = true;
-        for (auto &t : trav->childs)
-            ok = travModeStable(t.get(), mode) && ok;
-        return ok;
+        Array<bool, 4> oks;
+        oks.resize(trav->childs.size());
+        travChilds(this, out, trav, [&](TraverseTask &sub,
+            TraverseNode *t, uint32 i) {
+            oks[i] = travModeStable(sub, t, mode);
+        });
+        return allTrue(oks);
     }
 }
 
-bool CameraImpl::travModeBalanced(TraverseNode *trav, bool renderOnly)
+bool CameraImpl::travModeBalanced(TraverseTask &out, TraverseNode *trav,
+    bool renderOnly)
 {
     if (renderOnly)
     {
@@ -781,7 +854,7 @@ bool CameraImpl::travModeBalanced(TraverseNode *trav, bool renderOnly)
     }
     else
     {
-        if (!travInit(trav))
+        if (!travInit(out, trav))
             return false;
     }
 
@@ -793,16 +866,16 @@ bool CameraImpl::travModeBalanced(TraverseNode *trav, bool renderOnly)
         if (trav->determined)
         {
             touchDraws(trav);
-            renderNode(trav);
+            renderNode(out, trav);
             return true;
         }
     }
     else if (coarsenessTest(trav) || trav->childs.empty())
     {
-        gridPreloadRequest(trav);
-        if (travDetermineDraws(trav))
+        gridPreloadRequest(out, trav);
+        if (travDetermineDraws(out, trav))
         {
-            renderNode(trav);
+            renderNode(out, trav);
             return true;
         }
         renderOnly = true;
@@ -810,28 +883,28 @@ bool CameraImpl::travModeBalanced(TraverseNode *trav, bool renderOnly)
 
     Array<bool, 4> oks;
     oks.resize(trav->childs.size());
-    uint32 i = 0, okc = 0;
-    for (auto &it : trav->childs)
-    {
-        bool ok = travModeBalanced(it.get(), renderOnly);
-        oks[i++] = ok;
-        if (ok)
+    travChilds(this, out, trav, [&](TraverseTask &sub,
+        TraverseNode *t, uint32 i) {
+        oks[i] = travModeBalanced(sub, t, renderOnly);
+    });
+    uint32 okc = 0;
+    for (uint32 i = 0; i < oks.size(); i++)
+        if (oks[i])
             okc++;
-    }
     if (okc == 0 && renderOnly)
         return false;
-    i = 0;
+    uint32 i = 0;
     for (auto &it : trav->childs)
     {
         if (!oks[i++])
-            renderNodeCoarser(it.get());
+            renderNodeCoarser(out, it.get());
     }
     return true;
 }
 
-void CameraImpl::travModeFixed(TraverseNode *trav)
+void CameraImpl::travModeFixed(TraverseTask &out, TraverseNode *trav)
 {
-    if (!travInit(trav))
+    if (!travInit(out, trav))
         return;
 
     if (travDistance(trav, focusPosPhys) > options.fixedTraversalDistance)
@@ -840,16 +913,18 @@ void CameraImpl::travModeFixed(TraverseNode *trav)
     if (trav->id().lod >= options.fixedTraversalLod
         || trav->childs.empty())
     {
-        if (travDetermineDraws(trav))
-            renderNode(trav);
+        if (travDetermineDraws(out, trav))
+            renderNode(out, trav);
         return;
     }
 
-    for (auto &t : trav->childs)
-        travModeFixed(t.get());
+    travChilds(this, out, trav, [&](TraverseTask &sub,
+        TraverseNode *t, uint32) {
+        travModeFixed(sub, t);
+    });
 }
 
-void CameraImpl::traverseRender(TraverseNode *trav)
+void CameraImpl::traverseRender(TraverseTask &out, TraverseNode *trav)
 {
     switch (trav->layer->isGeodata() ? options.traverseModeGeodata
                                      : options.traverseModeSurfaces)
@@ -857,19 +932,19 @@ void CameraImpl::traverseRender(TraverseNode *trav)
     case TraverseMode::None:
         break;
     case TraverseMode::Flat:
-        travModeFlat(trav);
+        travModeFlat(out, trav);
         break;
     case TraverseMode::Stable:
-        travModeStable(trav, 0);
+        travModeStable(out, trav, 0);
         break;
     case TraverseMode::Balanced:
-        travModeBalanced(trav, false);
+        travModeBalanced(out, trav, false);
         break;
     case TraverseMode::Hierarchical:
-        travModeHierarchical(trav, false);
+        travModeHierarchical(out, trav, false);
         break;
     case TraverseMode::Fixed:
-        travModeFixed(trav);
+        travModeFixed(out, trav);
         break;
     default:
         assert(false);
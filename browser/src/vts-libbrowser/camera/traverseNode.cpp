@@ -24,8 +24,11 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <new>
+
 #include "../camera.hpp"
 #include "../traverseNode.hpp"
+#include "../mapLayer.hpp"
 #include "../renderTasks.hpp"
 #include "../hashTileId.hpp"
 #include "../geodata.hpp"
@@ -33,29 +36,43 @@
 namespace vts
 {
 
+namespace
+{
+
+uint32 hotSlot(uint32 poolIndex)
+{
+    return poolIndex % TraverseNodeHot::Size;
+}
+
+} // namespace
+
 TraverseNode::TraverseNode(MapLayer *layer, TraverseNode *parent,
-                           const NodeInfo &nodeInfo)
+        const NodeInfo &nodeInfo, TraverseNodeHot *hot, uint32 poolIndex)
     : layer(layer), parent(parent),
       nodeInfo(nodeInfo),
       hash(std::hash<TileId>()(id())),
-      diskNormalPhys(nan3()),
-      diskHeightsPhys(nan2()),
-      diskHalfAngle(nan1()),
-      texelSize(nan1()),
+      poolIndex(poolIndex),
+      hot(hot), slot(hotSlot(poolIndex)),
       priority(nan1())
 {
+    // the slot may have been used by another node
+    hot->diskNormalPhys[slot] = nan3();
+    hot->diskHeightsPhys[slot] = nan2();
+    hot->diskHalfAngle[slot] = nan1();
+    hot->texelSize[slot] = nan1();
+    hot->cullingStamp[slot] = 0;
     // initialize corners to NAN
     {
         for (uint32 i = 0; i < 8; i++)
-            cornersPhys[i] = nan3();
+            hot->cornersPhys[slot][i] = nan3();
         surrogatePhys = nan3();
     }
     // initialize aabb to universe
     {
         double di = std::numeric_limits<double>::infinity();
         vec3 vi(di, di, di);
-        aabbPhys[0] = -vi;
-        aabbPhys[1] = vi;
+        hot->aabbPhys[slot][0] = -vi;
+        hot->aabbPhys[slot][1] = vi;
     }
 }
 
@@ -108,5 +125,132 @@ bool TraverseNode::rendersEmpty() const
             && (!geodataAgg || geodataAgg->renders.empty());
 }
 
+void TraverseNodeRelease::operator()(TraverseNode *node) const
+{
+    node->layer->traverseNodes.release(node);
+}
+
+struct TraverseNodePool::Chunk
+{
+    TraverseNodeHot hot;
+    std::aligned_storage<sizeof(TraverseNode),
+        alignof(TraverseNode)>::type nodes[TraverseNodeHot::Size];
+};
+
+TraverseNodePool::TraverseNodePool()
+{}
+
+TraverseNodePool::~TraverseNodePool()
+{
+    while (!released.empty())
+    {
+        TraverseNode *node = released.back();
+        released.pop_back();
+        destroy(node);
+    }
+    assert(freeSlots.size() == capacity());
+}
+
+TraverseNodePtr TraverseNodePool::acquire(MapLayer *layer,
+    TraverseNode *parent, const NodeInfo &nodeInfo)
+{
+    std::lock_guard<std::recursive_mutex> lock(mut);
+    if (freeSlots.empty())
+    {
+        if (!released.empty())
+        {
+            TraverseNode *node = released.back();
+            released.pop_back();
+            destroy(node);
+        }
+        else
+            grow();
+    }
+    assert(!freeSlots.empty());
+    uint32 index = freeSlots.back();
+    Chunk *c = chunks[index / TraverseNodeHot::Size].get();
+    void *ptr = &c->nodes[hotSlot(index)];
+    TraverseNode *node = new (ptr) TraverseNode(layer, parent, nodeInfo,
+                                                &c->hot, index);
+    freeSlots.pop_back();
+    return TraverseNodePtr(node);
+}
+
+void TraverseNodePool::release(TraverseNode *node)
+{
+    std::lock_guard<std::recursive_mutex> lock(mut);
+    // the children of the node are released when it is destroyed
+    node->detached = true;
+    generations[node->poolIndex]++;
+    released.push_back(node);
+}
+
+TraverseNodeHandle TraverseNodePool::handle(TraverseNode *node) const
+{
+    TraverseNodeHandle h;
+    h.node = node;
+    h.poolIndex = node->poolIndex;
+    h.generation = generations[node->poolIndex];
+    return h;
+}
+
+TraverseNode *TraverseNodePool::resolve(const TraverseNodeHandle &h,
+    uint32 stamp)
+{
+    if (!h.node || generations[h.poolIndex] != h.generation)
+        return nullptr;
+    // a node is destroyed only after all its descendants are released
+    //   therefore the walk stops before reaching any destroyed node
+    TraverseNode *t = h.node;
+    for (; t && t->attachedStamp != stamp; t = t->parent)
+        if (t->detached)
+            return nullptr;
+    for (TraverseNode *u = h.node; u != t; u = u->parent)
+        u->attachedStamp = stamp;
+    return h.node;
+}
+
+void TraverseNodePool::collect()
+{
+    // destroying a node releases its children,
+    //   therefore whole subtrees are freed over several calls
+    uint32 cnt = released.size() / 4;
+    if (cnt < TraverseNodeHot::Size)
+        cnt = TraverseNodeHot::Size;
+    while (cnt-- > 0 && !released.empty())
+    {
+        TraverseNode *node = released.back();
+        released.pop_back();
+        destroy(node);
+    }
+}
+
+uint32 TraverseNodePool::capacity() const
+{
+    return chunks.size() * TraverseNodeHot::Size;
+}
+
+uint32 TraverseNodePool::pending() const
+{
+    return released.size();
+}
+
+void TraverseNodePool::destroy(TraverseNode *node)
+{
+    uint32 index = node->poolIndex;
+    node->~TraverseNode();
+    freeSlots.push_back(index);
+}
+
+void TraverseNodePool::grow()
+{
+    uint32 base = capacity();
+    chunks.push_back(std::make_unique<Chunk>());
+    generations.resize(capacity(), 0);
+    // reversed, so that siblings get consecutive slots
+    for (uint32 i = TraverseNodeHot::Size; i-- > 0;)
+        freeSlots.push_back(base + i);
+}
+
 } // namespace vts
 
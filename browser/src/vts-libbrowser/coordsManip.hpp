@@ -62,6 +62,13 @@ public:
     virtual vec3 convert(const vec3 &value, const Node &from, Srs to) = 0;
     virtual vec3 convert(const vec3 &value, Srs from, const Node &to) = 0;
 
+    // converts all the values in place
+    virtual void convert(vec3 *values, uint32 count, Srs from, Srs to) = 0;
+    virtual void convert(vec3 *values, uint32 count,
+                            const Node &from, Srs to) = 0;
+    virtual void convert(vec3 *values, uint32 count,
+                            Srs from, const Node &to) = 0;
+
     virtual vec3 geoDirect(const vec3 &position, double distance,
                               double azimuthIn, double &azimuthOut) = 0;
     vec3 geoDirect(const vec3 &position, double distance,
@@ -47,6 +47,9 @@ using TileId = vtslibs::registry::ReferenceFrame::Division::Node::Id;
 class GpuFont;
 class GpuTexture;
 class GpuGeodataSpec;
+class GeodataStyleCompiled;
+class GeodataShards;
+class GeodataJob;
 
 class GeodataFeatures : public Resource
 {
@@ -68,6 +71,7 @@ public:
 
     std::string data;
     std::shared_ptr<const Json::Value> json;
+    std::shared_ptr<const GeodataStyleCompiled> compiled;
     std::map<std::string, std::shared_ptr<GpuFont>> fonts;
     std::map<std::string, std::shared_ptr<GpuTexture>> bitmaps;
     Validity dependenciesValidity = Validity::Indeterminate;
@@ -82,6 +86,9 @@ public:
     void decode() override;
     void upload() override;
     bool requiresUpload() override { return true; }
+    // splits large tiles into shards for other threads
+    // returns false while other shards of the tile are still processing
+    bool process(const GeodataJob &job);
     FetchTask::ResourceType resourceType() const override;
     void update(
         const std::shared_ptr<GeodataStylesheet> &style,
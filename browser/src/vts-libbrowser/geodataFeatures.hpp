@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GEODATA_FEATURES_HPP_f7r2ws1
+#define GEODATA_FEATURES_HPP_f7r2ws1
+
+#include <vector>
+#include <string>
+
+#include "utilities/json.hpp"
+#include "include/vts-browser/math.hpp"
+
+namespace vts
+{
+
+// compact binary encoding of geodata features:
+//   coordinates are quantized and delta encoded (when they are integral),
+//   properties are stored in typed columns per group and feature type
+//   and all strings are shared in a single table
+
+bool isGeodataFeaturesBinary(const std::string &data);
+
+// validate enables the same checks as the validating geodata processing
+std::string convertGeodataFeaturesToBinary(
+    const Json::Value &features, bool validate);
+std::string convertGeodataFeaturesToBinary(
+    const std::string &json, bool validate);
+
+// streaming decoder over the binary encoding
+//   no intermediate document is constructed,
+//   values are decoded only when asked for
+class GeodataFeaturesReader
+{
+public:
+    enum class Type : uint8
+    {
+        Point,
+        Line,
+        Polygon,
+    };
+
+    // the data must outlive the reader
+    explicit GeodataFeaturesReader(const std::string &data);
+
+    sint32 version() const { return version_; }
+
+    // groups
+    bool nextGroup();
+    const Json::Value &groupId() const { return groupId_; }
+    const vec3 *groupBbox() const { return groupBbox_; }
+    double groupResolution() const { return groupResolution_; }
+
+    // features of the current group
+    uint32 beginFeatures(Type type); // returns number of features
+    bool nextFeature();
+    Json::Value id() const;
+    Json::Value property(const std::string &name) const;
+
+    // geometry of the current feature
+    //   points: single list, lines: list per line,
+    //   polygons: single list with the middle point
+    void positions(std::vector<std::vector<vec3>> &result) const;
+    void polygon(std::vector<vec3> &vertices,
+        std::vector<uint32> &surface) const; // polygons only
+
+    // reconstructs the current feature (for diagnostics)
+    Json::Value featureJson() const;
+
+private:
+    struct Span
+    {
+        const char *data;
+        uint32 size;
+    };
+
+    struct Column
+    {
+        const char *data;
+        uint32 name;
+        uint8 kind;
+    };
+
+    Column column(const char *&p, const char *e, bool named) const;
+    Json::Value value(uint8 tag, const char *payload) const;
+    Json::Value columnValue(const Column &c) const;
+    const char *columnEntry(const Column &c, uint8 &tag) const;
+    const char *list(const char *p, const char *e,
+        std::vector<vec3> &result) const;
+
+    std::vector<Span> strings;
+    std::vector<Column> columns;
+    Column ids;
+    Json::Value groupId_;
+    vec3 groupBbox_[2];
+    double groupResolution_;
+    const char *ptr; // position of the next group
+    const char *end;
+    const char *groupPtr; // position of the next features block
+    const char *groupEnd;
+    const char *featurePtr; // position of the next feature geometry
+    const char *blockEnd;
+    const char *geometry; // geometry of the current feature
+    const char *geometryEnd;
+    uint32 groupsLeft;
+    uint32 featuresCount;
+    uint32 featureIndex;
+    sint32 version_;
+    uint8 nextBlock;
+    Type type;
+    bool quantized;
+};
+
+} // namespace vts
+
+#endif
@@ -0,0 +1,252 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GEODATA_STYLE_HPP_k4h6df8
+#define GEODATA_STYLE_HPP_k4h6df8
+
+#include <array>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <string>
+
+#include "utilities/json.hpp"
+#include "include/vts-browser/foundation.hpp"
+
+namespace vts
+{
+
+// style layer properties which are evaluated for every feature
+#define VTS_GEODATA_STYLE_PROPERTIES(X) \
+    X(Visible, "visible") \
+    X(Point, "point") \
+    X(Line, "line") \
+    X(Icon, "icon") \
+    X(LineLabel, "line-label") \
+    X(Label, "label") \
+    X(Polygon, "polygon") \
+    X(ZIndex, "z-index") \
+    X(ZbufferOffset, "zbuffer-offset") \
+    X(Visibility, "visibility") \
+    X(VisibilityAbs, "visibility-abs") \
+    X(VisibilityRel, "visibility-rel") \
+    X(Culling, "culling") \
+    X(PointFlat, "point-flat") \
+    X(PointColor, "point-color") \
+    X(PointRadius, "point-radius") \
+    X(PointRadiusUnits, "point-radius-units") \
+    X(LineFlat, "line-flat") \
+    X(LineColor, "line-color") \
+    X(LineWidth, "line-width") \
+    X(LineWidthUnits, "line-width-units") \
+    X(Pack, "pack") \
+    X(IconSource, "icon-source") \
+    X(IconScale, "icon-scale") \
+    X(IconOrigin, "icon-origin") \
+    X(IconOffset, "icon-offset") \
+    X(IconNoOverlap, "icon-no-overlap") \
+    X(IconNoOverlapMargin, "icon-no-overlap-margin") \
+    X(IconColor, "icon-color") \
+    X(IconStick, "icon-stick") \
+    X(Hysteresis, "hysteresis") \
+    X(ImportanceSource, "importance-source") \
+    X(ImportanceWeight, "importance-weight") \
+    X(LineLabelFont, "line-label-font") \
+    X(LineLabelColor, "line-label-color") \
+    X(LineLabelColor2, "line-label-color2") \
+    X(LineLabelOutline, "line-label-outline") \
+    X(LineLabelOffset, "line-label-offset") \
+    X(LineLabelNoOverlapMargin, "line-label-no-overlap-margin") \
+    X(LineLabelSize, "line-label-size") \
+    X(LineLabelSource, "line-label-source") \
+    X(LabelFont, "label-font") \
+    X(LabelColor, "label-color") \
+    X(LabelColor2, "label-color2") \
+    X(LabelOutline, "label-outline") \
+    X(LabelOffset, "label-offset") \
+    X(LabelNoOverlap, "label-no-overlap") \
+    X(LabelNoOverlapMargin, "label-no-overlap-margin") \
+    X(LabelSize, "label-size") \
+    X(LabelWidth, "label-width") \
+    X(LabelOrigin, "label-origin") \
+    X(LabelAlign, "label-align") \
+    X(LabelStick, "label-stick") \
+    X(LabelSource, "label-source") \
+    X(PolygonColor, "polygon-color") \
+    X(PolygonStyle, "polygon-style") \
+    X(PolygonUseStencil, "polygon-use-stencil")
+
+// geodata stylesheet prepared for repeated evaluation
+//   inheritance is resolved and all expressions are compiled
+//   into a tree of operations, which is evaluated
+//   without any string comparisons
+// it is immutable once constructed, except for layers
+//   created lazily by visibility-switch (guarded by a mutex)
+class GeodataStyleCompiled : private Immovable
+{
+public:
+    enum class Property : uint8
+    {
+#define X(NAME, STR) NAME,
+        VTS_GEODATA_STYLE_PROPERTIES(X)
+#undef X
+        Count_
+    };
+
+    enum class Identifier : uint8
+    {
+        Invalid,
+        Id,
+        Group,
+        Type,
+        Metric,
+        Language,
+        Lod,
+        Ix,
+        Iy,
+        TileSize,
+    };
+
+    enum class Op : uint8
+    {
+        // values
+        Literal, // the value itself
+        Array, // array of evaluated args
+        Template, // string with {} expansions, args alternate with strings
+        Constant, // @constant
+        Property, // $property
+        Variable, // &variable (interned)
+        VariableDynamic, // &variable (not interned)
+        Identifier, // #identifier
+        Invalid, // always throws the error
+        UnknownFunction, // returns the value itself
+
+        // functions
+        Sgn, Sin, Cos, Tan, Asin, Acos, Atan, Sqrt, Abs,
+        Deg2rad, Rad2deg, Log, Round,
+        Add, Sub, Mul, Div, Pow, Atan2, Mod, Random,
+        Clamp, Min, Max, If,
+        Strlen, Str2num, Lowercase, Uppercase, Capitalize, Trim,
+        Find, Replace, Substr, HasLatin, IsCjk,
+        Map, Discrete, Discrete2, Linear, Linear2, LodScaled, LogScale,
+
+        // filters
+        FilterSkip, FilterInvalid, FilterUnknown,
+        FilterEqual, FilterNotEqual,
+        FilterGreaterEqual, FilterLessEqual, FilterGreater, FilterLess,
+        FilterNot, FilterHas, FilterIn, FilterAll, FilterAny, FilterNone,
+    };
+
+    struct Expr
+    {
+        std::vector<const Expr *> args;
+        Json::Value value; // literal value
+        std::string name; // constant, property, variable or identifier
+        std::string error; // reported when validating
+        const Json::Value *source = nullptr; // original expression
+        uint32 index = 0; // constant, variable or identifier
+        Op op = Op::Literal;
+    };
+
+    struct Layer;
+
+    struct Switch
+    {
+        const Expr *visibility = nullptr;
+        const Expr *layerName = nullptr; // null if empty
+        mutable std::atomic<const Layer *> merged {nullptr};
+    };
+
+    struct Layer
+    {
+        Json::Value source; // with resolved inheritance
+        std::string name;
+        std::array<const Expr *, (int)Property::Count_> properties {};
+        std::vector<const Expr *> variables; // indexed by variable id
+        const Expr *filter = nullptr;
+
+        // next-pass
+        const Layer *nextPass = nullptr;
+        std::string nextPassName;
+        std::string nextPassError;
+        sint32 nextPassZ = 0;
+        bool hasNextPass = false;
+
+        // visibility-switch
+        std::deque<Switch> switches;
+        bool hasSwitch = false;
+
+        const Expr *operator [] (Property p) const
+        { return properties[(int)p]; }
+        bool has(Property p) const
+        { return !!properties[(int)p]; }
+    };
+
+    explicit GeodataStyleCompiled(const Json::Value &style);
+
+    const Layer *findLayer(const std::string &name) const;
+
+    // layer produced by a visibility-switch
+    const Layer *mergedLayer(const Layer &base, const Switch &sw,
+        const std::string &name) const;
+
+    static Identifier findIdentifier(const std::string &name);
+
+    // compiles expressions which are not part of the stylesheet
+    //   (eg. values computed at runtime)
+    // the nodes are stored in the provided container
+    const Expr *compileExpression(std::deque<Expr> &nodes,
+        const Json::Value &expression) const;
+    const Expr *compileString(std::deque<Expr> &nodes,
+        const std::string &s) const;
+
+    const Json::Value constantsSource;
+    std::map<std::string, const Layer *> layersByName;
+    std::vector<const Expr *> constants; // indexed by constant id
+    std::map<std::string, uint32> constantIds;
+    std::map<std::string, uint32> variableIds;
+
+    // candidate layers for each feature type (points, lines, polygons)
+    std::array<std::vector<const Layer *>, 3> typedLayers;
+
+private:
+    friend class GeodataStyleCompiler;
+    void compileLayer(Layer &layer, bool intern) const;
+
+    // storage of all nodes and layers
+    //   grows only, previously returned pointers stay valid
+    mutable std::deque<Expr> nodes;
+    mutable std::deque<Layer> layers;
+    mutable std::map<std::pair<const Layer *, std::string>,
+        const Layer *> mergedDynamic;
+    mutable std::mutex mergedMutex;
+};
+
+} // namespace vts
+
+#endif
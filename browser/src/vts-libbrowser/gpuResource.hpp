@@ -48,6 +48,7 @@ public:
             const vtslibs::vts::SubMesh &m);
     void decode() override;
     void upload() override;
+    void uploadDone() override;
     bool requiresUpload() override { return true; }
     FetchTask::ResourceType resourceType() const override;
     uint32 faces = 0;
@@ -59,6 +60,7 @@ public:
     GpuTexture(MapImpl *map, const std::string &name);
     void decode() override;
     void upload() override;
+    void uploadDone() override;
     bool requiresUpload() override { return true; }
     FetchTask::ResourceType resourceType() const override;
     GpuTextureSpec::FilterMode filterMode
@@ -66,6 +68,15 @@ public:
     GpuTextureSpec::WrapMode wrapMode
         = GpuTextureSpec::WrapMode::ClampToEdge;
     uint32 width = 0, height = 0;
+    // color textures of surfaces and bound layers
+    //   are transcoded into compressed formats
+    //   and decoded at reduced resolution (if enabled in options)
+    std::atomic<bool> transcode {false};
+    std::string transcodedName() const; // in the disk cache, or empty
+    // the content was read from the disk cache under the transcodedName
+    //   (the transcoded format is accepted from there only)
+    std::atomic<bool> fromTranscodedCache {false};
+    uint32 decodeScale() const;
 };
 
 class GpuAtmosphereDensityTexture : public GpuTexture
@@ -104,6 +115,7 @@ public:
     MeshAggregate(MapImpl *map, const std::string &name);
     void decode() override;
     void upload() override;
+    void uploadDone() override;
     bool requiresUpload() override { return true; }
     FetchTask::ResourceType resourceType() const override;
 
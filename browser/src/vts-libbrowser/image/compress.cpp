@@ -0,0 +1,780 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <dbglog/dbglog.hpp>
+
+#include "compress.hpp"
+
+namespace vts
+{
+
+namespace
+{
+
+// 4x4 pixels, rgba, row major
+struct Block
+{
+    int px[16][4];
+};
+
+void fetchBlock(const unsigned char *pixels, uint32 width, uint32 height,
+    uint32 components, uint32 bx, uint32 by, Block &b)
+{
+    for (uint32 y = 0; y < 4; y++)
+    {
+        for (uint32 x = 0; x < 4; x++)
+        {
+            // the borders are extended by clamping
+            uint32 sx = std::min(bx * 4 + x, width - 1);
+            uint32 sy = std::min(by * 4 + y, height - 1);
+            const unsigned char *s = pixels + (sy * width + sx) * components;
+            int *d = b.px[y * 4 + x];
+            for (uint32 c = 0; c < 3; c++)
+                d[c] = s[c];
+            d[3] = components == 4 ? s[3] : 255;
+        }
+    }
+}
+
+void storeBlock(const Block &b, uint32 width, uint32 height,
+    uint32 bx, uint32 by, unsigned char *output)
+{
+    for (uint32 y = 0; y < 4; y++)
+    {
+        for (uint32 x = 0; x < 4; x++)
+        {
+            uint32 sx = bx * 4 + x;
+            uint32 sy = by * 4 + y;
+            if (sx >= width || sy >= height)
+                continue;
+            unsigned char *d = output + (sy * width + sx) * 4;
+            for (uint32 c = 0; c < 4; c++)
+                d[c] = (unsigned char)b.px[y * 4 + x][c];
+        }
+    }
+}
+
+int clamp255(int v)
+{
+    return std::min(std::max(v, 0), 255);
+}
+
+int colorError(const int a[], const int b[])
+{
+    int r = 0;
+    for (int c = 0; c < 3; c++)
+        r += (a[c] - b[c]) * (a[c] - b[c]);
+    return r;
+}
+
+////////////////////////////
+// BC1 (color)
+////////////////////////////
+
+int quantize(float v, int maxValue)
+{
+    return std::min(std::max((int)std::floor(v * maxValue / 255 + 0.5f),
+        0), maxValue);
+}
+
+uint16 pack565(const float c[3])
+{
+    int r = quantize(c[0], 31), g = quantize(c[1], 63), b = quantize(c[2], 31);
+    return (uint16)((r << 11) | (g << 5) | b);
+}
+
+void unpack565(uint16 v, int out[3])
+{
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+void bc1Palette(uint16 c0, uint16 c1, int palette[4][3])
+{
+    unpack565(c0, palette[0]);
+    unpack565(c1, palette[1]);
+    for (int c = 0; c < 3; c++)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+}
+
+// assigns the indices for the endpoints (in the four colors mode)
+// returns the squared error
+int bc1Fit(const Block &b, uint16 &c0, uint16 &c1, uint32 &indices)
+{
+    if (c0 < c1)
+        std::swap(c0, c1);
+    int palette[4][3];
+    bc1Palette(c0, c1, palette);
+    int err = 0;
+    indices = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int best = 0;
+        int bestErr = colorError(b.px[i], palette[0]);
+        if (c0 != c1)
+        {
+            for (int j = 1; j < 4; j++)
+            {
+                int e = colorError(b.px[i], palette[j]);
+                if (e < bestErr)
+                {
+                    bestErr = e;
+                    best = j;
+                }
+            }
+        }
+        indices |= (uint32)best << (i * 2);
+        err += bestErr;
+    }
+    return err;
+}
+
+void encodeBc1(const Block &b, unsigned char out[8])
+{
+    // principal axis of the colors
+    float mean[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+            mean[c] += b.px[i][c];
+    for (int c = 0; c < 3; c++)
+        mean[c] /= 16;
+    float cov[3][3] = {};
+    for (int i = 0; i < 16; i++)
+    {
+        float d[3];
+        for (int c = 0; c < 3; c++)
+            d[c] = b.px[i][c] - mean[c];
+        for (int y = 0; y < 3; y++)
+            for (int x = 0; x < 3; x++)
+                cov[y][x] += d[y] * d[x];
+    }
+    float axis[3] = { 1, 1, 1 };
+    for (int iter = 0; iter < 8; iter++)
+    {
+        float n[3];
+        for (int y = 0; y < 3; y++)
+            n[y] = cov[y][0] * axis[0] + cov[y][1] * axis[1]
+                + cov[y][2] * axis[2];
+        float l = std::max(std::max(std::abs(n[0]), std::abs(n[1])),
+            std::abs(n[2]));
+        if (l < 1e-6f)
+            break;
+        for (int c = 0; c < 3; c++)
+            axis[c] = n[c] / l;
+    }
+    float al = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+    // endpoints at the extremes of the projections
+    float tMin = 0, tMax = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = 0;
+        for (int c = 0; c < 3; c++)
+            t += (b.px[i][c] - mean[c]) * axis[c];
+        t /= al;
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+    float e0[3], e1[3];
+    for (int c = 0; c < 3; c++)
+    {
+        e0[c] = mean[c] + axis[c] * tMax;
+        e1[c] = mean[c] + axis[c] * tMin;
+    }
+    uint16 c0 = pack565(e0), c1 = pack565(e1);
+    uint32 indices;
+    int err = bc1Fit(b, c0, c1, indices);
+
+    // refine the endpoints with least squares for the assigned indices
+    if (err > 0 && c0 != c1)
+    {
+        static const float weights[4] = { 1, 0, 2.f / 3, 1.f / 3 };
+        float aa = 0, bb = 0, ab = 0, ax[3] = {}, bx[3] = {};
+        for (int i = 0; i < 16; i++)
+        {
+            float wa = weights[(indices >> (i * 2)) & 3];
+            float wb = 1 - wa;
+            aa += wa * wa;
+            bb += wb * wb;
+            ab += wa * wb;
+            for (int c = 0; c < 3; c++)
+            {
+                ax[c] += wa * b.px[i][c];
+                bx[c] += wb * b.px[i][c];
+            }
+        }
+        float det = aa * bb - ab * ab;
+        if (std::abs(det) > 1e-6f)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+                e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+            }
+            uint16 r0 = pack565(e0), r1 = pack565(e1);
+            uint32 ri;
+            int re = bc1Fit(b, r0, r1, ri);
+            if (re < err)
+            {
+                c0 = r0;
+                c1 = r1;
+                indices = ri;
+            }
+        }
+    }
+
+    out[0] = c0 & 255;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 255;
+    out[3] = c1 >> 8;
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (indices >> (i * 8)) & 255;
+}
+
+void decodeBc1(const unsigned char in[8], Block &b)
+{
+    uint16 c0 = in[0] | (in[1] << 8);
+    uint16 c1 = in[2] | (in[3] << 8);
+    int palette[4][3];
+    bc1Palette(c0, c1, palette);
+    bool transparent = false;
+    if (c0 <= c1)
+    {
+        // three colors mode
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+        transparent = true;
+    }
+    uint32 indices = in[4] | (in[5] << 8) | (in[6] << 16)
+        | ((uint32)in[7] << 24);
+    for (int i = 0; i < 16; i++)
+    {
+        uint32 j = (indices >> (i * 2)) & 3;
+        for (int c = 0; c < 3; c++)
+            b.px[i][c] = palette[j][c];
+        b.px[i][3] = transparent && j == 3 ? 0 : 255;
+    }
+}
+
+////////////////////////////
+// BC3 (alpha)
+////////////////////////////
+
+void bc3AlphaPalette(int a0, int a1, int palette[8])
+{
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1)
+    {
+        for (int i = 1; i < 7; i++)
+            palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+    }
+    else
+    {
+        for (int i = 1; i < 5; i++)
+            palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+void encodeBc3Alpha(const Block &b, unsigned char out[8])
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        a0 = std::max(a0, b.px[i][3]);
+        a1 = std::min(a1, b.px[i][3]);
+    }
+    int palette[8];
+    bc3AlphaPalette(a0, a1, palette);
+    uint64 indices = 0;
+    if (a0 != a1)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0;
+            for (int j = 1; j < 8; j++)
+                if (std::abs(palette[j] - b.px[i][3])
+                    < std::abs(palette[best] - b.px[i][3]))
+                    best = j;
+            indices |= (uint64)best << (i * 3);
+        }
+    }
+    out[0] = (unsigned char)a0;
+    out[1] = (unsigned char)a1;
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (indices >> (i * 8)) & 255;
+}
+
+void decodeBc3Alpha(const unsigned char in[8], Block &b)
+{
+    int palette[8];
+    bc3AlphaPalette(in[0], in[1], palette);
+    uint64 indices = 0;
+    for (int i = 0; i < 6; i++)
+        indices |= (uint64)in[2 + i] << (i * 8);
+    for (int i = 0; i < 16; i++)
+        b.px[i][3] = palette[(indices >> (i * 3)) & 7];
+}
+
+////////////////////////////
+// ETC2 (color)
+////////////////////////////
+
+const int etcModifiers[8][2] = {
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 },
+    { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 },
+};
+
+int etcModifier(uint32 table, uint32 index)
+{
+    // index: 0 = +a, 1 = +b, 2 = -a, 3 = -b
+    int m = etcModifiers[table][index & 1];
+    return index & 2 ? -m : m;
+}
+
+bool etcInSubblock(int i, bool flip, int sub)
+{
+    // i is row major index
+    int x = i % 4, y = i / 4;
+    return ((flip ? y : x) >= 2) == (sub == 1);
+}
+
+// finds the best table and indices for the base color
+// returns the squared error
+int etcSubblock(const Block &b, const int base[3], bool flip, int sub,
+    uint32 &bestTable, uint32 indices[16])
+{
+    int bestErr = -1;
+    uint32 tmp[16];
+    for (uint32 t = 0; t < 8; t++)
+    {
+        int err = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            if (!etcInSubblock(i, flip, sub))
+                continue;
+            int be = -1;
+            for (uint32 j = 0; j < 4; j++)
+            {
+                int m = etcModifier(t, j);
+                int c[3] = { clamp255(base[0] + m), clamp255(base[1] + m),
+                    clamp255(base[2] + m) };
+                int e = colorError(b.px[i], c);
+                if (be < 0 || e < be)
+                {
+                    be = e;
+                    tmp[i] = j;
+                }
+            }
+            err += be;
+            if (bestErr >= 0 && err >= bestErr)
+                break;
+        }
+        if (bestErr < 0 || err < bestErr)
+        {
+            bestErr = err;
+            bestTable = t;
+            for (int i = 0; i < 16; i++)
+                if (etcInSubblock(i, flip, sub))
+                    indices[i] = tmp[i];
+        }
+    }
+    return bestErr;
+}
+
+int expand4(int v)
+{
+    return (v << 4) | v;
+}
+
+int expand5(int v)
+{
+    return (v << 3) | (v >> 2);
+}
+
+void encodeEtc2(const Block &b, unsigned char out[8])
+{
+    int bestErr = -1;
+    for (int flip = 0; flip < 2; flip++)
+    {
+        float avg[2][3] = {};
+        for (int i = 0; i < 16; i++)
+        {
+            int s = etcInSubblock(i, flip, 1) ? 1 : 0;
+            for (int c = 0; c < 3; c++)
+                avg[s][c] += b.px[i][c] / 8.f;
+        }
+        for (int diff = 0; diff < 2; diff++)
+        {
+            int q[2][3], base[2][3];
+            for (int s = 0; s < 2; s++)
+            {
+                for (int c = 0; c < 3; c++)
+                {
+                    q[s][c] = quantize(avg[s][c], diff ? 31 : 15);
+                    base[s][c] = diff ? expand5(q[s][c]) : expand4(q[s][c]);
+                }
+            }
+            if (diff)
+            {
+                // the differences must fit into three bits
+                //   otherwise the block would be in another etc2 mode
+                bool valid = true;
+                for (int c = 0; c < 3; c++)
+                {
+                    int d = q[1][c] - q[0][c];
+                    valid = valid && d >= -4 && d <= 3;
+                }
+                if (!valid)
+                    continue;
+            }
+            uint32 tables[2];
+            uint32 indices[16];
+            int err = etcSubblock(b, base[0], flip, 0, tables[0], indices)
+                + etcSubblock(b, base[1], flip, 1, tables[1], indices);
+            if (bestErr >= 0 && err >= bestErr)
+                continue;
+            bestErr = err;
+            for (int c = 0; c < 3; c++)
+            {
+                if (diff)
+                    out[c] = (unsigned char)((q[0][c] << 3)
+                        | ((q[1][c] - q[0][c]) & 7));
+                else
+                    out[c] = (unsigned char)((q[0][c] << 4) | q[1][c]);
+            }
+            out[3] = (unsigned char)((tables[0] << 5) | (tables[1] << 2)
+                | (diff << 1) | flip);
+            uint32 msb = 0, lsb = 0;
+            for (int i = 0; i < 16; i++)
+            {
+                // the pixels are in column major order
+                int bit = (i % 4) * 4 + i / 4;
+                msb |= (indices[i] >> 1) << bit;
+                lsb |= (indices[i] & 1) << bit;
+            }
+            out[4] = (unsigned char)(msb >> 8);
+            out[5] = (unsigned char)(msb & 255);
+            out[6] = (unsigned char)(lsb >> 8);
+            out[7] = (unsigned char)(lsb & 255);
+        }
+    }
+}
+
+void decodeEtc2(const unsigned char in[8], Block &b)
+{
+    bool diff = in[3] & 2;
+    bool flip = in[3] & 1;
+    int base[2][3];
+    for (int c = 0; c < 3; c++)
+    {
+        if (diff)
+        {
+            int q0 = in[c] >> 3;
+            int d = in[c] & 7;
+            if (d >= 4)
+                d -= 8;
+            if (q0 + d < 0 || q0 + d > 31)
+            {
+                LOGTHROW(err2, std::runtime_error)
+                    << "Unsupported etc2 block mode";
+            }
+            base[0][c] = expand5(q0);
+            base[1][c] = expand5(q0 + d);
+        }
+        else
+        {
+            base[0][c] = expand4(in[c] >> 4);
+            base[1][c] = expand4(in[c] & 15);
+        }
+    }
+    uint32 tables[2] = { (uint32)in[3] >> 5, ((uint32)in[3] >> 2) & 7 };
+    uint32 msb = (in[4] << 8) | in[5];
+    uint32 lsb = (in[6] << 8) | in[7];
+    for (int i = 0; i < 16; i++)
+    {
+        int bit = (i % 4) * 4 + i / 4;
+        uint32 j = (((msb >> bit) & 1) << 1) | ((lsb >> bit) & 1);
+        int s = etcInSubblock(i, flip, 1) ? 1 : 0;
+        int m = etcModifier(tables[s], j);
+        for (int c = 0; c < 3; c++)
+            b.px[i][c] = clamp255(base[s][c] + m);
+        b.px[i][3] = 255;
+    }
+}
+
+////////////////////////////
+// EAC (alpha)
+////////////////////////////
+
+const int eacModifiers[16][8] = {
+    { -3, -6, -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 },
+    { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 },
+    { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 },
+    { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 },
+    { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 },
+    { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 },
+    { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 },
+    { -3, -5, -7, -9, 2, 4, 6, 8 },
+};
+
+void encodeEacAlpha(const Block &b, unsigned char out[8])
+{
+    int aMin = 255, aMax = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        aMin = std::min(aMin, b.px[i][3]);
+        aMax = std::max(aMax, b.px[i][3]);
+    }
+    // table 13 has zero modifier at index 4
+    int bestBase = aMin, bestMul = 1, bestTable = 13;
+    uint64 bestIndices = 0;
+    for (int i = 0; i < 16; i++)
+        bestIndices |= (uint64)4 << (45 - ((i % 4) * 4 + i / 4) * 3);
+    if (aMin != aMax)
+    {
+        int bestErr = -1;
+        for (int t = 0; t < 16; t++)
+        {
+            const int *mods = eacModifiers[t];
+            int range = mods[7] - mods[3];
+            int mulEst = (aMax - aMin + range / 2) / range;
+            for (int mul = std::max(mulEst - 1, 1);
+                mul <= std::min(mulEst + 1, 15); mul++)
+            {
+                int center = (aMin + aMax) / 2
+                    - mul * (mods[7] + mods[3]) / 2;
+                for (int base = std::max(center - 1, 0);
+                    base <= std::min(center + 1, 255); base++)
+                {
+                    int err = 0;
+                    uint64 indices = 0;
+                    for (int i = 0; i < 16 && (bestErr < 0
+                        || err < bestErr); i++)
+                    {
+                        int be = -1, bj = 0;
+                        for (int j = 0; j < 8; j++)
+                        {
+                            int v = clamp255(base + mods[j] * mul);
+                            int e = (v - b.px[i][3]) * (v - b.px[i][3]);
+                            if (be < 0 || e < be)
+                            {
+                                be = e;
+                                bj = j;
+                            }
+                        }
+                        err += be;
+                        indices |= (uint64)bj
+                            << (45 - ((i % 4) * 4 + i / 4) * 3);
+                    }
+                    if (bestErr < 0 || err < bestErr)
+                    {
+                        bestErr = err;
+                        bestBase = base;
+                        bestMul = mul;
+                        bestTable = t;
+                        bestIndices = indices;
+                    }
+                }
+            }
+        }
+    }
+    out[0] = (unsigned char)bestBase;
+    out[1] = (unsigned char)((bestMul << 4) | bestTable);
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (bestIndices >> (40 - i * 8)) & 255;
+}
+
+void decodeEacAlpha(const unsigned char in[8], Block &b)
+{
+    int base = in[0];
+    int mul = in[1] >> 4;
+    const int *mods = eacModifiers[in[1] & 15];
+    uint64 indices = 0;
+    for (int i = 0; i < 6; i++)
+        indices |= (uint64)in[2 + i] << (40 - i * 8);
+    for (int i = 0; i < 16; i++)
+    {
+        int j = (indices >> (45 - ((i % 4) * 4 + i / 4) * 3)) & 7;
+        b.px[i][3] = clamp255(base + mods[j] * mul);
+    }
+}
+
+} // namespace
+
+bool isCompressedFormat(uint32 format)
+{
+    switch ((CompressedFormat)format)
+    {
+    case CompressedFormat::Bc1:
+    case CompressedFormat::Bc3:
+    case CompressedFormat::Etc2:
+    case CompressedFormat::Etc2Eac:
+        return true;
+    default:
+        return false;
+    }
+}
+
+uint32 compressedSize(CompressedFormat format, uint32 width, uint32 height)
+{
+    uint32 blocks = ((width + 3) / 4) * ((height + 3) / 4);
+    switch (format)
+    {
+    case CompressedFormat::Bc1:
+    case CompressedFormat::Etc2:
+        return blocks * 8;
+    case CompressedFormat::Bc3:
+    case CompressedFormat::Etc2Eac:
+        return blocks * 16;
+    default:
+        LOGTHROW(fatal, std::invalid_argument)
+            << "invalid compressed format";
+    }
+}
+
+void compressImage(CompressedFormat format,
+    const unsigned char *pixels, uint32 width, uint32 height,
+    uint32 components, unsigned char *output)
+{
+    assert(components == 3 || components == 4);
+    uint32 bw = (width + 3) / 4, bh = (height + 3) / 4;
+    Block b;
+    for (uint32 by = 0; by < bh; by++)
+    {
+        for (uint32 bx = 0; bx < bw; bx++)
+        {
+            fetchBlock(pixels, width, height, components, bx, by, b);
+            switch (format)
+            {
+            case CompressedFormat::Bc1:
+                encodeBc1(b, output);
+                output += 8;
+                break;
+            case CompressedFormat::Bc3:
+                encodeBc3Alpha(b, output);
+                encodeBc1(b, output + 8);
+                output += 16;
+                break;
+            case CompressedFormat::Etc2:
+                encodeEtc2(b, output);
+                output += 8;
+                break;
+            case CompressedFormat::Etc2Eac:
+                encodeEacAlpha(b, output);
+                encodeEtc2(b, output + 8);
+                output += 16;
+                break;
+            }
+        }
+    }
+}
+
+void decompressImage(CompressedFormat format,
+    const unsigned char *blocks, uint32 width, uint32 height,
+    unsigned char *output)
+{
+    uint32 bw = (width + 3) / 4, bh = (height + 3) / 4;
+    Block b;
+    for (uint32 by = 0; by < bh; by++)
+    {
+        for (uint32 bx = 0; bx < bw; bx++)
+        {
+            switch (format)
+            {
+            case CompressedFormat::Bc1:
+                decodeBc1(blocks, b);
+                blocks += 8;
+                break;
+            case CompressedFormat::Bc3:
+                decodeBc1(blocks + 8, b);
+                decodeBc3Alpha(blocks, b);
+                blocks += 16;
+                break;
+            case CompressedFormat::Etc2:
+                decodeEtc2(blocks, b);
+                blocks += 8;
+                break;
+            case CompressedFormat::Etc2Eac:
+                decodeEtc2(blocks + 8, b);
+                decodeEacAlpha(blocks, b);
+                blocks += 16;
+                break;
+            }
+            storeBlock(b, width, height, bx, by, output);
+        }
+    }
+}
+
+void downsampleImage(const unsigned char *pixels,
+    uint32 width, uint32 height, uint32 components,
+    unsigned char *output)
+{
+    uint32 w = std::max(width / 2, 1u), h = std::max(height / 2, 1u);
+    for (uint32 y = 0; y < h; y++)
+    {
+        uint32 y0 = std::min(y * 2, height - 1);
+        uint32 y1 = std::min(y * 2 + 1, height - 1);
+        for (uint32 x = 0; x < w; x++)
+        {
+            uint32 x0 = std::min(x * 2, width - 1);
+            uint32 x1 = std::min(x * 2 + 1, width - 1);
+            for (uint32 c = 0; c < components; c++)
+            {
+                uint32 s = pixels[(y0 * width + x0) * components + c]
+                    + pixels[(y0 * width + x1) * components + c]
+                    + pixels[(y1 * width + x0) * components + c]
+                    + pixels[(y1 * width + x1) * components + c];
+                output[(y * w + x) * components + c]
+                    = (unsigned char)((s + 2) / 4);
+            }
+        }
+    }
+}
+
+} // namespace vts
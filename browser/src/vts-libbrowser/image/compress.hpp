@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPRESS_HPP_gw4h5zr8
+#define COMPRESS_HPP_gw4h5zr8
+
+#include "../include/vts-browser/foundation.hpp"
+
+namespace vts
+{
+
+// gpu block compressed formats (values compatible with OpenGL)
+enum class CompressedFormat : uint32
+{
+    Bc1 = 0x83F0, // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    Bc3 = 0x83F3, // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+    Etc2 = 0x9274, // GL_COMPRESSED_RGB8_ETC2
+    Etc2Eac = 0x9278, // GL_COMPRESSED_RGBA8_ETC2_EAC
+};
+
+bool isCompressedFormat(uint32 format);
+
+// size in bytes of one level of the image in the format
+uint32 compressedSize(CompressedFormat format, uint32 width, uint32 height);
+
+// encode 8 bit image with 3 or 4 components
+// the output must have compressedSize bytes
+void compressImage(CompressedFormat format,
+    const unsigned char *pixels, uint32 width, uint32 height,
+    uint32 components, unsigned char *output);
+
+// decode into 8 bit image with 4 components
+// only the etc2 modes produced by the encoder are supported
+void decompressImage(CompressedFormat format,
+    const unsigned char *blocks, uint32 width, uint32 height,
+    unsigned char *output);
+
+// box filter the 8 bit image to half the resolution (rounded down)
+void downsampleImage(const unsigned char *pixels,
+    uint32 width, uint32 height, uint32 components,
+    unsigned char *output);
+
+} // namespace vts
+
+#endif
@@ -25,15 +25,18 @@
  */
 
 #include "image.hpp"
+#include "compress.hpp"
 
 #include <dbglog/dbglog.hpp>
 #include <cstdio>
+#include <algorithm>
 
 namespace vts
 {
 
 void decodeImage(const Buffer &in, Buffer &out,
-                 uint32 &width, uint32 &height, uint32 &components)
+                 uint32 &width, uint32 &height, uint32 &components,
+                 const ImageDecodeOptions &options)
 {
     if (in.size() < 8)
         LOGTHROW(err1, std::runtime_error) << "insufficient image data";
@@ -42,9 +45,9 @@ void decodeImage(const Buffer &in, Buffer &out,
     static const unsigned char jpegSignature[]
         = { 0xFF, 0xD8, 0xFF };
     if (memcmp(in.data(), pngSignature, sizeof(pngSignature)) == 0)
-        decodePng(in, out, width, height, components);
+        decodePng(in, out, width, height, components, options);
     else if (memcmp(in.data(), jpegSignature, sizeof(jpegSignature)) == 0)
-        decodeJpeg(in, out, width, height, components);
+        decodeJpeg(in, out, width, height, components, options);
     else
     {
         // raw image data - assume square
@@ -53,6 +56,34 @@ void decodeImage(const Buffer &in, Buffer &out,
         if (in.size() != width * height * components)
             LOGTHROW(err1, std::runtime_error) << "Raw image is not square";
         out = in.copy();
+        if (options.bottomUp)
+        {
+            uint32 lineSize = width * components;
+            for (uint32 y = 0; y < height / 2; y++)
+                std::swap_ranges(out.data() + y * lineSize,
+                    out.data() + (y + 1) * lineSize,
+                    out.data() + (height - y - 1) * lineSize);
+        }
+        downscaleImage(out, width, height, components,
+                       options.scaleDenominator);
+    }
+}
+
+void downscaleImage(Buffer &buffer,
+                    uint32 &width, uint32 &height, uint32 components,
+                    uint32 scaleDenominator)
+{
+    while (scaleDenominator > 1 && (width > 1 || height > 1))
+    {
+        Buffer tmp(std::max(width / 2, 1u) * std::max(height / 2, 1u)
+                   * components);
+        downsampleImage((unsigned char *)buffer.data(),
+                        width, height, components,
+                        (unsigned char *)tmp.data());
+        buffer = std::move(tmp);
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+        scaleDenominator /= 2;
     }
 }
 
@@ -32,14 +32,34 @@
 namespace vts
 {
 
+struct ImageDecodeOptions
+{
+    // reduce the resolution of the image by this factor (1, 2, 4 or 8)
+    // jpeg images are decoded directly at the reduced resolution
+    //   (dct scaling), other images are downsampled after decoding
+    uint32 scaleDenominator = 1;
+
+    // the first row of the output is the bottom row of the image
+    //   (as expected by opengl), which avoids a separate vertical flip
+    bool bottomUp = false;
+};
+
 void decodePng(const Buffer &in, Buffer &out,
-               uint32 &width, uint32 &height, uint32 &components);
+               uint32 &width, uint32 &height, uint32 &components,
+               const ImageDecodeOptions &options = ImageDecodeOptions());
 
 void decodeJpeg(const Buffer &in, Buffer &out,
-                uint32 &width, uint32 &height, uint32 &components);
+                uint32 &width, uint32 &height, uint32 &components,
+                const ImageDecodeOptions &options = ImageDecodeOptions());
 
 void decodeImage(const Buffer &in, Buffer &out,
-                 uint32 &width, uint32 &height, uint32 &components);
+                 uint32 &width, uint32 &height, uint32 &components,
+                 const ImageDecodeOptions &options = ImageDecodeOptions());
+
+// box filter the image by the scale denominator (power of two)
+void downscaleImage(Buffer &buffer,
+                    uint32 &width, uint32 &height, uint32 components,
+                    uint32 scaleDenominator);
 
 void encodePng(const Buffer &in, Buffer &out,
                uint32 width, uint32 height, uint32 components);
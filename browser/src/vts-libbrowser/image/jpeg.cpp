@@ -24,7 +24,9 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include "../include/vts-browser/buffer.hpp"
+#include "image.hpp"
+
+#include <vector>
 
 #include <stdio.h> // needed for jpeglib
 #include <jpeglib.h>
@@ -48,7 +50,8 @@ void jpegErrFunc(j_common_ptr cinfo)
 } // namespace
 
 void decodeJpeg(const Buffer &in, Buffer &out,
-                uint32 &width, uint32 &height, uint32 &components)
+                uint32 &width, uint32 &height, uint32 &components,
+                const ImageDecodeOptions &options)
 {
     jpeg_decompress_struct info;
     jpeg_error_mgr errmgr;
@@ -59,18 +62,25 @@ void decodeJpeg(const Buffer &in, Buffer &out,
         jpeg_create_decompress(&info);
         jpeg_mem_src(&info, (unsigned char*)in.data(), in.size());
         jpeg_read_header(&info, TRUE);
+        info.scale_num = 1;
+        info.scale_denom = options.scaleDenominator;
         jpeg_start_decompress(&info);
         width = info.output_width;
         height = info.output_height;
-        components = info.num_components;
+        components = info.output_components;
         uint32 lineSize = components * width;
         out = Buffer(lineSize * height);
+        std::vector<unsigned char*> rows(height);
+        for (uint32 y = 0; y < height; y++)
+        {
+            rows[y] = (unsigned char*)out.data() + lineSize
+                    * (options.bottomUp ? height - y - 1 : y);
+        }
+        // the library returns at most rec_outbuf_height lines per call
         while (info.output_scanline < info.output_height)
         {
-            unsigned char *ptr[1];
-            ptr[0] = (unsigned char*)out.data()
-                    + lineSize * info.output_scanline;
-            jpeg_read_scanlines(&info, ptr, 1);
+            jpeg_read_scanlines(&info, rows.data() + info.output_scanline,
+                                info.output_height - info.output_scanline);
         }
         jpeg_finish_decompress(&info);
         jpeg_destroy_decompress(&info);
@@ -24,7 +24,7 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include "../include/vts-browser/buffer.hpp"
+#include "image.hpp"
 
 #include <png.h>
 #include <dbglog/dbglog.hpp>
@@ -94,7 +94,8 @@ void pngFlushFunc(png_structp)
 } // namespace
 
 void decodePng(const Buffer &in, Buffer &out,
-               uint32 &width, uint32 &height, uint32 &components)
+               uint32 &width, uint32 &height, uint32 &components,
+               const ImageDecodeOptions &options)
 {
     pngInfoCtx ctx;
     png_structp &png = ctx.png;
@@ -148,8 +149,12 @@ void decodePng(const Buffer &in, Buffer &out,
     assert(cols == png_get_rowbytes(png,info));
     out.allocate(height * cols);
     for (uint32 y = 0; y < height; y++)
-        rows[y] = (png_bytep)out.data() + y * cols;
+    {
+        rows[y] = (png_bytep)out.data()
+                + (options.bottomUp ? height - y - 1 : y) * cols;
+    }
     png_read_image(png, rows.data());
+    downscaleImage(out, width, height, components, options.scaleDenominator);
 }
 
 void encodePng(const Buffer &in, Buffer &out,
@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ALTITUDES_HPP_p5c8q2vmxa
+#define ALTITUDES_HPP_p5c8q2vmxa
+
+#include <vector>
+#include <memory>
+#include <atomic>
+
+#include "foundation.hpp"
+
+namespace vts
+{
+
+class AltitudesTaskImpl;
+class CameraImpl;
+
+// surface altitudes sampled from navigation tiles
+//   the task progresses with the camera renderUpdate,
+//   missing tiles are downloaded as needed
+class VTS_API AltitudesTask : private Immovable
+{
+public:
+    // points: pairs of x and y coordinates in navigation srs
+    // sampleSize: desired distance of the navtile samples
+    //   (in node srs units, usually meters),
+    //   zero selects the finest navtiles available
+    AltitudesTask(const double *points, uint32 count, double sampleSize);
+    virtual ~AltitudesTask();
+
+    const std::vector<double> points;
+    const double sampleSize;
+    std::vector<double> altitudes; // navigation srs, nan if not available
+    std::atomic<bool> done;
+
+private:
+    std::shared_ptr<AltitudesTaskImpl> impl;
+    friend CameraImpl;
+};
+
+} // namespace vts
+
+#endif
@@ -29,6 +29,7 @@
 
 #include <iostream>
 #include <string>
+#include <memory>
 
 #include "foundation.hpp"
 
@@ -41,6 +42,12 @@ public:
     Buffer();
     explicit Buffer(uint32 size); // create preallocated buffer (it is not zeroed)
     explicit Buffer(const std::string &str); // create buffer from string
+
+    // create buffer referencing memory owned by other object
+    //   (eg. memory mapped file)
+    // the owner is kept alive for the lifetime of the buffer
+    // the memory is not freed by the buffer
+    Buffer(const std::shared_ptr<void> &owner, char *data, uint32 size);
     ~Buffer();
 
     // move semantics
@@ -57,6 +64,11 @@ public:
     // explicitly create string out of the buffer
     std::string str() const;
 
+    // create buffer referencing part of this buffer
+    //   buffers with shared memory (see owner) share it without copying
+    //   other buffers are copied
+    Buffer slice(uint32 offset, uint32 size) const;
+
     // allocates a new buffer of the specified size
     //   any previous content is lost
     //   the buffer is not zeroed
@@ -66,9 +78,11 @@ public:
     //   all previous content (up to the size of the new buffer) is preserved
     //   any new space is not zeroed
     // this may invalidate all pointers
+    // buffers with shared memory are copied into newly allocated memory
     void resize(uint32 size);
 
     // fills the buffer with zeros
+    // buffers with shared memory are reallocated first
     void zero();
 
     void free();
@@ -76,16 +90,24 @@ public:
     char *data() const { return data_; }
     char *dataEnd() const { return data_ + size_; }
     uint32 size() const { return size_; }
+    const std::shared_ptr<void> &owner() const { return owner_; }
 
 private:
     char *data_;
     uint32 size_;
+    std::shared_ptr<void> owner_;
 };
 
 VTS_API void writeLocalFileBuffer(const std::string &path,
                                   const Buffer &buffer);
 VTS_API Buffer readLocalFileBuffer(const std::string &path);
 
+// maps the file into memory without copying it
+// the mapping is read only, the content of the buffer may not be modified
+//   (use copy() to obtain a writable buffer)
+// falls back to readLocalFileBuffer where mapping is not available
+VTS_API Buffer mapLocalFileBuffer(const std::string &path);
+
 // this will copy the data and return it in a buffer
 // it is safe to modify/free the buffer
 VTS_API Buffer readInternalMemoryBuffer(const std::string &path);
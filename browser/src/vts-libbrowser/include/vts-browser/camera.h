@@ -55,6 +55,13 @@ VTS_API void vtsCameraSuggestedNearFar(vtsHCamera cam,
                     double *near_, double *far_);
 VTS_API void vtsCameraRenderUpdate(vtsHCamera cam);
 
+// surface altitudes
+VTS_API vtsHAltitudes vtsCameraSurfaceAltitudes(vtsHCamera cam,
+                    const double points[], uint32 count, double sampleSize);
+VTS_API void vtsAltitudesDestroy(vtsHAltitudes altitudes);
+VTS_API bool vtsAltitudesGetDone(vtsHAltitudes altitudes);
+VTS_API const double *vtsAltitudesGetResults(vtsHAltitudes altitudes);
+
 // credits
 VTS_API const char *vtsCameraGetCredits(vtsHCamera cam);
 VTS_API const char *vtsCameraGetCreditsShort(vtsHCamera cam);
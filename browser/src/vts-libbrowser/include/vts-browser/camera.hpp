@@ -28,6 +28,7 @@
 #define CAMERA_HPP_jihsefk
 
 #include <array>
+#include <vector>
 #include <memory>
 
 #include "foundation.hpp"
@@ -36,6 +37,7 @@ namespace vts
 {
 
 class MapImpl;
+class AltitudesTask;
 class CameraCredits;
 class CameraDraws;
 class CameraOptions;
@@ -79,6 +81,14 @@ public:
     // only the last navigation created for this camera will be used
     std::shared_ptr<Navigation> createNavigation();
 
+    // surface altitudes at many points at once (see AltitudesTask)
+    std::shared_ptr<AltitudesTask> surfaceAltitudes(
+                const double *points, uint32 count, // xy pairs
+                double sampleSize = 0);
+    std::shared_ptr<AltitudesTask> surfaceAltitudes(
+                const std::vector<std::array<double, 2>> &points,
+                double sampleSize = 0);
+
 private:
     std::shared_ptr<CameraImpl> impl;
     friend Map;
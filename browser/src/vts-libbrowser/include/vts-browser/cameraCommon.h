@@ -43,6 +43,11 @@ typedef struct vtsCDrawSurfaceBase
     float blendingCoverage;
     bool externalUv;
     bool flatShading;
+    // user data of the resources, without ownership
+    //   valid until the render update of the map after the next one
+    void *meshPtr;
+    void *texColorPtr;
+    void *texMaskPtr;
 } vtsCDrawSurfaceBase;
 
 typedef struct vtsCDrawInfographicsBase
@@ -52,11 +57,16 @@ typedef struct vtsCDrawInfographicsBase
     float data[4];
     float data2[4];
     int type; // 0 = original infographics; 1 = tile diagnostics text
+    // user data of the resources, without ownership
+    void *meshPtr;
+    void *texColorPtr;
 } vtsCDrawInfographicsBase;
 
 typedef struct vtsCDrawColliderBase
 {
     float mv[16];
+    // user data of the resource, without ownership
+    void *meshPtr;
 } vtsCDrawColliderBase;
 
 typedef struct vtsCCameraBase
@@ -90,6 +90,12 @@ public:
     // move opaque blending draws into transparent group
     bool lodBlendingTransparent = false;
 
+    // the draw tasks carry only the raw pointers (eg. meshPtr)
+    //   and the shared pointers are left empty
+    // the resources are pinned instead, which avoids the reference counting
+    //   of thousands of shared pointers every frame
+    bool lightweightDraws = false;
+
     bool debugDetachedCamera = false;
     bool debugFlatShading = false;
     bool debugRenderSurrogates = false;
@@ -30,6 +30,7 @@
 #include <string>
 
 #include "foundation.hpp"
+#include "timingStatistics.hpp"
 
 namespace vts
 {
@@ -48,6 +49,14 @@ public:
     uint32 currentNodeMetaUpdates;
     uint32 currentNodeDrawsUpdates;
     uint32 currentGridNodes;
+
+    // cpu time of the main operations, per frame
+    //   the traversal tasks are summed over all layers
+    TimingStatistics timeRenderUpdate;
+    TimingStatistics timeTraversal;
+    TimingStatistics timeBlending;
+    TimingStatistics timeSubtiles;
+    TimingStatistics timeSort;
 };
 
 } // namespace vts
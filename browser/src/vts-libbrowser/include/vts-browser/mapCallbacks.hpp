@@ -28,6 +28,7 @@
 #define MAP_CALLBACKS_HPP_skjgfjshfk
 
 #include <functional>
+#include <vector>
 
 #include "foundation.hpp"
 
@@ -47,6 +48,19 @@ public:
     std::function<void(class ResourceInfo &, class GpuMeshSpec &,
         const std::string &id)> loadMesh;
 
+    // optional function callbacks to upload multiple textures or meshes
+    //   at once (eg. to sub-allocate them from shared buffers)
+    // when set, they are used instead of loadTexture or loadMesh
+    //   and receive the items gathered during one Map::dataTick()
+    //   (split by the upload batch limits in MapRuntimeOptions)
+    // the items must fill in their ResourceInfo just like the single
+    //   versions of the callbacks
+    // invoked from Map::dataTick()
+    std::function<void(const std::vector<class GpuTextureUpload> &)>
+        loadTextures;
+    std::function<void(const std::vector<class GpuMeshUpload> &)>
+        loadMeshes;
+
     // function callback to upload font to gpu
     // invoked from Map::dataTick()
     std::function<void(class ResourceInfo &, class GpuFontSpec &,
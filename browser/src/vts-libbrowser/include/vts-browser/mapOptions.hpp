@@ -74,6 +74,16 @@ public:
     //          is clearly reflected in the cached file name
     bool hashCachePaths = true;
 
+    // true -> store all cached resources in a few large append-only
+    //         segment files with an in-memory index
+    //         (hashCachePaths is ignored)
+    // false -> store each resource in a separate file
+    bool packedCache = false;
+
+    // maximum size of all segments of the packed cache
+    // oldest segments are removed when the limit is exceeded
+    uint32 packedCacheSizeLimitMB = 4096;
+
     // use search url/srs fallbacks on any body (not just Earth)
     bool searchUrlFallbackOutsideEarth = false;
 
@@ -83,6 +93,39 @@ public:
     // provide density texture for atmosphere rendering
     bool atmosphereDensityTexture = true;
 
+    // transcode color textures of surfaces and bound layers
+    //   into gpu compressed formats in the decode threads
+    //   (see GpuTextureSpec::Compression)
+    // 0 = none, 1 = bc1/bc3, 2 = etc2/etc2 eac
+    // the application must make sure the gpu supports the formats
+    // the transcoded textures are stored in the disk cache too
+    uint32 textureCompression = 0;
+
+    // decode color textures of surfaces and bound layers
+    //   at 1/2, 1/4 or 1/8 of their resolution
+    // jpeg images are decoded directly at the reduced resolution
+    // global quality knob - applies to all tiles, including the near ones
+    // reduces decoding time and memory usage at the cost of details
+    //   (eg. for low end devices)
+    uint32 textureDecodeScale = 1;
+
+    // number of threads that decode resources (images, meshes, ...)
+    // 0 -> use half of the available hardware threads
+    // ignored when debugUseExtraThreads is false
+    uint32 decodeThreads = 1;
+
+    // number of threads that process geodata (restyling)
+    // large geodata tiles are split between the threads too
+    // 0 -> use half of the available hardware threads
+    // ignored when debugUseExtraThreads is false
+    uint32 geodataThreads = 0;
+
+    // number of threads that traverse the map layers and their subtrees
+    // the rendering thread is counted in
+    // 0 -> use half of the available hardware threads
+    // ignored when debugUseExtraThreads is false
+    uint32 traverseThreads = 0;
+
     // true -> create and use separate threads for data processing
     // false -> serialize all tasks in the data thread
     bool debugUseExtraThreads = true;
@@ -114,16 +157,29 @@ public:
     // memory threshold at which resources start to be released
     uint32 targetResourcesMemoryKB = 0;
 
+    // separate thresholds for resources memory in ram and on gpu
+    // zero disables the particular threshold
+    uint32 targetResourcesRamMemoryKB = 0;
+    uint32 targetResourcesGpuMemoryKB = 0;
+
     // maximum size of the queue for the resources to be downloaded
     uint32 maxConcurrentDownloads = 25;
 
     // maximum number of items waiting in queue to be written to disk cache
     // new resources will be skipped when the queue is full
+    // the queue cannot hold more than 1024 items
     uint32 maxCacheWriteQueueLength = 500;
 
     // maximum number of resources processed per dataTick
     uint32 maxResourceProcessesPerTick = 10;
 
+    // limits of one batch for the batched upload callbacks
+    // the batch is handed to the application when any limit is reached
+    //   or when no more resources are waiting for upload
+    uint32 maxUploadBatchResources = 100;
+    uint32 maxUploadBatchSizeKB = 64 * 1024;
+    double maxUploadBatchDelay = 0.1; // seconds
+
     // maximum number of redirections before the download fails
     // this is to prevent infinite loops
     uint32 maxFetchRedirections = 5;
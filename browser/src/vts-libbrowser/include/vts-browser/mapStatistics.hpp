@@ -30,6 +30,7 @@
 #include <string>
 
 #include "foundation.hpp"
+#include "timingStatistics.hpp"
 
 namespace vts
 {
@@ -62,6 +63,29 @@ public:
     uint32 currentGpuMemUseKB;
     uint32 currentRamMemUseKB;
 
+    // time spent decoding resources, accumulated per decode thread
+    static const uint32 MaxDecodeThreads = 32;
+    uint32 decodeThreads;
+    uint32 decodeThreadsBusyTimeMs[MaxDecodeThreads];
+
+    // number of threads processing geodata
+    uint32 geodataThreads;
+
+    // number of threads traversing the map (including the rendering thread)
+    uint32 traverseThreads;
+
+    // cpu time of the main operations
+    TimingStatistics timeRenderUpdate; // per frame
+    TimingStatistics timeResourcesUpdate; // per frame
+    TimingStatistics timeTraverseClearing; // per frame
+    TimingStatistics timeDataUpdate; // per call to dataUpdate
+    TimingStatistics timeCacheRead; // per resource
+    TimingStatistics timeCacheWrite; // per resource
+    TimingStatistics timeDecode; // per resource
+    TimingStatistics timeGeodata; // per geodata tile or its shard
+    TimingStatistics timeUpload; // per resource
+    TimingStatistics timeUploadFlush; // per batch
+
     uint32 renderTicks;
 };
 
@@ -52,6 +52,7 @@ VTS_API void vtsTextureGetResolution(vtsHResource resource,
                 uint32 *width, uint32 *height, uint32 *components);
 VTS_API uint32 vtsTextureGetType(vtsHResource resource);
 VTS_API uint32 vtsTextureGetInternalFormat(vtsHResource resource);
+VTS_API uint32 vtsTextureGetMipmapLevels(vtsHResource resource);
 VTS_API uint32 vtsTextureGetFilterMode(vtsHResource resource);
 VTS_API uint32 vtsTextureGetWrapMode(vtsHResource resource);
 VTS_API void vtsTextureGetBuffer(vtsHResource resource,
@@ -73,6 +73,12 @@ class VTS_API GpuTextureSpec
 public:
     GpuTextureSpec();
     explicit GpuTextureSpec(const Buffer &buffer); // decode jpg or png file
+    // decode jpg or png file at 1/2, 1/4 or 1/8 of its resolution
+    //   (jpg is decoded directly at the reduced resolution, which is faster)
+    // bottomUp stores the rows in the order expected by opengl
+    //   and replaces a subsequent call to verticalFlip
+    GpuTextureSpec(const Buffer &buffer, uint32 scaleDenominator,
+        bool bottomUp);
     void verticalFlip();
 
     // image resolution
@@ -89,15 +95,46 @@ public:
     // the type must still be set appropriately since it defines buffer size
     uint32 internalFormat;
 
+    // number of levels stored consecutively in the buffer
+    //   each level has half the resolution of the previous (at least 1)
+    // zero or one means the base level only
+    //   and the mipmaps, if required, are generated by the application
+    uint32 mipmapLevels;
+
     // raw texture data
     // it has (width * height * components * gpuTypeSize(type)) bytes
     // the rows are in no way aligned to multi-byte boundaries
     //   (GL_UNPACK_ALIGNMENT = 1)
+    // compressed textures contain the blocks of all levels instead
     Buffer buffer;
 
     // expected size based on width * height * components * gpuTypeSize(type)
+    //   or the compressed sizes of all levels
     uint32 expectedSize() const;
 
+    // size in bytes of one level in the buffer
+    uint32 levelSize(uint32 level) const;
+
+    // true if the internalFormat is one of the gpu compressed formats
+    //   produced by compress
+    bool compressed() const;
+
+    enum class Compression
+    {
+        None = 0,
+        Bc = 1, // bc1 for rgb and bc3 for rgba (s3tc)
+        Etc2 = 2, // etc2 for rgb and etc2 eac for rgba
+    };
+
+    // transcode 8 bit rgb or rgba image into gpu compressed format
+    // all mipmap levels are generated if the filter mode requires them
+    // images of other types are left unchanged
+    void compress(Compression compression);
+
+    // decode the base level back into 8 bit rgb or rgba image
+    // intended for testing of the encoders
+    void decompress();
+
     // encode the image into png format
     Buffer encodePng() const;
 
@@ -169,6 +206,26 @@ public:
     GpuTypeEnum indexMode;
 };
 
+// one item passed to the batched loadTextures callback
+// the pointers are valid for the duration of the callback only
+class VTS_API GpuTextureUpload
+{
+public:
+    ResourceInfo *info;
+    GpuTextureSpec *spec;
+    const std::string *id;
+};
+
+// one item passed to the batched loadMeshes callback
+// the pointers are valid for the duration of the callback only
+class VTS_API GpuMeshUpload
+{
+public:
+    ResourceInfo *info;
+    GpuMeshSpec *spec;
+    const std::string *id;
+};
+
 // handle that provides the application with access
 //   to individual texture planes
 class VTS_API FontHandle
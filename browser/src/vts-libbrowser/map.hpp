@@ -28,11 +28,15 @@
 #define MAP_HPP_cvukikljqwdf
 
 #include <unordered_map>
+#include <array>
 #include <queue>
 #include <vector>
 #include <atomic>
 #include <thread>
 #include <memory>
+#include <list>
+#include <functional>
+#include <mutex>
 
 #include <vts-libs/registry/referenceframe.hpp>
 
@@ -44,7 +48,11 @@
 #include "include/vts-browser/buffer.hpp"
 
 #include "utilities/threadQueue.hpp"
+#include "utilities/taskPool.hpp"
+#include "utilities/timing.hpp"
 #include "validity.hpp"
+#include "resource.hpp"
+#include "resourceHandle.hpp"
 
 #include <boost/container/small_vector.hpp>
 
@@ -73,6 +81,7 @@ class TilesetMapping;
 class GeodataFeatures;
 class GeodataStylesheet;
 class GeodataTile;
+class GeodataShards;
 class Resource;
 class TraverseNode;
 class Credits;
@@ -106,12 +115,63 @@ public:
     UploadData &operator = (UploadData &&) = default;
 
     void process();
+    bool priority(float &p) const;
 
 protected:
     std::weak_ptr<Resource> uploadData;
     std::shared_ptr<void> destroyData;
 };
 
+// geodata tile (or its part) waiting for processing
+class GeodataJob
+{
+public:
+    std::weak_ptr<GeodataTile> tile;
+    std::shared_ptr<GeodataShards> shards; // null -> the whole tile
+    uint32 shard = 0;
+};
+
+// priorities for ThreadPriorityQueue
+class ResourcePriority
+{
+public:
+    bool operator () (const std::weak_ptr<Resource> &w, float &p) const;
+    bool operator () (const UploadData &u, float &p) const;
+};
+
+// cpu time of the main operations, summarized into the statistics
+class MapTimings
+{
+public:
+    TimingHistogram renderUpdate;
+    TimingHistogram resourcesUpdate;
+    TimingHistogram traverseClearing;
+    TimingHistogram dataUpdate;
+    TimingHistogram cacheRead;
+    TimingHistogram cacheWrite;
+    TimingHistogram decode;
+    TimingHistogram geodata;
+    TimingHistogram upload;
+    TimingHistogram uploadFlush;
+
+    void summarize(MapStatistics &statistics) const;
+};
+
+// counters incremented from any thread, summarized into the statistics
+class MapCounters
+{
+public:
+    std::atomic<uint32> resourcesCreated {0};
+    std::atomic<uint32> resourcesDownloaded {0};
+    std::atomic<uint32> resourcesDiskLoaded {0};
+    std::atomic<uint32> resourcesDecoded {0};
+    std::atomic<uint32> resourcesUploaded {0};
+    std::atomic<uint32> resourcesFailed {0};
+    std::atomic<uint32> resourcesReleased {0};
+
+    void summarize(MapStatistics &statistics) const;
+};
+
 class MapImpl : private Immovable
 {
 public:
@@ -122,21 +182,49 @@ public:
         std::shared_ptr<Cache> cache;
         std::shared_ptr<AuthConfig> auth;
         std::unordered_map<std::string, std::shared_ptr<Resource>> resources;
+        ResourceHandleMap handles; // fast lookup without composing urls
+        std::mutex mut; // guards the lookups from the traversal tasks
+
+        // bookkeeping updated on resource state transitions
+        std::array<std::atomic<uint32>, Resource::StatesCount> states {};
+        std::atomic<uint64> memRamUse {0};
+        std::atomic<uint64> memGpuUse {0};
+        // resources that may need an action by the main thread
+        //   (initializing, checkCache, startDownload, errors)
+        std::vector<std::weak_ptr<Resource>> attention;
+        std::vector<std::weak_ptr<Resource>> attentionIncoming;
+        std::mutex attentionMut;
+        // eviction order, most recently used first (main thread only)
+        std::list<Resource *> lruRam; // resources using ram
+        std::list<Resource *> lruGpu; // resources using gpu memory
+        std::vector<std::weak_ptr<Resource>> lruIncoming; // costs changed
         std::list<std::weak_ptr<SearchTask>> searchTasks;
         std::string authPath;
         std::atomic<uint32> downloads{0}; // number of active downloads
         std::condition_variable downloadsCondition;
         uint32 progressEstimationMaxResources = 0;
 
-        ThreadQueue<std::weak_ptr<Resource>> queDecode;
-        ThreadQueue<UploadData> queUpload;
-        ThreadQueue<CacheData> queCacheWrite;
+        ThreadPriorityQueue<std::weak_ptr<Resource>, ResourcePriority>
+            queDecode;
+        ThreadPriorityQueue<UploadData, ResourcePriority> queUpload;
+        ThreadRingQueue<CacheData> queCacheWrite;
         ThreadQueue<std::weak_ptr<GpuAtmosphereDensityTexture>> queAtmosphere;
-        ThreadQueue<std::weak_ptr<GeodataTile>> queGeodata;
+        ThreadQueue<GeodataJob> queGeodata;
+        // uploads waiting for the batched callbacks (data thread only)
+        struct UploadBatch
+        {
+            std::vector<GpuTextureUpload> textures;
+            std::vector<GpuMeshUpload> meshes;
+            std::vector<std::shared_ptr<Resource>> resources;
+            uint64 bytes = 0;
+            std::chrono::steady_clock::time_point started;
+        } uploadBatch;
         std::thread thrCacheWriter;
-        std::thread thrDecoder;
+        std::vector<std::thread> thrDecoders;
+        std::array<std::atomic<uint64>, MapStatistics::MaxDecodeThreads>
+            decodersBusyTime {}; // microseconds
         std::thread thrAtmosphereGenerator;
-        std::thread thrGeodataProcessor;
+        std::vector<std::thread> thrGeodataProcessors;
         
         class ThreadCustomQueue
         {
@@ -153,6 +241,8 @@ public:
     const MapCreateOptions createOptions;
     MapCallbacks callbacks;
     MapStatistics statistics;
+    MapTimings timings;
+    MapCounters counters;
     MapRuntimeOptions options;
     MapCelestialBody body;
     std::shared_ptr<Mapconfig> mapconfig;
@@ -160,6 +250,13 @@ public:
     std::shared_ptr<Credits> credits;
     boost::container::small_vector<std::shared_ptr<MapLayer>, 4> layers;
     boost::container::small_vector<std::weak_ptr<CameraImpl>, 1> cameras;
+
+    // traversal of layers and subtrees in concurrent tasks
+    TaskPool traversePool;
+    std::vector<std::thread> thrTraversal;
+    // guards the bound layers, credits and geodata styles
+    //   that are resolved lazily by the traversal tasks
+    std::recursive_mutex traverseMut;
     std::string mapconfigPath;
     std::string mapconfigView;
     double lastElapsedFrameTime = 0;
@@ -190,6 +287,7 @@ public:
     std::pair<Validity, std::shared_ptr<const std::string>>
         getActualGeoFeatures(const std::string &name);
     void traverseClearing(TraverseNode *trav);
+    void traverseWorkerEntry(uint32 index);
 
     // resources methods
     void resourcesDataFinalize();
@@ -198,21 +296,35 @@ public:
     void resourcesRenderUpdate();
     uint32 resourcesDataUpdateOne();
 
+    void resourcesTrack(const std::shared_ptr<Resource> &r);
+    void resourcesUntrack(Resource *r);
+    void resourcesStateChanged(Resource *r,
+        Resource::State previous, Resource::State current);
+    void resourcesUpdateAttention();
     bool resourcesTryRemove(std::shared_ptr<Resource> &r);
+    void resourcesLruTouch(Resource *r);
+    void resourcesEvict(std::list<Resource *> &lru,
+        const std::function<bool()> &overBudget);
+    void resourcesEvict(std::list<Resource *> &lruA,
+        std::list<Resource *> &lruB,
+        const std::function<bool()> &overBudget);
     void resourcesRemoveOld();
     void resourcesCheckInitialized();
     void resourcesStartDownloads();
     void resourcesDownloadsEntry();
     void resourcesUploadProcessorEntry();
     void resourcesAtmosphereGeneratorEntry();
-    void resourcesGeodataProcessorEntry();
-    void resourcesDecodeProcessorEntry();
+    void resourcesGeodataProcessorEntry(uint32 index);
+    void resourcesGeodataProcess(const GeodataJob &job);
+    void resourcesDecodeProcessorEntry(uint32 index);
     bool resourcesUploadProcessOne();
     bool resourcesAtmosphereProcessOne();
     bool resourcesGeodataProcessOne();
     bool resourcesDecodeProcessOne();
     void resourceDecodeProcess(const std::shared_ptr<Resource> &r);
     void resourceUploadProcess(const std::shared_ptr<Resource> &r);
+    void resourcesUploadFlush();
+    bool resourcesUploadBatchFull() const;
     void resourceSaveCorruptedFile(const std::shared_ptr<Resource> &r);
 
     void cacheInit();
@@ -224,23 +336,34 @@ public:
     void cachePurge();
 
     void touchResource(const std::shared_ptr<Resource> &resource);
+    void touchResources(const ResourceTouches &touches); // main thread
     Validity getResourceValidity(const std::string &name);
     Validity getResourceValidity(const std::shared_ptr<Resource> &resource);
 
     std::shared_ptr<GpuTexture> getTexture(const std::string &name);
+    std::shared_ptr<GpuTexture> getTexture(const InternedUrlTemplate &templ,
+        const UrlTemplate::Vars &vars);
     std::shared_ptr<GpuAtmosphereDensityTexture>
         getAtmosphereDensityTexture(const std::string &name);
     std::shared_ptr<GpuMesh> getMesh(const std::string &name);
     std::shared_ptr<AuthConfig> getAuthConfig(const std::string &name);
     std::shared_ptr<Mapconfig> getMapconfig(const std::string &name);
     std::shared_ptr<MetaTile> getMetaTile(const std::string &name);
+    std::shared_ptr<MetaTile> getMetaTile(const InternedUrlTemplate &templ,
+        const UrlTemplate::Vars &vars);
     std::shared_ptr<NavTile> getNavTile(const std::string &name);
+    std::shared_ptr<NavTile> getNavTile(const InternedUrlTemplate &templ,
+        const UrlTemplate::Vars &vars);
     std::shared_ptr<MeshAggregate> getMeshAggregate(const std::string &name);
+    std::shared_ptr<MeshAggregate> getMeshAggregate(
+        const InternedUrlTemplate &templ, const UrlTemplate::Vars &vars);
     std::shared_ptr<ExternalBoundLayer> getExternalBoundLayer(
             const std::string &name);
     std::shared_ptr<ExternalFreeLayer> getExternalFreeLayer(
             const std::string &name);
     std::shared_ptr<BoundMetaTile> getBoundMetaTile(const std::string &name);
+    std::shared_ptr<BoundMetaTile> getBoundMetaTile(
+        const InternedUrlTemplate &templ, const UrlTemplate::Vars &vars);
     std::shared_ptr<SearchTaskImpl> getSearchTask(const std::string &name);
     std::shared_ptr<TilesetMapping> getTilesetMapping(const std::string &name);
     std::shared_ptr<GeodataFeatures> getGeoFeatures(const std::string &name);
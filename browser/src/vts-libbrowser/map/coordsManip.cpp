@@ -35,7 +35,9 @@
 
 #include <unordered_map>
 #include <memory>
+#include <mutex>
 #include <functional>
+#include <sstream>
 
 namespace vts
 {
@@ -94,12 +96,212 @@ struct projInitClass
     }
 } projInitInstance;
 
+const double degToRad = M_PI / 180;
+const double radToDeg = 180 / M_PI;
+
+// conversions that are computed directly instead of through proj
+enum class FastPath
+{
+    None,
+    Identity,
+    GeographicToGeocentric,
+    GeocentricToGeographic,
+};
+
+struct Ellipsoid
+{
+    double a = 0;
+    double e2 = 0; // eccentricity squared
+};
+
+// same as proj does, for a single point
+vec3 geographicToGeocentric(const vec3 &v, const Ellipsoid &e)
+{
+    const double lon = v[0] * degToRad;
+    const double lat = v[1] * degToRad;
+    const double sl = std::sin(lat);
+    const double rn = e.a / std::sqrt(1 - e.e2 * sl * sl);
+    const double r = (rn + v[2]) * std::cos(lat);
+    return vec3(r * std::cos(lon), r * std::sin(lon),
+        (rn * (1 - e.e2) + v[2]) * sl);
+}
+
+// same as proj does, but over whole arrays (vectorized by eigen)
+//   small counts avoid the temporary arrays
+bool geographicToGeocentric(vec3 *values, uint32 count, const Ellipsoid &e)
+{
+    static const uint32 minArrayCount = 16;
+    for (uint32 i = 0; i < count; i++)
+    {
+        const vec3 &v = values[i];
+        if (!std::isfinite(v[0]) || !std::isfinite(v[1])
+            || !std::isfinite(v[2]) || std::abs(v[1]) > 90)
+            return false; // let proj handle the errors
+    }
+    if (count < minArrayCount)
+    {
+        for (uint32 i = 0; i < count; i++)
+            values[i] = geographicToGeocentric(values[i], e);
+        return true;
+    }
+    Eigen::ArrayXd lon(count), lat(count), h(count);
+    for (uint32 i = 0; i < count; i++)
+    {
+        const vec3 &v = values[i];
+        lon[i] = v[0];
+        lat[i] = v[1];
+        h[i] = v[2];
+    }
+    lon *= degToRad;
+    lat *= degToRad;
+    Eigen::ArrayXd sl = lat.sin();
+    Eigen::ArrayXd rn = e.a / (1 - e.e2 * sl.square()).sqrt();
+    Eigen::ArrayXd r = (rn + h) * lat.cos();
+    Eigen::ArrayXd x = r * lon.cos();
+    Eigen::ArrayXd y = r * lon.sin();
+    Eigen::ArrayXd z = (rn * (1 - e.e2) + h) * sl;
+    for (uint32 i = 0; i < count; i++)
+        values[i] = vec3(x[i], y[i], z[i]);
+    return true;
+}
+
+// the iterative method used by proj (geocent.c)
+//   converges in two or three iterations
+bool geocentricToGeographic(vec3 *values, uint32 count, const Ellipsoid &e)
+{
+    static const double genau = 1e-12;
+    static const double genau2 = genau * genau;
+    static const uint32 maxiter = 30;
+    const double b = e.a * std::sqrt(1 - e.e2);
+    for (uint32 i = 0; i < count; i++)
+    {
+        const vec3 &v = values[i];
+        if (!std::isfinite(v[0]) || !std::isfinite(v[1])
+            || !std::isfinite(v[2]))
+            return false;
+    }
+    for (uint32 i = 0; i < count; i++)
+    {
+        const double x = values[i][0], y = values[i][1], z = values[i][2];
+        const double p = std::sqrt(x * x + y * y);
+        const double rr = std::sqrt(x * x + y * y + z * z);
+        double lon = 0, lat, h;
+        if (p / e.a < genau)
+        {
+            if (rr / e.a < genau)
+            {
+                values[i] = vec3(0, 90, -b);
+                continue;
+            }
+        }
+        else
+            lon = std::atan2(y, x);
+        const double ct = z / rr;
+        const double st = p / rr;
+        double rx = 1 / std::sqrt(1 - e.e2 * (2 - e.e2) * st * st);
+        double cphi0 = st * (1 - e.e2) * rx;
+        double sphi0 = ct * rx;
+        double cphi, sphi, sdphi;
+        uint32 iter = 0;
+        do
+        {
+            iter++;
+            const double rn = e.a / std::sqrt(1 - e.e2 * sphi0 * sphi0);
+            h = p * cphi0 + z * sphi0 - rn * (1 - e.e2 * sphi0 * sphi0);
+            const double rk = e.e2 * rn / (rn + h);
+            rx = 1 / std::sqrt(1 - rk * (2 - rk) * st * st);
+            cphi = st * (1 - rk) * rx;
+            sphi = ct * rx;
+            sdphi = sphi * cphi0 - cphi * sphi0;
+            cphi0 = cphi;
+            sphi0 = sphi;
+        }
+        while (sdphi * sdphi > genau2 && iter < maxiter);
+        lat = std::atan(sphi / std::abs(cphi));
+        values[i] = vec3(lon * radToDeg, lat * radToDeg, h);
+    }
+    return true;
+}
+
+bool runFastPath(FastPath fast, const Ellipsoid &e,
+    vec3 *values, uint32 count)
+{
+    switch (fast)
+    {
+    case FastPath::None:
+        return false;
+    case FastPath::Identity:
+        return true;
+    case FastPath::GeographicToGeocentric:
+        return geographicToGeocentric(values, count, e);
+    case FastPath::GeocentricToGeographic:
+        return geocentricToGeographic(values, count, e);
+    }
+    return false;
+}
+
+// basic properties of a proj definition
+struct ProjInfo
+{
+    Ellipsoid ellipsoid;
+    bool latlong = false;
+    bool geocent = false;
+    bool plain = false; // no datum shifts, grids, units or axes
+};
+
+ProjInfo projInfo(const vtslibs::registry::Srs &srs)
+{
+    ProjInfo info;
+    if (srs.geoidGrid || srs.srsDef.type != geo::SrsDefinition::Type::proj4)
+        return info;
+    projPJ pj = pj_init_plus(srs.srsDef.srs.c_str());
+    if (!pj)
+        return info;
+    info.latlong = pj_is_latlong(pj);
+    info.geocent = pj_is_geocent(pj);
+    pj_get_spheroid_defn(pj, &info.ellipsoid.a, &info.ellipsoid.e2);
+    char *def = pj_get_def(pj, 0);
+    info.plain = true;
+    std::istringstream ss(def);
+    std::string t;
+    while (ss >> t)
+    {
+        std::string k = t.substr(0, t.find('='));
+        std::string v = k.size() < t.size() ? t.substr(k.size() + 1) : "";
+        if (k == "+nadgrids" || k == "+geoidgrids" || k == "+pm"
+            || k == "+axis" || k == "+to_meter" || k == "+over"
+            || k == "+lon_wrap" || k == "+vunits" || k == "+vto_meter")
+            info.plain = false;
+        if (k == "+units" && v != "m")
+            info.plain = false;
+        if (k == "+towgs84")
+        {
+            // zero shift is what +datum=WGS84 expands to
+            std::istringstream vs(v);
+            std::string n;
+            while (std::getline(vs, n, ','))
+                if (std::strtod(n.c_str(), nullptr) != 0)
+                    info.plain = false;
+        }
+    }
+    pj_dalloc(def);
+    pj_free(pj);
+    return info;
+}
+
+struct Conversion
+{
+    std::shared_ptr<vtslibs::vts::CsConvertor> cs;
+    FastPath fast = FastPath::None;
+    Ellipsoid ellipsoid;
+};
+
 class CoordManipImpl : public CoordManip
 {
     vtslibs::vts::MapConfig &mapconfig;
 
-    std::unordered_map<std::string, std::shared_ptr<vtslibs::vts::CsConvertor>>
-        convertors;
+    std::unordered_map<std::string, Conversion> conversions;
+    std::mutex mut; // conversions and proj, used by the traversal tasks
 
     boost::optional<GeographicLib::Geodesic> geodesic_;
 
@@ -160,43 +362,150 @@ public:
         }
     }
 
-    vtslibs::vts::CsConvertor &convertor(const std::string &a,
-                                         const std::string &b)
+    void convertProj(vtslibs::vts::CsConvertor &cs, vec3 *values, uint32 count)
     {
-        std::string key = a + " >>> " + b;
-        auto it = convertors.find(key);
-        if (it == convertors.end())
+        for (uint32 i = 0; i < count; i++)
+            values[i] = vecFromUblas<vec3>(
+                cs(vecFromUblas<math::Point3>(values[i])));
+    }
+
+    // the fast path is used only if it gives the same results as proj
+    bool verifyFastPath(Conversion &c)
+    {
+        static const vec3 geographic[] = {
+            vec3(0, 0, 0), vec3(14.42, 50.08, 300),
+            vec3(-122.4, -45.3, -50), vec3(179.9, 89.9, 8000) };
+        static const vec3 geocentric[] = {
+            vec3(6378137, 0, 0), vec3(3980000, 1020000, 4860000),
+            vec3(-2700000, -4300000, -3850000), vec3(0, 100, 6357000) };
+        const vec3 *samples = c.fast == FastPath::GeocentricToGeographic
+            ? geocentric : geographic;
+        vec3 tolerance;
+        switch (c.fast)
         {
-            auto c = std::make_shared<vtslibs::vts::CsConvertor>(
-                a, b, mapconfig);
-            convertors[key] = c;
-            return *c;
+        case FastPath::GeographicToGeocentric:
+            tolerance = vec3(1e-6, 1e-6, 1e-6);
+            break;
+        case FastPath::GeocentricToGeographic:
+            tolerance = vec3(1e-9, 1e-9, 1e-6);
+            break;
+        default:
+            tolerance = vec3(1e-7, 1e-7, 1e-7);
+            break;
         }
-        return *it->second;
+        try
+        {
+            for (uint32 i = 0; i < 4; i++)
+            {
+                vec3 a = samples[i], b = samples[i];
+                convertProj(*c.cs, &a, 1);
+                if (!runFastPath(c.fast, c.ellipsoid, &b, 1))
+                    return false;
+                for (uint32 j = 0; j < 3; j++)
+                    if (!(std::abs(a[j] - b[j]) <= tolerance[j]))
+                        return false;
+            }
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+        return true;
     }
 
-    vec3 convert(const vec3 &value, const std::string &f, const std::string &t)
+    void detectFastPath(Conversion &c,
+        const std::string &a, const std::string &b)
     {
-        auto cs = convertor(f, t);
-        vec3 res = vecFromUblas<vec3>(cs(vecFromUblas<math::Point3>(value)));
-        //LOG(debug) << "Converted <" << value.transpose() << "><" << f
-        //           << "> to <" << res.transpose() << "><" << t << ">";
-        return res;
+        if (a == b)
+            c.fast = FastPath::Identity;
+        else
+        {
+            ProjInfo ia = projInfo(mapconfig.srs.get(a));
+            ProjInfo ib = projInfo(mapconfig.srs.get(b));
+            if (!ia.plain || !ib.plain
+                || ia.ellipsoid.a != ib.ellipsoid.a
+                || ia.ellipsoid.e2 != ib.ellipsoid.e2)
+                return;
+            c.ellipsoid = ia.ellipsoid;
+            if (ia.latlong && ib.geocent)
+                c.fast = FastPath::GeographicToGeocentric;
+            else if (ia.geocent && ib.latlong)
+                c.fast = FastPath::GeocentricToGeographic;
+        }
+        if (c.fast != FastPath::None && !verifyFastPath(c))
+        {
+            LOG(info2) << "Conversion from <" << a << "> to <" << b
+                       << "> does not match proj, fast path disabled";
+            c.fast = FastPath::None;
+        }
+    }
+
+    Conversion &conversion(const std::string &a, const std::string &b)
+    {
+        std::string key = a + " >>> " + b;
+        auto it = conversions.find(key);
+        if (it != conversions.end())
+            return it->second;
+        Conversion &c = conversions[key];
+        c.cs = std::make_shared<vtslibs::vts::CsConvertor>(a, b, mapconfig);
+        detectFastPath(c, a, b);
+        return c;
+    }
+
+    void convert(vec3 *values, uint32 count,
+                 const std::string &f, const std::string &t)
+    {
+        if (count == 0)
+            return;
+        std::unique_lock<std::mutex> lock(mut);
+        Conversion &c = conversion(f, t);
+        if (c.fast != FastPath::None)
+        {
+            // the fast paths do not need the lock
+            lock.unlock();
+            if (runFastPath(c.fast, c.ellipsoid, values, count))
+                return;
+            lock.lock();
+        }
+        convertProj(*c.cs, values, count);
     }
 
     vec3 convert(const vec3 &value, Srs from, Srs to) override
     {
-        return convert(value, srsToProj(from), srsToProj(to));
+        vec3 res = value;
+        convert(&res, 1, srsToProj(from), srsToProj(to));
+        return res;
     }
 
     vec3 convert(const vec3 &value, const Node &from, Srs to) override
     {
-        return convert(value, from.srs, srsToProj(to));
+        vec3 res = value;
+        convert(&res, 1, from.srs, srsToProj(to));
+        return res;
     }
 
     vec3 convert(const vec3 &value, Srs from, const Node &to) override
     {
-        return convert(value, srsToProj(from), to.srs);
+        vec3 res = value;
+        convert(&res, 1, srsToProj(from), to.srs);
+        return res;
+    }
+
+    void convert(vec3 *values, uint32 count, Srs from, Srs to) override
+    {
+        convert(values, count, srsToProj(from), srsToProj(to));
+    }
+
+    void convert(vec3 *values, uint32 count,
+                 const Node &from, Srs to) override
+    {
+        convert(values, count, from.srs, srsToProj(to));
+    }
+
+    void convert(vec3 *values, uint32 count,
+                 Srs from, const Node &to) override
+    {
+        convert(values, count, srsToProj(from), to.srs);
     }
 
     vec3 geoDirect(const vec3 &position, double distance,
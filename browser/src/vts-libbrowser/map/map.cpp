@@ -49,6 +49,14 @@ MapImpl::MapImpl(Map *map, const MapCreateOptions &options,
     map(map), createOptions(options)
 {
     assert(fetcher);
+    switch (createOptions.textureDecodeScale)
+    {
+    case 1: case 2: case 4: case 8:
+        break;
+    default:
+        LOGTHROW(err4, std::invalid_argument)
+                << "Texture decode scale must be 1, 2, 4 or 8";
+    }
     resources.fetcher = fetcher;
     resources.thrCacheWriter = std::thread(&MapImpl::cacheWriteEntry, this);
     resources.fetching.thr
@@ -59,11 +67,39 @@ MapImpl::MapImpl(Map *map, const MapCreateOptions &options,
     {
         resources.thrAtmosphereGenerator
             = std::thread(&MapImpl::resourcesAtmosphereGeneratorEntry, this);
-        resources.thrGeodataProcessor
-            = std::thread(&MapImpl::resourcesGeodataProcessorEntry, this);
-        resources.thrDecoder
-            = std::thread(&MapImpl::resourcesDecodeProcessorEntry, this);
+        uint32 geodatas = createOptions.geodataThreads;
+        if (geodatas == 0)
+            geodatas = std::thread::hardware_concurrency() / 2;
+        geodatas = std::max(geodatas, 1u);
+        for (uint32 i = 0; i < geodatas; i++)
+        {
+            resources.thrGeodataProcessors.push_back(std::thread(
+                &MapImpl::resourcesGeodataProcessorEntry, this, i));
+        }
+        statistics.geodataThreads = geodatas;
+        uint32 decoders = createOptions.decodeThreads;
+        if (decoders == 0)
+            decoders = std::thread::hardware_concurrency() / 2;
+        decoders = std::max(decoders, 1u);
+        decoders = std::min(decoders, MapStatistics::MaxDecodeThreads);
+        for (uint32 i = 0; i < decoders; i++)
+        {
+            resources.thrDecoders.push_back(std::thread(
+                &MapImpl::resourcesDecodeProcessorEntry, this, i));
+        }
+        statistics.decodeThreads = decoders;
+        uint32 traversals = createOptions.traverseThreads;
+        if (traversals == 0)
+            traversals = std::thread::hardware_concurrency() / 2;
+        traversals = std::max(traversals, 1u);
+        // the rendering thread takes part in the traversal too
+        for (uint32 i = 1; i < traversals; i++)
+        {
+            thrTraversal.push_back(std::thread(
+                &MapImpl::traverseWorkerEntry, this, i));
+        }
     }
+    statistics.traverseThreads = thrTraversal.size() + 1;
     cacheInit();
     credits = std::make_shared<Credits>();
 }
@@ -79,6 +115,7 @@ MapImpl::~MapImpl()
     resources.cacheReading.con.notify_all();
     resources.fetching.stop = true;
     resources.fetching.con.notify_all();
+    traversePool.terminate();
 
     resources.thrCacheWriter.join();
     resources.cacheReading.thr.join();
@@ -87,11 +124,24 @@ MapImpl::~MapImpl()
     if (createOptions.debugUseExtraThreads)
     {
         resources.thrAtmosphereGenerator.join();
-        resources.thrGeodataProcessor.join();
-        resources.thrDecoder.join();
+        for (std::thread &thr : resources.thrGeodataProcessors)
+            thr.join();
+        for (std::thread &thr : resources.thrDecoders)
+            thr.join();
+        for (std::thread &thr : thrTraversal)
+            thr.join();
     }
 }
 
+void MapImpl::traverseWorkerEntry(uint32 index)
+{
+    std::string threadName = std::string() + "traversal "
+        + std::to_string(index);
+    OPTICK_THREAD(threadName.c_str());
+    setLogThreadName(threadName);
+    traversePool.workerEntry();
+}
+
 void MapImpl::renderUpdate(double elapsedTime)
 {
     OPTICK_EVENT();
@@ -116,14 +166,43 @@ void MapImpl::renderUpdate(double elapsedTime)
 
     {
         OPTICK_EVENT("traverseClearing");
+        ScopedTimer timer(timings.traverseClearing);
         for (auto &it : layers)
+        {
             traverseClearing(it->traverseRoot.get());
+            it->traverseNodes.collect();
+        }
     }
 
     if (mapconfig->atmosphereDensityTexture)
         updateAtmosphereDensity();
 }
 
+void MapTimings::summarize(MapStatistics &statistics) const
+{
+    renderUpdate.summarize(statistics.timeRenderUpdate);
+    resourcesUpdate.summarize(statistics.timeResourcesUpdate);
+    traverseClearing.summarize(statistics.timeTraverseClearing);
+    dataUpdate.summarize(statistics.timeDataUpdate);
+    cacheRead.summarize(statistics.timeCacheRead);
+    cacheWrite.summarize(statistics.timeCacheWrite);
+    decode.summarize(statistics.timeDecode);
+    geodata.summarize(statistics.timeGeodata);
+    upload.summarize(statistics.timeUpload);
+    uploadFlush.summarize(statistics.timeUploadFlush);
+}
+
+void MapCounters::summarize(MapStatistics &statistics) const
+{
+    statistics.resourcesCreated = resourcesCreated;
+    statistics.resourcesDownloaded = resourcesDownloaded;
+    statistics.resourcesDiskLoaded = resourcesDiskLoaded;
+    statistics.resourcesDecoded = resourcesDecoded;
+    statistics.resourcesUploaded = resourcesUploaded;
+    statistics.resourcesFailed = resourcesFailed;
+    statistics.resourcesReleased = resourcesReleased;
+}
+
 void MapImpl::initializeNavigation()
 {
     OPTICK_EVENT();
@@ -287,7 +366,7 @@ bool MapImpl::prerequisitesCheck()
 
 void MapImpl::traverseClearing(TraverseNode *trav)
 {
-    if (std::max(trav->lastAccessTime, trav->lastRenderTime) + 5
+    if (std::max<uint32>(trav->lastAccessTime, trav->lastRenderTime) + 5
                 < renderTickIndex)
     {
         if (trav->meta)
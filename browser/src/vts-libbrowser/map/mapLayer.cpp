@@ -87,9 +87,11 @@ BoundParamInfo::List MapLayer::boundList(const SurfaceInfo *surface,
         surfaceName = n[surfaceReference - 1];
     else if (!n.empty())
         surfaceName = n.back();
-    const vtslibs::registry::View::BoundLayerParams::list &boundList
-            = boundLayerParams[surfaceName];
-    BoundParamInfo::List bls(boundList.begin(), boundList.end());
+    // read only, the traversal tasks call this concurrently
+    auto it = boundLayerParams.find(surfaceName);
+    if (it == boundLayerParams.end())
+        return {};
+    BoundParamInfo::List bls(it->second.begin(), it->second.end());
     return bls;
 }
 
@@ -132,7 +134,7 @@ bool MapLayer::prerequisitesCheckMainSurfaces()
     if (surfaceStack.surfaces.empty())
         surfaceStack.generateReal(map);
 
-    traverseRoot = std::make_unique<TraverseNode>(this, nullptr, NodeInfo(
+    traverseRoot = traverseNodes.acquire(this, nullptr, NodeInfo(
                     mapconfig->referenceFrame, TileId(), false, *mapconfig));
     traverseRoot->priority = std::numeric_limits<double>::infinity();
 
@@ -151,7 +153,7 @@ bool MapLayer::prerequisitesCheckFreeLayer()
     surfaceStack.generateFree(map, *freeLayer);
     assert(!surfaceStack.surfaces.empty());
 
-    traverseRoot = std::make_unique<TraverseNode>(this, nullptr, NodeInfo(
+    traverseRoot = traverseNodes.acquire(this, nullptr, NodeInfo(
                     mapconfig->referenceFrame, TileId(), false, *mapconfig));
     traverseRoot->priority = std::numeric_limits<double>::infinity();
 
@@ -31,12 +31,11 @@
 
 #include "renderInfos.hpp"
 #include "credits.hpp"
+#include "traverseNode.hpp"
 
 namespace vts
 {
 
-class TraverseNode;
-
 class SurfaceInfo
 {
 public:
@@ -50,10 +49,11 @@ public:
     SurfaceInfo(const vtslibs::registry::FreeLayer::Geodata &surface,
         const std::string &parentPath);
 
-    UrlTemplate urlMeta;
-    UrlTemplate urlMesh;
-    UrlTemplate urlIntTex;
-    UrlTemplate urlGeodata;
+    InternedUrlTemplate urlMeta;
+    InternedUrlTemplate urlMesh;
+    InternedUrlTemplate urlIntTex;
+    InternedUrlTemplate urlGeodata;
+    InternedUrlTemplate urlNav;
     vtslibs::vts::TilesetIdList name;
     vec3f color {0,0,0};
     bool alien = false;
@@ -100,7 +100,8 @@ public:
     SurfaceStack surfaceStack;
     boost::optional<SurfaceStack> tilesetStack;
 
-    std::unique_ptr<TraverseNode> traverseRoot;
+    TraverseNodePool traverseNodes; // must outlive the root
+    TraverseNodePtr traverseRoot;
 
     MapImpl *const map = nullptr;
     Credits::Scope creditScope;
@@ -29,6 +29,8 @@
 
 #include <memory>
 #include <string>
+#include <list>
+#include <vector>
 #include <atomic>
 #include <ctime>
 
@@ -58,11 +60,27 @@ public:
         errorRetry,
         availFail,
     };
+    static const uint32 StatesCount = (uint32)State::availFail + 1;
+
+    // atomic state which reports all transitions
+    //   to the bookkeeping in the map
+    class StateTracker : private Immovable
+    {
+    public:
+        explicit StateTracker(Resource *owner) : owner(owner) {}
+        StateTracker &operator = (State s);
+        operator State () const { return value; }
+
+    private:
+        Resource *const owner;
+        std::atomic<State> value {State::initializing};
+    };
 
     explicit Resource(MapImpl *map, const std::string &name);
     virtual ~Resource();
     virtual void decode() = 0; // eg. decode an image
     virtual void upload() {} // call the resource callback
+    virtual void uploadDone() {} // after the (possibly batched) callback
     virtual bool requiresUpload() { return false; }
     virtual FetchTask::ResourceType resourceType() const = 0;
     bool allowDiskCache() const;
@@ -72,17 +90,51 @@ public:
     void forceRedownload();
     explicit operator bool() const; // return state == ready
     std::shared_ptr<void> getUserData() const; // returns the user data from info but with replaced owner to prolonge the lifetime of the entire resource
+    void *getUserDataPinned(); // returns the user data without ownership, the resource is kept for this and the next render tick
 
     const std::string name;
     MapImpl *const map = nullptr;
-    std::atomic<State> state {State::initializing};
+    StateTracker state {this};
+    std::atomic<bool> decoding {false};
     ResourceInfo info;
     std::shared_ptr<void> decodeData;
     std::shared_ptr<FetchTaskImpl> fetch;
     std::time_t retryTime = -1;
     uint32 retryNumber = 0;
-    uint32 lastAccessTick = 0;
-    float priority;
+    std::atomic<uint32> lastAccessTick {0}; // touched by traversal tasks
+    std::atomic<uint32> pinnedTick {0}; // used in draws without ownership
+    std::atomic<float> priority;
+
+    // position in an eviction list in the map (main thread only)
+    struct LruPosition
+    {
+        std::list<Resource *>::iterator it;
+        bool linked = false;
+    };
+
+    // bookkeeping in the map
+    uint32 accountedRamMemoryCost = 0;
+    uint32 accountedGpuMemoryCost = 0;
+    bool tracked = false; // the resource is registered in the map
+    bool attention = false; // in the attention list (main thread only)
+    LruPosition lruRam, lruGpu;
+};
+
+// resources touched by a traversal task
+//   the eviction lists are updated from them by the main thread
+//   after the tasks are joined
+typedef std::vector<Resource *> ResourceTouches;
+
+// touches made by this thread are collected in the buffer
+//   instead of the eviction lists while the scope is alive
+class ResourceTouchesScope : private Immovable
+{
+public:
+    explicit ResourceTouchesScope(ResourceTouches &touches);
+    ~ResourceTouchesScope();
+
+private:
+    ResourceTouches *const previous;
 };
 
 std::ostream &operator << (std::ostream &stream, Resource::State state);
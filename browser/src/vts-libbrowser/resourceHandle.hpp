@@ -0,0 +1,110 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef RESOURCEHANDLE_HPP_t8e3k1dn5wq
+#define RESOURCEHANDLE_HPP_t8e3k1dn5wq
+
+#include <vector>
+#include <memory>
+
+#include <vts-libs/registry/referenceframe.hpp>
+#include <vts-libs/vts/urltemplate.hpp>
+
+#include "include/vts-browser/foundation.hpp"
+
+namespace vts
+{
+
+using vtslibs::vts::UrlTemplate;
+using TileId = vtslibs::registry::ReferenceFrame::Division::Node::Id;
+
+class Resource;
+
+// url template with an identity
+// the id changes whenever the template is parsed,
+//   copies of the template share the id
+class InternedUrlTemplate
+{
+public:
+    InternedUrlTemplate();
+    void parse(const std::string &str);
+    std::string operator () (const UrlTemplate::Vars &vars) const;
+    uint32 id() const { return id_; }
+
+private:
+    UrlTemplate templ;
+    uint32 id_ = 0;
+};
+
+// identifies a resource by its url template and variables
+//   without composing the url
+class ResourceHandle
+{
+public:
+    ResourceHandle() = default;
+    ResourceHandle(const InternedUrlTemplate &templ,
+        const UrlTemplate::Vars &vars);
+    bool operator == (const ResourceHandle &other) const;
+    uint64 hash() const { return hash_; }
+
+private:
+    TileId tileId;
+    TileId localId;
+    uint32 subMesh = 0;
+    uint32 templateId = 0;
+    uint64 hash_ = 0;
+};
+
+// open addressing map from handles to resources
+// the resources are owned elsewhere,
+//   expired entries are dropped when the table grows
+class ResourceHandleMap
+{
+public:
+    std::shared_ptr<Resource> find(const ResourceHandle &handle) const;
+    void insert(const ResourceHandle &handle,
+        const std::shared_ptr<Resource> &resource);
+    void clear();
+    uint32 size() const { return used; }
+
+private:
+    struct Slot
+    {
+        ResourceHandle handle;
+        std::weak_ptr<Resource> resource;
+        bool used = false;
+    };
+
+    void rehash();
+    uint32 position(const ResourceHandle &handle) const;
+
+    std::vector<Slot> slots; // size is power of two
+    uint32 used = 0;
+};
+
+} // namespace vts
+
+#endif
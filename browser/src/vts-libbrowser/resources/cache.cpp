@@ -26,6 +26,7 @@
 
 #include "../include/vts-browser/mapOptions.hpp"
 #include "../map.hpp"
+#include "../cache.hpp"
 
 #include <boost/filesystem.hpp>
 #include <utility/path.hpp> // homeDir
@@ -67,38 +68,77 @@ char digit(unsigned char a)
 
 } // namespace
 
-class Cache
+Cache::Cache(const MapCreateOptions &options) :
+    disabled(!options.diskCache)
 {
-public:
-    Cache(const MapCreateOptions &options) :
-        disabled(!options.diskCache),
-        hashes(options.hashCachePaths)
+    if (options.diskCache)
     {
-        if (options.diskCache)
-        {
 #ifdef __EMSCRIPTEN__
-            LOGTHROW(err4, std::logic_error)
-                << "Disk Cache is not awailable in WASM";
+        LOGTHROW(err4, std::logic_error)
+            << "Disk Cache is not awailable in WASM";
 #else
+        if (root.empty())
+        {
+            root = "/home";
+            root = utility::homeDir().string();
             if (root.empty())
             {
-                root = "/home";
-                root = utility::homeDir().string();
-                if (root.empty())
-                {
-                    LOGTHROW(err3, std::runtime_error)
-                        << "Invalid home dir, the cache path must be defined";
-                }
-                root += "/.cache/vts-browser/";
+                LOGTHROW(err3, std::runtime_error)
+                    << "Invalid home dir, the cache path must be defined";
             }
-            if (root.back() != '/')
-                root += "/";
-            LOG(info2) << "Disk cache path: <" << root << ">";
-#endif
+            root += "/.cache/vts-browser/";
         }
+        if (root.back() != '/')
+            root += "/";
+        LOG(info2) << "Disk cache path: <" << root << ">";
+#endif
     }
+}
 
-    void write(CacheData &&cd)
+Cache::~Cache()
+{}
+
+void Cache::purge()
+{
+#ifndef __EMSCRIPTEN__
+    if (disabled)
+        return;
+    OPTICK_EVENT();
+    LOG(info2) << "Purging disk cache";
+    assert(root.length() > 0 && root[root.length() - 1] == '/');
+    std::string op = root.substr(0, root.length() - 1);
+    if (!boost::filesystem::exists(op))
+        return;
+    try
+    {
+        std::string np = op + "-deleted";
+        boost::filesystem::rename(op, np);
+        boost::filesystem::remove_all(np);
+    }
+    catch (const std::exception &e)
+    {
+        LOG(warn3) << "Purging cache failed: <" << e.what() << ">";
+    }
+#endif
+}
+
+std::string Cache::stripScheme(const std::string &name)
+{
+    auto p = name.find("://");
+    return p == std::string::npos ? name : name.substr(p + 3);
+}
+
+namespace
+{
+
+class FilesCache : public Cache
+{
+public:
+    FilesCache(const MapCreateOptions &options) : Cache(options),
+        hashes(options.hashCachePaths)
+    {}
+
+    void write(CacheData &&cd) override
     {
 #ifndef __EMSCRIPTEN__
         if (disabled)
@@ -128,7 +168,7 @@ public:
 #endif
     }
 
-    CacheData read(const std::string &nameParam)
+    CacheData read(const std::string &nameParam) override
     {
 #ifdef __EMSCRIPTEN__
         return {};
@@ -143,7 +183,7 @@ public:
         try
         {
             CacheData cd;
-            Buffer b = readLocalFileBuffer(fileName);
+            Buffer b = mapLocalFileBuffer(fileName);
             if (b.size() < sizeof(CacheHeader))
                 return {};
             CacheHeader *h = (CacheHeader*)b.data();
@@ -167,9 +207,8 @@ public:
             uint32 size = b.size() - sizeof(CacheHeader) - h->nameLen;
             if (size > 0)
             {
-                cd.buffer.allocate(size);
-                memcpy(cd.buffer.data(), b.data()
-                    + sizeof(CacheHeader) + h->nameLen, size);
+                // shares the mapped memory, no copy
+                cd.buffer = b.slice(sizeof(CacheHeader) + h->nameLen, size);
             }
             cd.availFailed = (h->flags & (uint16)CacheFlags::AvailFailed)
                 == (uint16)CacheFlags::AvailFailed;
@@ -183,30 +222,6 @@ public:
 #endif
     }
 
-    void purge()
-    {
-#ifndef __EMSCRIPTEN__
-        if (disabled)
-            return;
-        OPTICK_EVENT();
-        LOG(info2) << "Purging disk cache";
-        assert(root.length() > 0 && root[root.length() - 1] == '/');
-        std::string op = root.substr(0, root.length() - 1);
-        if (!boost::filesystem::exists(op))
-            return;
-        try
-        {
-            std::string np = op + "-deleted";
-            boost::filesystem::rename(op, np);
-            boost::filesystem::remove_all(np);
-        }
-        catch (const std::exception &e)
-        {
-            LOG(warn3) << "Purging cache failed: <" << e.what() << ">";
-        }
-#endif
-    }
-
     std::string convertNameToCache(const std::string &path)
     {
         assert(path == stripScheme(path));
@@ -236,20 +251,23 @@ public:
         }
     }
 
-    std::string stripScheme(const std::string &name)
-    {
-        auto p = name.find("://");
-        return p == std::string::npos ? name : name.substr(p + 3);
-    }
-
-    std::string root;
-    bool disabled;
-    bool hashes;
+    const bool hashes;
 };
 
+} // namespace
+
+std::shared_ptr<Cache> Cache::create(const MapCreateOptions &options)
+{
+#ifndef __EMSCRIPTEN__
+    if (options.diskCache && options.packedCache)
+        return createPackedCache(options);
+#endif
+    return std::make_shared<FilesCache>(options);
+}
+
 void MapImpl::cacheInit()
 {
-    resources.cache = std::make_shared<Cache>(createOptions);
+    resources.cache = Cache::create(createOptions);
 }
 
 void MapImpl::cacheWrite(CacheData &&data)
@@ -0,0 +1,757 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/mapOptions.hpp"
+#include "../map.hpp"
+#include "../cache.hpp"
+
+#include <boost/filesystem.hpp>
+#include <dbglog/dbglog.hpp>
+#include <optick.h>
+#include <zlib.h> // crc32
+
+#include <unordered_map>
+#include <map>
+#include <mutex>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#ifndef _WIN32
+#define VTS_CACHE_MMAP
+#include <unistd.h> // pread
+#endif
+
+namespace vts
+{
+
+namespace
+{
+
+// all resources are appended into few large segment files
+// the index maps hashed resource names to records in the segments
+//   and is periodically saved into a snapshot file
+// records appended after the last snapshot are recovered
+//   by scanning the tails of the segments
+
+static const uint32 RecordMagic = 0x72737476; // vtsr
+static const char IndexMagic[] = "vtspidx";
+static const uint32 IndexVersion = 1;
+static const uint32 IndexSaveInterval = 1000; // number of writes
+static const uint64 SegmentSizeMax = 64 * 1024 * 1024;
+static const uint64 SegmentSizeMin = 1024 * 1024;
+static const uint32 RecordAlignment = 8;
+static const uint64 RemapThreshold = 4 * 1024 * 1024; // growth of a segment
+
+enum class RecordFlags : uint16
+{
+    None = 0,
+    AvailFailed = 1 << 0,
+};
+
+struct RecordHeader
+{
+    uint32 magic;
+    uint32 checksum; // crc32 of name and data
+    uint32 nameLen;
+    uint32 dataLen;
+    sint64 expires;
+    uint16 flags;
+    uint16 reserved1;
+    uint32 reserved2;
+};
+
+struct IndexHeader
+{
+    char magic[8];
+    uint32 version;
+    uint32 checksum; // crc32 of everything that follows the header
+    uint32 segmentsCount;
+    uint32 reserved;
+    uint64 entriesCount;
+};
+
+struct IndexSegment
+{
+    uint32 id;
+    uint32 reserved;
+    uint64 size;
+};
+
+struct IndexEntry
+{
+    uint64 hash;
+    uint32 segment;
+    uint32 offset;
+    uint32 size;
+    uint16 flags;
+    uint16 reserved;
+    sint64 expires;
+};
+
+// stable across runs and platforms, unlike std::hash
+uint64 hashName(const std::string &name)
+{
+    uint64 h = 14695981039346656037ull;
+    for (char c : name)
+    {
+        h ^= (unsigned char)c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// records are padded so that all headers are aligned in the mapped memory
+uint32 recordSize(uint32 nameLen, uint32 dataLen)
+{
+    uint32 s = sizeof(RecordHeader) + nameLen + dataLen;
+    return (s + RecordAlignment - 1) / RecordAlignment * RecordAlignment;
+}
+
+uint32 checksum(const char *name, uint32 nameLen,
+    const char *data, uint32 dataLen)
+{
+    // passing null pointer to crc32 would reset the checksum
+    uLong c = crc32(0L, Z_NULL, 0);
+    if (nameLen)
+        c = crc32(c, (const Bytef*)name, nameLen);
+    if (dataLen)
+        c = crc32(c, (const Bytef*)data, dataLen);
+    return (uint32)c;
+}
+
+class PackedCache : public Cache
+{
+public:
+    struct Entry
+    {
+        uint32 segment;
+        uint32 offset;
+        uint32 size; // whole record including the header and padding
+        uint16 flags;
+        sint64 expires;
+    };
+
+    struct Segment
+    {
+        uint64 size = 0; // valid length of the file
+        uint64 liveBytes = 0; // bytes referenced by the index
+        FILE *reader = nullptr;
+        Buffer mapping; // whole file mapped into memory
+    };
+
+    PackedCache(const MapCreateOptions &options) : Cache(options),
+        sizeLimit((uint64)options.packedCacheSizeLimitMB * 1024 * 1024)
+    {
+        segmentLimit = std::max(SegmentSizeMin,
+            std::min(SegmentSizeMax, sizeLimit / 8));
+        dir = root + "packed/";
+    }
+
+    ~PackedCache()
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        try
+        {
+            if (loaded && pendingWrites > 0)
+                saveIndex();
+        }
+        catch (...)
+        {
+            // do nothing
+        }
+        closeFiles();
+    }
+
+    void write(CacheData &&cd) override
+    {
+        OPTICK_EVENT();
+        std::lock_guard<std::mutex> lock(mut);
+        try
+        {
+            load();
+            std::string name = stripScheme(cd.name);
+            uint16 flags = cd.availFailed
+                ? (uint16)RecordFlags::AvailFailed : 0;
+            append(name, cd.buffer.data(), cd.buffer.size(),
+                cd.expires, flags);
+            if (++pendingWrites >= IndexSaveInterval)
+                saveIndex();
+        }
+        catch (const std::exception &e)
+        {
+            LOG(warn2) << "Failed writing into packed cache: <"
+                << e.what() << ">";
+        }
+    }
+
+    CacheData read(const std::string &nameParam) override
+    {
+        OPTICK_EVENT();
+        std::lock_guard<std::mutex> lock(mut);
+        try
+        {
+            load();
+            std::string name = stripScheme(nameParam);
+            auto it = index.find(hashName(name));
+            if (it == index.end())
+                return {};
+            const Entry &e = it->second;
+            if (e.expires == -2)
+                return {}; // must revalidate
+            if (e.expires > 0 && e.expires < std::time(nullptr))
+                return {}; // expired
+            Buffer b = readRecord(e);
+            const RecordHeader *h = (const RecordHeader*)b.data();
+            if (h->nameLen != name.size() || memcmp(
+                b.data() + sizeof(RecordHeader), name.data(),
+                name.size()) != 0)
+                return {}; // hash collision
+            CacheData cd;
+            cd.expires = h->expires;
+            cd.availFailed = (h->flags & (uint16)RecordFlags::AvailFailed)
+                == (uint16)RecordFlags::AvailFailed;
+            if (h->dataLen > 0)
+            {
+                // shares the mapped memory when available, no copy
+                cd.buffer = b.slice(sizeof(RecordHeader) + h->nameLen,
+                    h->dataLen);
+            }
+            cd.name = nameParam;
+            return cd;
+        }
+        catch (const std::exception &e)
+        {
+            LOG(warn2) << "Failed reading from packed cache: <"
+                << e.what() << ">";
+            return {};
+        }
+    }
+
+    void purge() override
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        closeFiles();
+        index.clear();
+        segments.clear();
+        pendingWrites = 0;
+        loaded = false;
+        Cache::purge();
+    }
+
+private:
+    std::string segmentPath(uint32 id) const
+    {
+        char buf[32];
+        sprintf(buf, "%08x.seg", id);
+        return dir + buf;
+    }
+
+    std::string indexPath() const
+    {
+        return dir + "index";
+    }
+
+    void closeFiles()
+    {
+        for (auto &it : segments)
+        {
+            if (it.second.reader)
+                fclose(it.second.reader);
+            it.second.reader = nullptr;
+            it.second.mapping.free();
+        }
+        if (writer)
+            fclose(writer);
+        writer = nullptr;
+    }
+
+    ////////////////////////////
+    // WRITING
+    ////////////////////////////
+
+    void openWriter()
+    {
+        if (writer)
+            return;
+        uint32 id = segments.empty() ? 0 : segments.rbegin()->first;
+        if (segments.empty() || segments[id].size >= segmentLimit)
+            id++;
+        boost::filesystem::create_directories(dir);
+        writer = fopen(segmentPath(id).c_str(), "ab");
+        if (!writer)
+            LOGTHROW(err2, std::runtime_error)
+                << "Failed to open cache segment <"
+                << segmentPath(id) << ">";
+        segments[id];
+        writerId = id;
+    }
+
+    void rollWriter()
+    {
+        fclose(writer);
+        writer = nullptr;
+        LOG(info1) << "Packed cache segment <" << writerId << "> is full";
+        if (!compacting)
+            compact();
+        openWriter();
+    }
+
+    void append(const std::string &name, const char *data, uint32 dataLen,
+        sint64 expires, uint16 flags)
+    {
+        openWriter();
+        uint32 size = recordSize(name.size(), dataLen);
+        if (segments[writerId].size > 0
+            && segments[writerId].size + size > segmentLimit)
+            rollWriter();
+        Buffer b(size);
+        b.zero(); // initialize structure and record padding
+        RecordHeader *h = (RecordHeader*)b.data();
+        h->magic = RecordMagic;
+        h->nameLen = name.size();
+        h->dataLen = dataLen;
+        h->expires = expires;
+        h->flags = flags;
+        h->checksum = checksum(name.data(), name.size(), data, dataLen);
+        memcpy(b.data() + sizeof(RecordHeader), name.data(), name.size());
+        memcpy(b.data() + sizeof(RecordHeader) + name.size(), data, dataLen);
+        Segment &s = segments[writerId];
+        if (fwrite(b.data(), b.size(), 1, writer) != 1 || fflush(writer) != 0)
+        {
+            // the tail may be partially written, the segment is abandoned
+            //   and its tail will be discarded on next recovery
+            fclose(writer);
+            writer = nullptr;
+            s.size = segmentLimit;
+            LOGTHROW(err2, std::runtime_error)
+                << "Failed to write cache segment <"
+                << segmentPath(writerId) << ">";
+        }
+        Entry e;
+        e.segment = writerId;
+        e.offset = s.size;
+        e.size = size;
+        e.flags = flags;
+        e.expires = expires;
+        s.size += size;
+        insert(hashName(name), e);
+    }
+
+    void insert(uint64 hash, const Entry &e)
+    {
+        auto it = index.find(hash);
+        if (it != index.end())
+        {
+            auto s = segments.find(it->second.segment);
+            if (s != segments.end())
+                s->second.liveBytes -= it->second.size;
+            it->second = e;
+        }
+        else
+            index[hash] = e;
+        segments[e.segment].liveBytes += e.size;
+    }
+
+    ////////////////////////////
+    // READING
+    ////////////////////////////
+
+    FILE *reader(uint32 id)
+    {
+        Segment &s = segments.at(id);
+        if (!s.reader)
+        {
+            s.reader = fopen(segmentPath(id).c_str(), "rb");
+            if (!s.reader)
+                LOGTHROW(err2, std::runtime_error)
+                    << "Failed to open cache segment <"
+                    << segmentPath(id) << ">";
+        }
+        return s.reader;
+    }
+
+    Buffer readRecord(const Entry &e)
+    {
+#ifdef VTS_CACHE_MMAP
+        Segment &s = segments.at(e.segment);
+        uint64 end = (uint64)e.offset + e.size;
+        if (end > s.mapping.size() && (s.mapping.size() == 0
+            || s.size >= s.mapping.size() + RemapThreshold))
+        {
+            // the segment has grown enough since it was mapped
+            //   the previous mapping is released once
+            //   all buffers sharing it are gone
+            s.mapping = mapLocalFileBuffer(segmentPath(e.segment));
+        }
+        Buffer b;
+        if (end <= s.mapping.size())
+            b = s.mapping.slice(e.offset, e.size);
+        else
+        {
+            // records appended after the mapping are read until the next remap
+            b.allocate(e.size);
+            if (pread(fileno(reader(e.segment)), b.data(), b.size(), e.offset)
+                != (ssize_t)b.size())
+                LOGTHROW(err2, std::runtime_error)
+                    << "Failed to read cache segment <"
+                    << segmentPath(e.segment) << ">";
+        }
+#else
+        FILE *f = reader(e.segment);
+        Buffer b(e.size);
+        if (fseek(f, e.offset, SEEK_SET) != 0
+            || fread(b.data(), b.size(), 1, f) != 1)
+            LOGTHROW(err2, std::runtime_error)
+                << "Failed to read cache segment <"
+                << segmentPath(e.segment) << ">";
+#endif
+        const RecordHeader *h = (const RecordHeader*)b.data();
+        if (h->magic != RecordMagic
+            || recordSize(h->nameLen, h->dataLen) != e.size)
+            LOGTHROW(err2, std::runtime_error)
+                << "Corrupted record in cache segment <"
+                << segmentPath(e.segment) << ">";
+        return b;
+    }
+
+    ////////////////////////////
+    // INDEX
+    ////////////////////////////
+
+    void load()
+    {
+        if (loaded)
+            return;
+        loaded = true;
+        if (!boost::filesystem::exists(dir))
+            return;
+
+        // find segment files
+        std::map<uint32, uint64> files; // id -> file size
+        for (boost::filesystem::directory_iterator it(dir), et;
+            it != et; it++)
+        {
+            if (it->path().extension() != ".seg")
+                continue;
+            uint32 id = 0;
+            if (sscanf(it->path().stem().string().c_str(), "%x", &id) != 1
+                || id == 0)
+                continue;
+            files[id] = boost::filesystem::file_size(it->path());
+        }
+
+        // load the snapshot
+        std::map<uint32, uint64> indexed; // id -> length covered by index
+        try
+        {
+            loadIndex(files, indexed);
+        }
+        catch (const std::exception &e)
+        {
+            LOG(warn2) << "Packed cache index is invalid: <"
+                << e.what() << ">, it will be rebuilt";
+            index.clear();
+            indexed.clear();
+        }
+
+        // recover records appended after the snapshot was taken
+        //   (in order of writing, so that newer records take precedence)
+        for (const auto &f : files)
+        {
+            segments[f.first];
+            auto it = indexed.find(f.first);
+            uint64 start = it == indexed.end() ? 0 : it->second;
+            recoverTail(f.first, start, f.second);
+        }
+        for (auto &it : index)
+            segments[it.second.segment].liveBytes += it.second.size;
+
+        LOG(info2) << "Packed cache loaded with " << index.size()
+            << " entries in " << segments.size() << " segments";
+        compact();
+        if (pendingWrites > 0)
+            saveIndex();
+    }
+
+    void loadIndex(const std::map<uint32, uint64> &files,
+        std::map<uint32, uint64> &indexed)
+    {
+        if (!boost::filesystem::exists(indexPath()))
+            return;
+        Buffer b = readLocalFileBuffer(indexPath());
+        if (b.size() < sizeof(IndexHeader))
+            LOGTHROW(err1, std::runtime_error) << "Truncated header";
+        const IndexHeader *h = (const IndexHeader*)b.data();
+        if (memcmp(h->magic, IndexMagic, sizeof(IndexMagic)) != 0
+            || h->version != IndexVersion)
+            LOGTHROW(err1, std::runtime_error) << "Invalid version";
+        if (b.size() != sizeof(IndexHeader)
+            + h->segmentsCount * sizeof(IndexSegment)
+            + h->entriesCount * sizeof(IndexEntry))
+            LOGTHROW(err1, std::runtime_error) << "Invalid size";
+        if (h->checksum != checksum(nullptr, 0,
+            b.data() + sizeof(IndexHeader), b.size() - sizeof(IndexHeader)))
+            LOGTHROW(err1, std::runtime_error) << "Invalid checksum";
+        const IndexSegment *ss = (const IndexSegment*)
+            (b.data() + sizeof(IndexHeader));
+        for (uint32 i = 0; i < h->segmentsCount; i++)
+        {
+            auto f = files.find(ss[i].id);
+            if (f == files.end() || f->second < ss[i].size)
+                continue; // the segment was removed or truncated
+            indexed[ss[i].id] = ss[i].size;
+        }
+        const IndexEntry *es = (const IndexEntry*)
+            (ss + h->segmentsCount);
+        index.reserve(h->entriesCount);
+        for (uint64 i = 0; i < h->entriesCount; i++)
+        {
+            const IndexEntry &ie = es[i];
+            auto s = indexed.find(ie.segment);
+            if (s == indexed.end()
+                || (uint64)ie.offset + ie.size > s->second)
+                continue;
+            Entry e;
+            e.segment = ie.segment;
+            e.offset = ie.offset;
+            e.size = ie.size;
+            e.flags = ie.flags;
+            e.expires = ie.expires;
+            index[ie.hash] = e;
+        }
+    }
+
+    void recoverTail(uint32 id, uint64 start, uint64 fileSize)
+    {
+        Segment &s = segments[id];
+        s.size = start;
+        if (start >= fileSize)
+            return;
+        FILE *f = reader(id);
+        if (fseek(f, start, SEEK_SET) != 0)
+            return;
+        uint32 recovered = 0;
+        Buffer b;
+        while (s.size + sizeof(RecordHeader) <= fileSize)
+        {
+            RecordHeader h;
+            if (fread(&h, sizeof(h), 1, f) != 1)
+                break;
+            if (h.magic != RecordMagic
+                || (uint64)h.nameLen + h.dataLen > fileSize)
+                break;
+            uint32 size = recordSize(h.nameLen, h.dataLen);
+            if (s.size + size > fileSize)
+                break;
+            b.allocate(size - sizeof(RecordHeader));
+            if (b.size() > 0 && fread(b.data(), b.size(), 1, f) != 1)
+                break;
+            if (h.checksum != checksum(b.data(), h.nameLen,
+                b.data() + h.nameLen, h.dataLen))
+                break;
+            Entry e;
+            e.segment = id;
+            e.offset = s.size;
+            e.size = size;
+            e.flags = h.flags;
+            e.expires = h.expires;
+            index[hashName(std::string(b.data(), h.nameLen))] = e;
+            s.size += e.size;
+            recovered++;
+        }
+        pendingWrites += recovered;
+        if (recovered)
+            LOG(info2) << "Packed cache recovered " << recovered
+                << " records in segment <" << id << ">";
+        if (s.size < fileSize)
+        {
+            // discard incomplete or corrupted tail
+            LOG(warn2) << "Packed cache segment <" << id
+                << "> is truncated from " << fileSize
+                << " to " << s.size << " bytes";
+            fclose(s.reader);
+            s.reader = nullptr;
+            s.mapping.free();
+            boost::filesystem::resize_file(segmentPath(id), s.size);
+        }
+    }
+
+    void saveIndex()
+    {
+        OPTICK_EVENT();
+        pendingWrites = 0;
+        if (writer)
+            fflush(writer);
+        Buffer b(sizeof(IndexHeader)
+            + segments.size() * sizeof(IndexSegment)
+            + index.size() * sizeof(IndexEntry));
+        b.zero(); // initialize structure padding
+        IndexHeader *h = (IndexHeader*)b.data();
+        memcpy(h->magic, IndexMagic, sizeof(IndexMagic));
+        h->version = IndexVersion;
+        h->segmentsCount = segments.size();
+        h->entriesCount = index.size();
+        IndexSegment *ss = (IndexSegment*)(b.data() + sizeof(IndexHeader));
+        for (const auto &it : segments)
+        {
+            ss->id = it.first;
+            ss->size = it.second.size;
+            ss++;
+        }
+        IndexEntry *es = (IndexEntry*)ss;
+        for (const auto &it : index)
+        {
+            es->hash = it.first;
+            es->segment = it.second.segment;
+            es->offset = it.second.offset;
+            es->size = it.second.size;
+            es->flags = it.second.flags;
+            es->expires = it.second.expires;
+            es++;
+        }
+        h->checksum = checksum(nullptr, 0, b.data() + sizeof(IndexHeader),
+            b.size() - sizeof(IndexHeader));
+        // writes into temporary file and renames it, which is atomic
+        writeLocalFileBuffer(indexPath(), b);
+    }
+
+    ////////////////////////////
+    // COMPACTION
+    ////////////////////////////
+
+    uint64 totalSize() const
+    {
+        uint64 t = 0;
+        for (const auto &it : segments)
+            t += it.second.size;
+        return t;
+    }
+
+    void removeSegment(uint32 id)
+    {
+        auto s = segments.find(id);
+        assert(s != segments.end());
+        if (s->second.reader)
+            fclose(s->second.reader);
+        segments.erase(s);
+        boost::system::error_code ec;
+        boost::filesystem::remove(segmentPath(id), ec);
+    }
+
+    void removeEntries(uint32 id)
+    {
+        for (auto it = index.begin(); it != index.end();)
+        {
+            if (it->second.segment == id)
+                it = index.erase(it);
+            else
+                it++;
+        }
+    }
+
+    // rewrites live records from sparse segments into the active segment
+    //   and drops the oldest segments to fit into the size limit
+    // the last segment is never touched as it is (or will be) the active one
+    void compact()
+    {
+        OPTICK_EVENT();
+        if (segments.empty())
+            return;
+        compacting = true;
+        uint32 lastId = segments.rbegin()->first;
+        std::vector<uint32> sparse;
+        for (const auto &it : segments)
+        {
+            if (it.first != lastId && it.second.size >= segmentLimit / 2
+                && it.second.liveBytes < it.second.size / 2)
+                sparse.push_back(it.first);
+        }
+        uint64 limit = sizeLimit > segmentLimit
+            ? sizeLimit - segmentLimit : 0;
+        bool changed = false;
+        for (uint32 id : sparse)
+        {
+            if (totalSize() + segments[id].liveBytes <= limit)
+            {
+                // collect records first, appending modifies the index
+                std::vector<Entry> live;
+                for (const auto &it : index)
+                    if (it.second.segment == id)
+                        live.push_back(it.second);
+                std::sort(live.begin(), live.end(),
+                    [](const Entry &a, const Entry &b) {
+                    return a.offset < b.offset;
+                });
+                for (const Entry &e : live)
+                {
+                    Buffer b = readRecord(e);
+                    const RecordHeader *h = (const RecordHeader*)b.data();
+                    std::string name(b.data() + sizeof(RecordHeader),
+                        h->nameLen);
+                    append(name, b.data() + sizeof(RecordHeader)
+                        + h->nameLen, h->dataLen, h->expires, h->flags);
+                }
+            }
+            removeEntries(id);
+            LOG(info1) << "Packed cache segment <" << id << "> compacted";
+            removeSegment(id);
+            changed = true;
+        }
+        while (segments.size() > 1 && totalSize() > limit)
+        {
+            uint32 id = segments.begin()->first;
+            LOG(info1) << "Packed cache segment <" << id << "> evicted";
+            removeEntries(id);
+            removeSegment(id);
+            changed = true;
+        }
+        compacting = false;
+        if (changed)
+            saveIndex();
+    }
+
+    std::unordered_map<uint64, Entry> index;
+    std::map<uint32, Segment> segments;
+    std::string dir;
+    std::mutex mut;
+    FILE *writer = nullptr;
+    const uint64 sizeLimit;
+    uint64 segmentLimit;
+    uint32 writerId = 0;
+    uint32 pendingWrites = 0;
+    bool loaded = false;
+    bool compacting = false;
+};
+
+} // namespace
+
+std::shared_ptr<Cache> createPackedCache(const MapCreateOptions &options)
+{
+    return std::make_shared<PackedCache>(options);
+}
+
+} // namespace vts
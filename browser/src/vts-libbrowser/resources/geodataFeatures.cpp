@@ -0,0 +1,878 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/exceptions.hpp"
+#include "../geodataFeatures.hpp"
+
+#include <dbglog/dbglog.hpp>
+
+#include <cstring>
+#include <cmath>
+#include <map>
+
+namespace vts
+{
+
+using Json::Value;
+typedef GeodataFeaturesReader::Type Type;
+
+#define THROW LOGTHROW(err3, GeodataValidationException)
+
+namespace
+{
+
+const char magic[] = "VTSGEOB1";
+const uint32 magicSize = sizeof(magic) - 1;
+
+// value tags and column kinds
+enum class Tag : uint8
+{
+    Absent,
+    Null,
+    Bool,
+    Int,
+    UInt,
+    Double,
+    String,
+    Json, // arrays and objects, serialized in the string table
+    Mixed, // column kind only, each entry is tagged
+};
+
+uint32 payloadSize(uint8 tag)
+{
+    switch ((Tag)tag)
+    {
+    case Tag::Bool:
+        return 1;
+    case Tag::String:
+    case Tag::Json:
+        return 4;
+    case Tag::Int:
+    case Tag::UInt:
+    case Tag::Double:
+        return 8;
+    case Tag::Mixed:
+        return 9;
+    default:
+        return 0;
+    }
+}
+
+Tag valueTag(const Value *v)
+{
+    if (!v)
+        return Tag::Absent;
+    switch (v->type())
+    {
+    case Json::nullValue:
+        return Tag::Null;
+    case Json::booleanValue:
+        return Tag::Bool;
+    case Json::intValue:
+        return Tag::Int;
+    case Json::uintValue:
+        return Tag::UInt;
+    case Json::realValue:
+        return Tag::Double;
+    case Json::stringValue:
+        return Tag::String;
+    default:
+        return Tag::Json;
+    }
+}
+
+////////////////////////////
+// PRIMITIVES
+////////////////////////////
+
+void writeU8(std::string &out, uint8 v)
+{
+    out.push_back((char)v);
+}
+
+void writeFixed(std::string &out, uint64 v, uint32 bytes)
+{
+    for (uint32 i = 0; i < bytes; i++)
+        out.push_back((char)(uint8)(v >> (i * 8)));
+}
+
+void writeDouble(std::string &out, double v)
+{
+    uint64 u;
+    memcpy(&u, &v, sizeof(u));
+    writeFixed(out, u, 8);
+}
+
+void writeVaruint(std::string &out, uint64 v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back((char)(uint8)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((char)(uint8)v);
+}
+
+void writeVarsint(std::string &out, sint64 v)
+{
+    writeVaruint(out, ((uint64)v << 1) ^ (uint64)(v >> 63));
+}
+
+void need(const char *p, const char *e, uint64 bytes)
+{
+    if ((uint64)(e - p) < bytes)
+    {
+        LOGTHROW(err2, std::runtime_error)
+            << "Truncated binary geodata features";
+    }
+}
+
+uint8 readU8(const char *&p, const char *e)
+{
+    need(p, e, 1);
+    return (uint8)*p++;
+}
+
+uint64 decodeFixed(const char *p, uint32 bytes)
+{
+    uint64 v = 0;
+    for (uint32 i = 0; i < bytes; i++)
+        v |= (uint64)(uint8)p[i] << (i * 8);
+    return v;
+}
+
+double decodeDouble(const char *p)
+{
+    uint64 u = decodeFixed(p, 8);
+    double v;
+    memcpy(&v, &u, sizeof(v));
+    return v;
+}
+
+double readDouble(const char *&p, const char *e)
+{
+    need(p, e, 8);
+    double v = decodeDouble(p);
+    p += 8;
+    return v;
+}
+
+uint64 readVaruint(const char *&p, const char *e)
+{
+    uint64 v = 0;
+    uint32 shift = 0;
+    while (true)
+    {
+        uint8 b = readU8(p, e);
+        v |= (uint64)(b & 0x7f) << shift;
+        if (b < 0x80)
+            return v;
+        shift += 7;
+        if (shift >= 64)
+        {
+            LOGTHROW(err2, std::runtime_error)
+                << "Invalid varint in binary geodata features";
+        }
+    }
+}
+
+sint64 readVarsint(const char *&p, const char *e)
+{
+    uint64 u = readVaruint(p, e);
+    return (sint64)(u >> 1) ^ -(sint64)(u & 1);
+}
+
+////////////////////////////
+// ENCODER
+////////////////////////////
+
+class Encoder
+{
+public:
+    explicit Encoder(bool validate) : validate(validate)
+    {}
+
+    std::string encode(const Value &features)
+    {
+        // the version is validated by the processing
+        sint32 version = features["version"].isConvertibleTo(Json::intValue)
+            ? features["version"].asInt() : 0;
+
+        std::string body;
+        const Value &groups = features["groups"];
+        uint32 groupsCount = 0;
+        for (const Value &g : groups)
+        {
+            (void)g;
+            groupsCount++;
+        }
+        writeVaruint(body, groupsCount);
+        for (const Value &g : groups)
+            block(body, group(g));
+
+        std::string out(magic, magicSize);
+        writeVarsint(out, version);
+        writeVaruint(out, strings.size());
+        for (const std::string *s : strings)
+        {
+            writeVaruint(out, s->size());
+            out += *s;
+        }
+        out += body;
+        return out;
+    }
+
+private:
+    struct Feature
+    {
+        const Value *value;
+        std::vector<std::vector<vec3>> lists;
+        std::vector<uint32> surface;
+    };
+
+    static void block(std::string &out, const std::string &b)
+    {
+        writeVaruint(out, b.size());
+        out += b;
+    }
+
+    uint32 string(const std::string &s)
+    {
+        auto it = stringIds.find(s);
+        if (it != stringIds.end())
+            return it->second;
+        uint32 id = strings.size();
+        it = stringIds.emplace(s, id).first;
+        strings.push_back(&it->first);
+        return id;
+    }
+
+    void payload(std::string &out, Tag tag, const Value *v)
+    {
+        switch (tag)
+        {
+        case Tag::Bool:
+            writeU8(out, v->asBool());
+            break;
+        case Tag::Int:
+            writeFixed(out, (uint64)v->asInt64(), 8);
+            break;
+        case Tag::UInt:
+            writeFixed(out, v->asUInt64(), 8);
+            break;
+        case Tag::Double:
+            writeDouble(out, v->asDouble());
+            break;
+        case Tag::String:
+            writeFixed(out, string(v->asString()), 4);
+            break;
+        case Tag::Json:
+            writeFixed(out, string(jsonToString(*v)), 4);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void value(std::string &out, const Value *v)
+    {
+        Tag tag = valueTag(v);
+        writeU8(out, (uint8)tag);
+        payload(out, tag, v);
+    }
+
+    void column(std::string &out, const std::vector<const Value *> &values)
+    {
+        Tag kind = valueTag(values[0]);
+        for (const Value *v : values)
+            if (valueTag(v) != kind)
+                kind = Tag::Mixed;
+        writeU8(out, (uint8)kind);
+        for (const Value *v : values)
+        {
+            if (kind == Tag::Mixed)
+            {
+                Tag tag = valueTag(v);
+                writeU8(out, (uint8)tag);
+                payload(out, tag, v);
+                writeFixed(out, 0, 8 - payloadSize((uint8)tag));
+            }
+            else
+                payload(out, kind, v);
+        }
+    }
+
+    vec3 point(const Value &v) const
+    {
+        if (validate)
+        {
+            if (!v.isArray() || v.size() != 3)
+                THROW << "Point must have 3 coordinates";
+        }
+        return vec3(v[0].asDouble(), v[1].asDouble(), v[2].asDouble());
+    }
+
+    std::vector<vec3> points(const Value &v) const
+    {
+        std::vector<vec3> a;
+        a.reserve(v.size());
+        for (const Value &p : v)
+            a.push_back(point(p));
+        return a;
+    }
+
+    Feature geometry(const Value &f, Type type) const
+    {
+        Feature r;
+        r.value = &f;
+        switch (type)
+        {
+        case Type::Point:
+            r.lists.push_back(points(f["points"]));
+            break;
+        case Type::Line:
+            for (const Value &l : f["lines"])
+                r.lists.push_back(points(l));
+            break;
+        case Type::Polygon:
+        {
+            r.lists.push_back({ point(f["middle"]) });
+            const Value &vs = f["vertices"];
+            if (validate)
+            {
+                if (!vs.isArray() || (vs.size() % 3) != 0)
+                    THROW << "Polygon vertices must be an array "
+                    "with size divisible by 3";
+            }
+            std::vector<vec3> vertices;
+            vertices.reserve(vs.size() / 3 + 1);
+            for (uint32 i = 0, e = vs.size(); i < e; i += 3)
+            {
+                vertices.push_back(vec3(vs[i + 0].asDouble(),
+                    vs[i + 1].asDouble(), vs[i + 2].asDouble()));
+            }
+            r.lists.push_back(std::move(vertices));
+            const Value &surface = f["surface"];
+            if (validate)
+            {
+                if (!surface.isArray() || (surface.size() % 3) != 0)
+                    THROW << "Polygon surface must be an array "
+                    "with size divisible by 3";
+            }
+            for (const Value &vi : surface)
+                r.surface.push_back(vi.asUInt());
+        } break;
+        }
+        return r;
+    }
+
+    static bool quantizable(double c)
+    {
+        static const double limit = (double)(1ull << 40);
+        return c == std::floor(c) && std::abs(c) <= limit
+            && !(c == 0 && std::signbit(c));
+    }
+
+    void list(std::string &out, const std::vector<vec3> &ps,
+        bool quantized) const
+    {
+        writeVaruint(out, ps.size());
+        sint64 prev[3] = { 0, 0, 0 };
+        for (const vec3 &p : ps)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                if (quantized)
+                {
+                    sint64 c = (sint64)p[i];
+                    writeVarsint(out, c - prev[i]);
+                    prev[i] = c;
+                }
+                else
+                    writeDouble(out, p[i]);
+            }
+        }
+    }
+
+    std::string features(const std::vector<Feature> &fs,
+        Type type, bool quantized)
+    {
+        std::string out;
+        writeVaruint(out, fs.size());
+        if (fs.empty())
+            return out;
+
+        // ids
+        {
+            std::vector<const Value *> ids;
+            ids.reserve(fs.size());
+            for (const Feature &f : fs)
+                ids.push_back(f.value->find("id", "id" + 2));
+            column(out, ids);
+        }
+
+        // properties
+        {
+            std::vector<std::string> names;
+            std::map<std::string, uint32> nameIds;
+            std::vector<std::vector<const Value *>> columns;
+            for (uint32 fi = 0, fe = fs.size(); fi < fe; fi++)
+            {
+                const Value &ps = (*fs[fi].value)["properties"];
+                if (!ps.isObject())
+                    continue;
+                for (auto it = ps.begin(), et = ps.end(); it != et; it++)
+                {
+                    std::string n = it.name();
+                    auto ni = nameIds.find(n);
+                    if (ni == nameIds.end())
+                    {
+                        ni = nameIds.emplace(n, names.size()).first;
+                        names.push_back(n);
+                        columns.emplace_back(fs.size(), nullptr);
+                    }
+                    columns[ni->second][fi] = &*it;
+                }
+            }
+            writeVaruint(out, names.size());
+            for (uint32 i = 0, e = names.size(); i < e; i++)
+            {
+                writeVaruint(out, string(names[i]));
+                column(out, columns[i]);
+            }
+        }
+
+        // geometry
+        for (const Feature &f : fs)
+        {
+            std::string g;
+            writeVaruint(g, f.lists.size());
+            for (const auto &l : f.lists)
+                list(g, l, quantized);
+            if (type == Type::Polygon)
+            {
+                writeVaruint(g, f.surface.size());
+                for (uint32 i : f.surface)
+                    writeVaruint(g, i);
+            }
+            block(out, g);
+        }
+
+        return out;
+    }
+
+    std::string group(const Value &g)
+    {
+        std::string out;
+        value(out, &g["id"]);
+        {
+            const Value &a = g["bbox"][0];
+            writeDouble(out, a[0].asDouble());
+            writeDouble(out, a[1].asDouble());
+            writeDouble(out, a[2].asDouble());
+            const Value &b = g["bbox"][1];
+            writeDouble(out, b[0].asDouble());
+            writeDouble(out, b[1].asDouble());
+            writeDouble(out, b[2].asDouble());
+        }
+        writeDouble(out, g["resolution"].asDouble());
+
+        static const char *typeNames[3] = { "points", "lines", "polygons" };
+        std::vector<Feature> fs[3];
+        bool quantized = true;
+        for (uint32 t = 0; t < 3; t++)
+        {
+            for (const Value &f : g[typeNames[t]])
+            {
+                fs[t].push_back(geometry(f, (Type)t));
+                for (const auto &l : fs[t].back().lists)
+                    for (const vec3 &p : l)
+                        for (int i = 0; i < 3; i++)
+                            quantized = quantized && quantizable(p[i]);
+            }
+        }
+        writeU8(out, quantized);
+        for (uint32 t = 0; t < 3; t++)
+            block(out, features(fs[t], (Type)t, quantized));
+        return out;
+    }
+
+    std::map<std::string, uint32> stringIds;
+    std::vector<const std::string *> strings;
+    const bool validate;
+};
+
+} // namespace
+
+bool isGeodataFeaturesBinary(const std::string &data)
+{
+    return data.size() >= magicSize
+        && memcmp(data.data(), magic, magicSize) == 0;
+}
+
+std::string convertGeodataFeaturesToBinary(
+    const Json::Value &features, bool validate)
+{
+    return Encoder(validate).encode(features);
+}
+
+std::string convertGeodataFeaturesToBinary(
+    const std::string &json, bool validate)
+{
+    return convertGeodataFeaturesToBinary(stringToJson(json), validate);
+}
+
+////////////////////////////
+// DECODER
+////////////////////////////
+
+GeodataFeaturesReader::GeodataFeaturesReader(const std::string &data) :
+    groupResolution_(0),
+    ptr(data.data()), end(data.data() + data.size()),
+    groupPtr(nullptr), groupEnd(nullptr),
+    featurePtr(nullptr), blockEnd(nullptr),
+    geometry(nullptr), geometryEnd(nullptr),
+    groupsLeft(0), featuresCount(0), featureIndex(0), version_(0),
+    nextBlock(0), type(Type::Point), quantized(false)
+{
+    if (!isGeodataFeaturesBinary(data))
+    {
+        LOGTHROW(err2, std::runtime_error)
+            << "Invalid binary geodata features";
+    }
+    ptr += magicSize;
+    version_ = (sint32)readVarsint(ptr, end);
+    uint64 cnt = readVaruint(ptr, end);
+    need(ptr, end, cnt);
+    strings.reserve(cnt);
+    for (uint64 i = 0; i < cnt; i++)
+    {
+        uint64 s = readVaruint(ptr, end);
+        need(ptr, end, s);
+        strings.push_back({ ptr, (uint32)s });
+        ptr += s;
+    }
+    groupsLeft = (uint32)readVaruint(ptr, end);
+}
+
+bool GeodataFeaturesReader::nextGroup()
+{
+    featuresCount = featureIndex = 0;
+    columns.clear();
+    if (groupsLeft == 0)
+        return false;
+    groupsLeft--;
+    uint64 len = readVaruint(ptr, end);
+    need(ptr, end, len);
+    groupPtr = ptr;
+    groupEnd = ptr + len;
+    ptr = groupEnd;
+    {
+        uint8 tag = readU8(groupPtr, groupEnd);
+        uint32 s = payloadSize(tag);
+        need(groupPtr, groupEnd, s);
+        groupId_ = value(tag, groupPtr);
+        groupPtr += s;
+    }
+    for (int i = 0; i < 2; i++)
+        for (int j = 0; j < 3; j++)
+            groupBbox_[i][j] = readDouble(groupPtr, groupEnd);
+    groupResolution_ = readDouble(groupPtr, groupEnd);
+    quantized = readU8(groupPtr, groupEnd);
+    nextBlock = 0;
+    return true;
+}
+
+GeodataFeaturesReader::Column GeodataFeaturesReader::column(
+    const char *&p, const char *e, bool named) const
+{
+    Column c;
+    c.name = named ? (uint32)readVaruint(p, e) : 0;
+    if (c.name >= strings.size() && named)
+    {
+        LOGTHROW(err2, std::runtime_error)
+            << "Invalid string in binary geodata features";
+    }
+    c.kind = readU8(p, e);
+    uint64 s = (uint64)payloadSize(c.kind) * featuresCount;
+    need(p, e, s);
+    c.data = p;
+    p += s;
+    return c;
+}
+
+uint32 GeodataFeaturesReader::beginFeatures(Type t)
+{
+    featuresCount = 0;
+    featureIndex = -1;
+    columns.clear();
+    if ((uint8)t < nextBlock)
+    {
+        LOGTHROW(err2, std::logic_error)
+            << "Geodata features types must be read in order";
+    }
+    while (nextBlock <= (uint8)t)
+    {
+        uint64 len = readVaruint(groupPtr, groupEnd);
+        need(groupPtr, groupEnd, len);
+        const char *p = groupPtr;
+        const char *e = p + len;
+        groupPtr = e;
+        if (nextBlock++ < (uint8)t)
+            continue;
+        type = t;
+        featuresCount = (uint32)readVaruint(p, e);
+        if (featuresCount)
+        {
+            ids = column(p, e, false);
+            uint64 cnt = readVaruint(p, e);
+            need(p, e, cnt);
+            columns.reserve(cnt);
+            for (uint64 i = 0; i < cnt; i++)
+                columns.push_back(column(p, e, true));
+        }
+        featurePtr = p;
+        blockEnd = e;
+    }
+    return featuresCount;
+}
+
+bool GeodataFeaturesReader::nextFeature()
+{
+    if (featureIndex + 1 >= featuresCount)
+    {
+        featureIndex = featuresCount;
+        return false;
+    }
+    featureIndex++;
+    uint64 len = readVaruint(featurePtr, blockEnd);
+    need(featurePtr, blockEnd, len);
+    geometry = featurePtr;
+    geometryEnd = featurePtr = featurePtr + len;
+    return true;
+}
+
+Json::Value GeodataFeaturesReader::value(
+    uint8 tag, const char *payload) const
+{
+    switch ((Tag)tag)
+    {
+    case Tag::Bool:
+        return Value(*payload != 0);
+    case Tag::Int:
+        return Value((Json::Int64)decodeFixed(payload, 8));
+    case Tag::UInt:
+        return Value((Json::UInt64)decodeFixed(payload, 8));
+    case Tag::Double:
+        return Value(decodeDouble(payload));
+    case Tag::String:
+    case Tag::Json:
+    {
+        uint64 i = decodeFixed(payload, 4);
+        if (i >= strings.size())
+        {
+            LOGTHROW(err2, std::runtime_error)
+                << "Invalid string in binary geodata features";
+        }
+        const Span &s = strings[i];
+        if ((Tag)tag == Tag::String)
+            return Value(s.data, s.data + s.size);
+        return stringToJson(std::string(s.data, s.size));
+    }
+    default:
+        return Value();
+    }
+}
+
+const char *GeodataFeaturesReader::columnEntry(
+    const Column &c, uint8 &tag) const
+{
+    assert(featureIndex < featuresCount);
+    const char *p = c.data + payloadSize(c.kind) * featureIndex;
+    if ((Tag)c.kind == Tag::Mixed)
+    {
+        tag = (uint8)*p;
+        return p + 1;
+    }
+    tag = c.kind;
+    return p;
+}
+
+Json::Value GeodataFeaturesReader::columnValue(const Column &c) const
+{
+    uint8 tag;
+    const char *p = columnEntry(c, tag);
+    return value(tag, p);
+}
+
+Json::Value GeodataFeaturesReader::id() const
+{
+    return columnValue(ids);
+}
+
+Json::Value GeodataFeaturesReader::property(const std::string &name) const
+{
+    for (const Column &c : columns)
+    {
+        const Span &s = strings[c.name];
+        if (s.size == name.size() && memcmp(s.data, name.data(), s.size) == 0)
+            return columnValue(c);
+    }
+    return Value();
+}
+
+const char *GeodataFeaturesReader::list(const char *p, const char *e,
+    std::vector<vec3> &result) const
+{
+    uint64 cnt = readVaruint(p, e);
+    need(p, e, cnt * (quantized ? 3 : 24));
+    result.clear();
+    result.reserve(cnt);
+    if (quantized)
+    {
+        sint64 c[3] = { 0, 0, 0 };
+        for (uint64 i = 0; i < cnt; i++)
+        {
+            for (int j = 0; j < 3; j++)
+                c[j] += readVarsint(p, e);
+            result.push_back(vec3(c[0], c[1], c[2]));
+        }
+    }
+    else
+    {
+        for (uint64 i = 0; i < cnt; i++)
+        {
+            double x = readDouble(p, e);
+            double y = readDouble(p, e);
+            double z = readDouble(p, e);
+            result.push_back(vec3(x, y, z));
+        }
+    }
+    return p;
+}
+
+void GeodataFeaturesReader::positions(
+    std::vector<std::vector<vec3>> &result) const
+{
+    const char *p = geometry;
+    uint64 cnt = readVaruint(p, geometryEnd);
+    if (type == Type::Polygon)
+        cnt = std::min<uint64>(cnt, 1);
+    need(p, geometryEnd, cnt);
+    result.resize(cnt);
+    for (auto &r : result)
+        p = list(p, geometryEnd, r);
+}
+
+void GeodataFeaturesReader::polygon(std::vector<vec3> &vertices,
+    std::vector<uint32> &surface) const
+{
+    assert(type == Type::Polygon);
+    const char *p = geometry;
+    if (readVaruint(p, geometryEnd) != 2)
+    {
+        LOGTHROW(err2, std::runtime_error)
+            << "Invalid polygon in binary geodata features";
+    }
+    p = list(p, geometryEnd, vertices); // middle
+    p = list(p, geometryEnd, vertices);
+    surface.clear();
+    if (p == geometryEnd)
+        return;
+    uint64 cnt = readVaruint(p, geometryEnd);
+    need(p, geometryEnd, cnt);
+    surface.reserve(cnt);
+    for (uint64 i = 0; i < cnt; i++)
+        surface.push_back((uint32)readVaruint(p, geometryEnd));
+}
+
+Json::Value GeodataFeaturesReader::featureJson() const
+{
+    auto point = [](const vec3 &p) {
+        Value r;
+        for (int i = 0; i < 3; i++)
+            r.append(p[i]);
+        return r;
+    };
+    auto points = [&](const std::vector<vec3> &ps) {
+        Value r(Json::arrayValue);
+        for (const vec3 &p : ps)
+            r.append(point(p));
+        return r;
+    };
+
+    Value f(Json::objectValue);
+    uint8 tag;
+    columnEntry(ids, tag);
+    if ((Tag)tag != Tag::Absent)
+        f["id"] = id();
+    for (const Column &c : columns)
+    {
+        columnEntry(c, tag);
+        if ((Tag)tag != Tag::Absent)
+        {
+            const Span &s = strings[c.name];
+            f["properties"][std::string(s.data, s.size)] = columnValue(c);
+        }
+    }
+    switch (type)
+    {
+    case Type::Point:
+    case Type::Line:
+    {
+        std::vector<std::vector<vec3>> ps;
+        positions(ps);
+        if (type == Type::Point)
+            f["points"] = points(ps.empty() ? std::vector<vec3>() : ps[0]);
+        else
+        {
+            Value &ls = f["lines"] = Value(Json::arrayValue);
+            for (const auto &l : ps)
+                ls.append(points(l));
+        }
+    } break;
+    case Type::Polygon:
+    {
+        std::vector<std::vector<vec3>> ps;
+        positions(ps);
+        if (!ps.empty() && !ps[0].empty())
+            f["middle"] = point(ps[0][0]);
+        std::vector<vec3> vs;
+        std::vector<uint32> ss;
+        polygon(vs, ss);
+        Value &v = f["vertices"] = Value(Json::arrayValue);
+        for (const vec3 &p : vs)
+            for (int i = 0; i < 3; i++)
+                v.append(p[i]);
+        Value &s = f["surface"] = Value(Json::arrayValue);
+        for (uint32 i : ss)
+            s.append(i);
+    } break;
+    }
+    return f;
+}
+
+} // namespace vts
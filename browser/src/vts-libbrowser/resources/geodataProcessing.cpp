@@ -31,6 +31,8 @@
 #include "../utilities/case.hpp"
 #include "../gpuResource.hpp"
 #include "../geodata.hpp"
+#include "../geodataStyle.hpp"
+#include "../geodataFeatures.hpp"
 #include "../renderTasks.hpp"
 #include "../mapConfig.hpp"
 #include "../map.hpp"
@@ -38,6 +40,7 @@
 #include <optick.h>
 #include <utf8.h>
 #include <cstdlib>
+#include <exception>
 
 namespace vts
 {
@@ -47,7 +50,6 @@ using Json::Value;
 namespace
 {
 
-typedef std::map<std::string, const Value> AmpVariables;
 typedef std::basic_string<uint32> S32;
 
 S32 s8to32(const std::string &s8)
@@ -66,19 +68,22 @@ std::string s32to8(const S32 &s32)
     return s8;
 }
 
+// each scope invalidates all cached &variables
+//   the previous scope is restored afterwards
 struct AmpVarsScope
 {
-    AmpVariables &vars;
-    AmpVariables cache;
+    uint32 &current;
+    const uint32 previous;
 
-    AmpVarsScope(AmpVariables &vars) : vars(vars)
+    AmpVarsScope(uint32 &current, uint32 &counter)
+        : current(current), previous(current)
     {
-        std::swap(vars, cache);
+        current = ++counter;
     }
 
     ~AmpVarsScope()
     {
-        std::swap(vars, cache);
+        current = previous;
     }
 };
 
@@ -221,20 +226,15 @@ double str2num(const std::string &s)
     return f;
 }
 
-bool isLayerStyleRequested(const Value &v)
-{
-    if (v.isNull())
-        return false;
-    if (v.isConvertibleTo(Json::ValueType::booleanValue))
-        return v.asBool();
-    return true;
-}
-
+// pred applies to items starting at first
 template<class V>
-static void erase_if(V &v, const std::vector<bool> &pred)
+static void erase_if(V &v, const std::vector<bool> &pred,
+    std::size_t first = 0)
 {
+    if (v.size() <= first)
+        return;
     auto p = pred.begin();
-    v.erase(std::remove_if(v.begin(), v.end(), [p](auto&) mutable {
+    v.erase(std::remove_if(v.begin() + first, v.end(), [p](auto&) mutable {
         return *p++;
         }), v.end());
 }
@@ -251,20 +251,30 @@ struct geoContext
 
     typedef std::array<float, 3> Point;
 
-    double convertToDouble(const Value &p) const
+    typedef GeodataStyleCompiled::Expr Expr;
+    typedef GeodataStyleCompiled::Op Op;
+    typedef GeodataStyleCompiled::Layer Layer;
+    typedef GeodataStyleCompiled::Property Prop;
+    typedef GeodataStyleCompiled::Identifier Identifier;
+
+    static double toDouble(const Value &v)
     {
-        Value v = evaluate(p);
         if (v.isString())
             return str2num(v.asString());
         return v.asDouble();
     }
 
-    Point convertPoint(const Value &p) const
+    double convertToDouble(const Value &p) const
     {
-        return group->convertPoint(evaluate(p));
+        return toDouble(evaluate(p));
     }
 
-    vec4f convertColor(const Value &p) const
+    double convertToDouble(const Expr *p) const
+    {
+        return toDouble(evaluate(p));
+    }
+
+    vec4f convertColor(const Expr *p) const
     {
         Value v = evaluate(p);
         validateArrayLength(v, 4, 4, "Color must have 4 components");
@@ -272,7 +282,7 @@ struct geoContext
             v[2].asInt(), v[3].asInt()) / 255.f;
     }
 
-    vec4f convertVector4(const Value &p) const
+    vec4f convertVector4(const Expr *p) const
     {
         Value v = evaluate(p);
         validateArrayLength(v, 4, 4, "Expected 4 components");
@@ -280,14 +290,14 @@ struct geoContext
             convertToDouble(v[2]), convertToDouble(v[3]));
     }
 
-    vec2f convertVector2(const Value &p) const
+    vec2f convertVector2(const Expr *p) const
     {
         Value v = evaluate(p);
         validateArrayLength(v, 2, 2, "Expected 2 components");
         return vec2f(convertToDouble(v[0]), convertToDouble(v[1]));
     }
 
-    vec2f convertNoOverlapMargin(const Value &p) const
+    vec2f convertNoOverlapMargin(const Expr *p) const
     {
         Json::Value lnom = evaluate(p);
         switch (lnom.size())
@@ -306,7 +316,7 @@ struct geoContext
         }
     }
 
-    GpuGeodataSpec::Stick convertStick(const Value &p) const
+    GpuGeodataSpec::Stick convertStick(const Expr *p) const
     {
         Value v = evaluate(p);
         validateArrayLength(v, 7, 8, "Stick must have 7 or 8 components");
@@ -320,7 +330,7 @@ struct geoContext
         return s;
     }
 
-    GpuGeodataSpec::Origin convertOrigin(const Value &p) const
+    GpuGeodataSpec::Origin convertOrigin(const Expr *p) const
     {
         Value v = evaluate(p);
         std::string s = v.asString();
@@ -347,7 +357,7 @@ struct geoContext
         return GpuGeodataSpec::Origin::Invalid;
     }
 
-    GpuGeodataSpec::TextAlign convertTextAlign(const Value &p) const
+    GpuGeodataSpec::TextAlign convertTextAlign(const Expr *p) const
     {
         Value v = evaluate(p);
         std::string s = v.asString();
@@ -395,57 +405,57 @@ struct geoContext
         return true;
     }
 
-    geoContext(GeodataTile *data)
+    // features are converted to the binary encoding
+    //   unless it was done already when the features were decoded
+    static std::shared_ptr<const std::string> binaryFeatures(
+        const GeodataTile *data)
+    {
+        if (isGeodataFeaturesBinary(*data->features))
+            return data->features;
+        return std::make_shared<const std::string>(
+            convertGeodataFeaturesToBinary(*data->features, Validating));
+    }
+
+    // only features in range [featuresBegin, featuresEnd) are processed
+    //   features are numbered as they are visited (types without layers
+    //   are skipped), see countFeatures
+    geoContext(GeodataTile *data, uint32 featuresBegin = 0,
+        uint32 featuresEnd = -1)
         : data(data),
         stylesheet(data->style.get()),
-        style(*data->style->json),
-        features(stringToJson(*data->features)),
+        compiledHolder(data->style->compiled),
+        compiled(*compiledHolder),
+        featuresHolder(binaryFeatures(data)),
+        features(*featuresHolder),
         browserOptions(*data->browserOptions),
         aabbPhys{ data->aabbPhys[0], data->aabbPhys[1] },
         tileId(data->tileId),
         compatibility(getCompatibilityMode(data)),
+        featuresBegin(featuresBegin),
+        featuresEnd(featuresEnd),
         currentLayer(nullptr)
     {}
 
-    // defines which style layers are candidates for a specific feature type
-    std::vector<std::string> filterLayersByType(Type t) const
+    static uint32 countFeatures(const GeodataTile *data, uint32 &work)
     {
-        std::vector<std::string> result;
-        const auto allLayerNames = style["layers"].getMemberNames();
-        for (const std::string &layerName : allLayerNames)
+        uint32 count = 0;
+        work = 0;
+        const GeodataStyleCompiled &compiled = *data->style->compiled;
+        GeodataFeaturesReader features(*data->features);
+        while (features.nextGroup())
         {
-            Value layer = style["layers"][layerName];
-            if (layer.isMember("filter") && layer["filter"].isArray()
-                && layer["filter"][0] == "skip")
-                continue;
-            if (layer.isMember("visibility-switch"))
+            for (Type type : { Type::Point, Type::Line, Type::Polygon })
             {
-                result.push_back(layerName);
-                continue;
-            }
-            bool point = isLayerStyleRequested(layer["point"]);
-            bool line = isLayerStyleRequested(layer["line"]);
-            bool icon = isLayerStyleRequested(layer["icon"]);
-            bool labelScreen = isLayerStyleRequested(layer["label"]);
-            bool labelFlat = isLayerStyleRequested(layer["line-label"]);
-            bool polygon = isLayerStyleRequested(layer["polygon"]);
-            bool ok = false;
-            switch (t)
-            {
-            case Type::Point:
-                ok = point || icon || labelScreen;
-                break;
-            case Type::Line:
-                ok = line || labelFlat; // todo enable degrading line features to point layers
-                break;
-            case Type::Polygon:
-                ok = polygon; // todo enable degrading polygon features to all layer types
-                break;
+                const auto &layers = compiled.typedLayers[(int)type];
+                if (layers.empty())
+                    continue;
+                uint32 c = features.beginFeatures(
+                    (GeodataFeaturesReader::Type)type);
+                count += c;
+                work += c * layers.size();
             }
-            if (ok)
-                result.push_back(layerName);
         }
-        return result;
+        return count;
     }
 
     // entry point
@@ -483,47 +493,42 @@ struct geoContext
         if (Validating)
         {
             // check version
-            if (features["version"].asInt() != 1)
+            if (features.version() != 1)
             {
                 THROW << "Invalid geodata features <"
                     << data->name << "> version <"
-                    << features["version"].asInt() << ">";
+                    << features.version() << ">";
             }
         }
 
-        solveInheritance();
-
-        static const std::vector<std::pair<Type, std::string>> allTypes
-            = { { Type::Point, "points" },
-                { Type::Line, "lines" },
-                { Type::Polygon, "polygons"}
-        };
-
-        // style layers filtered by valid feature types
-        std::map<Type, std::vector<std::string>> typedLayerNames;
-        for (Type t : { Type::Point, Type::Line, Type::Polygon })
-            typedLayerNames[t] = filterLayersByType(t);
-
         // groups
-        for (const Value &group : features["groups"])
+        uint32 index = 0;
+        while (features.nextGroup() && index < featuresEnd)
         {
-            this->group.emplace(group);
+            this->group.emplace(features);
             // types
-            for (const auto &type : allTypes)
+            for (Type type : { Type::Point, Type::Line, Type::Polygon })
             {
-                this->type.emplace(type.first);
-                const auto &layers = typedLayerNames[type.first];
+                this->type.emplace(type);
+                const auto &layers = compiled.typedLayers[(int)type];
                 if (layers.empty())
                     continue;
                 // features
-                for (const Value &feature : group[type.second])
+                uint32 cnt = features.beginFeatures(
+                    (GeodataFeaturesReader::Type)type);
+                if (index + cnt <= featuresBegin)
+                {
+                    index += cnt;
+                    continue;
+                }
+                while (index < featuresEnd && features.nextFeature())
                 {
-                    this->feature.emplace(feature);
+                    if (index++ < featuresBegin)
+                        continue;
                     // layers
-                    for (const std::string &layerName : layers)
-                        processFeatureName(layerName);
+                    for (const Layer *layer : layers)
+                        processFeatureLayer(*layer);
                 }
-                this->feature.reset();
             }
             this->type.reset();
         }
@@ -532,12 +537,16 @@ struct geoContext
 #ifndef NDEBUG
         finalAsserts();
 #endif // !NDEBUG
+    }
 
-        // put cache into queue for upload
-        data->specsToUpload.clear();
+    // moves the generated specs out, ordered
+    void result(std::vector<GpuGeodataSpec> &specs)
+    {
+        specs.clear();
+        specs.reserve(cacheData.size());
         for (const GpuGeodataSpec &spec : cacheData)
-            data->specsToUpload.push_back(
-                std::move(const_cast<GpuGeodataSpec&>(spec)));
+            specs.push_back(std::move(const_cast<GpuGeodataSpec&>(spec)));
+        cacheData.clear();
     }
 
     void finalAsserts()
@@ -588,398 +597,293 @@ struct geoContext
         }
     }
 
-    Value resolveInheritance(const Value &orig) const
-    {
-        if (!orig["inherit"])
-            return orig;
-
-        Value base = resolveInheritance(
-            style["layers"][orig["inherit"].asString()]);
-
-        for (auto n : orig.getMemberNames())
-            base[n] = orig[n];
-
-        base.removeMember("inherit");
-
-        return base;
-    }
-
-    // update style layers with inherit property
-    void solveInheritance()
-    {
-        Value ls;
-        for (const std::string &n : style["layers"].getMemberNames())
-            ls[n] = resolveInheritance(style["layers"][n]);
-        style["layers"].swap(ls);
-    }
-
     // solves @constants, $properties, &variables and #identifiers
+    //   in strings computed at runtime
     Value replacement(const std::string &name) const
     {
-        if (Validating)
-        {
-            try
-            {
-                return replacementInternal(name);
-            }
-            catch (...)
-            {
-                LOG(info3) << "In replacements of <" << name << ">";
-                throw;
-            }
-        }
-        return replacementInternal(name);
-    }
-
-    Value replacementInternal(const std::string &name) const
-    {
-        assert(group);
-        assert(type);
-        assert(feature);
         if (name.empty())
             return Value();
         switch (name[0])
         {
         case '@': // constant
-            return evaluate(style["constants"][name]);
+        {
+            auto it = compiled.constantIds.find(name);
+            if (it == compiled.constantIds.end())
+                return Value();
+            return evaluate(compiled.constants[it->second]);
+        }
         case '$': // property
-            return (*feature)["properties"][name.substr(1)];
+            return features.property(name.substr(1));
         case '&': // ampersand variable
         {
-            auto it = ampVariables.find(name);
-            if (it != ampVariables.end())
-                return it->second;
-            if (Validating)
-            {
-                if (!currentLayer->isMember(name))
-                    THROW << "Undefined variable <" << name << ">";
-            }
-            return const_cast<AmpVariables&>(ampVariables).emplace(
-                    name, evaluate((*currentLayer)[name])).first->second;
+            auto it = compiled.variableIds.find(name);
+            if (it != compiled.variableIds.end())
+                return variable(it->second, name);
+            return variableDynamic(name);
         }
         case '#': // identifier
-            if (name == "#id")
-                return (*feature)["id"];
-            if (name == "#group")
-                return group->group["id"];
-            if (name == "#type")
-            {
-                switch (*type)
-                {
-                case Type::Point:
-                    return "point";
-                case Type::Line:
-                    return "line";
-                case Type::Polygon:
-                    return "polygon";
-                }
-            }
-            if (name == "#metric")
-                return !!data->map->options.measurementUnitsSystem;
-            if (name == "#language")
-                return data->map->options.language;
-            if (name == "#lod")
-                return tileId.lod;
-            if (name == "#ix")
-                return tileId.x;
-            if (name == "#iy")
-                return tileId.y;
-            if (name == "#tileSize")
-            {
-                // todo
-                return Value();
-            }
-            if (Validating)
-            {
-                THROW << "Undefined identifier <" << name << ">";
-            }
-            return Value();
+            return identifier(GeodataStyleCompiled::findIdentifier(name),
+                name);
         default:
             return name;
         }
     }
 
-    // solves functions and string expansion
-    Value evaluate(const Value &expression) const
+    Value variable(uint32 id, const std::string &name) const
     {
+        assert(currentLayer);
+        if (ampScopes.size() <= id)
+        {
+            ampScopes.resize(id + 1, 0);
+            ampValues.resize(id + 1);
+        }
+        if (ampScopes[id] == ampScope)
+            return ampValues[id];
+        const Expr *e = id < currentLayer->variables.size()
+            ? currentLayer->variables[id] : nullptr;
         if (Validating)
         {
-            try
-            {
-                return evaluateInternal(expression);
-            }
-            catch (...)
-            {
-                LOG(info3) << "In evaluation of <"
-                    << expression.toStyledString() << ">";
-                throw;
-            }
+            if (!e)
+                THROW << "Undefined variable <" << name << ">";
         }
-        return evaluateInternal(expression);
+        Value v = evaluate(e);
+        ampScopes[id] = ampScope;
+        ampValues[id] = v;
+        return v;
     }
 
-    Value evaluateInternal(const Value &expression) const
+    // variable not known to the compiled stylesheet (not cached)
+    Value variableDynamic(const std::string &name) const
     {
-        if (expression.isArray())
-            return evaluateArray(expression);
-        if (expression.isObject())
-            return evaluateObject(expression);
-        if (expression.isString())
-            return evaluateString(expression.asString());
-        return expression;
+        assert(currentLayer);
+        if (Validating)
+        {
+            if (!currentLayer->source.isMember(name))
+                THROW << "Undefined variable <" << name << ">";
+        }
+        return evaluate(currentLayer->source[name]);
     }
 
-    Value interpolate(const Value &a, const Value &b, double f) const
+    Value identifier(Identifier id, const std::string &name) const
     {
-        if (Validating)
-        {
-            if (a.isArray() != b.isArray())
-                THROW << "Cannot interpolate <" << a.toStyledString()
-                << "> and <" << b.toStyledString()
-                << "> because one is array and the other is not";
-            if (a.isArray() && a.size() != b.size())
+        assert(group);
+        assert(type);
+        switch (id)
+        {
+        case Identifier::Id:
+            return features.id();
+        case Identifier::Group:
+            return features.groupId();
+        case Identifier::Type:
+            switch (*type)
             {
-                THROW << "Cannot interpolate <" << a.toStyledString()
-                    << "> and <" << b.toStyledString()
-                    << "> because they have different number of elements";
+            case Type::Point:
+                return "point";
+            case Type::Line:
+                return "line";
+            case Type::Polygon:
+                return "polygon";
             }
+            break;
+        case Identifier::Metric:
+            return !!data->map->options.measurementUnitsSystem;
+        case Identifier::Language:
+            return data->map->options.language;
+        case Identifier::Lod:
+            return tileId.lod;
+        case Identifier::Ix:
+            return tileId.x;
+        case Identifier::Iy:
+            return tileId.y;
+        case Identifier::TileSize:
+            // todo
+            return Value();
+        case Identifier::Invalid:
+            break;
         }
-        if (a.isArray())
+        if (Validating)
         {
-            Value r;
-            Json::ArrayIndex cnt = a.size();
-            for (Json::ArrayIndex i = 0; i < cnt; i++)
-                r[i] = interpolate(a[i], b[i], f);
-            return r;
+            THROW << "Undefined identifier <" << name << ">";
         }
-        double aa = convertToDouble(a);
-        double bb = convertToDouble(b);
-        return aa + (bb - aa) * f;
+        return Value();
     }
 
-    template<bool Linear>
-    Value evaluatePairsArray(const Value &what,
-        const Value &searchArray) const
+    // evaluates compiled expression
+    Value evaluate(const Expr *expression) const
     {
+        if (!expression)
+            return Value();
         if (Validating)
         {
             try
             {
-                return evaluatePairsArrayInternal<Linear>(what, searchArray);
+                return evaluateInternal(*expression);
             }
             catch (...)
             {
-                LOG(info3) << "In search of <"
-                    << what.toStyledString()
-                    << "> in pairs array <"
-                    << searchArray.toStyledString() << ">";
+                if (expression->source)
+                    LOG(info3) << "In evaluation of <"
+                        << expression->source->toStyledString() << ">";
                 throw;
             }
         }
-        return evaluatePairsArrayInternal<Linear>(what, searchArray);
+        return evaluateInternal(*expression);
     }
 
-    template<bool Linear>
-    Value evaluatePairsArrayInternal(const Value &what,
-        const Value &searchArrayParam) const
+    // evaluates value computed at runtime
+    Value evaluate(const Value &value) const
     {
-        const Value searchArray = evaluate(searchArrayParam);
-        if (Validating)
+        switch (value.type())
         {
-            if (!searchArray.isArray())
-                THROW << "Expected an array";
-            for (const auto &p : searchArray)
-            {
-                if (!p.isArray() || p.size() != 2)
-                    THROW << "Expected an array with two elements";
-            }
-        }
-        double v = convertToDouble(evaluate(what));
-        for (sint32 index = searchArray.size() - 1; index >= 0; index--)
+        case Json::ValueType::arrayValue:
         {
-            double v1 = convertToDouble(searchArray[index][0]);
-            if (v < v1)
-                continue;
-            if (Linear)
-            {
-                if (index + 1u < searchArray.size())
-                {
-                    double v2 = convertToDouble(searchArray[index + 1][0]);
-                    return interpolate(
-                        evaluate(searchArray[index + 0][1]),
-                        evaluate(searchArray[index + 1][1]),
-                        (v - v1) / (v2 - v1));
-                }
-            }
-            return evaluate(searchArray[index][1]);
+            Value r(value);
+            for (Value &it : r)
+                it = evaluate(it);
+            return r;
         }
-        return evaluate(searchArray[0][1]);
-    }
-
-    Value evaluateMap(const Value &key,
-        const Value &pairsp, const Value &default_) const
-    {
-        if (Validating)
+        case Json::ValueType::objectValue:
         {
-            try
-            {
-                return evaluateMapInternal(key, pairsp, default_);
-            }
-            catch (...)
-            {
-                LOG(info3) << "In search of <"
-                    << key.toStyledString()
-                    << "> in pairs array <"
-                    << pairsp.toStyledString()
-                    << "> with default value <"
-                    << default_.toStyledString()
-                    << ">";
-                throw;
-            }
+            std::deque<Expr> nodes;
+            return evaluate(compiled.compileExpression(nodes, value));
+        }
+        case Json::ValueType::stringValue:
+            return evaluateString(value.asString());
+        default:
+            return value;
         }
-        return evaluateMapInternal(key, pairsp, default_);
     }
 
-    Value evaluateMapInternal(const Value &key,
-        const Value &pairsp, const Value &default_) const
+    Value evaluateString(const std::string &s) const
     {
-        const std::string k = evaluate(key).asString();
-        const Value pairs = evaluate(pairsp);
-        if (Validating)
+        if (s.find_first_of("{}") != s.npos)
         {
-            if (!pairs.isArray())
-                THROW << "Expected an array";
-            std::set<std::string> keys;
-            for (const auto &p : pairs)
-            {
-                if (!p.isArray() || p.size() != 2)
-                    THROW << "Expected an array with two elements";
-                std::string a = evaluate(p[0]).asString();
-                if (!keys.insert(a).second)
-                    THROW << "Duplicate keys <" << a << ">";
-            }
+            std::deque<Expr> nodes;
+            return evaluate(compiled.compileString(nodes, s));
         }
-        for (const Value &p : pairs)
-        {
-            if (k == evaluate(p[0]).asString())
-                return evaluate(p[1]);
-        }
-        return evaluate(default_);
+        return replacement(s);
     }
 
-    Value evaluateArray(const Value &expression) const
+    static const Expr *arg(const Expr &e, uint32 index)
     {
-        Value r(expression);
-        for (Value &it : r)
-            it = evaluate(it);
-        return r;
+        return index < e.args.size() ? e.args[index] : nullptr;
     }
 
-    // evaluate function
-    Value evaluateObject(const Value &expression) const
+    Value evaluateInternal(const Expr &e) const
     {
-        if (Validating)
+        if (Validating && !e.error.empty())
+            THROW << e.error;
+
+        switch (e.op)
         {
-            if (expression.size() != 1)
-                THROW << "Function must have exactly one member";
+        // values
+        case Op::Literal:
+        case Op::UnknownFunction:
+            return e.value;
+        case Op::Array:
+        {
+            Value r(Json::arrayValue);
+            for (const Expr *a : e.args)
+                r.append(evaluate(a));
+            return r;
         }
-        const std::string fnc = expression.getMemberNames()[0];
+        case Op::Template:
+        {
+            // string expansion, the result is evaluated again
+            std::string r = e.value[0].asString();
+            for (uint32 i = 0, cnt = e.args.size(); i < cnt; i++)
+            {
+                r += evaluate(e.args[i]).asString();
+                r += e.value[i + 1].asString();
+            }
+            return evaluateString(r);
+        }
+        case Op::Constant:
+            return evaluate(compiled.constants[e.index]);
+        case Op::Property:
+            return features.property(e.name);
+        case Op::Variable:
+            return variable(e.index, e.name);
+        case Op::VariableDynamic:
+            return variableDynamic(e.name);
+        case Op::Identifier:
+            return identifier((Identifier)e.index, e.name);
+        case Op::Invalid:
+            THROW << e.error;
+            break;
 
         // 'sgn', 'sin', 'cos', 'tan', 'asin', 'acos', 'atan',
         // 'sqrt', 'abs', 'deg2rad', 'rad2deg', 'log'
-        if (fnc == "sgn")
+        case Op::Sgn:
         {
-            double v = convertToDouble(expression[fnc]);
+            double v = convertToDouble(arg(e, 0));
             if (v < 0) return -1;
             if (v > 0) return 1;
             return 0;
         }
-        if (fnc == "sin")
-            return std::sin(convertToDouble(expression[fnc]));
-        if (fnc == "cos")
-            return std::cos(convertToDouble(expression[fnc]));
-        if (fnc == "tan")
-            return std::tan(convertToDouble(expression[fnc]));
-        if (fnc == "asin")
-            return std::asin(convertToDouble(expression[fnc]));
-        if (fnc == "acos")
-            return std::acos(convertToDouble(expression[fnc]));
-        if (fnc == "atan")
-            return std::atan(convertToDouble(expression[fnc]));
-        if (fnc == "sqrt")
-            return std::sqrt(convertToDouble(expression[fnc]));
-        if (fnc == "abs")
-            return std::abs(convertToDouble(expression[fnc]));
-        if (fnc == "deg2rad")
-            return convertToDouble(expression[fnc]) * M_PI / 180;
-        if (fnc == "rad2deg")
-            return convertToDouble(expression[fnc]) * 180 / M_PI;
-        if (fnc == "log")
-            return std::log(convertToDouble(expression[fnc]));
+        case Op::Sin:
+            return std::sin(convertToDouble(arg(e, 0)));
+        case Op::Cos:
+            return std::cos(convertToDouble(arg(e, 0)));
+        case Op::Tan:
+            return std::tan(convertToDouble(arg(e, 0)));
+        case Op::Asin:
+            return std::asin(convertToDouble(arg(e, 0)));
+        case Op::Acos:
+            return std::acos(convertToDouble(arg(e, 0)));
+        case Op::Atan:
+            return std::atan(convertToDouble(arg(e, 0)));
+        case Op::Sqrt:
+            return std::sqrt(convertToDouble(arg(e, 0)));
+        case Op::Abs:
+            return std::abs(convertToDouble(arg(e, 0)));
+        case Op::Deg2rad:
+            return convertToDouble(arg(e, 0)) * M_PI / 180;
+        case Op::Rad2deg:
+            return convertToDouble(arg(e, 0)) * 180 / M_PI;
+        case Op::Log:
+            return std::log(convertToDouble(arg(e, 0)));
 
         // 'round'
-        if (fnc == "round")
-            return (sint32)std::round(convertToDouble(expression[fnc]));
+        case Op::Round:
+            return (sint32)std::round(convertToDouble(arg(e, 0)));
 
         // 'add', 'sub', 'mul', 'div'
-#define COMP(NAME, OP) \
-if (fnc == #NAME) \
-{ \
-    validateArrayLength(expression[#NAME], 2, 2, \
-        "Function '" #NAME "' is expecting an array with 2 elements."); \
-    double a = convertToDouble(expression[#NAME][0]); \
-    double b = convertToDouble(expression[#NAME][1]); \
-    return a OP b; \
-}
-        COMP(add, +);
-        COMP(sub, -);
-        COMP(mul, *);
-        COMP(div, /);
-#undef COMP
+        case Op::Add:
+            return convertToDouble(arg(e, 0)) + convertToDouble(arg(e, 1));
+        case Op::Sub:
+            return convertToDouble(arg(e, 0)) - convertToDouble(arg(e, 1));
+        case Op::Mul:
+            return convertToDouble(arg(e, 0)) * convertToDouble(arg(e, 1));
+        case Op::Div:
+            return convertToDouble(arg(e, 0)) / convertToDouble(arg(e, 1));
 
         // 'pow', 'atan2', 'mod', 'random'
-        if (fnc == "pow")
-        {
-            validateArrayLength(expression[fnc], 2, 2,
-                "Function 'pow' is expecting an array with 2 elements.");
-            double a = convertToDouble(expression[fnc][0]);
-            double b = convertToDouble(expression[fnc][1]);
-            return std::pow(a, b);
-        }
-        if (fnc == "atan2")
-        {
-            validateArrayLength(expression[fnc], 2, 2,
-                "Function 'atan2' is expecting an array with 2 elements.");
-            double a = convertToDouble(expression[fnc][0]);
-            double b = convertToDouble(expression[fnc][1]);
-            return std::atan2(a, b);
-        }
-        if (fnc == "mod")
-        {
-            validateArrayLength(expression[fnc], 2, 2,
-                "Function 'mod' is expecting an array with 2 elements.");
-            sint32 a = (sint32)convertToDouble(expression[fnc][0]);
-            sint32 b = (sint32)convertToDouble(expression[fnc][1]);
+        case Op::Pow:
+            return std::pow(convertToDouble(arg(e, 0)),
+                convertToDouble(arg(e, 1)));
+        case Op::Atan2:
+            return std::atan2(convertToDouble(arg(e, 0)),
+                convertToDouble(arg(e, 1)));
+        case Op::Mod:
+        {
+            sint32 a = (sint32)convertToDouble(arg(e, 0));
+            sint32 b = (sint32)convertToDouble(arg(e, 1));
             return a % b;
         }
-        if (fnc == "random")
+        case Op::Random:
         {
-            validateArrayLength(expression[fnc], 2, 2,
-                "Function 'random' is expecting an array with 2 elements.");
-            double a = convertToDouble(expression[fnc][0]);
-            double b = convertToDouble(expression[fnc][1]);
+            double a = convertToDouble(arg(e, 0));
+            double b = convertToDouble(arg(e, 1));
             return std::rand() * (b - a) / RAND_MAX;
         }
 
         // 'clamp'
-        if (fnc == "clamp")
+        case Op::Clamp:
         {
-            const Value &arr = expression[fnc];
-            validateArrayLength(arr, 3, 3,
-                "Function 'clamp' must have 3 values");
-            double f = convertToDouble(arr[0]);
-            double a = convertToDouble(arr[1]);
-            double b = convertToDouble(arr[2]);
+            double f = convertToDouble(arg(e, 0));
+            double a = convertToDouble(arg(e, 1));
+            double b = convertToDouble(arg(e, 2));
             if (Validating)
             {
                 if (a >= b)
@@ -990,114 +894,83 @@ if (fnc == #NAME) \
         }
 
         // 'min', 'max'
-        if (fnc == "min")
-        {
-            const Value &arr = expression[fnc];
-            validateArrayLength(arr, 1, (uint32)-1,
-                "Function 'min' expects an array");
-            double t = convertToDouble(arr[0]);
-            for (uint32 i = 1; i < arr.size(); i++)
-                t = std::min(t, convertToDouble(arr[i]));
+        case Op::Min:
+        {
+            double t = convertToDouble(arg(e, 0));
+            for (uint32 i = 1; i < e.args.size(); i++)
+                t = std::min(t, convertToDouble(e.args[i]));
             return t;
         }
-        if (fnc == "max")
+        case Op::Max:
         {
-            const Value &arr = expression[fnc];
-            validateArrayLength(arr, 1, (uint32)-1,
-                "Function 'max' expects an array");
-            double t = convertToDouble(arr[0]);
-            for (uint32 i = 1; i < arr.size(); i++)
-                t = std::max(t, convertToDouble(arr[i]));
+            double t = convertToDouble(arg(e, 0));
+            for (uint32 i = 1; i < e.args.size(); i++)
+                t = std::max(t, convertToDouble(e.args[i]));
             return t;
         }
 
         // 'if'
-        if (fnc == "if")
-        {
-            const Value &arr = expression[fnc];
-            validateArrayLength(arr, 3, 3,
-                "Function 'if' must have 3 values");
-            if (filter(arr[0]))
-                return evaluate(arr[1]);
+        case Op::If:
+            if (filter(arg(e, 0)))
+                return evaluate(arg(e, 1));
             else
-                return evaluate(arr[2]);
-        }
+                return evaluate(arg(e, 2));
 
         // 'strlen', 'str2num', 'lowercase', 'uppercase', 'capitalize', 'trim'
-        if (fnc == "strlen")
-            return utf8len(evaluate(expression[fnc]).asString());
-        if (fnc == "str2num")
-            return str2num(evaluate(expression[fnc]).asString());
-        if (fnc == "lowercase")
-            return lowercase(evaluate(expression[fnc]).asString());
-        if (fnc == "uppercase")
-            return uppercase(evaluate(expression[fnc]).asString());
-        if (fnc == "capitalize")
-            return titlecase(evaluate(expression[fnc]).asString());
-        if (fnc == "trim")
-            return utf8trim(evaluate(expression[fnc]).asString());
+        case Op::Strlen:
+            return utf8len(evaluate(arg(e, 0)).asString());
+        case Op::Str2num:
+            return str2num(evaluate(arg(e, 0)).asString());
+        case Op::Lowercase:
+            return lowercase(evaluate(arg(e, 0)).asString());
+        case Op::Uppercase:
+            return uppercase(evaluate(arg(e, 0)).asString());
+        case Op::Capitalize:
+            return titlecase(evaluate(arg(e, 0)).asString());
+        case Op::Trim:
+            return utf8trim(evaluate(arg(e, 0)).asString());
 
         // 'find', 'replace', 'substr'
-        if (fnc == "find")
-        {
-            const auto &arr = expression[fnc];
-            validateArrayLength(arr, 2, 3,
-                "Function 'find' must have 2 or 3 values");
-            return utf8find(evaluate(arr[0]).asString(),
-                evaluate(arr[1]).asString(),
-                arr.size() == 3 ? evaluate(arr[2]).asUInt() : 0);
-        }
-        if (fnc == "replace")
-        {
-            const auto &arr = expression[fnc];
-            validateArrayLength(arr, 3, 3,
-                "Function 'replace' must have 3 values");
-            return utf8replace(evaluate(arr[0]).asString(),
-                evaluate(arr[1]).asString(),
-                evaluate(arr[2]).asString());
-        }
-        if (fnc == "substr")
-        {
-            const auto &arr = expression[fnc];
-            validateArrayLength(arr, 2, 3,
-                "Function 'substr' must have 2 or 3 values");
-            return utf8substr(evaluate(arr[0]).asString(),
-                evaluate(arr[1]).asInt(),
-                arr.size() == 3 ? evaluate(arr[2]).asUInt() : (uint32)-1);
-        }
+        case Op::Find:
+            return utf8find(evaluate(arg(e, 0)).asString(),
+                evaluate(arg(e, 1)).asString(),
+                e.args.size() == 3 ? evaluate(arg(e, 2)).asUInt() : 0);
+        case Op::Replace:
+            return utf8replace(evaluate(arg(e, 0)).asString(),
+                evaluate(arg(e, 1)).asString(),
+                evaluate(arg(e, 2)).asString());
+        case Op::Substr:
+            return utf8substr(evaluate(arg(e, 0)).asString(),
+                evaluate(arg(e, 1)).asInt(),
+                e.args.size() == 3 ? evaluate(arg(e, 2)).asUInt()
+                : (uint32)-1);
 
         // 'has-fonts', 'has-latin', 'is-cjk'
-        if (fnc == "has-latin")
-            return hasLatin(evaluate(expression[fnc]).asString());
-        if (fnc == "is-cjk")
-            return isCjk(evaluate(expression[fnc]).asString());
+        case Op::HasLatin:
+            return hasLatin(evaluate(arg(e, 0)).asString());
+        case Op::IsCjk:
+            return isCjk(evaluate(arg(e, 0)).asString());
 
         // 'map'
-        if (fnc == "map")
-        {
-            // { "map" : [inputValue, [[key, value], ...], defaultValue] }
-            const auto &arr = expression[fnc];
-            validateArrayLength(arr, 3, 3,
-                "Function 'map' must have 3 values");
-            return evaluateMap(arr[0], arr[1], arr[2]);
-        }
+        case Op::Map:
+            return evaluateMap(arg(e, 0), arg(e, 1), arg(e, 2));
 
         // 'discrete', 'discrete2', 'linear', 'linear2'
-        if (fnc == "discrete")
-            return evaluatePairsArray<false>(tileId.lod, expression[fnc]);
-        if (fnc == "discrete2")
-            return evaluatePairsArray<false>(expression[fnc][0],
-                expression[fnc][1]);
-        if (fnc == "linear")
-            return evaluatePairsArray<true>(tileId.lod, expression[fnc]);
-        if (fnc == "linear2")
-            return evaluatePairsArray<true>(expression[fnc][0],
-                expression[fnc][1]);
+        case Op::Discrete:
+            return evaluatePairsArray<false>(tileId.lod, arg(e, 0));
+        case Op::Discrete2:
+            return evaluatePairsArray<false>(
+                convertToDouble(evaluate(arg(e, 0))), arg(e, 1));
+        case Op::Linear:
+            return evaluatePairsArray<true>(tileId.lod, arg(e, 0));
+        case Op::Linear2:
+            return evaluatePairsArray<true>(
+                convertToDouble(evaluate(arg(e, 0))), arg(e, 1));
 
         // 'lod-scaled'
-        if (fnc == "lod-scaled")
+        case Op::LodScaled:
         {
-            Value arr = evaluate(expression["lod-scaled"]);
+            Value arr = evaluate(arg(e, 0));
             validateArrayLength(arr, 2, 3,
                 "Function 'lod-scaled' must have 2 or 3 values");
             float l = convertToDouble(arr[0]);
@@ -1107,9 +980,9 @@ if (fnc == #NAME) \
         }
 
         // 'log-scale'
-        if (fnc == "logScale" || fnc == "log-scale")
+        case Op::LogScale:
         {
-            Value arr = evaluate(expression[fnc]);
+            Value arr = evaluate(arg(e, 0));
             validateArrayLength(arr, 2, 4,
                 "Function 'log-scale' must have 2 to 4 values");
             double v = convertToDouble(arr[0]);
@@ -1121,199 +994,192 @@ if (fnc == #NAME) \
             return p * std::log(v + 1) + a;
         }
 
-        // unknown
+        // filters
+        default:
+            return filterInternal(e);
+        }
+        return Value();
+    }
+
+    Value interpolate(const Value &a, const Value &b, double f) const
+    {
         if (Validating)
-            THROW << "Unknown function <" << fnc << ">";
-        return expression;
+        {
+            if (a.isArray() != b.isArray())
+                THROW << "Cannot interpolate <" << a.toStyledString()
+                << "> and <" << b.toStyledString()
+                << "> because one is array and the other is not";
+            if (a.isArray() && a.size() != b.size())
+            {
+                THROW << "Cannot interpolate <" << a.toStyledString()
+                    << "> and <" << b.toStyledString()
+                    << "> because they have different number of elements";
+            }
+        }
+        if (a.isArray())
+        {
+            Value r;
+            Json::ArrayIndex cnt = a.size();
+            for (Json::ArrayIndex i = 0; i < cnt; i++)
+                r[i] = interpolate(a[i], b[i], f);
+            return r;
+        }
+        double aa = convertToDouble(a);
+        double bb = convertToDouble(b);
+        return aa + (bb - aa) * f;
     }
 
-    // string processing
-    Value evaluateString(const std::string &s) const
+    template<bool Linear>
+    Value evaluatePairsArray(double what, const Expr *searchArray) const
     {
         if (Validating)
         {
             try
             {
-                return evaluateStringInternal(s);
+                return evaluatePairsArrayInternal<Linear>(what, searchArray);
             }
             catch (...)
             {
-                LOG(info3) << "In evaluation of string <"
-                    << s << ">";
+                LOG(info3) << "In search of <" << what
+                    << "> in pairs array";
                 throw;
             }
         }
-        return evaluateStringInternal(s);
+        return evaluatePairsArrayInternal<Linear>(what, searchArray);
     }
 
-    Value evaluateStringInternal(const std::string &s) const
+    template<bool Linear>
+    Value evaluatePairsArrayInternal(double v,
+        const Expr *searchArrayParam) const
     {
-        // find '{'
-        std::size_t start = s.find("{");
-        if (start != s.npos)
+        const Value searchArray = evaluate(searchArrayParam);
+        if (Validating)
         {
-            size_t e = s.length();
-            uint32 cnt = 1;
-            std::size_t end = start;
-            while (cnt > 0 && end + 1 < e)
+            if (!searchArray.isArray())
+                THROW << "Expected an array";
+            for (const auto &p : searchArray)
             {
-                end++;
-                switch (s[end])
-                {
-                case '{': cnt++; break;
-                case '}': cnt--; break;
-                default: break;
-                }
+                if (!p.isArray() || p.size() != 2)
+                    THROW << "Expected an array with two elements";
             }
-            if (cnt > 0)
-                THROW << "Missing '}' in <" << s << ">";
-            if (end == start + 1)
-                THROW << "Invalid '{}' in <" << s << ">";
-            std::string subs = s.substr(start + 1, end - start - 1);
-            Json::Value v;
-            try
+        }
+        for (sint32 index = searchArray.size() - 1; index >= 0; index--)
+        {
+            double v1 = convertToDouble(searchArray[index][0]);
+            if (v < v1)
+                continue;
+            if (Linear)
             {
-                v = subs[0] == '{'
-                    ? stringToJson(subs)
-                    : Json::Value(subs);
+                if (index + 1u < searchArray.size())
+                {
+                    double v2 = convertToDouble(searchArray[index + 1][0]);
+                    return interpolate(
+                        evaluate(searchArray[index + 0][1]),
+                        evaluate(searchArray[index + 1][1]),
+                        (v - v1) / (v2 - v1));
+                }
             }
-            catch (std::exception &e)
+            return evaluate(searchArray[index][1]);
+        }
+        return evaluate(searchArray[0][1]);
+    }
+
+    Value evaluateMap(const Expr *key,
+        const Expr *pairsp, const Expr *default_) const
+    {
+        const std::string k = evaluate(key).asString();
+        const Value pairs = evaluate(pairsp);
+        if (Validating)
+        {
+            if (!pairs.isArray())
+                THROW << "Expected an array";
+            std::set<std::string> keys;
+            for (const auto &p : pairs)
             {
-                THROW << "Invalid json <" << subs
-                    << ">, message <" << e.what() << ">";
+                if (!p.isArray() || p.size() != 2)
+                    THROW << "Expected an array with two elements";
+                std::string a = evaluate(p[0]).asString();
+                if (!keys.insert(a).second)
+                    THROW << "Duplicate keys <" << a << ">";
             }
-            subs = evaluate(v).asString();
-            std::string res;
-            if (start > 0)
-                res += s.substr(0, start);
-            res += subs;
-            if (end < s.size())
-                res += s.substr(end + 1);
-            return evaluate(res);
-        }
-        // find '}'
-        if (Validating)
+        }
+        for (const Value &p : pairs)
         {
-            auto end = s.find("}");
-            if (end != s.npos)
-                THROW << "Unmatched <}> in <" << s << ">";
+            if (k == evaluate(p[0]).asString())
+                return evaluate(p[1]);
         }
-        // apply replacements
-        return replacement(s);
+        return evaluate(default_);
     }
 
     // evaluation of expressions whose result is boolean
-    bool filter(const Value &expression) const
+    bool filter(const Expr *expression) const
     {
+        if (!expression)
+            return false;
         if (Validating)
         {
             try
             {
-                return filterInternal(expression);
+                return filterInternal(*expression);
             }
             catch (...)
             {
-                LOG(info3) << "In filter <"
-                    << expression.toStyledString() << ">";
+                if (expression->source)
+                    LOG(info3) << "In filter <"
+                        << expression->source->toStyledString() << ">";
                 throw;
             }
         }
-        return filterInternal(expression);
+        return filterInternal(*expression);
     }
 
-    // some stylesheets contain an invalid aggregate filter
-    //   in which the tests are all enclosed in additional array
-    // this function tries to detect such cases and workaround it
-    // example:
-    //   invalid filter: ["all", [["has", "$foo"], ["has", "$bar"]]]
-    //   correct filter: ["all", ["has", "$foo"], ["has", "$bar"]]
-    const Value &aggregateFilterData(const Value &expression,
-        uint32 &start) const
+    bool filterInternal(const Expr &e) const
     {
-        if (expression.size() == 2
-            && expression[1].isArray()
-            && expression[1][0].isArray())
-        {
-            start = 0;
-            return expression[1];
-        }
-        else
-        {
-            start = 1;
-            return expression;
-        }
-    }
-
-    bool filterInternal(const Value &expression) const
-    {
-        if (Validating)
-        {
-            if (!expression.isArray())
-                THROW << "Filter must be array.";
-        }
-
-        std::string cond = expression[0].asString();
+        if (Validating && !e.error.empty())
+            THROW << e.error;
 
-        if (cond == "skip")
+        switch (e.op)
         {
-            validateArrayLength(expression, 1, 1,
-                "Invalid filter 'skip' array length.");
+        case Op::FilterSkip:
+        case Op::FilterInvalid:
+        case Op::FilterUnknown:
             return false;
-        }
 
         // comparison filters
-        if (cond == "==" || cond == "!=")
+        case Op::FilterEqual:
+        case Op::FilterNotEqual:
         {
-            validateArrayLength(expression, 3, 3, std::string()
-                + "Invalid filter '" + cond + "' array length.");
-            Value a = evaluate(expression[1]);
-            Value b = evaluate(expression[2]);
-            bool op = cond == "==";
+            Value a = evaluate(arg(e, 0));
+            Value b = evaluate(arg(e, 1));
+            bool op = e.op == Op::FilterEqual;
             if ((a.isString() || a.isNull()) && (b.isString() || b.isNull()))
                 return (a.asString() == b.asString()) == op;
             return (convertToDouble(a) == convertToDouble(b)) == op;
         }
-#define COMP(OP) \
-if (cond == #OP) \
-{ \
-    validateArrayLength(expression, 3, 3, \
-            "Invalid filter '" #OP "' array length."); \
-    double a = convertToDouble(expression[1]); \
-    double b = convertToDouble(expression[2]); \
-    return a OP b; \
-}
-        COMP(>= );
-        COMP(<= );
-        COMP(> );
-        COMP(< );
-#undef COMP
+        case Op::FilterGreaterEqual:
+            return convertToDouble(arg(e, 0)) >= convertToDouble(arg(e, 1));
+        case Op::FilterLessEqual:
+            return convertToDouble(arg(e, 0)) <= convertToDouble(arg(e, 1));
+        case Op::FilterGreater:
+            return convertToDouble(arg(e, 0)) > convertToDouble(arg(e, 1));
+        case Op::FilterLess:
+            return convertToDouble(arg(e, 0)) < convertToDouble(arg(e, 1));
 
         // negative filters
-        if (!cond.empty() && cond[0] == '!')
-        {
-            Value v(expression);
-            v[0] = cond.substr(1);
-            return !filter(v);
-        }
+        case Op::FilterNot:
+            return !filter(arg(e, 0));
 
         // has filters
-        if (cond == "has")
-        {
-            validateArrayLength(expression, 2, -1,
-                "Invalid filter 'has' array length.");
-            Value a = expression[1];
-            return !replacement(a.asString()).empty();
-        }
+        case Op::FilterHas:
+            return !evaluate(arg(e, 0)).empty();
 
         // in filters
-        if (cond == "in")
+        case Op::FilterIn:
         {
-            validateArrayLength(expression, 2, -1,
-                "Invalid filter 'in' array length.");
-            std::string v = evaluate(expression[1]).asString();
-            for (uint32 i = 2, e = expression.size(); i < e; i++)
+            std::string v = evaluate(arg(e, 0)).asString();
+            for (uint32 i = 1, cnt = e.args.size(); i < cnt; i++)
             {
-                std::string m = evaluate(expression[i]).asString();
+                std::string m = evaluate(e.args[i]).asString();
                 if (v == m)
                     return true;
             }
@@ -1321,38 +1187,32 @@ if (cond == #OP) \
         }
 
         // aggregate filters
-        if (cond == "all")
-        {
-            uint32 start;
-            const Value &v = aggregateFilterData(expression, start);
-            for (uint32 i = start, e = v.size(); i < e; i++)
-                if (!filter(v[i]))
+        case Op::FilterAll:
+            for (const Expr *a : e.args)
+                if (!filter(a))
                     return false;
             return true;
-        }
-        if (cond == "any")
-        {
-            uint32 start;
-            const Value &v = aggregateFilterData(expression, start);
-            for (uint32 i = start, e = v.size(); i < e; i++)
-                if (filter(v[i]))
+        case Op::FilterAny:
+            for (const Expr *a : e.args)
+                if (filter(a))
                     return true;
             return false;
-        }
-        if (cond == "none")
-        {
-            uint32 start;
-            const Value &v = aggregateFilterData(expression, start);
-            for (uint32 i = start, e = v.size(); i < e; i++)
-                if (filter(v[i]))
+        case Op::FilterNone:
+            for (const Expr *a : e.args)
+                if (filter(a))
                     return false;
             return true;
-        }
 
-        // unknown filter
-        if (Validating)
-            THROW << "Unknown filter condition type.";
+        case Op::Invalid:
+            THROW << e.error;
+            break;
 
+        default:
+            // value used as a filter
+            if (Validating)
+                THROW << "Filter must be array.";
+            break;
+        }
         return false;
     }
 
@@ -1365,10 +1225,10 @@ if (cond == #OP) \
         output.push_back(it->second->getUserData());
     }
 
-    void findFonts(const Value &expression,
+    void findFonts(const Expr *expression,
         std::vector<std::shared_ptr<void>> &output) const
     {
-        if (!expression.empty())
+        if (expression && !expression->source->empty())
         {
             Value v = evaluate(expression);
             validateArrayLength(v, 1, -1, "Fonts must be an array");
@@ -1382,12 +1242,11 @@ if (cond == #OP) \
     }
 
     // process single feature with specific style layer
-    void processFeatureName(const std::string &layerName)
+    void processFeatureLayer(const Layer &layer)
     {
         std::array<float, 2> tv;
         tv[0] = -std::numeric_limits<float>::infinity();
         tv[1] = +std::numeric_limits<float>::infinity();
-        const Value &layer = style["layers"][layerName];
         if (Validating)
         {
             try
@@ -1397,15 +1256,16 @@ if (cond == #OP) \
             catch (...)
             {
                 LOG(info3)
-                    << "In feature <" << feature->toStyledString()
-                    << "> and layer name <" << layerName << ">";
+                    << "In feature <"
+                    << features.featureJson().toStyledString()
+                    << "> and layer name <" << layer.name << ">";
                 throw;
             }
         }
         return processFeatureInternal(layer, tv, {});
     }
 
-    void processFeature(const Value &layer,
+    void processFeature(const Layer &layer,
         std::array<float, 2> tileVisibility,
         boost::optional<sint32> zOverride)
     {
@@ -1418,88 +1278,83 @@ if (cond == #OP) \
             }
             catch (...)
             {
-                LOG(info3) << "In layer <" << layer.toStyledString() << ">";
+                LOG(info3) << "In layer <"
+                    << layer.source.toStyledString() << ">";
                 throw;
             }
         }
         return processFeatureInternal(layer, tileVisibility, zOverride);
     }
 
-    void processFeatureInternal(const Value &layer,
+    void processFeatureInternal(const Layer &layer,
         std::array<float, 2> tileVisibility,
         boost::optional<sint32> zOverride)
     {
         currentLayer = &layer;
-        AmpVarsScope ampVarsScope(ampVariables);
+        AmpVarsScope ampVarsScope(ampScope, ampScopesCounter);
 
         // filter
-        if (!zOverride && layer.isMember("filter")
-            && !filter(layer["filter"]))
+        if (!zOverride && layer.filter
+            && !filter(layer.filter))
             return;
 
         // visible
-        if (layer.isMember("visible")
-            && !evaluate(layer["visible"]).asBool())
+        if (layer.has(Prop::Visible)
+            && !evaluate(layer[Prop::Visible]).asBool())
             return;
 
         // next-pass
+        if (layer.hasNextPass)
         {
-            auto np = layer["next-pass"];
-            if (!np.empty())
+            if (!layer.nextPassError.empty())
+                THROW << layer.nextPassError;
+            if (Validating)
             {
-                std::string layerName = np[1].asString();
-                if (Validating)
-                {
-                    if (!style["layers"].isMember(layerName))
-                        THROW << "Invalid layer name <"
-                        << layerName << "> in next-pass";
-                }
-                processFeature(style["layers"][layerName],
-                    tileVisibility, np[0].asInt());
+                if (!layer.nextPass)
+                    THROW << "Invalid layer name <"
+                    << layer.nextPassName << "> in next-pass";
             }
+            if (layer.nextPass)
+                processFeature(*layer.nextPass,
+                    tileVisibility, layer.nextPassZ);
         }
 
         // visibility-switch
-        if (layer.isMember("visibility-switch"))
+        if (layer.hasSwitch)
         {
-            validateArrayLength(layer["visibility-switch"], 1, -1,
+            const Value &switches = layer.source["visibility-switch"];
+            validateArrayLength(switches, 1, -1,
                 "Visibility-switch must be an array.");
             float ve = -std::numeric_limits<float>::infinity();
-            for (const Value &vs : layer["visibility-switch"])
+            Json::ArrayIndex index = 0;
+            for (const auto &vs : layer.switches)
             {
-                validateArrayLength(vs, 2, 2, "All visibility-switch "
+                validateArrayLength(switches[index++], 2, 2,
+                    "All visibility-switch "
                     "elements must be arrays with 2 elements");
-                float a = evaluate(vs[0]).asFloat();
+                float a = evaluate(vs.visibility).asFloat();
                 if (Validating)
                 {
                     if (a <= ve)
                         THROW << "Values in visibility-switch "
                         "must be increasing";
                 }
-                if (!vs[1].empty())
+                if (vs.layerName)
                 {
                     std::array<float, 2> tv;
                     tv[0] = std::max(tileVisibility[0], ve);
                     tv[1] = std::min(tileVisibility[1], a);
                     if (tv[0] < tv[1])
                     {
-                        std::string ln = evaluate(vs[1]).asString();
+                        std::string ln = evaluate(vs.layerName).asString();
                         if (Validating)
                         {
-                            if (!style["layers"].isMember(ln))
+                            if (!compiled.findLayer(ln))
                                 THROW << "Invalid layer name <"
                                 << ln << "> in visibility-switch";
                         }
-                        Value l = layer;
-                        l.removeMember("filter");
-                        l.removeMember("visible");
-                        l.removeMember("next-pass");
-                        l.removeMember("visibility-switch");
-                        const Value &s = style["layers"][ln];
-                        for (auto n : s.getMemberNames())
-                            l[n] = s[n];
-                        l["filter"] = layer["filter"];
-                        processFeature(l, tv, zOverride);
+                        processFeature(*compiled.mergedLayer(layer, vs, ln),
+                            tv, zOverride);
                     }
                 }
                 ve = a;
@@ -1513,33 +1368,33 @@ if (cond == #OP) \
         processFeatureCommon(layer, spec, zOverride);
 
         // point
-        if (evaluate(layer["point"]).asBool())
+        if (evaluate(layer[Prop::Point]).asBool())
             processFeaturePoint(layer, spec);
 
         // line
-        if (evaluate(layer["line"]).asBool())
+        if (evaluate(layer[Prop::Line]).asBool())
             processFeatureLine(layer, spec);
 
         // icon
-        if (evaluate(layer["icon"]).asBool())
+        if (evaluate(layer[Prop::Icon]).asBool())
             processFeatureIcon(layer, spec);
 
         // label flat
-        if (evaluate(layer["line-label"]).asBool())
+        if (evaluate(layer[Prop::LineLabel]).asBool())
             processFeatureLabelFlat(layer, spec);
 
         // label screen
-        if (evaluate(layer["label"]).asBool())
+        if (evaluate(layer[Prop::Label]).asBool())
             processFeatureLabelScreen(layer, spec);
 
         // polygon
-        if (evaluate(layer["polygon"]).asBool())
+        if (evaluate(layer[Prop::Polygon]).asBool())
             processFeaturePolygon(layer, spec);
     }
 
-    void addIconSpec(const Value &layer, GpuGeodataSpec &spec) const
+    void addIconSpec(const Layer &layer, GpuGeodataSpec &spec) const
     {
-        Value src = evaluate(layer["icon-source"]);
+        Value src = evaluate(layer[Prop::IconSource]);
         validateArrayLength(src, 5, 5, "icon-source must have 5 values");
         std::string btm = src[0].asString();
         if (stylesheet->bitmaps.count(btm) != 1)
@@ -1554,48 +1409,48 @@ if (cond == #OP) \
         spec.bitmap = tex->getUserData();
 
         spec.commonData.icon.scale
-            = layer.isMember("icon-scale")
-            ? convertToDouble(layer["icon-scale"])
+            = layer.has(Prop::IconScale)
+            ? convertToDouble(layer[Prop::IconScale])
             : 1;
         if (compatibility)
             spec.commonData.icon.scale *= 0.5;
 
         spec.commonData.icon.origin
-            = layer.isMember("icon-origin")
-            ? convertOrigin(layer["icon-origin"])
+            = layer.has(Prop::IconOrigin)
+            ? convertOrigin(layer[Prop::IconOrigin])
             : GpuGeodataSpec::Origin::BottomCenter;
 
-        vecToRaw(layer.isMember("icon-offset")
-            ? convertVector2(layer["icon-offset"])
+        vecToRaw(layer.has(Prop::IconOffset)
+            ? convertVector2(layer[Prop::IconOffset])
             : vec2f(0, 0),
             spec.commonData.icon.offset);
         spec.commonData.icon.offset[1] *= -1;
 
-        if (layer.isMember("icon-no-overlap"))
+        if (layer.has(Prop::IconNoOverlap))
             spec.commonData.preventOverlap
             = spec.commonData.preventOverlap
-            && evaluate(layer["icon-no-overlap"]).asBool();
+            && evaluate(layer[Prop::IconNoOverlap]).asBool();
 
         vecToRaw(vec2f(5, 5), spec.commonData.icon.margin);
-        if (layer.isMember("icon-no-overlap-margin"))
-            vecToRaw(convertNoOverlapMargin(layer["icon-no-overlap-margin"]),
+        if (layer.has(Prop::IconNoOverlapMargin))
+            vecToRaw(convertNoOverlapMargin(layer[Prop::IconNoOverlapMargin]),
                 spec.commonData.icon.margin);
 
-        vecToRaw(layer.isMember("icon-color")
-            ? convertColor(layer["icon-color"])
+        vecToRaw(layer.has(Prop::IconColor)
+            ? convertColor(layer[Prop::IconColor])
             : vec4f(1, 1, 1, 1),
             spec.commonData.icon.color);
 
-        if (layer.isMember("icon-stick"))
-            spec.commonData.stick = convertStick(layer["icon-stick"]);
+        if (layer.has(Prop::IconStick))
+            spec.commonData.stick = convertStick(layer[Prop::IconStick]);
     }
 
-    void addIconItems(const Value &layer,
+    void addIconItems(const Layer &layer,
         GpuGeodataSpec &data, uint32 itemsCount)
     {
         if (!(data.commonData.icon.scale == data.commonData.icon.scale))
             return;
-        Value src = evaluate(layer["icon-source"]);
+        Value src = evaluate(layer[Prop::IconSource]);
         auto tex = stylesheet->bitmaps.at(src[0].asString());
         assert(tex);
         sint32 a[4] = { src[1].asInt(), src[2].asInt(),
@@ -1615,13 +1470,13 @@ if (cond == #OP) \
             data.iconCoords.push_back(uv);
     }
 
-    std::string getHysteresisIdSpec(const Value &layer,
+    std::string getHysteresisIdSpec(const Layer &layer,
         GpuGeodataSpec &spec)
     {
         std::string hysteresisId;
-        if (layer.isMember("hysteresis"))
+        if (layer.has(Prop::Hysteresis))
         {
-            Value arr = evaluate(layer["hysteresis"]);
+            Value arr = evaluate(layer[Prop::Hysteresis]);
             validateArrayLength(arr, 4, 4,
                 "hysteresis must have 4 values");
             spec.commonData.hysteresisDuration[0]
@@ -1645,16 +1500,16 @@ if (cond == #OP) \
             data.hysteresisIds.push_back(hysteresisId);
     }
 
-    float getImportanceSpec(const Value &layer,
+    float getImportanceSpec(const Layer &layer,
         GpuGeodataSpec &spec, float *overrideMargin = nullptr)
     {
         float importance = nan1();
-        if (layer.isMember("importance-source"))
+        if (layer.has(Prop::ImportanceSource))
             importance = convertToDouble(
-                evaluate(layer["importance-source"]));
-        if (layer.isMember("importance-weight"))
+                evaluate(layer[Prop::ImportanceSource]));
+        if (layer.has(Prop::ImportanceWeight))
             importance *= convertToDouble(
-                evaluate(layer["importance-weight"]));
+                evaluate(layer[Prop::ImportanceWeight]));
         if (!std::isnan(importance)
             && browserOptions.isMember("mapFeaturesReduceMode")
             && browserOptions["mapFeaturesReduceMode"].asString()
@@ -1692,7 +1547,7 @@ if (cond == #OP) \
             data.importances.push_back(importance);
     }
 
-    void processFeatureCommon(const Value &layer, GpuGeodataSpec &spec,
+    void processFeatureCommon(const Layer &layer, GpuGeodataSpec &spec,
         boost::optional<sint32> zOverride) const
     {
         // model matrix
@@ -1701,13 +1556,13 @@ if (cond == #OP) \
         // z-index
         if (zOverride)
             spec.commonData.zIndex = *zOverride;
-        else if (layer.isMember("z-index"))
-            spec.commonData.zIndex = evaluate(layer["z-index"]).asInt();
+        else if (layer.has(Prop::ZIndex))
+            spec.commonData.zIndex = evaluate(layer[Prop::ZIndex]).asInt();
 
         // zbuffer-offset
-        if (layer.isMember("zbuffer-offset"))
+        if (layer.has(Prop::ZbufferOffset))
         {
-            Value arr = evaluate(layer["zbuffer-offset"]);
+            Value arr = evaluate(layer[Prop::ZbufferOffset]);
             validateArrayLength(arr, 3, 3,
                 "zbuffer-offset must have 3 values");
             for (int i = 0; i < 3; i++)
@@ -1720,16 +1575,16 @@ if (cond == #OP) \
         }
 
         // visibility
-        if (layer.isMember("visibility"))
+        if (layer.has(Prop::Visibility))
         {
             spec.commonData.visibilities[0]
-                = convertToDouble(layer["visibility"]);
+                = convertToDouble(layer[Prop::Visibility]);
         }
 
         // visibility-abs
-        if (layer.isMember("visibility-abs"))
+        if (layer.has(Prop::VisibilityAbs))
         {
-            Value arr = evaluate(layer["visibility-abs"]);
+            Value arr = evaluate(layer[Prop::VisibilityAbs]);
             validateArrayLength(arr, 2, 2,
                 "visibility-abs must have 2 values");
             for (int i = 0; i < 2; i++)
@@ -1738,9 +1593,9 @@ if (cond == #OP) \
         }
 
         // visibility-rel
-        if (layer.isMember("visibility-rel"))
+        if (layer.has(Prop::VisibilityRel))
         {
-            Value arr = evaluate(layer["visibility-rel"]);
+            Value arr = evaluate(layer[Prop::VisibilityRel]);
             validateArrayLength(arr, 4, 4,
                 "visibility-rel must have 4 values");
             float d = convertToDouble(arr[0]) * convertToDouble(arr[1]);
@@ -1762,26 +1617,26 @@ if (cond == #OP) \
         }
 
         // culling
-        if (layer.isMember("culling"))
+        if (layer.has(Prop::Culling))
             spec.commonData.visibilities[3]
-                = convertToDouble(layer["culling"]);
+                = convertToDouble(layer[Prop::Culling]);
     }
 
-    void processFeaturePoint(const Value &layer, GpuGeodataSpec spec)
+    void processFeaturePoint(const Layer &layer, GpuGeodataSpec spec)
     {
-        if (evaluate(layer["point-flat"]).asBool())
+        if (evaluate(layer[Prop::PointFlat]).asBool())
             spec.type = GpuGeodataSpec::Type::PointFlat;
         else
             spec.type = GpuGeodataSpec::Type::PointScreen;
 
-        vecToRaw(layer.isMember("point-color")
-            ? convertColor(layer["point-color"])
+        vecToRaw(layer.has(Prop::PointColor)
+            ? convertColor(layer[Prop::PointColor])
             : vec4f(1, 1, 1, 1),
             spec.unionData.point.color);
 
-        if (layer.isMember("point-radius-units"))
+        if (layer.has(Prop::PointRadiusUnits))
         {
-            std::string units = evaluate(layer["point-radius-units"]).asString();
+            std::string units = evaluate(layer[Prop::PointRadiusUnits]).asString();
             if (units == "ratio")
                 spec.unionData.point.units = GpuGeodataSpec::Units::Ratio;
             else if (units == "pixels")
@@ -1812,8 +1667,8 @@ if (cond == #OP) \
             spec.unionData.point.units = GpuGeodataSpec::Units::Pixels;
 
         spec.unionData.point.radius
-            = layer.isMember("point-radius")
-            ? convertToDouble(layer["point-radius"])
+            = layer.has(Prop::PointRadius)
+            ? convertToDouble(layer[Prop::PointRadius])
             : 1;
         if (compatibility && spec.unionData.point.units
             != GpuGeodataSpec::Units::Ratio)
@@ -1826,21 +1681,21 @@ if (cond == #OP) \
         data.positions.insert(data.positions.end(), arr.begin(), arr.end());
     }
 
-    void processFeatureLine(const Value &layer, GpuGeodataSpec spec)
+    void processFeatureLine(const Layer &layer, GpuGeodataSpec spec)
     {
-        if (evaluate(layer["line-flat"]).asBool())
+        if (evaluate(layer[Prop::LineFlat]).asBool())
             spec.type = GpuGeodataSpec::Type::LineFlat;
         else
             spec.type = GpuGeodataSpec::Type::LineScreen;
 
-        vecToRaw(layer.isMember("line-color")
-            ? convertColor(layer["line-color"])
+        vecToRaw(layer.has(Prop::LineColor)
+            ? convertColor(layer[Prop::LineColor])
             : vec4f(1, 1, 1, 1),
             spec.unionData.line.color);
 
-        if (layer.isMember("line-width-units"))
+        if (layer.has(Prop::LineWidthUnits))
         {
-            std::string units = evaluate(layer["line-width-units"]).asString();
+            std::string units = evaluate(layer[Prop::LineWidthUnits]).asString();
             if (units == "ratio")
                 spec.unionData.line.units = GpuGeodataSpec::Units::Ratio;
             else if (units == "pixels")
@@ -1871,20 +1726,21 @@ if (cond == #OP) \
             spec.unionData.line.units = GpuGeodataSpec::Units::Pixels;
 
         spec.unionData.line.width
-            = convertToDouble(layer["line-width"]);
+            = convertToDouble(layer[Prop::LineWidth]);
         if (compatibility && spec.type == GpuGeodataSpec::Type::LineScreen)
             spec.unionData.line.width *= 0.5;
 
         GpuGeodataSpec &data = findSpecData(spec);
         const auto arr = getFeaturePositions();
+        std::size_t first = data.positions.size();
         data.positions.reserve(data.positions.size() + arr.size());
         data.positions.insert(data.positions.end(), arr.begin(), arr.end());
-        eliminateSingularLines(data);
+        eliminateSingularLines(data, first);
     }
 
-    void processFeatureIcon(const Value &layer, GpuGeodataSpec spec)
+    void processFeatureIcon(const Layer &layer, GpuGeodataSpec spec)
     {
-        if (evaluate(layer["pack"]).asBool())
+        if (evaluate(layer[Prop::Pack]).asBool())
             return;
 
         spec.type = GpuGeodataSpec::Type::IconScreen;
@@ -1904,47 +1760,47 @@ if (cond == #OP) \
         addIconItems(layer, data, arr.size());
     }
 
-    void processFeatureLabelFlat(const Value &layer, GpuGeodataSpec spec)
+    void processFeatureLabelFlat(const Layer &layer, GpuGeodataSpec spec)
     {
-        findFonts(layer["line-label-font"], spec.fontCascade);
+        findFonts(layer[Prop::LineLabelFont], spec.fontCascade);
 
         spec.type = GpuGeodataSpec::Type::LabelFlat;
 
-        vecToRaw(layer.isMember("line-label-color")
-            ? convertColor(layer["line-label-color"])
+        vecToRaw(layer.has(Prop::LineLabelColor)
+            ? convertColor(layer[Prop::LineLabelColor])
             : vec4f(1, 1, 1, 1),
             spec.unionData.labelFlat.color);
-        vecToRaw(layer.isMember("line-label-color2")
-            ? convertColor(layer["line-label-color2"])
+        vecToRaw(layer.has(Prop::LineLabelColor2)
+            ? convertColor(layer[Prop::LineLabelColor2])
             : vec4f(0, 0, 0, 1),
             spec.unionData.labelFlat.color2);
 
-        vecToRaw(layer.isMember("line-label-outline")
-            ? convertVector4(layer["line-label-outline"])
+        vecToRaw(layer.has(Prop::LineLabelOutline)
+            ? convertVector4(layer[Prop::LineLabelOutline])
             : vec4f(0.27, 0.75, 2.2, 2.2),
             spec.unionData.labelFlat.outline);
 
         spec.unionData.labelFlat.offset
-            = layer.isMember("line-label-offset")
-            ? convertToDouble(layer["line-label-offset"])
+            = layer.has(Prop::LineLabelOffset)
+            ? convertToDouble(layer[Prop::LineLabelOffset])
             : 0;
 
         spec.commonData.preventOverlap
-            = layer.isMember("line-label-no-overlap-margin");
+            = layer.has(Prop::LineLabelNoOverlapMargin);
 
         spec.unionData.labelFlat.marginMult
-            = layer.isMember("line-label-no-overlap-margin")
-            ? convertToDouble(layer["line-label-no-overlap-margin"])
+            = layer.has(Prop::LineLabelNoOverlapMargin)
+            ? convertToDouble(layer[Prop::LineLabelNoOverlapMargin])
             : 1.1;
 
         spec.unionData.labelFlat.size
-            = layer.isMember("line-label-size")
-            ? convertToDouble(layer["line-label-size"])
+            = layer.has(Prop::LineLabelSize)
+            ? convertToDouble(layer[Prop::LineLabelSize])
             : 1;
 
         spec.unionData.labelFlat.units
-            = (layer.isMember("line-label-type")
-            && layer["line-label-type"] == "screen-flat")
+            = (layer.source.isMember("line-label-type")
+            && layer.source["line-label-type"] == "screen-flat")
             ? GpuGeodataSpec::Units::Pixels
             : GpuGeodataSpec::Units::Meters;
 
@@ -1957,8 +1813,9 @@ if (cond == #OP) \
                 spec.unionData.labelFlat.size *= 0.85;
         }
 
-        std::string text = evaluate(layer.isMember("line-label-source")
-            ? layer["line-label-source"] : "$name").asString();
+        std::string text = (layer.has(Prop::LineLabelSource)
+            ? evaluate(layer[Prop::LineLabelSource])
+            : replacement("$name")).asString();
         if (text.empty())
             return;
 
@@ -1971,6 +1828,7 @@ if (cond == #OP) \
 
         GpuGeodataSpec &data = findSpecData(spec);
         auto arr = getFeaturePositions();
+        std::size_t first = data.positions.size();
         data.positions.reserve(data.positions.size() + arr.size());
         data.positions.insert(data.positions.end(), arr.begin(), arr.end());
         data.texts.reserve(data.texts.size() + arr.size());
@@ -1978,35 +1836,35 @@ if (cond == #OP) \
             data.texts.push_back(text);
         addHysteresisIdItems(hysteresisId, data, arr.size());
         addImportanceItems(importance, data, arr.size());
-        eliminateSingularLines(data);
+        eliminateSingularLines(data, first);
     }
 
-    void processFeatureLabelScreen(const Value &layer, GpuGeodataSpec spec)
+    void processFeatureLabelScreen(const Layer &layer, GpuGeodataSpec spec)
     {
-        findFonts(layer["label-font"], spec.fontCascade);
+        findFonts(layer[Prop::LabelFont], spec.fontCascade);
 
         spec.type = GpuGeodataSpec::Type::LabelScreen;
 
-        if (evaluate(layer["icon"]).asBool()
-            && evaluate(layer["pack"]).asBool())
+        if (evaluate(layer[Prop::Icon]).asBool()
+            && evaluate(layer[Prop::Pack]).asBool())
             addIconSpec(layer, spec);
 
-        vecToRaw(layer.isMember("label-color")
-            ? convertColor(layer["label-color"])
+        vecToRaw(layer.has(Prop::LabelColor)
+            ? convertColor(layer[Prop::LabelColor])
             : vec4f(1, 1, 1, 1),
             spec.unionData.labelScreen.color);
-        vecToRaw(layer.isMember("label-color2")
-            ? convertColor(layer["label-color2"])
+        vecToRaw(layer.has(Prop::LabelColor2)
+            ? convertColor(layer[Prop::LabelColor2])
             : vec4f(0, 0, 0, 1),
             spec.unionData.labelScreen.color2);
 
-        vecToRaw(layer.isMember("label-outline")
-            ? convertVector4(layer["label-outline"])
+        vecToRaw(layer.has(Prop::LabelOutline)
+            ? convertVector4(layer[Prop::LabelOutline])
             : vec4f(0.27, 0.75, 2.2, 2.2),
             spec.unionData.labelScreen.outline);
 
-        vecToRaw(layer.isMember("label-offset")
-            ? convertVector2(layer["label-offset"])
+        vecToRaw(layer.has(Prop::LabelOffset)
+            ? convertVector2(layer[Prop::LabelOffset])
             : vec2f(0, 0),
             spec.unionData.labelScreen.offset);
         spec.unionData.labelScreen.offset[1] *= -1;
@@ -2016,44 +1874,45 @@ if (cond == #OP) \
             spec.unionData.labelScreen.offset[1] *= 0.5;
         }
 
-        if (layer.isMember("label-no-overlap"))
+        if (layer.has(Prop::LabelNoOverlap))
             spec.commonData.preventOverlap
                 = spec.commonData.preventOverlap
-                    && evaluate(layer["label-no-overlap"]).asBool();
+                    && evaluate(layer[Prop::LabelNoOverlap]).asBool();
 
         vecToRaw(vec2f(5, 5), spec.unionData.labelScreen.margin);
-        if (layer.isMember("label-no-overlap-margin"))
-            vecToRaw(convertNoOverlapMargin(layer["label-no-overlap-margin"]),
+        if (layer.has(Prop::LabelNoOverlapMargin))
+            vecToRaw(convertNoOverlapMargin(layer[Prop::LabelNoOverlapMargin]),
                 spec.unionData.labelScreen.margin);
 
         spec.unionData.labelScreen.size
-            = layer.isMember("label-size")
-            ? convertToDouble(layer["label-size"])
+            = layer.has(Prop::LabelSize)
+            ? convertToDouble(layer[Prop::LabelSize])
             : 20;
         if (compatibility)
             spec.unionData.labelScreen.size *= 1.5 * 1.52 / 3.0;
 
         spec.unionData.labelScreen.width
-            = layer.isMember("label-width")
-            ? convertToDouble(layer["label-width"])
+            = layer.has(Prop::LabelWidth)
+            ? convertToDouble(layer[Prop::LabelWidth])
             : 200;
 
         spec.unionData.labelScreen.origin
-            = layer.isMember("label-origin")
-            ? convertOrigin(layer["label-origin"])
+            = layer.has(Prop::LabelOrigin)
+            ? convertOrigin(layer[Prop::LabelOrigin])
             : GpuGeodataSpec::Origin::BottomCenter;
 
         spec.unionData.labelScreen.textAlign
-            = layer.isMember("label-align")
-            ? convertTextAlign(layer["label-align"])
+            = layer.has(Prop::LabelAlign)
+            ? convertTextAlign(layer[Prop::LabelAlign])
             : GpuGeodataSpec::TextAlign::Center;
 
-        if (layer.isMember("label-stick"))
+        if (layer.has(Prop::LabelStick))
             spec.commonData.stick
-            = convertStick(layer["label-stick"]);
+            = convertStick(layer[Prop::LabelStick]);
 
-        std::string text = evaluate(layer.isMember("label-source")
-            ? layer["label-source"] : "$name").asString();
+        std::string text = (layer.has(Prop::LabelSource)
+            ? evaluate(layer[Prop::LabelSource])
+            : replacement("$name")).asString();
         if (text.empty())
             return;
 
@@ -2075,18 +1934,18 @@ if (cond == #OP) \
         addIconItems(layer, data, arr.size());
     }
 
-    void processFeaturePolygon(const Value &layer, GpuGeodataSpec spec)
+    void processFeaturePolygon(const Layer &layer, GpuGeodataSpec spec)
     {
         spec.type = GpuGeodataSpec::Type::Triangles;
 
-        vecToRaw(layer.isMember("polygon-color")
-            ? convertColor(layer["polygon-color"])
+        vecToRaw(layer.has(Prop::PolygonColor)
+            ? convertColor(layer[Prop::PolygonColor])
             : vec4f(1, 1, 1, 1),
             spec.unionData.triangles.color);
 
-        if (layer.isMember("polygon-style"))
+        if (layer.has(Prop::PolygonStyle))
         {
-            Value v = evaluate(layer["polygon-style"]);
+            Value v = evaluate(layer[Prop::PolygonStyle]);
             if (v.asString() == "solid")
                 spec.unionData.triangles.style
                     = GpuGeodataSpec::PolygonStyle::Solid;
@@ -2102,9 +1961,9 @@ if (cond == #OP) \
                 = GpuGeodataSpec::PolygonStyle::FlatShade;
         }
 
-        if (layer.isMember("polygon-use-stencil"))
+        if (layer.has(Prop::PolygonUseStencil))
         {
-            Value v = evaluate(layer["polygon-use-stencil"]);
+            Value v = evaluate(layer[Prop::PolygonUseStencil]);
             spec.unionData.triangles.useStencil = v.asBool();
         }
 
@@ -2129,12 +1988,16 @@ if (cond == #OP) \
 
     GeodataTile *const data;
     const GeodataStylesheet *const stylesheet;
-    Value style;
-    const Value features;
+    const std::shared_ptr<const GeodataStyleCompiled> compiledHolder;
+    const GeodataStyleCompiled &compiled;
+    const std::shared_ptr<const std::string> featuresHolder;
+    GeodataFeaturesReader features;
     const Value &browserOptions;
     const vec3 aabbPhys[2];
     const TileId tileId;
     const bool compatibility;
+    const uint32 featuresBegin;
+    const uint32 featuresEnd;
 
     // processing data
     //   fast accessors to currently processed feature
@@ -2142,15 +2005,11 @@ if (cond == #OP) \
 
     struct Group
     {
-        const Value &group;
-
-        Group(const Value &group) : group(group)
+        Group(const GeodataFeaturesReader &features)
         {
-            const Value &a = group["bbox"][0];
-            vec3 aa = vec3(a[0].asDouble(), a[1].asDouble(), a[2].asDouble());
-            const Value &b = group["bbox"][1];
-            vec3 bb = vec3(b[0].asDouble(), b[1].asDouble(), b[2].asDouble());
-            double resolution = group["resolution"].asDouble();
+            vec3 aa = features.groupBbox()[0];
+            vec3 bb = features.groupBbox()[1];
+            double resolution = features.groupResolution();
             vec3 mm = bb - aa;
             double ms = length(mm) * 0.01;
             if (ms < 1e-15)
@@ -2161,10 +2020,8 @@ if (cond == #OP) \
             model = translationMatrix(aa) * scaleMatrix(ms);
         }
 
-        Point convertPoint(const Value &v) const
+        Point convertPoint(const vec3 &p) const
         {
-            validateArrayLength(v, 3, 3, "Point must have 3 coordinates");
-            vec3 p = vec3(v[0].asDouble(), v[1].asDouble(), v[2].asDouble());
             vec3f f = vec3(orthonormalize * p).cast<float>();
             assert(!std::isnan(f[0])
                 && !std::isnan(f[1])
@@ -2172,12 +2029,13 @@ if (cond == #OP) \
             return { f[0], f[1], f[2] };
         }
 
-        std::vector<Point> convertArray(const Value &v, bool relative) const
+        std::vector<Point> convertArray(const std::vector<vec3> &v,
+            bool relative) const
         {
             (void)relative; // todo
             std::vector<Point> a;
             a.reserve(v.size());
-            for (const Value &p : v)
+            for (const vec3 &p : v)
                 a.push_back(convertPoint(p));
             return a;
         }
@@ -2196,38 +2054,19 @@ if (cond == #OP) \
 
     boost::optional<Group> group;
     boost::optional<Type> type;
-    boost::optional<const Value &> feature;
 
+    // points: single array
+    // lines: array per line
+    // polygons: the middle point
     std::vector<std::vector<Point>> getFeaturePositions() const
     {
+        std::vector<std::vector<vec3>> positions;
+        features.positions(positions);
         std::vector<std::vector<Point>> result;
-        switch (*type)
-        {
-        case Type::Point:
-        {
-            const Value &array1 = (*feature)["points"];
-            result.push_back(
-                group->convertArray(array1, false));
-            // todo d-points
-        } break;
-        case Type::Line:
-        {
-            const Value &array1 = (*feature)["lines"];
-            result.reserve(array1.size());
-            for (const Value &array2 : array1)
-            {
-                result.push_back(
-                    group->convertArray(array2, false));
-            }
-            // todo d-lines
-        } break;
-        case Type::Polygon:
-        {
-            std::vector<Point> r;
-            r.push_back(group->convertPoint((*feature)["middle"]));
-            result.push_back(r);
-        } break;
-        }
+        result.reserve(positions.size());
+        for (const auto &it : positions)
+            result.push_back(group->convertArray(it, false));
+        // todo d-points, d-lines
         return result;
     }
 
@@ -2235,37 +2074,16 @@ if (cond == #OP) \
     {
         std::vector<Point> result;
         assert(*type == Type::Polygon);
-        const Value &array1 = (*feature)["vertices"];
-        if (Validating)
-        {
-            if (!array1.isArray() || (array1.size() % 3) != 0)
-                THROW << "Polygon vertices must be an array "
-                "with size divisible by 3";
-        }
-        std::vector<Point> vertices;
-        vertices.reserve(array1.size());
-        for (uint32 i = 0, e = array1.size(); i < e; i += 3)
-        {
-            Value v;
-            v.resize(3);
-            for (uint32 j = 0; j < 3; j++)
-                v[j] = array1[i + j];
-            vertices.push_back(group->convertPoint(v));
-        }
-        const Value &surface = (*feature)["surface"];
-        if (Validating)
-        {
-            if (!surface.isArray() || (surface.size() % 3) != 0)
-                THROW << "Polygon surface must be an array "
-                         "with size divisible by 3";
-        }
+        std::vector<vec3> vertices;
+        std::vector<uint32> surface;
+        features.polygon(vertices, surface);
         auto verticesCount = vertices.size();
-        for (const Value &vi : surface)
+        result.reserve(surface.size());
+        for (uint32 i : surface)
         {
-            Json::UInt i = vi.asUInt();
             if (i >= verticesCount)
                 THROW << "Index out of range (polygon surface vertex)";
-            result.push_back(vertices[i]);
+            result.push_back(group->convertPoint(vertices[i]));
         }
         return { result };
     }
@@ -2293,12 +2111,15 @@ if (cond == #OP) \
         }), fps.end());
     }
 
-    void eliminateSingularLines(GpuGeodataSpec &data) const
+    // lines before first were already processed
+    void eliminateSingularLines(GpuGeodataSpec &data, std::size_t first) const
     {
         std::vector<bool> removes;
-        removes.reserve(data.positions.size());
-        for (auto &v : data.positions)
+        removes.reserve(data.positions.size() - first);
+        for (auto it = data.positions.begin() + first,
+            et = data.positions.end(); it != et; it++)
         {
+            auto &v = *it;
             vec3 l = nan3();
             v.erase(std::remove_if(v.begin(), v.end(),
                 [&](const Point &pp) {
@@ -2310,23 +2131,169 @@ if (cond == #OP) \
             }), v.end());
             removes.push_back(v.size() <= 1);
         }
-        erase_if(data.positions, removes);
-        erase_if(data.iconCoords, removes);
-        erase_if(data.texts, removes);
-        erase_if(data.hysteresisIds, removes);
-        erase_if(data.importances, removes);
+        erase_if(data.positions, removes, first);
+        erase_if(data.iconCoords, removes, first);
+        erase_if(data.texts, removes, first);
+        erase_if(data.hysteresisIds, removes, first);
+        erase_if(data.importances, removes, first);
     }
 
     // cache data
     //   temporary data generated while processing features
 
     std::set<GpuGeodataSpec, GpuGeodataSpecComparator> cacheData;
-    AmpVariables ampVariables;
-    const Value *currentLayer;
+    const Layer *currentLayer;
+
+    // cached values of &variables, valid in the current scope only
+    mutable std::vector<Value> ampValues;
+    mutable std::vector<uint32> ampScopes;
+    uint32 ampScope = 0;
+    uint32 ampScopesCounter = 0;
+};
+
+template<bool Validating>
+void processGeodata(GeodataTile *tile, std::vector<GpuGeodataSpec> &specs,
+    uint32 featuresBegin = 0, uint32 featuresEnd = -1)
+{
+    geoContext<Validating> ctx(tile, featuresBegin, featuresEnd);
+    ctx.process();
+    ctx.result(specs);
+}
+
+template<class V>
+void append(V &a, V &b)
+{
+    a.reserve(a.size() + b.size());
+    std::move(b.begin(), b.end(), std::back_inserter(a));
+}
+
+// items of equal specs are concatenated in the order of the shards,
+//   which gives the same result as if the tile was processed at once
+void mergeShards(std::vector<std::vector<GpuGeodataSpec>> &results,
+    std::vector<GpuGeodataSpec> &specs)
+{
+    std::set<GpuGeodataSpec, GpuGeodataSpecComparator> merged;
+    for (auto &result : results)
+    {
+        for (GpuGeodataSpec &spec : result)
+        {
+            auto it = merged.find(spec);
+            if (it == merged.end())
+            {
+                merged.insert(std::move(spec));
+                continue;
+            }
+            // only modifying attributes not used in comparison
+            GpuGeodataSpec &data = const_cast<GpuGeodataSpec&>(*it);
+            append(data.positions, spec.positions);
+            append(data.iconCoords, spec.iconCoords);
+            append(data.texts, spec.texts);
+            append(data.hysteresisIds, spec.hysteresisIds);
+            append(data.importances, spec.importances);
+        }
+        std::vector<GpuGeodataSpec>().swap(result);
+    }
+    specs.clear();
+    specs.reserve(merged.size());
+    for (const GpuGeodataSpec &spec : merged)
+        specs.push_back(std::move(const_cast<GpuGeodataSpec&>(spec)));
+}
+
+// number of feature-layer pairs worth of a separate thread
+const uint32 shardMinimalWork = 5000;
+
+} // namespace
+
+// results of a geodata tile processed in parts by multiple threads
+class GeodataShards
+{
+public:
+    GeodataShards(uint32 count, uint32 features) :
+        results(count), errors(count), remaining(count), features(features)
+    {}
+
+    // index of the first feature of the shard
+    uint32 begin(uint32 shard) const
+    {
+        return (uint64)features * shard / results.size();
+    }
+
+    std::vector<std::vector<GpuGeodataSpec>> results;
+    std::vector<std::exception_ptr> errors;
+    std::atomic<uint32> remaining;
+    const uint32 features;
 };
 
+namespace
+{
+
+// the last shard to finish merges the results
+bool processShard(GeodataTile *tile, GeodataShards &shards, uint32 shard)
+{
+    OPTICK_EVENT();
+    OPTICK_TAG("shard", shard);
+    try
+    {
+        uint32 b = shards.begin(shard);
+        uint32 e = shards.begin(shard + 1);
+        if (tile->map->options.debugValidateGeodataStyles)
+            processGeodata<true>(tile, shards.results[shard], b, e);
+        else
+            processGeodata<false>(tile, shards.results[shard], b, e);
+    }
+    catch (...)
+    {
+        shards.errors[shard] = std::current_exception();
+    }
+    if (--shards.remaining > 0)
+        return false;
+    for (const std::exception_ptr &e : shards.errors)
+        if (e)
+            std::rethrow_exception(e);
+    mergeShards(shards.results, tile->specsToUpload);
+    return true;
+}
+
 } // namespace
 
+bool GeodataTile::process(const GeodataJob &job)
+{
+    if (job.shards)
+        return processShard(this, *job.shards, job.shard);
+
+    // split large tiles to use all geodata threads
+    uint32 threads = map->statistics.geodataThreads;
+    uint32 featuresCount = 0;
+    uint32 work = 0;
+    if (threads > 1 && isGeodataFeaturesBinary(*features))
+        featuresCount = geoContext<false>::countFeatures(this, work);
+    uint32 count = std::min(std::min(threads, featuresCount),
+        work / shardMinimalWork);
+    if (count <= 1)
+    {
+        decode();
+        return true;
+    }
+
+    OPTICK_EVENT();
+    OPTICK_TAG("name", name.c_str());
+    LOG(info2) << "Decoding geodata tile <" << name
+        << "> in " << count << " shards";
+    assert(state == Resource::State::downloaded);
+    map->counters.resourcesDecoded++;
+
+    auto shards = std::make_shared<GeodataShards>(count, featuresCount);
+    for (uint32 i = count - 1; i > 0; i--)
+    {
+        GeodataJob j;
+        j.tile = std::dynamic_pointer_cast<GeodataTile>(shared_from_this());
+        j.shards = shards;
+        j.shard = i;
+        map->resources.queGeodata.pushFront(std::move(j));
+    }
+    return processShard(this, *shards, 0);
+}
+
 void GeodataTile::decode()
 {
     OPTICK_EVENT();
@@ -2337,18 +2304,12 @@ void GeodataTile::decode()
     assert(!fetch);
 
     assert(state == Resource::State::downloaded);
-    map->statistics.resourcesDecoded++;
+    map->counters.resourcesDecoded++;
 
     if (map->options.debugValidateGeodataStyles)
-    {
-        geoContext<true> ctx(this);
-        ctx.process();
-    }
+        processGeodata<true>(this, specsToUpload);
     else
-    {
-        geoContext<false> ctx(this);
-        ctx.process();
-    }
+        processGeodata<false>(this, specsToUpload);
 }
 
 void GeodataTile::upload()
@@ -2356,7 +2317,7 @@ void GeodataTile::upload()
     LOG(info2) << "Uploading geodata tile <" << name << ">";
 
     assert(state == Resource::State::decoded);
-    map->statistics.resourcesUploaded++;
+    map->counters.resourcesUploaded++;
 
     // upload
     renders.clear();
@@ -2382,50 +2343,48 @@ void GeodataTile::upload()
     }
 }
 
-void MapImpl::resourcesGeodataProcessorEntry()
-{
-    OPTICK_THREAD("geodata");
-    setLogThreadName("geodata");
-    while (!resources.queGeodata.stopped())
-    {
-        std::weak_ptr<GeodataTile> w;
-        resources.queGeodata.waitPop(w);
-        std::shared_ptr<GeodataTile> r = w.lock();
-        if (!r)
-            continue;
-        try
-        {
-            r->decode();
-            r->state = Resource::State::decoded;
-            resources.queUpload.push(UploadData(r));
-        }
-        catch (const std::exception &)
-        {
-            statistics.resourcesFailed++;
-            r->state = Resource::State::errorFatal;
-        }
-    }
-}
-
-bool MapImpl::resourcesGeodataProcessOne()
+void MapImpl::resourcesGeodataProcess(const GeodataJob &job)
 {
-    std::weak_ptr<GeodataTile> w;
-    if (!resources.queGeodata.tryPop(w))
-        return false;
-    std::shared_ptr<GeodataTile> r = w.lock();
+    std::shared_ptr<GeodataTile> r = job.tile.lock();
     if (!r)
-        return resourcesGeodataProcessOne();
+        return;
+    ScopedTimer timer(timings.geodata);
     try
     {
-        r->decode();
+        if (!r->process(job))
+            return; // other shards of the tile are not done yet
         r->state = Resource::State::decoded;
         resources.queUpload.push(UploadData(r));
     }
     catch (const std::exception &)
     {
-        statistics.resourcesFailed++;
+        counters.resourcesFailed++;
         r->state = Resource::State::errorFatal;
     }
+}
+
+void MapImpl::resourcesGeodataProcessorEntry(uint32 index)
+{
+    std::string threadName = std::string() + "geodata "
+        + std::to_string(index);
+    OPTICK_THREAD(threadName.c_str());
+    setLogThreadName(threadName);
+    while (!resources.queGeodata.stopped())
+    {
+        GeodataJob job;
+        resources.queGeodata.waitPop(job);
+        resourcesGeodataProcess(job);
+    }
+}
+
+bool MapImpl::resourcesGeodataProcessOne()
+{
+    GeodataJob job;
+    if (!resources.queGeodata.tryPop(job))
+        return false;
+    if (job.tile.expired())
+        return resourcesGeodataProcessOne();
+    resourcesGeodataProcess(job);
     return true;
 }
 
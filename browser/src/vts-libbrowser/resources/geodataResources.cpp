@@ -29,6 +29,8 @@
 #include "../renderTasks.hpp"
 #include "../map.hpp"
 #include "../gpuResource.hpp"
+#include "../geodataStyle.hpp"
+#include "../geodataFeatures.hpp"
 #include "../utilities/json.hpp"
 
 #include <dbglog/dbglog.hpp>
@@ -43,7 +45,7 @@ GeodataFeatures::GeodataFeatures(vts::MapImpl *map, const std::string &name) :
 void GeodataFeatures::decode()
 {
     LOG(info2) << "Decoding geodata features <" << name << ">";
-    data = std::make_shared<const std::string>(fetch->reply.content.str());
+    std::string content = fetch->reply.content.str();
 
 #ifndef __EMSCRIPTEN__
     if (map->options.debugExtractRawResources)
@@ -56,10 +58,22 @@ void GeodataFeatures::decode()
         if (!boost::filesystem::exists(path))
         {
             boost::filesystem::create_directories(prefix + b);
-            writeLocalFileBuffer(path, Buffer(*data));
+            writeLocalFileBuffer(path, Buffer(content));
         }
     }
 #endif
+
+    // the json is parsed only once here
+    //   and all restyling uses the binary encoding
+    if (isGeodataFeaturesBinary(content))
+        data = std::make_shared<const std::string>(std::move(content));
+    else
+    {
+        data = std::make_shared<const std::string>(
+            convertGeodataFeaturesToBinary(content,
+                map->options.debugValidateGeodataStyles));
+    }
+    info.ramMemoryCost += sizeof(*this) + data->size();
 }
 
 FetchTask::ResourceType GeodataFeatures::resourceType() const
@@ -177,6 +191,7 @@ Validity GeodataStylesheet::dependencies()
         try
         {
             json = std::make_shared<const Json::Value>(stringToJson(data));
+            compiled = std::make_shared<const GeodataStyleCompiled>(*json);
             auto &s = *json;
             for (const auto &n : s["fonts"].getMemberNames())
             {
@@ -279,8 +294,10 @@ void GeodataTile::update(
             aabbPhys[1] = ab[1];
             tileId = tid;
             state = Resource::State::downloaded;
-            map->resources.queGeodata.push(
-                std::dynamic_pointer_cast<GeodataTile>(shared_from_this()));
+            GeodataJob job;
+            job.tile = std::dynamic_pointer_cast<GeodataTile>(
+                shared_from_this());
+            map->resources.queGeodata.push(std::move(job));
             return;
         }
         break;
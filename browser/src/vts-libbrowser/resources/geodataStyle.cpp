@@ -0,0 +1,791 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../geodataStyle.hpp"
+
+namespace vts
+{
+
+using Json::Value;
+typedef GeodataStyleCompiled::Expr Expr;
+typedef GeodataStyleCompiled::Op Op;
+typedef GeodataStyleCompiled::Layer Layer;
+typedef GeodataStyleCompiled::Property Property;
+typedef GeodataStyleCompiled::Identifier Identifier;
+
+namespace
+{
+
+const std::map<std::string, Op> &functionOps()
+{
+    static const std::map<std::string, Op> ops = {
+        { "sgn", Op::Sgn },
+        { "sin", Op::Sin },
+        { "cos", Op::Cos },
+        { "tan", Op::Tan },
+        { "asin", Op::Asin },
+        { "acos", Op::Acos },
+        { "atan", Op::Atan },
+        { "sqrt", Op::Sqrt },
+        { "abs", Op::Abs },
+        { "deg2rad", Op::Deg2rad },
+        { "rad2deg", Op::Rad2deg },
+        { "log", Op::Log },
+        { "round", Op::Round },
+        { "add", Op::Add },
+        { "sub", Op::Sub },
+        { "mul", Op::Mul },
+        { "div", Op::Div },
+        { "pow", Op::Pow },
+        { "atan2", Op::Atan2 },
+        { "mod", Op::Mod },
+        { "random", Op::Random },
+        { "clamp", Op::Clamp },
+        { "min", Op::Min },
+        { "max", Op::Max },
+        { "if", Op::If },
+        { "strlen", Op::Strlen },
+        { "str2num", Op::Str2num },
+        { "lowercase", Op::Lowercase },
+        { "uppercase", Op::Uppercase },
+        { "capitalize", Op::Capitalize },
+        { "trim", Op::Trim },
+        { "find", Op::Find },
+        { "replace", Op::Replace },
+        { "substr", Op::Substr },
+        { "has-latin", Op::HasLatin },
+        { "is-cjk", Op::IsCjk },
+        { "map", Op::Map },
+        { "discrete", Op::Discrete },
+        { "discrete2", Op::Discrete2 },
+        { "linear", Op::Linear },
+        { "linear2", Op::Linear2 },
+        { "lod-scaled", Op::LodScaled },
+        { "logScale", Op::LogScale },
+        { "log-scale", Op::LogScale },
+    };
+    return ops;
+}
+
+const char *propertyNames[] = {
+#define X(NAME, STR) STR,
+    VTS_GEODATA_STYLE_PROPERTIES(X)
+#undef X
+};
+
+bool isLayerStyleRequested(const Value &v)
+{
+    if (v.isNull())
+        return false;
+    if (v.isConvertibleTo(Json::ValueType::booleanValue))
+        return v.asBool();
+    return true;
+}
+
+Value resolveInheritance(const Value &layers, const Value &orig)
+{
+    if (!orig["inherit"])
+        return orig;
+
+    Value base = resolveInheritance(layers,
+        layers[orig["inherit"].asString()]);
+
+    for (auto n : orig.getMemberNames())
+        base[n] = orig[n];
+
+    base.removeMember("inherit");
+
+    return base;
+}
+
+} // namespace
+
+class GeodataStyleCompiler
+{
+public:
+    GeodataStyleCompiler(const GeodataStyleCompiled *style,
+        std::deque<Expr> &nodes,
+        std::map<std::string, uint32> *internVariables)
+        : style(style), nodes(nodes), internVariables(internVariables)
+    {}
+
+    const Expr *expression(const Value &e)
+    {
+        try
+        {
+            return expressionInternal(e);
+        }
+        catch (const std::exception &ex)
+        {
+            return invalid(&e, ex.what());
+        }
+    }
+
+    const Expr *filter(const Value &e)
+    {
+        try
+        {
+            return filterInternal(e);
+        }
+        catch (const std::exception &ex)
+        {
+            return invalid(&e, ex.what());
+        }
+    }
+
+    const Expr *string(const std::string &s, const Value *source)
+    {
+        try
+        {
+            return stringInternal(s, source);
+        }
+        catch (const std::exception &ex)
+        {
+            return invalid(source, ex.what());
+        }
+    }
+
+    // solves @constants, $properties, &variables and #identifiers
+    const Expr *replacement(const std::string &name, const Value *source)
+    {
+        if (name.empty())
+            return literal(Value(), source);
+        switch (name[0])
+        {
+        case '@': // constant
+        {
+            auto it = style->constantIds.find(name);
+            if (it == style->constantIds.end())
+                return literal(Value(), source);
+            Expr &e = node(Op::Constant, source);
+            e.index = it->second;
+            e.name = name;
+            return &e;
+        }
+        case '$': // property
+        {
+            Expr &e = node(Op::Property, source);
+            e.name = name.substr(1);
+            return &e;
+        }
+        case '&': // ampersand variable
+        {
+            uint32 id = 0;
+            if (!variableId(name, id))
+            {
+                Expr &e = node(Op::VariableDynamic, source);
+                e.name = name;
+                return &e;
+            }
+            Expr &e = node(Op::Variable, source);
+            e.index = id;
+            e.name = name;
+            return &e;
+        }
+        case '#': // identifier
+        {
+            Expr &e = node(Op::Identifier, source);
+            e.index = (uint32)GeodataStyleCompiled::findIdentifier(name);
+            e.name = name;
+            return &e;
+        }
+        default:
+            return literal(name, source);
+        }
+    }
+
+    bool variableId(const std::string &name, uint32 &id)
+    {
+        if (!internVariables)
+        {
+            auto it = style->variableIds.find(name);
+            if (it == style->variableIds.end())
+                return false;
+            id = it->second;
+            return true;
+        }
+        auto it = internVariables->find(name);
+        if (it != internVariables->end())
+        {
+            id = it->second;
+            return true;
+        }
+        id = internVariables->size();
+        (*internVariables)[name] = id;
+        return true;
+    }
+
+private:
+    Expr &node(Op op, const Value *source)
+    {
+        nodes.emplace_back();
+        Expr &e = nodes.back();
+        e.op = op;
+        e.source = source;
+        return e;
+    }
+
+    const Expr *literal(const Value &v, const Value *source)
+    {
+        Expr &e = node(Op::Literal, source);
+        e.value = v;
+        return &e;
+    }
+
+    const Expr *invalid(const Value *source, const std::string &message)
+    {
+        Expr &e = node(Op::Invalid, source);
+        e.error = message;
+        return &e;
+    }
+
+    // keeps a value, that is not part of the stylesheet, alive
+    const Value &hold(const Value &v)
+    {
+        return node(Op::Literal, nullptr).value = v;
+    }
+
+    static bool validLength(const Value &value, uint32 minimum, uint32 maximum)
+    {
+        return value.isArray() && value.size() >= minimum
+            && value.size() <= maximum;
+    }
+
+    void arrayArgs(Expr &e, const Value &arr,
+        uint32 minimum, uint32 maximum, const std::string &message)
+    {
+        if (!validLength(arr, minimum, maximum))
+            e.error = message;
+        if (arr.isArray())
+            for (const Value &a : arr)
+                e.args.push_back(expression(a));
+    }
+
+    const Expr *expressionInternal(const Value &e)
+    {
+        if (e.isArray())
+        {
+            Expr &r = node(Op::Array, &e);
+            bool allLiterals = true;
+            for (const Value &a : e)
+            {
+                const Expr *c = expression(a);
+                allLiterals = allLiterals && c->op == Op::Literal
+                    && c->error.empty();
+                r.args.push_back(c);
+            }
+            if (allLiterals)
+            {
+                // fold into single value
+                r.op = Op::Literal;
+                r.value = Value(Json::arrayValue);
+                for (const Expr *c : r.args)
+                    r.value.append(c->value);
+                r.args.clear();
+            }
+            return &r;
+        }
+        if (e.isObject())
+            return function(e);
+        if (e.isString())
+            return string(e.asString(), &e);
+        return literal(e, &e);
+    }
+
+    const Expr *function(const Value &expression)
+    {
+        static const std::string sizeError
+            = "Function must have exactly one member";
+        if (expression.size() == 0)
+            return invalid(&expression, sizeError);
+        const std::string fnc = expression.getMemberNames()[0];
+        const Value &p = expression[fnc];
+        const auto &ops = functionOps();
+        auto it = ops.find(fnc);
+        if (it == ops.end())
+        {
+            Expr &e = node(Op::UnknownFunction, &expression);
+            e.value = expression;
+            e.error = expression.size() != 1 ? sizeError
+                : "Unknown function <" + fnc + ">";
+            return &e;
+        }
+
+        Expr &e = node(it->second, &expression);
+        switch (e.op)
+        {
+        case Op::Add:
+        case Op::Sub:
+        case Op::Mul:
+        case Op::Div:
+        case Op::Pow:
+        case Op::Atan2:
+        case Op::Mod:
+        case Op::Random:
+            arrayArgs(e, p, 2, 2, "Function '" + fnc
+                + "' is expecting an array with 2 elements.");
+            break;
+        case Op::Clamp:
+            arrayArgs(e, p, 3, 3, "Function 'clamp' must have 3 values");
+            break;
+        case Op::Min:
+        case Op::Max:
+            arrayArgs(e, p, 1, -1, "Function '" + fnc
+                + "' expects an array");
+            break;
+        case Op::If:
+            if (!validLength(p, 3, 3))
+                e.error = "Function 'if' must have 3 values";
+            e.args.push_back(filter(p[0]));
+            e.args.push_back(this->expression(p[1]));
+            e.args.push_back(this->expression(p[2]));
+            break;
+        case Op::Find:
+            arrayArgs(e, p, 2, 3, "Function 'find' must have 2 or 3 values");
+            break;
+        case Op::Replace:
+            arrayArgs(e, p, 3, 3, "Function 'replace' must have 3 values");
+            break;
+        case Op::Substr:
+            arrayArgs(e, p, 2, 3,
+                "Function 'substr' must have 2 or 3 values");
+            break;
+        case Op::Map:
+            // { "map" : [inputValue, [[key, value], ...], defaultValue] }
+            arrayArgs(e, p, 3, 3, "Function 'map' must have 3 values");
+            break;
+        case Op::Discrete2:
+        case Op::Linear2:
+            e.args.push_back(this->expression(p[0]));
+            e.args.push_back(this->expression(p[1]));
+            break;
+        default:
+            e.args.push_back(this->expression(p));
+            break;
+        }
+        if (expression.size() != 1)
+            e.error = sizeError;
+        return &e;
+    }
+
+    const Expr *stringInternal(const std::string &s, const Value *source)
+    {
+        // find '{'
+        std::size_t start = s.find("{");
+        if (start == s.npos)
+        {
+            const Expr *r = replacement(s, source);
+            // find '}'
+            if (s.find("}") != s.npos)
+                const_cast<Expr *>(r)->error
+                    = "Unmatched <}> in <" + s + ">";
+            return r;
+        }
+
+        // the expansions are concatenated and the result
+        //   is evaluated again (it may form eg. a property name)
+        Expr &e = node(Op::Template, source);
+        e.value = Value(Json::arrayValue);
+        std::size_t pos = 0;
+        while (start != s.npos)
+        {
+            size_t l = s.length();
+            uint32 cnt = 1;
+            std::size_t end = start;
+            while (cnt > 0 && end + 1 < l)
+            {
+                end++;
+                switch (s[end])
+                {
+                case '{': cnt++; break;
+                case '}': cnt--; break;
+                default: break;
+                }
+            }
+            if (cnt > 0)
+                return invalid(source, "Missing '}' in <" + s + ">");
+            if (end == start + 1)
+                return invalid(source, "Invalid '{}' in <" + s + ">");
+            std::string subs = s.substr(start + 1, end - start - 1);
+            e.value.append(s.substr(pos, start - pos));
+            if (subs[0] == '{')
+            {
+                Value v;
+                try
+                {
+                    v = stringToJson(subs);
+                }
+                catch (std::exception &ex)
+                {
+                    return invalid(source, "Invalid json <" + subs
+                        + ">, message <" + ex.what() + ">");
+                }
+                e.args.push_back(expression(hold(v)));
+            }
+            else
+                e.args.push_back(string(subs, nullptr));
+            pos = end + 1;
+            start = s.find("{", pos);
+        }
+        e.value.append(s.substr(pos));
+        return &e;
+    }
+
+    // some stylesheets contain an invalid aggregate filter
+    //   in which the tests are all enclosed in additional array
+    // this function tries to detect such cases and workaround it
+    // example:
+    //   invalid filter: ["all", [["has", "$foo"], ["has", "$bar"]]]
+    //   correct filter: ["all", ["has", "$foo"], ["has", "$bar"]]
+    static const Value &aggregateFilterData(const Value &expression,
+        uint32 &start)
+    {
+        if (expression.size() == 2
+            && expression[1].isArray()
+            && expression[1][0].isArray())
+        {
+            start = 0;
+            return expression[1];
+        }
+        else
+        {
+            start = 1;
+            return expression;
+        }
+    }
+
+    const Expr *filterInternal(const Value &expression)
+    {
+        if (!expression.isArray())
+        {
+            Expr &e = node(Op::FilterInvalid, &expression);
+            e.error = "Filter must be array.";
+            return &e;
+        }
+
+        const std::string cond = expression[0].asString();
+
+        static const std::map<std::string, Op> comparisons = {
+            { "==", Op::FilterEqual },
+            { "!=", Op::FilterNotEqual },
+            { ">=", Op::FilterGreaterEqual },
+            { "<=", Op::FilterLessEqual },
+            { ">", Op::FilterGreater },
+            { "<", Op::FilterLess },
+        };
+
+        if (cond == "skip")
+        {
+            Expr &e = node(Op::FilterSkip, &expression);
+            if (!validLength(expression, 1, 1))
+                e.error = "Invalid filter 'skip' array length.";
+            return &e;
+        }
+
+        // comparison filters
+        {
+            auto it = comparisons.find(cond);
+            if (it != comparisons.end())
+            {
+                Expr &e = node(it->second, &expression);
+                if (!validLength(expression, 3, 3))
+                    e.error = "Invalid filter '" + cond + "' array length.";
+                e.args.push_back(this->expression(expression[1]));
+                e.args.push_back(this->expression(expression[2]));
+                return &e;
+            }
+        }
+
+        // negative filters
+        if (!cond.empty() && cond[0] == '!')
+        {
+            Value v(expression);
+            v[0] = cond.substr(1);
+            Expr &e = node(Op::FilterNot, &expression);
+            e.args.push_back(filter(hold(v)));
+            return &e;
+        }
+
+        // has filters
+        if (cond == "has")
+        {
+            Expr &e = node(Op::FilterHas, &expression);
+            if (!validLength(expression, 2, -1))
+                e.error = "Invalid filter 'has' array length.";
+            e.args.push_back(replacement(expression[1].asString(),
+                &expression[1]));
+            return &e;
+        }
+
+        // in filters
+        if (cond == "in")
+        {
+            Expr &e = node(Op::FilterIn, &expression);
+            if (!validLength(expression, 2, -1))
+                e.error = "Invalid filter 'in' array length.";
+            for (uint32 i = 1, e2 = expression.size(); i < e2; i++)
+                e.args.push_back(this->expression(expression[i]));
+            return &e;
+        }
+
+        // aggregate filters
+        if (cond == "all" || cond == "any" || cond == "none")
+        {
+            Expr &e = node(cond == "all" ? Op::FilterAll
+                : cond == "any" ? Op::FilterAny : Op::FilterNone,
+                &expression);
+            uint32 start;
+            const Value &v = aggregateFilterData(expression, start);
+            for (uint32 i = start, e2 = v.size(); i < e2; i++)
+                e.args.push_back(filter(v[i]));
+            return &e;
+        }
+
+        // unknown filter
+        Expr &e = node(Op::FilterUnknown, &expression);
+        e.error = "Unknown filter condition type.";
+        return &e;
+    }
+
+    const GeodataStyleCompiled *const style;
+    std::deque<Expr> &nodes;
+    std::map<std::string, uint32> *const internVariables;
+};
+
+GeodataStyleCompiled::GeodataStyleCompiled(const Value &style)
+    : constantsSource(style["constants"])
+{
+    GeodataStyleCompiler compiler(this, nodes, &variableIds);
+
+    // constants
+    //   all names are known before compiling any of them
+    for (const std::string &n : constantsSource.getMemberNames())
+    {
+        uint32 id = constantIds.size();
+        constantIds[n] = id;
+    }
+    constants.resize(constantIds.size());
+    for (const auto &it : constantIds)
+        constants[it.second] = compiler.expression(constantsSource[it.first]);
+
+    // layers with resolved inheritance
+    const Value &ls = style["layers"];
+    for (const std::string &n : ls.getMemberNames())
+    {
+        layers.emplace_back();
+        Layer &l = layers.back();
+        l.name = n;
+        l.source = resolveInheritance(ls, ls[n]);
+        layersByName[n] = &l;
+    }
+    for (Layer &l : layers)
+        compileLayer(l, true);
+
+    // defines which style layers are candidates for a specific feature type
+    for (const auto &it : layersByName)
+    {
+        const Value &layer = it.second->source;
+        if (layer.isMember("filter") && layer["filter"].isArray()
+            && layer["filter"][0] == "skip")
+            continue;
+        if (layer.isMember("visibility-switch"))
+        {
+            for (auto &t : typedLayers)
+                t.push_back(it.second);
+            continue;
+        }
+        bool point = isLayerStyleRequested(layer["point"]);
+        bool line = isLayerStyleRequested(layer["line"]);
+        bool icon = isLayerStyleRequested(layer["icon"]);
+        bool labelScreen = isLayerStyleRequested(layer["label"]);
+        bool labelFlat = isLayerStyleRequested(layer["line-label"]);
+        bool polygon = isLayerStyleRequested(layer["polygon"]);
+        if (point || icon || labelScreen)
+            typedLayers[0].push_back(it.second);
+        if (line || labelFlat) // todo enable degrading line features to point layers
+            typedLayers[1].push_back(it.second);
+        if (polygon) // todo enable degrading polygon features to all layer types
+            typedLayers[2].push_back(it.second);
+    }
+}
+
+void GeodataStyleCompiled::compileLayer(Layer &layer, bool intern) const
+{
+    GeodataStyleCompiler compiler(this, nodes,
+        intern ? &const_cast<GeodataStyleCompiled *>(this)->variableIds
+        : nullptr);
+    const Value &s = layer.source;
+
+    for (uint32 i = 0; i < (uint32)Property::Count_; i++)
+    {
+        if (s.isMember(propertyNames[i]))
+            layer.properties[i] = compiler.expression(s[propertyNames[i]]);
+    }
+
+    if (s.isMember("filter"))
+        layer.filter = compiler.filter(s["filter"]);
+
+    for (const std::string &n : s.getMemberNames())
+    {
+        if (n.empty() || n[0] != '&')
+            continue;
+        uint32 id = 0;
+        if (!compiler.variableId(n, id))
+            continue; // evaluated as dynamic variable
+        if (layer.variables.size() <= id)
+            layer.variables.resize(id + 1);
+        layer.variables[id] = compiler.expression(s[n]);
+    }
+
+    // next-pass
+    const Value &np = s["next-pass"];
+    if (!np.empty())
+    {
+        layer.hasNextPass = true;
+        try
+        {
+            layer.nextPassName = np[1].asString();
+            layer.nextPassZ = np[0].asInt();
+        }
+        catch (const std::exception &e)
+        {
+            layer.nextPassError = e.what();
+        }
+        layer.nextPass = findLayer(layer.nextPassName);
+    }
+
+    // visibility-switch
+    if (s.isMember("visibility-switch"))
+    {
+        layer.hasSwitch = true;
+        const Value &vss = s["visibility-switch"];
+        if (vss.isArray())
+        {
+            for (const Value &vs : vss)
+            {
+                layer.switches.emplace_back();
+                auto &sw = layer.switches.back();
+                if (!vs.isArray())
+                    continue;
+                sw.visibility = compiler.expression(vs[0]);
+                if (!vs[1].empty())
+                    sw.layerName = compiler.expression(vs[1]);
+            }
+        }
+    }
+}
+
+const Layer *GeodataStyleCompiled::findLayer(const std::string &name) const
+{
+    auto it = layersByName.find(name);
+    if (it == layersByName.end())
+        return nullptr;
+    return it->second;
+}
+
+const Layer *GeodataStyleCompiled::mergedLayer(const Layer &base,
+    const Switch &sw, const std::string &name) const
+{
+    // the layer name is known in advance in most stylesheets
+    const bool fixed = sw.layerName->op == Op::Literal;
+    if (fixed)
+    {
+        const Layer *m = sw.merged.load(std::memory_order_acquire);
+        if (m)
+            return m;
+    }
+
+    std::lock_guard<std::mutex> lock(mergedMutex);
+    if (fixed)
+    {
+        const Layer *m = sw.merged.load(std::memory_order_relaxed);
+        if (m)
+            return m;
+    }
+    else
+    {
+        auto it = mergedDynamic.find({ &base, name });
+        if (it != mergedDynamic.end())
+            return it->second;
+    }
+
+    layers.emplace_back();
+    Layer &l = layers.back();
+    l.name = base.name;
+    l.source = base.source;
+    l.source.removeMember("filter");
+    l.source.removeMember("visible");
+    l.source.removeMember("next-pass");
+    l.source.removeMember("visibility-switch");
+    if (const Layer *t = findLayer(name))
+    {
+        for (auto n : t->source.getMemberNames())
+            l.source[n] = t->source[n];
+    }
+    l.source["filter"] = base.source["filter"];
+    compileLayer(l, false);
+
+    if (fixed)
+        sw.merged.store(&l, std::memory_order_release);
+    else
+        mergedDynamic[{ &base, name }] = &l;
+    return &l;
+}
+
+Identifier GeodataStyleCompiled::findIdentifier(const std::string &name)
+{
+    static const std::map<std::string, Identifier> ids = {
+        { "#id", Identifier::Id },
+        { "#group", Identifier::Group },
+        { "#type", Identifier::Type },
+        { "#metric", Identifier::Metric },
+        { "#language", Identifier::Language },
+        { "#lod", Identifier::Lod },
+        { "#ix", Identifier::Ix },
+        { "#iy", Identifier::Iy },
+        { "#tileSize", Identifier::TileSize },
+    };
+    auto it = ids.find(name);
+    if (it == ids.end())
+        return Identifier::Invalid;
+    return it->second;
+}
+
+const Expr *GeodataStyleCompiled::compileExpression(std::deque<Expr> &nodes,
+    const Value &expression) const
+{
+    GeodataStyleCompiler compiler(this, nodes, nullptr);
+    return compiler.expression(expression);
+}
+
+const Expr *GeodataStyleCompiled::compileString(std::deque<Expr> &nodes,
+    const std::string &s) const
+{
+    GeodataStyleCompiler compiler(this, nodes, nullptr);
+    return compiler.string(s, nullptr);
+}
+
+} // namespace vts
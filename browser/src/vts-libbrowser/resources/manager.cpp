@@ -27,6 +27,7 @@
 #include "../include/vts-browser/log.hpp"
 
 #include "../fetchTask.hpp"
+#include "../gpuResource.hpp"
 #include "../map.hpp"
 #include "../authConfig.hpp"
 #include "../utilities/dataUrl.hpp"
@@ -122,6 +123,95 @@ void UploadData::process()
         r->map->resourceUploadProcess(r);
 }
 
+bool UploadData::priority(float &p) const
+{
+    if (destroyData)
+    {
+        // release gpu memory as soon as possible
+        p = std::numeric_limits<float>::infinity();
+        return true;
+    }
+    return ResourcePriority()(uploadData, p);
+}
+
+bool ResourcePriority::operator () (const std::weak_ptr<Resource> &w,
+    float &p) const
+{
+    std::shared_ptr<Resource> r = w.lock();
+    if (!r)
+        return false;
+    p = r->priority;
+    if (std::isnan(p))
+        p = 0;
+    return true;
+}
+
+bool ResourcePriority::operator () (const UploadData &u, float &p) const
+{
+    return u.priority(p);
+}
+
+////////////////////////////
+// ANY THREAD
+////////////////////////////
+
+namespace
+{
+
+bool needsAttention(Resource::State state)
+{
+    switch (state)
+    {
+    case Resource::State::initializing:
+    case Resource::State::checkCache:
+    case Resource::State::startDownload:
+    case Resource::State::errorFatal:
+    case Resource::State::errorRetry:
+    case Resource::State::availFail:
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+void MapImpl::resourcesStateChanged(Resource *r,
+    Resource::State previous, Resource::State current)
+{
+    resources.states[(uint32)previous]--;
+    resources.states[(uint32)current]++;
+
+    // the memory costs are updated before the state changes
+    resources.memRamUse += r->info.ramMemoryCost;
+    resources.memRamUse -= r->accountedRamMemoryCost;
+    resources.memGpuUse += r->info.gpuMemoryCost;
+    resources.memGpuUse -= r->accountedGpuMemoryCost;
+    bool lruChange = (r->accountedRamMemoryCost > 0)
+        != (r->info.ramMemoryCost > 0)
+        || (r->accountedGpuMemoryCost > 0)
+        != (r->info.gpuMemoryCost > 0);
+    r->accountedRamMemoryCost = r->info.ramMemoryCost;
+    r->accountedGpuMemoryCost = r->info.gpuMemoryCost;
+
+    bool attention = needsAttention(current) && !needsAttention(previous);
+    if (attention || lruChange)
+    {
+        std::lock_guard<std::mutex> lock(resources.attentionMut);
+        if (attention)
+            resources.attentionIncoming.push_back(r->shared_from_this());
+        if (lruChange)
+            resources.lruIncoming.push_back(r->shared_from_this());
+    }
+}
+
+void MapImpl::resourcesUntrack(Resource *r)
+{
+    resources.states[(uint32)(Resource::State)r->state]--;
+    resources.memRamUse -= r->accountedRamMemoryCost;
+    resources.memGpuUse -= r->accountedGpuMemoryCost;
+}
+
 ////////////////////////////
 // A FETCH THREAD
 ////////////////////////////
@@ -241,9 +331,10 @@ void MapImpl::resourceDecodeProcess(const std::shared_ptr<Resource> &r)
 {
     OPTICK_EVENT();
     OPTICK_TAG("name", r->name.c_str());
+    ScopedTimer timer(timings.decode);
 
     assert(r->state == Resource::State::downloaded);
-    statistics.resourcesDecoded++;
+    counters.resourcesDecoded++;
     r->info.gpuMemoryCost = r->info.ramMemoryCost = 0;
     try
     {
@@ -261,16 +352,19 @@ void MapImpl::resourceDecodeProcess(const std::shared_ptr<Resource> &r)
         LOG(err3) << "Failed decoding resource <" << r->name
             << ">, exception <" << e.what() << ">";
         resourceSaveCorruptedFile(r);
-        statistics.resourcesFailed++;
+        counters.resourcesFailed++;
         r->state = Resource::State::errorFatal;
     }
     r->fetch.reset();
 }
 
-void MapImpl::resourcesDecodeProcessorEntry()
+void MapImpl::resourcesDecodeProcessorEntry(uint32 index)
 {
-    OPTICK_THREAD("decode");
-    setLogThreadName("decode");
+    std::string threadName = std::string() + "decode "
+        + std::to_string(index);
+    OPTICK_THREAD(threadName.c_str());
+    setLogThreadName(threadName);
+    std::atomic<uint64> &busyTime = resources.decodersBusyTime[index];
     while (!resources.queDecode.stopped())
     {
         std::weak_ptr<Resource> w;
@@ -278,7 +372,20 @@ void MapImpl::resourcesDecodeProcessorEntry()
         std::shared_ptr<Resource> r = w.lock();
         if (!r)
             continue;
-        resourceDecodeProcess(r);
+        // the resource may have been queued more than once
+        //   (eg. forced redownload), the stale items are dropped,
+        //   a new download queues the resource again
+        if (r->decoding.exchange(true))
+            continue;
+        if (r->state == Resource::State::downloaded)
+        {
+            auto start = std::chrono::steady_clock::now();
+            resourceDecodeProcess(r);
+            busyTime += std::chrono::duration_cast<
+                std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        }
+        r->decoding = false;
     }
 }
 
@@ -290,7 +397,12 @@ bool MapImpl::resourcesDecodeProcessOne()
     std::shared_ptr<Resource> r = w.lock();
     if (!r)
         return resourcesDecodeProcessOne();
-    resourceDecodeProcess(r);
+    // same as in the decoder threads, stale items are dropped
+    if (r->decoding.exchange(true))
+        return true;
+    if (r->state == Resource::State::downloaded)
+        resourceDecodeProcess(r);
+    r->decoding = false;
     return true;
 }
 
@@ -302,25 +414,104 @@ void MapImpl::resourceUploadProcess(const std::shared_ptr<Resource> &r)
 {
     OPTICK_EVENT();
     OPTICK_TAG("name", r->name.c_str());
+    ScopedTimer timer(timings.upload);
 
     assert(r->state == Resource::State::decoded);
-    statistics.resourcesUploaded++;
+    counters.resourcesUploaded++;
+    auto &batch = resources.uploadBatch;
+    const std::size_t texturesBefore = batch.textures.size();
+    const std::size_t meshesBefore = batch.meshes.size();
     try
     {
         r->upload();
+        if (batch.textures.size() != texturesBefore
+            || batch.meshes.size() != meshesBefore)
+        {
+            // finished in resourcesUploadFlush
+            if (batch.resources.empty())
+                batch.started = std::chrono::steady_clock::now();
+            for (std::size_t i = texturesBefore;
+                i < batch.textures.size(); i++)
+                batch.bytes += batch.textures[i].spec->buffer.size();
+            for (std::size_t i = meshesBefore; i < batch.meshes.size(); i++)
+                batch.bytes += batch.meshes[i].spec->vertices.size()
+                    + batch.meshes[i].spec->indices.size();
+            batch.resources.push_back(r);
+            if (resourcesUploadBatchFull())
+                resourcesUploadFlush();
+            return;
+        }
+        r->uploadDone();
         r->state = Resource::State::ready;
     }
     catch (const std::exception &e)
     {
         LOG(err3) << "Failed uploading resource <" << r->name
             << ">, exception <" << e.what() << ">";
+        batch.textures.resize(texturesBefore);
+        batch.meshes.resize(meshesBefore);
         resourceSaveCorruptedFile(r);
-        statistics.resourcesFailed++;
+        counters.resourcesFailed++;
         r->state = Resource::State::errorFatal;
     }
     r->decodeData.reset();
 }
 
+void MapImpl::resourcesUploadFlush()
+{
+    auto &batch = resources.uploadBatch;
+    if (batch.resources.empty())
+        return;
+    OPTICK_EVENT();
+    ScopedTimer timer(timings.uploadFlush);
+    bool ok = true;
+    try
+    {
+        if (!batch.textures.empty())
+            callbacks.loadTextures(batch.textures);
+        if (!batch.meshes.empty())
+            callbacks.loadMeshes(batch.meshes);
+    }
+    catch (const std::exception &e)
+    {
+        LOG(err3) << "Failed uploading batch of <" << batch.resources.size()
+            << "> resources, exception <" << e.what() << ">";
+        ok = false;
+    }
+    for (const auto &r : batch.resources)
+    {
+        if (ok)
+        {
+            r->uploadDone();
+            r->state = Resource::State::ready;
+        }
+        else
+        {
+            counters.resourcesFailed++;
+            r->state = Resource::State::errorFatal;
+        }
+        r->decodeData.reset();
+    }
+    batch.textures.clear();
+    batch.meshes.clear();
+    batch.resources.clear();
+    batch.bytes = 0;
+}
+
+bool MapImpl::resourcesUploadBatchFull() const
+{
+    const auto &batch = resources.uploadBatch;
+    if (batch.resources.empty())
+        return false;
+    if (batch.resources.size() >= options.maxUploadBatchResources)
+        return true;
+    if (batch.bytes >= options.maxUploadBatchSizeKB * uint64(1024))
+        return true;
+    double age = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - batch.started).count();
+    return age >= options.maxUploadBatchDelay;
+}
+
 bool MapImpl::resourcesUploadProcessOne()
 {
     UploadData w;
@@ -340,13 +531,21 @@ void MapImpl::resourcesUploadProcessorEntry()
             UploadData w;
             resources.queUpload.waitPop(w);
             w.process();
+            if (resources.queUpload.estimateSize() == 0
+                || resourcesUploadBatchFull())
+                resourcesUploadFlush();
         }
     }
     else
     {
         while (!resources.queUpload.stopped())
         {
-            while (resourcesDataUpdateOne());
+            while (resourcesDataUpdateOne())
+            {
+                if (resourcesUploadBatchFull())
+                    resourcesUploadFlush();
+            }
+            resourcesUploadFlush();
             using namespace std::chrono_literals;
             std::this_thread::sleep_for(0.01s);
         }
@@ -376,6 +575,7 @@ void MapImpl::resourcesDataUpdate()
             processed += p;
         }
     }
+    resourcesUploadFlush();
 }
 
 uint32 MapImpl::resourcesDataUpdateOne()
@@ -394,6 +594,9 @@ uint32 MapImpl::resourcesDataUpdateOne()
 
 void MapImpl::resourcesDataFinalize()
 {
+    resources.uploadBatch.textures.clear();
+    resources.uploadBatch.meshes.clear();
+    resources.uploadBatch.resources.clear();
     resources.queUpload.purge();
 }
 
@@ -410,7 +613,10 @@ void MapImpl::cacheWriteEntry()
         CacheData cwd;
         resources.queCacheWrite.waitPop(cwd);
         if (!cwd.name.empty())
+        {
+            ScopedTimer timer(timings.cacheWrite);
             cacheWrite(std::move(cwd));
+        }
     }
 }
 
@@ -436,7 +642,7 @@ void MapImpl::cacheReadEntry()
             }
             catch (const std::exception &e)
             {
-                statistics.resourcesFailed++;
+                counters.resourcesFailed++;
                 r->state = Resource::State::errorFatal;
                 LOG(err3) << "Failed preparing resource <" << r->name
                     << ">, exception <" << e.what() << ">";
@@ -460,13 +666,26 @@ bool startsWith(const std::string &text, const std::string &start)
 void MapImpl::cacheReadProcess(const std::shared_ptr<Resource> &r)
 {
     OPTICK_EVENT();
+    ScopedTimer timer(timings.cacheRead);
     assert(r->state == Resource::State::checkCache);
     if (!r->fetch)
         r->fetch = std::make_shared<FetchTaskImpl>(r);
     r->info.gpuMemoryCost = r->info.ramMemoryCost = 0;
     CacheData cd;
-    if (r->allowDiskCache() && (cd = cacheRead(
-        r->name)).name == r->name)
+    std::shared_ptr<GpuTexture> texture;
+    std::string transcoded; // prefer already transcoded textures
+    if (r->resourceType() == FetchTask::ResourceType::Texture)
+    {
+        texture = std::static_pointer_cast<GpuTexture>(r);
+        transcoded = texture->transcodedName();
+        texture->fromTranscodedCache = false;
+    }
+    bool isTranscoded = r->allowDiskCache() && !transcoded.empty()
+        && (cd = cacheRead(transcoded)).name == transcoded;
+    if (isTranscoded)
+        texture->fromTranscodedCache = true;
+    if (isTranscoded || (r->allowDiskCache()
+        && (cd = cacheRead(r->name)).name == r->name))
     {
         r->fetch->reply.expires = cd.expires;
         r->fetch->reply.content = std::move(cd.buffer);
@@ -475,7 +694,7 @@ void MapImpl::cacheReadProcess(const std::shared_ptr<Resource> &r)
             r->state = Resource::State::availFail;
         else
             r->state = Resource::State::downloaded;
-        statistics.resourcesDiskLoaded++;
+        counters.resourcesDiskLoaded++;
     }
     else if (startsWith(r->name, "data:"))
     {
@@ -543,7 +762,7 @@ void MapImpl::resourcesDownloadsEntry()
             if (resources.auth)
                 resources.auth->authorize(r);
             resources.fetcher->fetch(r->fetch);
-            statistics.resourcesDownloaded++;
+            counters.resourcesDownloaded++;
             if (!resources.fetching.resources.empty())
                 break; // refresh the priorities
         }
@@ -556,10 +775,61 @@ void MapImpl::resourcesDownloadsEntry()
 // MAIN THREAD
 ////////////////////////////
 
+void MapImpl::resourcesTrack(const std::shared_ptr<Resource> &r)
+{
+    assert(!r->tracked);
+    r->tracked = true;
+    Resource::State state = r->state;
+    resources.states[(uint32)state]++;
+    r->accountedRamMemoryCost = r->info.ramMemoryCost;
+    r->accountedGpuMemoryCost = r->info.gpuMemoryCost;
+    resources.memRamUse += r->accountedRamMemoryCost;
+    resources.memGpuUse += r->accountedGpuMemoryCost;
+    if (needsAttention(state))
+    {
+        r->attention = true;
+        resources.attention.push_back(r);
+    }
+}
+
+void MapImpl::resourcesUpdateAttention()
+{
+    std::vector<std::weak_ptr<Resource>> incoming;
+    {
+        std::lock_guard<std::mutex> lock(resources.attentionMut);
+        incoming.swap(resources.attentionIncoming);
+    }
+    for (const auto &w : incoming)
+    {
+        std::shared_ptr<Resource> r = w.lock();
+        if (r && !r->attention)
+        {
+            r->attention = true;
+            resources.attention.push_back(r);
+        }
+    }
+    auto &a = resources.attention;
+    a.erase(std::remove_if(a.begin(), a.end(),
+        [](const std::weak_ptr<Resource> &w) {
+            std::shared_ptr<Resource> r = w.lock();
+            if (!r)
+                return true;
+            if (needsAttention(r->state))
+                return false;
+            r->attention = false;
+            return true;
+        }), a.end());
+}
+
 bool MapImpl::resourcesTryRemove(std::shared_ptr<Resource> &r)
 {
+    // used by draws without ownership
+    if (r->pinnedTick + 1 >= renderTickIndex)
+        return false;
     std::string name = r->name;
     assert(resources.resources.count(name) == 1);
+    // the resource may be destroyed below
+    Resource::LruPosition lruRam = r->lruRam, lruGpu = r->lruGpu;
     {
         // release the pointer if we are the last one holding it
         std::weak_ptr<Resource> w = r;
@@ -577,86 +847,127 @@ bool MapImpl::resourcesTryRemove(std::shared_ptr<Resource> &r)
     if (!r)
     {
         LOG(info1) << "Released resource <" << name << ">";
+        if (lruRam.linked)
+            resources.lruRam.erase(lruRam.it);
+        if (lruGpu.linked)
+            resources.lruGpu.erase(lruGpu.it);
         resources.resources.erase(name);
-        statistics.resourcesReleased++;
+        counters.resourcesReleased++;
         return true;
     }
     return false;
 }
 
+void MapImpl::resourcesEvict(std::list<Resource *> &lru,
+    const std::function<bool()> &overBudget)
+{
+    // walk from the least recently used
+    auto it = lru.end();
+    while (it != lru.begin() && overBudget())
+    {
+        auto candidate = std::prev(it);
+        Resource *r = *candidate;
+        if (r->lastAccessTick + 5 >= renderTickIndex)
+            break; // all remaining resources were used recently
+        if (!resourcesTryRemove(resources.resources[r->name]))
+            it = candidate; // still in use, skip it
+    }
+}
+
+void MapImpl::resourcesEvict(std::list<Resource *> &lruA,
+    std::list<Resource *> &lruB,
+    const std::function<bool()> &overBudget)
+{
+    // walk both lists from the least recently used
+    //   always taking the older of the two candidates
+    // removing a resource unlinks it from both lists
+    //   the positions point at resources that were skipped
+    auto itA = lruA.end();
+    auto itB = lruB.end();
+    while (overBudget())
+    {
+        bool hasA = itA != lruA.begin();
+        bool hasB = itB != lruB.begin();
+        if (!hasA && !hasB)
+            break;
+        bool useA = hasA && (!hasB || (*std::prev(itA))->lastAccessTick
+            <= (*std::prev(itB))->lastAccessTick);
+        auto &it = useA ? itA : itB;
+        auto candidate = std::prev(it);
+        Resource *r = *candidate;
+        if (r->lastAccessTick + 5 >= renderTickIndex)
+            break; // all remaining resources were used recently
+        if (!resourcesTryRemove(resources.resources[r->name]))
+            it = candidate; // still in use, skip it
+    }
+}
+
 void MapImpl::resourcesRemoveOld()
 {
     OPTICK_EVENT();
-    struct Res
-    {
-        std::string n; // name
-        uint32 m; // memory used
-        uint32 a; // lastAccessTick
-        Res(const std::string &n, uint32 m, uint32 a) : n(n), m(m), a(a)
-        {}
-    };
-    // successfully loaded resources are removed
-    //   only when we are tight on memory
-    std::vector<Res> resourcesToRemove;
-    resourcesToRemove.reserve(resources.resources.size() / 4);
+
     // resources that errored are removed immediately
-    std::vector<Res> unconditionalToRemove;
-    unconditionalToRemove.reserve(resources.resources.size() / 4);
-    uint64 memRamUse = 0;
-    uint64 memGpuUse = 0;
-    // find resource candidates for removal
-    for (const auto &it : resources.resources)
-    {
-        memRamUse += it.second->info.ramMemoryCost;
-        memGpuUse += it.second->info.gpuMemoryCost;
-        // skip recently used resources
-        if (it.second->lastAccessTick + 5 < renderTickIndex)
+    //   (only the attention list may contain them)
+    {
+        std::vector<std::string> unconditionalToRemove;
+        for (const auto &w : resources.attention)
         {
-            Res r(it.first,
-                it.second->info.ramMemoryCost + it.second->info.gpuMemoryCost,
-                it.second->lastAccessTick);
-            switch ((vts::Resource::State)it.second->state)
+            std::shared_ptr<Resource> r = w.lock();
+            if (!r || r->lastAccessTick + 5 >= renderTickIndex)
+                continue;
+            switch ((Resource::State)r->state)
             {
             case Resource::State::initializing:
             case Resource::State::startDownload:
             case Resource::State::errorFatal:
             case Resource::State::errorRetry:
             case Resource::State::availFail:
-                unconditionalToRemove.push_back(std::move(r));
+                unconditionalToRemove.push_back(r->name);
                 break;
             default:
-                resourcesToRemove.push_back(std::move(r));
                 break;
             }
         }
+        for (const std::string &n : unconditionalToRemove)
+            resourcesTryRemove(resources.resources[n]);
     }
-    statistics.currentGpuMemUseKB = memGpuUse / 1024;
-    statistics.currentRamMemUseKB = memRamUse / 1024;
-    uint64 memUse = memRamUse + memGpuUse;
-    // remove unconditionalToRemove
-    for (const Res &res : unconditionalToRemove)
-    {
-        if (resourcesTryRemove(resources.resources[res.n]))
-            memUse -= res.m;
-    }
-    // remove resourcesToRemove
-    uint64 trs = (uint64)options.targetResourcesMemoryKB * 1024;
-    if (memUse > trs)
+
+    // successfully loaded resources are removed
+    //   only when we are tight on memory
     {
-        std::sort(resourcesToRemove.begin(), resourcesToRemove.end(),
-                  [](const Res &a, const Res &b){
-            return a.a < b.a; // least recently used first
-        });
-        for (const Res &res : resourcesToRemove)
+        // resources that started or stopped using some memory
+        std::vector<std::weak_ptr<Resource>> incoming;
         {
-            if (resourcesTryRemove(resources.resources[res.n]))
-            {
-                memUse -= res.m;
-                if (memUse < trs)
-                    break;
-            }
+            std::lock_guard<std::mutex> lock(resources.attentionMut);
+            incoming.swap(resources.lruIncoming);
         }
+        for (const auto &w : incoming)
+        {
+            std::shared_ptr<Resource> r = w.lock();
+            if (r)
+                resourcesLruTouch(r.get());
+        }
+
+        uint64 trs = (uint64)options.targetResourcesMemoryKB * 1024;
+        uint64 trsRam = (uint64)options.targetResourcesRamMemoryKB * 1024;
+        uint64 trsGpu = (uint64)options.targetResourcesGpuMemoryKB * 1024;
+        const std::atomic<uint64> &ram = resources.memRamUse;
+        const std::atomic<uint64> &gpu = resources.memGpuUse;
+        if (trsGpu)
+            resourcesEvict(resources.lruGpu, [&]() {
+                return gpu > trsGpu;
+            });
+        if (trsRam)
+            resourcesEvict(resources.lruRam, [&]() {
+                return ram > trsRam;
+            });
+        resourcesEvict(resources.lruRam, resources.lruGpu, [&]() {
+            return ram + gpu > trs;
+        });
     }
+
+    statistics.currentGpuMemUseKB = resources.memGpuUse / 1024;
+    statistics.currentRamMemUseKB = resources.memRamUse / 1024;
 }
 
 void MapImpl::resourcesCheckInitialized()
@@ -664,10 +975,11 @@ void MapImpl::resourcesCheckInitialized()
     OPTICK_EVENT();
     std::time_t current = std::time(nullptr);
 
-    for (const auto &it : resources.resources)
+    resourcesUpdateAttention();
+    for (const auto &w : resources.attention)
     {
-        const std::shared_ptr<Resource> &r = it.second;
-        if (r->lastAccessTick + 3 < renderTickIndex)
+        std::shared_ptr<Resource> r = w.lock();
+        if (!r || r->lastAccessTick + 3 < renderTickIndex)
             continue; // skip resources that were not accessed last tick
         switch ((Resource::State)r->state)
         {
@@ -677,7 +989,7 @@ void MapImpl::resourcesCheckInitialized()
                 LOG(err3) << "All retries for resource <"
                     << r->name << "> has failed";
                 r->state = Resource::State::errorFatal;
-                statistics.resourcesFailed++;
+                counters.resourcesFailed++;
                 break;
             }
             if (r->retryTime == -1)
@@ -713,9 +1025,12 @@ void MapImpl::resourcesStartDownloads()
     std::vector<std::weak_ptr<Resource>> requestCacheRead;
     std::vector<std::weak_ptr<Resource>> requestDownloads;
 
-    for (const auto &it : resources.resources)
+    resourcesUpdateAttention();
+    for (const auto &w : resources.attention)
     {
-        const std::shared_ptr<Resource> &r = it.second;
+        std::shared_ptr<Resource> r = w.lock();
+        if (!r)
+            continue;
         switch ((Resource::State)r->state)
         {
         case Resource::State::checkCache:
@@ -752,6 +1067,10 @@ void MapImpl::resourcesRenderFinalize()
     purgeMapconfig();
 
     // clear the resources now while all the necessary things are still working
+    resources.handles.clear();
+    resources.attention.clear();
+    resources.lruRam.clear();
+    resources.lruGpu.clear();
     resources.resources.clear();
 
     // allow the dataAllRun method to return to the caller
@@ -764,25 +1083,15 @@ void MapImpl::resourcesRenderUpdate()
     // resourcesPreparing is used to determine mapRenderComplete
     //   and must be updated every frame
     statistics.resourcesPreparing = 0;
-    for (const auto &it : resources.resources)
-    {
-        switch ((Resource::State)it.second->state)
-        {
-        case Resource::State::initializing:
-        case Resource::State::checkCache:
-        case Resource::State::startDownload:
-        case Resource::State::downloading:
-        case Resource::State::downloaded:
-        case Resource::State::decoded:
-            statistics.resourcesPreparing++;
-            break;
-        case Resource::State::ready:
-        case Resource::State::errorFatal:
-        case Resource::State::errorRetry:
-        case Resource::State::availFail:
-            break;
-        }
-    }
+    for (Resource::State s : { Resource::State::initializing,
+            Resource::State::checkCache, Resource::State::startDownload,
+            Resource::State::downloading, Resource::State::downloaded,
+            Resource::State::decoded })
+        statistics.resourcesPreparing += resources.states[(uint32)s];
+
+    // priorities change as the camera moves
+    resources.queDecode.reprioritize();
+    resources.queUpload.reprioritize();
 
     statistics.resourcesActive
         = resources.resources.size();
@@ -798,6 +1107,11 @@ void MapImpl::resourcesRenderUpdate()
         = resources.queGeodata.estimateSize();
     statistics.resourcesQueueAtmosphere
         = resources.queAtmosphere.estimateSize();
+    for (uint32 i = 0; i < statistics.decodeThreads; i++)
+    {
+        statistics.decodeThreadsBusyTimeMs[i]
+            = resources.decodersBusyTime[i] / 1000;
+    }
 
     // split workload into multiple render frames
     switch (renderTickIndex % 3)
@@ -306,7 +306,20 @@ void GpuMesh::upload()
 {
     LOG(info1) << "Uploading (gpu) mesh '" << name << "'";
     auto spec = std::static_pointer_cast<GpuMeshSpec>(decodeData);
-    map->callbacks.loadMesh(info, *spec, name);
+    if (map->callbacks.loadMeshes)
+    {
+        GpuMeshUpload u;
+        u.info = &info;
+        u.spec = spec.get();
+        u.id = &name;
+        map->resources.uploadBatch.meshes.push_back(u);
+    }
+    else
+        map->callbacks.loadMesh(info, *spec, name);
+}
+
+void GpuMesh::uploadDone()
+{
     info.ramMemoryCost += sizeof(*this);
 }
 
@@ -412,10 +425,16 @@ void MeshAggregate::upload()
 {
     LOG(info2) << "Uploading (aggregated) mesh <" << name << ">";
 
+    for (const auto &it : submeshes)
+        it.renderable->upload();
+}
+
+void MeshAggregate::uploadDone()
+{
     info.ramMemoryCost += sizeof(*this) + submeshes.size() * sizeof(MeshPart);
     for (const auto &it : submeshes)
     {
-        it.renderable->upload();
+        it.renderable->uploadDone();
         info.gpuMemoryCost += it.renderable->info.gpuMemoryCost;
         info.ramMemoryCost += it.renderable->info.ramMemoryCost;
         it.renderable->decodeData.reset();
@@ -78,6 +78,8 @@ Resource::~Resource()
 {
     LOG(debug) << "Destroying resource <" << name
                << "> at <" << this << ">";
+    if (tracked)
+        map->resourcesUntrack(this);
     if (info.userData)
     {
         map->resources.queUpload.push(
@@ -107,14 +109,15 @@ bool Resource::allowDiskCache(FetchTask::ResourceType type)
 
 void Resource::updatePriority(float p)
 {
-    if (!std::isnan(priority))
-        priority = std::max(priority, p);
-    else
-        priority = p;
+    // concurrent traversal tasks may update the priority
+    float c = priority;
+    while ((std::isnan(c) || c < p)
+        && !priority.compare_exchange_weak(c, p));
 }
 
 void Resource::updateAvailability(const std::shared_ptr<void> &availTest)
 {
+    std::lock_guard<std::mutex> lock(map->resources.mut);
     auto f = fetch;
     if (f)
     {
@@ -136,6 +139,14 @@ void Resource::forceRedownload()
     state = Resource::State::errorRetry;
 }
 
+Resource::StateTracker &Resource::StateTracker::operator = (State s)
+{
+    State previous = value.exchange(s);
+    if (owner->tracked)
+        owner->map->resourcesStateChanged(owner, previous, s);
+    return *this;
+}
+
 Resource::operator bool() const
 {
     return state == Resource::State::ready;
@@ -146,6 +157,14 @@ std::shared_ptr<void> Resource::getUserData() const
     return std::shared_ptr<void>(shared_from_this(), info.userData.get());
 }
 
+void *Resource::getUserDataPinned()
+{
+    // relaxed store, the removal happens on the same thread
+    //   after the traversal tasks are joined
+    pinnedTick.store(map->renderTickIndex, std::memory_order_relaxed);
+    return info.userData.get();
+}
+
 std::ostream &operator << (std::ostream &stream, Resource::State state)
 {
     switch (state)
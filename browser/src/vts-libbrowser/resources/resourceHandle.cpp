@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <atomic>
+
+#include "../resourceHandle.hpp"
+
+namespace vts
+{
+
+namespace
+{
+
+std::atomic<uint32> lastTemplateId;
+
+uint64 hashCombine(uint64 h, uint64 v)
+{
+    // splitmix64 finalizer
+    h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+
+uint64 hashTile(uint64 h, const TileId &t)
+{
+    h = hashCombine(h, t.lod);
+    return hashCombine(h, ((uint64)t.x << 32) | t.y);
+}
+
+} // namespace
+
+InternedUrlTemplate::InternedUrlTemplate() : id_(++lastTemplateId)
+{}
+
+void InternedUrlTemplate::parse(const std::string &str)
+{
+    templ.parse(str);
+    id_ = ++lastTemplateId;
+}
+
+std::string InternedUrlTemplate::operator () (
+    const UrlTemplate::Vars &vars) const
+{
+    return templ(vars);
+}
+
+ResourceHandle::ResourceHandle(const InternedUrlTemplate &templ,
+    const UrlTemplate::Vars &vars)
+    : tileId(vars.tileId), localId(vars.localId),
+    subMesh(vars.subMesh), templateId(templ.id())
+{
+    uint64 h = templateId;
+    h = hashTile(h, tileId);
+    h = hashTile(h, localId);
+    hash_ = hashCombine(h, subMesh);
+}
+
+bool ResourceHandle::operator == (const ResourceHandle &other) const
+{
+    return hash_ == other.hash_
+        && templateId == other.templateId
+        && subMesh == other.subMesh
+        && tileId == other.tileId
+        && localId == other.localId;
+}
+
+std::shared_ptr<Resource> ResourceHandleMap::find(
+    const ResourceHandle &handle) const
+{
+    if (slots.empty())
+        return {};
+    const Slot &s = slots[position(handle)];
+    if (!s.used)
+        return {};
+    return s.resource.lock();
+}
+
+void ResourceHandleMap::insert(const ResourceHandle &handle,
+    const std::shared_ptr<Resource> &resource)
+{
+    if ((used + 1) * 2 > slots.size())
+        rehash();
+    Slot &s = slots[position(handle)];
+    if (!s.used)
+    {
+        s.handle = handle;
+        s.used = true;
+        used++;
+    }
+    s.resource = resource;
+}
+
+void ResourceHandleMap::clear()
+{
+    slots.clear();
+    used = 0;
+}
+
+void ResourceHandleMap::rehash()
+{
+    std::vector<Slot> old;
+    std::swap(old, slots);
+    uint32 live = 0;
+    for (const Slot &s : old)
+        if (s.used && !s.resource.expired())
+            live++;
+    uint32 capacity = 64;
+    while (capacity < (live + 1) * 4)
+        capacity *= 2;
+    slots.resize(capacity);
+    used = 0;
+    for (Slot &s : old)
+    {
+        if (!s.used || s.resource.expired())
+            continue;
+        slots[position(s.handle)] = std::move(s);
+        used++;
+    }
+}
+
+uint32 ResourceHandleMap::position(const ResourceHandle &handle) const
+{
+    // linear probing, the load factor is kept below one half
+    //   so there is always an empty slot
+    uint32 mask = slots.size() - 1;
+    uint32 i = handle.hash() & mask;
+    while (slots[i].used && !(slots[i].handle == handle))
+        i = (i + 1) & mask;
+    return i;
+}
+
+} // namespace vts
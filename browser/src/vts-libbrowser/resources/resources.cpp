@@ -41,37 +41,135 @@ namespace vts
 namespace
 {
 
+// resources.mut must be locked
 template<class T>
-std::shared_ptr<T> getMapResource(MapImpl *map, const std::string &name)
+std::shared_ptr<Resource> findMapResource(MapImpl *map,
+    const std::string &name)
 {
-    assert(!name.empty());
     auto it = map->resources.resources.find(name);
     if (it == map->resources.resources.end())
     {
         auto r = std::make_shared<T>(map, name);
         it = map->resources.resources.insert(std::make_pair(name, r)).first;
-        map->statistics.resourcesCreated++;
+        map->resourcesTrack(r);
+        map->counters.resourcesCreated++;
     }
     assert(it->second);
-    map->touchResource(it->second);
-    auto res = std::dynamic_pointer_cast<T>(it->second);
+    return it->second;
+}
+
+template<class T>
+std::shared_ptr<T> getMapResource(MapImpl *map, const std::string &name)
+{
+    assert(!name.empty());
+    std::shared_ptr<Resource> r;
+    {
+        std::lock_guard<std::mutex> lock(map->resources.mut);
+        r = findMapResource<T>(map, name);
+    }
+    map->touchResource(r);
+    auto res = std::dynamic_pointer_cast<T>(r);
     assert(res);
     return res;
 }
 
+template<class T>
+std::shared_ptr<T> getMapResource(MapImpl *map,
+    const InternedUrlTemplate &templ, const UrlTemplate::Vars &vars)
+{
+    ResourceHandle handle(templ, vars);
+    std::shared_ptr<Resource> r;
+    {
+        std::lock_guard<std::mutex> lock(map->resources.mut);
+        r = map->resources.handles.find(handle);
+    }
+    if (!r)
+    {
+        // compose the url only when the handle is not known
+        std::string name = templ(vars);
+        std::lock_guard<std::mutex> lock(map->resources.mut);
+        r = findMapResource<T>(map, name);
+        map->resources.handles.insert(handle, r);
+    }
+    map->touchResource(r);
+    assert(std::dynamic_pointer_cast<T>(r));
+    return std::static_pointer_cast<T>(r);
+}
+
+thread_local ResourceTouches *currentTouches = nullptr;
+
+void lruTouch(std::list<Resource *> &lru, Resource::LruPosition &pos,
+    Resource *r, bool member)
+{
+    if (pos.linked)
+    {
+        if (member)
+            lru.splice(lru.begin(), lru, pos.it);
+        else
+        {
+            lru.erase(pos.it);
+            pos.linked = false;
+        }
+    }
+    else if (member)
+    {
+        lru.push_front(r);
+        pos.it = lru.begin();
+        pos.linked = true;
+    }
+}
+
 } // namespace
 
+ResourceTouchesScope::ResourceTouchesScope(ResourceTouches &touches)
+    : previous(currentTouches)
+{
+    currentTouches = &touches;
+}
+
+ResourceTouchesScope::~ResourceTouchesScope()
+{
+    currentTouches = previous;
+}
+
 void MapImpl::touchResource(const std::shared_ptr<Resource> &resource)
 {
-    resource->lastAccessTick = renderTickIndex;
+    // the first touch in the tick wins, even across the traversal tasks
+    if (resource->lastAccessTick.exchange(renderTickIndex)
+        == renderTickIndex)
+        return;
+    if (!resource->tracked)
+        return;
+    // the resources are owned by the map until the tasks are joined
+    if (currentTouches)
+        currentTouches->push_back(resource.get());
+    else
+        resourcesLruTouch(resource.get());
+}
+
+void MapImpl::touchResources(const ResourceTouches &touches)
+{
+    for (Resource *r : touches)
+        resourcesLruTouch(r);
+}
+
+void MapImpl::resourcesLruTouch(Resource *r)
+{
+    lruTouch(resources.lruRam, r->lruRam, r, r->info.ramMemoryCost > 0);
+    lruTouch(resources.lruGpu, r->lruGpu, r, r->info.gpuMemoryCost > 0);
 }
 
 Validity MapImpl::getResourceValidity(const std::string &name)
 {
-    auto it = resources.resources.find(name);
-    if (it == resources.resources.end())
-        return Validity::Invalid;
-    return getResourceValidity(it->second);
+    std::shared_ptr<Resource> r;
+    {
+        std::lock_guard<std::mutex> lock(resources.mut);
+        auto it = resources.resources.find(name);
+        if (it == resources.resources.end())
+            return Validity::Invalid;
+        r = it->second;
+    }
+    return getResourceValidity(r);
 }
 
 Validity MapImpl::getResourceValidity(
@@ -94,6 +192,12 @@ std::shared_ptr<GpuTexture> MapImpl::getTexture(const std::string &name)
     return getMapResource<GpuTexture>(this, name);
 }
 
+std::shared_ptr<GpuTexture> MapImpl::getTexture(
+        const InternedUrlTemplate &templ, const UrlTemplate::Vars &vars)
+{
+    return getMapResource<GpuTexture>(this, templ, vars);
+}
+
 std::shared_ptr<GpuAtmosphereDensityTexture>
 MapImpl::getAtmosphereDensityTexture(
     const std::string &name)
@@ -121,18 +225,36 @@ std::shared_ptr<MetaTile> MapImpl::getMetaTile(const std::string &name)
     return getMapResource<MetaTile>(this, name);
 }
 
+std::shared_ptr<MetaTile> MapImpl::getMetaTile(
+        const InternedUrlTemplate &templ, const UrlTemplate::Vars &vars)
+{
+    return getMapResource<MetaTile>(this, templ, vars);
+}
+
 std::shared_ptr<NavTile> MapImpl::getNavTile(
         const std::string &name)
 {
     return getMapResource<NavTile>(this, name);
 }
 
+std::shared_ptr<NavTile> MapImpl::getNavTile(
+        const InternedUrlTemplate &templ, const UrlTemplate::Vars &vars)
+{
+    return getMapResource<NavTile>(this, templ, vars);
+}
+
 std::shared_ptr<MeshAggregate> MapImpl::getMeshAggregate(
         const std::string &name)
 {
     return getMapResource<MeshAggregate>(this, name);
 }
 
+std::shared_ptr<MeshAggregate> MapImpl::getMeshAggregate(
+        const InternedUrlTemplate &templ, const UrlTemplate::Vars &vars)
+{
+    return getMapResource<MeshAggregate>(this, templ, vars);
+}
+
 std::shared_ptr<ExternalBoundLayer> MapImpl::getExternalBoundLayer(
         const std::string &name)
 {
@@ -151,6 +273,12 @@ std::shared_ptr<BoundMetaTile> MapImpl::getBoundMetaTile(
     return getMapResource<BoundMetaTile>(this, name);
 }
 
+std::shared_ptr<BoundMetaTile> MapImpl::getBoundMetaTile(
+        const InternedUrlTemplate &templ, const UrlTemplate::Vars &vars)
+{
+    return getMapResource<BoundMetaTile>(this, templ, vars);
+}
+
 std::shared_ptr<SearchTaskImpl> MapImpl::getSearchTask(const std::string &name)
 {
     return getMapResource<SearchTaskImpl>(this, name);
@@ -180,6 +308,7 @@ std::shared_ptr<GeodataStylesheet> MapImpl::newGeoStyle(
     auto res = std::make_shared<GeodataStylesheet>(this, name);
     res->data = value;
     res->json.reset();
+    res->compiled.reset();
     res->dependenciesLoaded = false;
     res->state = Resource::State::ready;
     return res;
@@ -25,6 +25,7 @@
  */
 
 #include "../image/image.hpp"
+#include "../image/compress.hpp"
 #include "../gpuResource.hpp"
 #include "../fetchTask.hpp"
 #include "../map.hpp"
@@ -34,9 +35,121 @@
 namespace vts
 {
 
+namespace
+{
+
+// header of transcoded textures stored in the disk cache
+struct TranscodedHeader
+{
+    char magic[8];
+    uint32 width, height, components;
+    uint32 internalFormat, mipmapLevels;
+    uint32 filterMode;
+};
+
+const char TranscodedMagic[8] = { 'v', 't', 's', 't', 'e', 'x', 'c', '1' };
+
+Buffer writeTranscoded(const GpuTextureSpec &spec)
+{
+    TranscodedHeader h;
+    memcpy(h.magic, TranscodedMagic, sizeof(h.magic));
+    h.width = spec.width;
+    h.height = spec.height;
+    h.components = spec.components;
+    h.internalFormat = spec.internalFormat;
+    h.mipmapLevels = spec.mipmapLevels;
+    h.filterMode = (uint32)spec.filterMode;
+    Buffer b(sizeof(h) + spec.buffer.size());
+    memcpy(b.data(), &h, sizeof(h));
+    memcpy(b.data() + sizeof(h), spec.buffer.data(), spec.buffer.size());
+    return b;
+}
+
+// limits of the transcoded textures accepted from the disk cache
+const uint32 MaxTranscodedSize = 16384;
+const uint32 MaxTranscodedLevels = 15; // down to 1x1
+
+bool validFilterMode(uint32 filterMode)
+{
+    switch ((GpuTextureSpec::FilterMode)filterMode)
+    {
+    case GpuTextureSpec::FilterMode::Nearest:
+    case GpuTextureSpec::FilterMode::Linear:
+    case GpuTextureSpec::FilterMode::NearestMipmapNearest:
+    case GpuTextureSpec::FilterMode::LinearMipmapNearest:
+    case GpuTextureSpec::FilterMode::NearestMipmapLinear:
+    case GpuTextureSpec::FilterMode::LinearMipmapLinear:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::shared_ptr<GpuTextureSpec> readTranscoded(const Buffer &buffer)
+{
+    TranscodedHeader h;
+    if (buffer.size() < sizeof(h))
+    {
+        LOGTHROW(err2, std::runtime_error)
+            << "Truncated transcoded texture";
+    }
+    memcpy(&h, buffer.data(), sizeof(h));
+    if (memcmp(h.magic, TranscodedMagic, sizeof(h.magic)) != 0
+        || h.width == 0 || h.width > MaxTranscodedSize
+        || h.height == 0 || h.height > MaxTranscodedSize
+        || h.components == 0 || h.components > 4
+        || h.mipmapLevels > MaxTranscodedLevels
+        || !validFilterMode(h.filterMode))
+    {
+        LOGTHROW(err2, std::runtime_error)
+            << "Invalid transcoded texture header";
+    }
+    auto spec = std::make_shared<GpuTextureSpec>();
+    spec->width = h.width;
+    spec->height = h.height;
+    spec->components = h.components;
+    spec->internalFormat = h.internalFormat;
+    spec->mipmapLevels = h.mipmapLevels;
+    spec->filterMode = (GpuTextureSpec::FilterMode)h.filterMode;
+    if (!spec->compressed())
+    {
+        LOGTHROW(err2, std::runtime_error)
+            << "Invalid transcoded texture format";
+    }
+    uint64 size = 0;
+    for (uint32 l = 0; l < std::max(h.mipmapLevels, 1u); l++)
+        size += spec->levelSize(l);
+    if (buffer.size() - sizeof(h) != size)
+    {
+        LOGTHROW(err2, std::runtime_error)
+            << "Invalid transcoded texture size";
+    }
+    spec->buffer = buffer.slice(sizeof(h), buffer.size() - sizeof(h));
+    return spec;
+}
+
+bool requiresMipmaps(GpuTextureSpec::FilterMode filterMode)
+{
+    switch (filterMode)
+    {
+    case GpuTextureSpec::FilterMode::Nearest:
+    case GpuTextureSpec::FilterMode::Linear:
+        return false;
+    default:
+        return true;
+    }
+}
+
+bool startsWith(const std::string &text, const std::string &start)
+{
+    return text.substr(0, start.length()) == start;
+}
+
+} // namespace
+
 GpuTextureSpec::GpuTextureSpec()
     : width(0), height(0), components(0),
-    type(GpuTypeEnum::UnsignedByte), internalFormat(0),
+    type(GpuTypeEnum::UnsignedByte), internalFormat(0), mipmapLevels(0),
     filterMode(FilterMode::NearestMipmapLinear), wrapMode(WrapMode::Repeat)
 {}
 
@@ -45,8 +158,19 @@ GpuTextureSpec::GpuTextureSpec(const Buffer &buffer) : GpuTextureSpec()
     decodeImage(buffer, this->buffer, width, height, components);
 }
 
+GpuTextureSpec::GpuTextureSpec(const Buffer &buffer,
+    uint32 scaleDenominator, bool bottomUp) : GpuTextureSpec()
+{
+    ImageDecodeOptions options;
+    options.scaleDenominator = scaleDenominator;
+    options.bottomUp = bottomUp;
+    decodeImage(buffer, this->buffer, width, height, components, options);
+}
+
 void GpuTextureSpec::verticalFlip()
 {
+    if (buffer.owner())
+        buffer = buffer.copy(); // the shared memory may be read only
     uint32 lineSize = width * components;
     Buffer tmp(lineSize);
     for (uint32 y = 0; y < height / 2; y++)
@@ -62,7 +186,103 @@ void GpuTextureSpec::verticalFlip()
 
 uint32 GpuTextureSpec::expectedSize() const
 {
-    return width * height * components * gpuTypeSize(type);
+    uint32 result = 0;
+    for (uint32 l = 0; l < std::max(mipmapLevels, 1u); l++)
+        result += levelSize(l);
+    return result;
+}
+
+uint32 GpuTextureSpec::levelSize(uint32 level) const
+{
+    uint32 w = std::max(width >> level, 1u);
+    uint32 h = std::max(height >> level, 1u);
+    if (compressed())
+        return compressedSize((CompressedFormat)internalFormat, w, h);
+    return w * h * components * gpuTypeSize(type);
+}
+
+bool GpuTextureSpec::compressed() const
+{
+    return isCompressedFormat(internalFormat);
+}
+
+void GpuTextureSpec::compress(Compression compression)
+{
+    if (compression == Compression::None || internalFormat != 0
+        || mipmapLevels > 1 || type != GpuTypeEnum::UnsignedByte
+        || (components != 3 && components != 4)
+        || width == 0 || height == 0)
+        return;
+
+    // opaque images do not need the alpha channel
+    bool alpha = false;
+    if (components == 4)
+    {
+        for (uint32 i = 0, e = width * height; i < e && !alpha; i++)
+            alpha = (unsigned char)buffer.data()[i * 4 + 3] != 255;
+    }
+    CompressedFormat format;
+    switch (compression)
+    {
+    case Compression::Bc:
+        format = alpha ? CompressedFormat::Bc3 : CompressedFormat::Bc1;
+        break;
+    case Compression::Etc2:
+        format = alpha ? CompressedFormat::Etc2Eac : CompressedFormat::Etc2;
+        break;
+    default:
+        LOGTHROW(err2, std::invalid_argument)
+            << "Invalid texture compression";
+        throw;
+    }
+
+    uint32 levels = 1;
+    if (requiresMipmaps(filterMode))
+        while ((std::max(width, height) >> levels) > 0)
+            levels++;
+
+    internalFormat = (uint32)format;
+    mipmapLevels = levels;
+    Buffer out(expectedSize());
+    Buffer tmp;
+    const unsigned char *pixels = (const unsigned char *)buffer.data();
+    uint32 offset = 0;
+    for (uint32 l = 0; l < levels; l++)
+    {
+        uint32 w = std::max(width >> l, 1u);
+        uint32 h = std::max(height >> l, 1u);
+        compressImage(format, pixels, w, h, components,
+            (unsigned char *)out.data() + offset);
+        offset += levelSize(l);
+        if (l + 1 < levels)
+        {
+            Buffer next(std::max(w / 2, 1u) * std::max(h / 2, 1u)
+                * components);
+            downsampleImage(pixels, w, h, components,
+                (unsigned char *)next.data());
+            tmp = std::move(next);
+            pixels = (const unsigned char *)tmp.data();
+        }
+    }
+    assert(offset == out.size());
+    buffer = std::move(out);
+}
+
+void GpuTextureSpec::decompress()
+{
+    if (!compressed())
+        return;
+    Buffer rgba(width * height * 4);
+    decompressImage((CompressedFormat)internalFormat,
+        (const unsigned char *)buffer.data(), width, height,
+        (unsigned char *)rgba.data());
+    Buffer out(width * height * components);
+    for (uint32 i = 0, e = width * height; i < e; i++)
+        for (uint32 c = 0; c < components; c++)
+            out.data()[i * components + c] = rgba.data()[i * 4 + c];
+    buffer = std::move(out);
+    internalFormat = 0;
+    mipmapLevels = 0;
 }
 
 Buffer GpuTextureSpec::encodePng() const
@@ -81,11 +301,49 @@ GpuTexture::GpuTexture(MapImpl *map, const std::string &name) :
     Resource(map, name)
 {}
 
+std::string GpuTexture::transcodedName() const
+{
+    if (!transcode)
+        return "";
+    std::string scale;
+    if (decodeScale() > 1)
+        scale = std::to_string(decodeScale());
+    switch ((GpuTextureSpec::Compression)map->createOptions.textureCompression)
+    {
+    case GpuTextureSpec::Compression::Bc:
+        return name + "#bc" + scale;
+    case GpuTextureSpec::Compression::Etc2:
+        return name + "#etc2" + scale;
+    default:
+        return "";
+    }
+}
+
+uint32 GpuTexture::decodeScale() const
+{
+    if (!transcode)
+        return 1;
+    return map->createOptions.textureDecodeScale;
+}
+
 void GpuTexture::decode()
 {
     LOG(info1) << "Decoding texture <" << name << ">";
-    std::shared_ptr<GpuTextureSpec> spec
-        = std::make_shared<GpuTextureSpec>(fetch->reply.content);
+
+    // transcoded texture from the disk cache
+    std::shared_ptr<GpuTextureSpec> spec;
+    if (fromTranscodedCache)
+    {
+        spec = readTranscoded(fetch->reply.content);
+        this->width = spec->width;
+        this->height = spec->height;
+        spec->wrapMode = wrapMode;
+        decodeData = std::static_pointer_cast<void>(spec);
+        return;
+    }
+
+    spec = std::make_shared<GpuTextureSpec>(fetch->reply.content,
+        decodeScale(), true);
     this->width = spec->width;
     this->height = spec->height;
     spec->filterMode = filterMode;
@@ -102,15 +360,38 @@ void GpuTexture::decode()
         if (!boost::filesystem::exists(path))
         {
             boost::filesystem::create_directories(prefix + b);
+            GpuTextureSpec flipped;
+            flipped.width = spec->width;
+            flipped.height = spec->height;
+            flipped.components = spec->components;
+            flipped.buffer = spec->buffer.copy();
+            flipped.verticalFlip();
             Buffer out;
-            encodePng(spec->buffer, out,
+            encodePng(flipped.buffer, out,
                 spec->width, spec->height, spec->components);
             writeLocalFileBuffer(path, out);
         }
     }
 #endif
 
-    spec->verticalFlip();
+    const std::string tn = transcodedName();
+    if (!tn.empty())
+    {
+        spec->compress((GpuTextureSpec::Compression)
+            map->createOptions.textureCompression);
+        if (spec->compressed() && allowDiskCache()
+            && (startsWith(name, "http://") || startsWith(name, "https://"))
+            && map->resources.queCacheWrite.estimateSize()
+            < map->options.maxCacheWriteQueueLength)
+        {
+            CacheData cd;
+            cd.buffer = writeTranscoded(*spec);
+            cd.name = tn;
+            cd.expires = fetch->reply.expires;
+            map->resources.queCacheWrite.push(std::move(cd));
+        }
+    }
+
     decodeData = std::static_pointer_cast<void>(spec);
 }
 
@@ -118,7 +399,20 @@ void GpuTexture::upload()
 {
     LOG(info2) << "Uploading texture <" << name << ">";
     auto spec = std::static_pointer_cast<GpuTextureSpec>(decodeData);
-    map->callbacks.loadTexture(info, *spec, name);
+    if (map->callbacks.loadTextures)
+    {
+        GpuTextureUpload u;
+        u.info = &info;
+        u.spec = spec.get();
+        u.id = &name;
+        map->resources.uploadBatch.textures.push_back(u);
+    }
+    else
+        map->callbacks.loadTexture(info, *spec, name);
+}
+
+void GpuTexture::uploadDone()
+{
     info.ramMemoryCost += sizeof(*this);
 }
 
@@ -36,6 +36,7 @@ namespace vts
 
 class TraverseNode;
 class CameraImpl;
+class TraverseTask;
 
 class SubtilesMerger : private Immovable
 {
@@ -47,7 +48,7 @@ public:
         Subtile(TraverseNode *orig, const vec4f &uvClip);
     };
     std::vector<Subtile> subtiles;
-    void resolve(TraverseNode *trav, CameraImpl *impl);
+    void resolve(TraverseNode *trav, CameraImpl *impl, TraverseTask &out);
 };
 
 } // namespace vts
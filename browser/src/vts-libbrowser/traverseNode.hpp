@@ -27,6 +27,11 @@
 #ifndef TRAVERSENODE_HPP_sgh44f
 #define TRAVERSENODE_HPP_sgh44f
 
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <mutex>
+
 #include <vts-libs/vts/nodeinfo.hpp>
 #include <vts-libs/vts/metatile.hpp>
 
@@ -50,6 +55,43 @@ class RenderSurfaceTask;
 class RenderColliderTask;
 class MeshAggregate;
 class GeodataTile;
+class TraverseNode;
+
+// returns the node back to the pool of its layer
+struct TraverseNodeRelease
+{
+    void operator()(TraverseNode *node) const;
+};
+
+typedef std::unique_ptr<TraverseNode, TraverseNodeRelease> TraverseNodePtr;
+
+// reference to a node that stays safe after the node is released
+// it expires when the node or any of its ancestors is released
+struct TraverseNodeHandle
+{
+    TraverseNode *node = nullptr;
+    uint32 poolIndex = 0;
+    uint32 generation = 0;
+};
+
+// data accessed by culling and coarseness tests for every visited node
+// stored as structure of arrays, separately from the rest of the nodes
+struct TraverseNodeHot
+{
+    static const uint32 Size = 256;
+
+    vec3 aabbPhys[Size][2];
+    vec3 cornersPhys[Size][8];
+    vec3 diskNormalPhys[Size];
+    vec2 diskHeightsPhys[Size];
+    double diskHalfAngle[Size];
+    double texelSize[Size];
+
+    // results of the batched tests, valid for the stamp of the camera
+    uint32 cullingStamp[Size];
+    bool cullingVisible[Size];
+    double cullingCoarseness[Size];
+};
 
 class TraverseNode : private Immovable
 {
@@ -61,31 +103,42 @@ public:
     };
 
     // traversal
-    Array<std::unique_ptr<TraverseNode>, 4> childs;
+    Array<TraverseNodePtr, 4> childs;
     MapLayer *const layer = nullptr;
     TraverseNode *const parent = nullptr;
     const NodeInfo nodeInfo;
     const uint32 hash = 0;
+    const uint32 poolIndex = 0;
+    bool detached = false; // released back to the pool
 
     // metadata
     boost::container::small_vector<vtslibs::registry::CreditId, 8> credits;
     boost::container::small_vector<std::shared_ptr<MetaTile>, 1> metaTiles;
     boost::optional<vtslibs::vts::MetaNode> meta;
     boost::optional<Obb> obb;
-    vec3 cornersPhys[8];
-    vec3 aabbPhys[2];
     boost::optional<vec3> surrogatePhys;
     boost::optional<float> surrogateNav;
-    vec3 diskNormalPhys;
-    vec2 diskHeightsPhys;
-    double diskHalfAngle;
-    double texelSize;
     const SurfaceInfo *surface = nullptr;
 
-    uint32 lastAccessTime = 0;
-    uint32 lastRenderTime = 0;
+    // hot data, stored in the arrays of the pool at the slot
+    TraverseNodeHot *const hot = nullptr;
+    const uint32 slot = 0;
+
+    // may be updated from concurrent traversal tasks (eg. coarser nodes)
+    std::atomic<uint32> lastAccessTime {0};
+    std::atomic<uint32> lastRenderTime {0};
     float priority;
 
+    // lod blending, valid for the stamp of the camera
+    uint32 blendStamp = 0;
+    TraverseNode *blendCurrent = nullptr; // trav of current draw at this node
+    bool blendOpaque = false; // a fully visible draw covers this node
+    bool blendCoveredKnown = false;
+    bool blendCovered = false; // blendOpaque of any ancestor
+
+    // the node and its ancestors are attached, valid for the stamp
+    uint32 attachedStamp = 0;
+
     // renders
     bool determined = false; // draws are fully loaded (draws may be empty)
     std::shared_ptr<MeshAggregate> meshAgg;
@@ -95,7 +148,7 @@ public:
     boost::container::small_vector<RenderColliderTask, 1> colliders;
 
     TraverseNode(MapLayer *layer, TraverseNode *parent,
-        const NodeInfo &nodeInfo);
+        const NodeInfo &nodeInfo, TraverseNodeHot *hot, uint32 poolIndex);
     ~TraverseNode();
     void clearAll();
     void clearRenders();
@@ -104,6 +157,47 @@ public:
     TileId id() const { return nodeInfo.nodeId(); }
 };
 
+// allocates traverse nodes in chunks and recycles them
+// released subtrees are destroyed lazily
+//   releasing a subtree is O(1) regardless of its size
+class TraverseNodePool : private Immovable
+{
+public:
+    TraverseNodePool();
+    ~TraverseNodePool();
+
+    TraverseNodePtr acquire(MapLayer *layer, TraverseNode *parent,
+        const NodeInfo &nodeInfo);
+    void release(TraverseNode *node);
+
+    TraverseNodeHandle handle(TraverseNode *node) const;
+    // returns nullptr if the handle has expired
+    // the result is remembered in the nodes for the stamp,
+    //   handles sharing ancestors do not walk them again
+    TraverseNode *resolve(const TraverseNodeHandle &handle, uint32 stamp);
+
+    // destroy some of the released nodes
+    //   to free the resources they hold
+    void collect();
+
+    uint32 capacity() const;
+    uint32 pending() const;
+
+private:
+    struct Chunk;
+
+    void destroy(TraverseNode *node);
+    void grow();
+
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    std::vector<uint32> freeSlots;
+    std::vector<uint32> generations; // per slot, incremented on release
+    std::vector<TraverseNode *> released;
+    // childs are acquired by concurrent traversal tasks
+    //   recursive: destroying a node releases its childs
+    std::recursive_mutex mut;
+};
+
 TraverseNode *findTravById(TraverseNode *trav, const TileId &what);
 
 } // namespace vts
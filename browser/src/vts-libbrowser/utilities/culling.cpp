@@ -0,0 +1,198 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "culling.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// this file must be compiled without contraction of floating point
+//   operations (eg. into fma), so that the vectorized and the scalar
+//   paths round identically
+
+namespace vts
+{
+
+void aabbTest(const vec3 *const aabbs[], uint32 count,
+              const vec4 planes[6], bool results[])
+{
+    uint32 i = 0;
+
+#if defined(VTS_SIMD_AVX)
+    for (; i + 4 <= count; i += 4)
+    {
+        const vec3 *const *a = aabbs + i;
+        __m256d fail = _mm256_setzero_pd();
+        for (uint32 j = 0; j < 6; j++)
+        {
+            const vec4 &p = planes[j];
+            uint32 sx = p[0] > 0, sy = p[1] > 0, sz = p[2] > 0;
+            __m256d x = _mm256_set_pd(a[3][sx][0], a[2][sx][0],
+                                      a[1][sx][0], a[0][sx][0]);
+            __m256d y = _mm256_set_pd(a[3][sy][1], a[2][sy][1],
+                                      a[1][sy][1], a[0][sy][1]);
+            __m256d z = _mm256_set_pd(a[3][sz][2], a[2][sz][2],
+                                      a[1][sz][2], a[0][sz][2]);
+            __m256d d = _mm256_add_pd(_mm256_add_pd(
+                _mm256_mul_pd(_mm256_set1_pd(p[0]), x),
+                _mm256_mul_pd(_mm256_set1_pd(p[1]), y)),
+                _mm256_mul_pd(_mm256_set1_pd(p[2]), z));
+            fail = _mm256_or_pd(fail, _mm256_cmp_pd(d,
+                _mm256_set1_pd(-p[3]), _CMP_LT_OQ));
+        }
+        int m = _mm256_movemask_pd(fail);
+        for (uint32 k = 0; k < 4; k++)
+            results[i + k] = !(m & (1 << k));
+    }
+#endif
+
+#if defined(VTS_SIMD_SSE2)
+    for (; i + 2 <= count; i += 2)
+    {
+        const vec3 *const *a = aabbs + i;
+        __m128d fail = _mm_setzero_pd();
+        for (uint32 j = 0; j < 6; j++)
+        {
+            const vec4 &p = planes[j];
+            uint32 sx = p[0] > 0, sy = p[1] > 0, sz = p[2] > 0;
+            __m128d x = _mm_set_pd(a[1][sx][0], a[0][sx][0]);
+            __m128d y = _mm_set_pd(a[1][sy][1], a[0][sy][1]);
+            __m128d z = _mm_set_pd(a[1][sz][2], a[0][sz][2]);
+            __m128d d = _mm_add_pd(_mm_add_pd(
+                _mm_mul_pd(_mm_set1_pd(p[0]), x),
+                _mm_mul_pd(_mm_set1_pd(p[1]), y)),
+                _mm_mul_pd(_mm_set1_pd(p[2]), z));
+            fail = _mm_or_pd(fail, _mm_cmplt_pd(d, _mm_set1_pd(-p[3])));
+        }
+        int m = _mm_movemask_pd(fail);
+        results[i + 0] = !(m & 1);
+        results[i + 1] = !(m & 2);
+    }
+#endif
+
+    for (; i < count; i++)
+        results[i] = aabbTest(aabbs[i], planes);
+}
+
+namespace
+{
+
+// projected y and w coordinates of a point
+//   explicit order of operations, same as in the vectorized variant
+void projectYW(const mat4 &m, const vec3 &p, double &y, double &w)
+{
+    y = m(1, 0) * p[0] + m(1, 1) * p[1] + m(1, 2) * p[2] + m(1, 3);
+    w = m(3, 0) * p[0] + m(3, 1) * p[1] + m(3, 2) * p[2] + m(3, 3);
+}
+
+double cornerHeight(const mat4 &viewProj, const vec3 &corner, const vec3 &up)
+{
+    vec3 c1 = corner - up * 0.5;
+    vec3 c2 = c1 + up;
+    double y1, w1, y2, w2;
+    projectYW(viewProj, c1, y1, w1);
+    projectYW(viewProj, c2, y2, w2);
+    return std::abs(y2 / w2 - y1 / w1);
+}
+
+#if defined(VTS_SIMD_SSE2)
+
+// two points at once, lanes hold the coordinates of the points
+void projectYW(const mat4 &m, __m128d x, __m128d y, __m128d z,
+               __m128d &ry, __m128d &rw)
+{
+    ry = _mm_add_pd(_mm_add_pd(_mm_add_pd(
+        _mm_mul_pd(_mm_set1_pd(m(1, 0)), x),
+        _mm_mul_pd(_mm_set1_pd(m(1, 1)), y)),
+        _mm_mul_pd(_mm_set1_pd(m(1, 2)), z)),
+        _mm_set1_pd(m(1, 3)));
+    rw = _mm_add_pd(_mm_add_pd(_mm_add_pd(
+        _mm_mul_pd(_mm_set1_pd(m(3, 0)), x),
+        _mm_mul_pd(_mm_set1_pd(m(3, 1)), y)),
+        _mm_mul_pd(_mm_set1_pd(m(3, 2)), z)),
+        _mm_set1_pd(m(3, 3)));
+}
+
+#endif
+
+} // namespace
+
+double cornersHeight(const mat4 &viewProj,
+                     const vec3 corners[8], const vec3 &up)
+{
+    double result = 0;
+    for (uint32 i = 0; i < 8; i++)
+        result = std::max(result, cornerHeight(viewProj, corners[i], up));
+    return result;
+}
+
+void cornersHeight(const mat4 &viewProj,
+                   const vec3 *const corners[], uint32 count,
+                   const vec3 &upUnit, const double scales[],
+                   double results[])
+{
+    for (uint32 i = 0; i < count; i++)
+    {
+        const vec3 *c = corners[i];
+        vec3 up = upUnit * scales[i];
+
+#if defined(VTS_SIMD_SSE2)
+        double hs[8];
+        __m128d hu[3];
+        __m128d fu[3];
+        for (uint32 k = 0; k < 3; k++)
+        {
+            hu[k] = _mm_set1_pd(up[k] * 0.5);
+            fu[k] = _mm_set1_pd(up[k]);
+        }
+        const __m128d sign = _mm_set1_pd(-0.0);
+        for (uint32 j = 0; j < 8; j += 2)
+        {
+            __m128d p[3], q[3];
+            for (uint32 k = 0; k < 3; k++)
+            {
+                p[k] = _mm_sub_pd(_mm_set_pd(c[j + 1][k], c[j][k]), hu[k]);
+                q[k] = _mm_add_pd(p[k], fu[k]);
+            }
+            __m128d y1, w1, y2, w2;
+            projectYW(viewProj, p[0], p[1], p[2], y1, w1);
+            projectYW(viewProj, q[0], q[1], q[2], y2, w2);
+            __m128d h = _mm_sub_pd(_mm_div_pd(y2, w2), _mm_div_pd(y1, w1));
+            _mm_storeu_pd(hs + j, _mm_andnot_pd(sign, h));
+        }
+        // same order of comparisons as the single box variant
+        double result = 0;
+        for (uint32 j = 0; j < 8; j++)
+            result = std::max(result, hs[j]);
+        results[i] = result;
+#else
+        results[i] = cornersHeight(viewProj, c, up);
+#endif
+    }
+}
+
+} // namespace vts
@@ -0,0 +1,55 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CULLING_HPP_h3n6vd0qpe
+#define CULLING_HPP_h3n6vd0qpe
+
+#include "../include/vts-browser/math.hpp"
+
+namespace vts
+{
+
+// tests multiple boxes at once, aabbs[i] points to min and max corners
+// the results are identical to the single box aabbTest
+void aabbTest(const vec3 *const aabbs[], uint32 count,
+              const vec4 planes[6], bool results[]);
+
+// maximum height of the vector up, placed at each of the corners,
+//   after projection, in normalized device coordinates
+double cornersHeight(const mat4 &viewProj,
+                     const vec3 corners[8], const vec3 &up);
+
+// computes cornersHeight for multiple boxes at once,
+//   corners[i] points to eight corners and the up is upUnit * scales[i]
+// the results are identical to the single box variant
+void cornersHeight(const mat4 &viewProj,
+                   const vec3 *const corners[], uint32 count,
+                   const vec3 &upUnit, const double scales[],
+                   double results[]);
+
+} // namespace vts
+
+#endif
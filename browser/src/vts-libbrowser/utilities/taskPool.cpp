@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+
+#include "taskPool.hpp"
+
+namespace vts
+{
+
+void TaskPool::run(uint32 count, const std::function<void(uint32)> &fnc)
+{
+    if (count == 0)
+        return;
+    if (count == 1)
+    {
+        fnc(0);
+        return;
+    }
+
+    auto batch = std::make_shared<Batch>();
+    batch->fnc = &fnc;
+    batch->count = count;
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        batches.push_back(batch);
+    }
+    con.notify_all();
+
+    // process own tasks first
+    while (true)
+    {
+        uint32 i = batch->next++;
+        if (i >= count)
+            break;
+        runTask(*batch, i);
+    }
+
+    // help others while waiting for the remaining tasks
+    while (batch->done < count)
+    {
+        if (runOne())
+            continue;
+        std::unique_lock<std::mutex> lock(mut);
+        con.wait(lock, [&]() {
+            return batch->done == count || anyPending();
+        });
+    }
+
+    if (batch->error)
+        std::rethrow_exception(batch->error);
+}
+
+void TaskPool::workerEntry()
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mut);
+            con.wait(lock, [&]() {
+                return stop || anyPending();
+            });
+            if (stop)
+                return;
+        }
+        runOne();
+    }
+}
+
+void TaskPool::terminate()
+{
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        stop = true;
+    }
+    con.notify_all();
+}
+
+bool TaskPool::runOne()
+{
+    std::shared_ptr<Batch> batch;
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        if (!anyPending())
+            return false;
+        batch = batches.back(); // prefer most recent (nested) batches
+    }
+    uint32 i = batch->next++;
+    if (i >= batch->count)
+        return true; // someone else took the last task, try again
+    runTask(*batch, i);
+    return true;
+}
+
+void TaskPool::runTask(Batch &batch, uint32 index)
+{
+    try
+    {
+        (*batch.fnc)(index);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        if (!batch.error)
+            batch.error = std::current_exception();
+    }
+    if (++batch.done == batch.count)
+    {
+        // lock to avoid missing the notification
+        std::lock_guard<std::mutex> lock(mut);
+        con.notify_all();
+    }
+}
+
+bool TaskPool::anyPending()
+{
+    // must be called with the mutex locked
+    // removes batches with all tasks already taken
+    batches.erase(std::remove_if(batches.begin(), batches.end(),
+        [](const std::shared_ptr<Batch> &b) {
+            return !b->pending();
+        }), batches.end());
+    return !batches.empty();
+}
+
+} // namespace vts
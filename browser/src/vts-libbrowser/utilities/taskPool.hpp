@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TASK_POOL_hj4k5l6j7k8
+#define TASK_POOL_hj4k5l6j7k8
+
+#include <deque>
+#include <memory>
+#include <functional>
+#include <exception>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "../include/vts-browser/foundation.hpp"
+
+namespace vts
+{
+
+// fork-join execution of batches of tasks
+// threads waiting for their batch to finish help with any other pending
+//   tasks, including the tasks of nested batches
+class TaskPool : private Immovable
+{
+public:
+    // calls fnc(i) for all i in [0, count) and waits for all to finish
+    //   the calling thread takes part in the work
+    //   rethrows the first exception thrown by any of the tasks
+    void run(uint32 count, const std::function<void(uint32)> &fnc);
+
+    // executes tasks until terminated (the worker threads)
+    void workerEntry();
+    void terminate();
+
+private:
+    struct Batch
+    {
+        const std::function<void(uint32)> *fnc = nullptr;
+        std::exception_ptr error;
+        uint32 count = 0;
+        std::atomic<uint32> next {0};
+        std::atomic<uint32> done {0};
+
+        bool pending() const { return next < count; }
+    };
+
+    bool runOne(); // returns false if no task was pending
+    void runTask(Batch &batch, uint32 index);
+    bool anyPending();
+
+    std::deque<std::shared_ptr<Batch>> batches;
+    std::mutex mut;
+    std::condition_variable con;
+    bool stop = false;
+};
+
+} // namespace vts
+
+#endif
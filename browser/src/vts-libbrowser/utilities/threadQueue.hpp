@@ -28,6 +28,10 @@
 #define THREAD_QUEUE_gdf5g4d56f4ghd6h4
 
 #include <deque>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <iterator>
 #include <atomic>
 #include <thread>
 #include <mutex>
@@ -61,6 +65,16 @@ public:
         con.notify_one();
     }
 
+    // skips ahead of all waiting items
+    void pushFront(T &&v)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            q.push_front(std::move(v));
+        }
+        con.notify_one();
+    }
+
     bool tryPop(T &v)
     {
         std::lock_guard<std::mutex> lock(mut);
@@ -118,6 +132,318 @@ private:
     std::condition_variable con;
 };
 
+// bounded lock-free queue for many producers
+// push fails when the queue is full
+// the consumers are woken up only when they actually sleep,
+//   so they process items in batches
+template<class T>
+class ThreadRingQueue
+{
+public:
+    explicit ThreadRingQueue(uint32 capacity = 1024) : stop(false)
+    {
+        uint32 c = 2;
+        while (c < capacity)
+            c *= 2;
+        mask = c - 1;
+        cells.reset(new Cell[c]);
+        for (uint32 i = 0; i < c; i++)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool push(const T &v)
+    {
+        return push(T(v));
+    }
+
+    bool push(T &&v)
+    {
+        uint64 pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell *c = nullptr;
+        while (true)
+        {
+            c = &cells[pos & mask];
+            uint64 seq = c->sequence.load(std::memory_order_acquire);
+            sint64 dif = (sint64)seq - (sint64)pos;
+            if (dif == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1,
+                    std::memory_order_relaxed))
+                    break;
+            }
+            else if (dif < 0)
+                return false; // full
+            else
+                pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+        c->value = std::move(v);
+        c->sequence.store(pos + 1, std::memory_order_release);
+
+        // pairs with the fence in waitPop
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            con.notify_one();
+        }
+        return true;
+    }
+
+    bool tryPop(T &v)
+    {
+        if (stop)
+            return false;
+        return pop(v);
+    }
+
+    bool waitPop(T &v)
+    {
+        while (true)
+        {
+            if (stop)
+                return false;
+            if (pop(v))
+                return true;
+            std::unique_lock<std::mutex> lock(mut);
+            sleeping++;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // recheck after announcing the sleep to not miss a push
+            bool popped = !stop && pop(v);
+            if (!popped && !stop)
+                con.wait(lock);
+            sleeping--;
+            if (popped)
+                return true;
+        }
+    }
+
+    void terminate()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            stop = true;
+        }
+        con.notify_all();
+    }
+
+    void purge()
+    {
+        T tmp;
+        while (pop(tmp));
+    }
+
+    bool stopped() const
+    {
+        return stop;
+    }
+
+    uint32 estimateSize() const
+    {
+        uint64 e = enqueuePos.load(std::memory_order_relaxed);
+        uint64 d = dequeuePos.load(std::memory_order_relaxed);
+        return e > d ? e - d : 0;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<uint64> sequence;
+        T value;
+    };
+
+    bool pop(T &v)
+    {
+        uint64 pos = dequeuePos.load(std::memory_order_relaxed);
+        Cell *c = nullptr;
+        while (true)
+        {
+            c = &cells[pos & mask];
+            uint64 seq = c->sequence.load(std::memory_order_acquire);
+            sint64 dif = (sint64)seq - (sint64)(pos + 1);
+            if (dif == 0)
+            {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1,
+                    std::memory_order_relaxed))
+                    break;
+            }
+            else if (dif < 0)
+                return false; // empty
+            else
+                pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+        v = std::move(c->value);
+        c->value = T();
+        c->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::unique_ptr<Cell[]> cells;
+    uint64 mask = 0;
+    std::atomic<uint64> enqueuePos {0};
+    std::atomic<uint64> dequeuePos {0};
+    std::atomic<uint32> sleeping {0};
+    std::atomic<bool> stop;
+    std::mutex mut;
+    std::condition_variable con;
+};
+
+// queue ordered by priority (highest first)
+//   items with same priority are ordered by time of insertion
+// Priority is a functor: bool (const T &item, float &priority)
+//   it returns false when the item is no longer needed
+//   and it may be invoked from any thread
+template<class T, class Priority>
+class ThreadPriorityQueue
+{
+public:
+    ThreadPriorityQueue() : stop(false)
+    {}
+
+    void push(const T &v)
+    {
+        push(T(v));
+    }
+
+    void push(T &&v)
+    {
+        float p = 0;
+        if (!Priority()(v, p))
+            return;
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            q.emplace_back(p, index++, std::move(v));
+            std::push_heap(q.begin(), q.end());
+            wake = waiting > 0;
+        }
+        // notify only when there is someone to wake up
+        if (wake)
+            con.notify_one();
+    }
+
+    bool tryPop(T &v)
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        if (q.empty() || stop)
+            return false;
+        pop(v);
+        return true;
+    }
+
+    bool waitPop(T &v)
+    {
+        std::unique_lock<std::mutex> lock(mut);
+        while (q.empty() && !stop)
+        {
+            waiting++;
+            con.wait(lock);
+            waiting--;
+        }
+        if (q.empty())
+            return false;
+        pop(v);
+        return true;
+    }
+
+    // update priorities of all items and drop items no longer needed
+    // the priorities are evaluated and the dropped items destroyed
+    //   outside the lock, because releasing the last reference
+    //   to a resource may push into this queue again
+    void reprioritize()
+    {
+        std::vector<Item> items;
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            std::swap(items, q);
+        }
+        Priority prio;
+        std::vector<Item> dropped;
+        std::vector<Item> kept;
+        kept.reserve(items.size());
+        for (Item &it : items)
+        {
+            if (prio(it.value, it.priority))
+                kept.push_back(std::move(it));
+            else
+                dropped.push_back(std::move(it));
+        }
+        items.clear();
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            // keep items pushed in the meantime
+            std::move(q.begin(), q.end(), std::back_inserter(kept));
+            std::swap(kept, q);
+            std::make_heap(q.begin(), q.end());
+            wake = waiting > 0 && !q.empty();
+        }
+        if (wake)
+            con.notify_all();
+    }
+
+    void terminate()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            stop = true;
+        }
+        con.notify_all();
+    }
+
+    void purge()
+    {
+        std::vector<Item> items; // destroyed outside the lock
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            std::swap(items, q);
+        }
+        con.notify_all();
+    }
+
+    bool stopped() const
+    {
+        return stop;
+    }
+
+    uint32 estimateSize() const
+    {
+        return q.size();
+    }
+
+private:
+    struct Item
+    {
+        Item(float priority, uint64 index, T &&value) :
+            value(std::move(value)), index(index), priority(priority)
+        {}
+
+        bool operator < (const Item &other) const
+        {
+            if (priority != other.priority)
+                return priority < other.priority;
+            return index > other.index;
+        }
+
+        T value;
+        uint64 index;
+        float priority;
+    };
+
+    void pop(T &v)
+    {
+        std::pop_heap(q.begin(), q.end());
+        v = std::move(q.back().value);
+        q.pop_back();
+    }
+
+    std::atomic<bool> stop;
+    std::vector<Item> q;
+    uint64 index = 0;
+    uint32 waiting = 0; // number of threads in waitPop
+    mutable std::mutex mut;
+    std::condition_variable con;
+};
+
 } // namespace vts
 
 #endif
@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+
+#include "timing.hpp"
+
+namespace vts
+{
+
+void TimingHistogram::add(double ms)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    samples[count++ % TimingStatistics::WindowSize] = (float)ms;
+}
+
+void TimingHistogram::summarize(TimingStatistics &result) const
+{
+    float tmp[TimingStatistics::WindowSize];
+    uint32 cnt;
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        cnt = std::min<uint32>(count, TimingStatistics::WindowSize);
+        std::copy(samples, samples + cnt, tmp);
+    }
+    result.samples = cnt;
+    if (cnt == 0)
+    {
+        result.p50 = result.p95 = result.max = 0;
+        return;
+    }
+    std::sort(tmp, tmp + cnt);
+    result.p50 = tmp[cnt * 50 / 100];
+    result.p95 = tmp[cnt * 95 / 100];
+    result.max = tmp[cnt - 1];
+}
+
+ScopedTimer::ScopedTimer(TimingHistogram &histogram) :
+    start(std::chrono::steady_clock::now()), histogram(&histogram)
+{}
+
+ScopedTimer::ScopedTimer(double &accumulator) :
+    start(std::chrono::steady_clock::now()), accumulator(&accumulator)
+{}
+
+ScopedTimer::~ScopedTimer()
+{
+    double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    if (histogram)
+        histogram->add(ms);
+    if (accumulator)
+        *accumulator += ms;
+}
+
+} // namespace vts
@@ -0,0 +1,69 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TIMING_HPP_w5n8c1r4tz
+#define TIMING_HPP_w5n8c1r4tz
+
+#include <chrono>
+#include <mutex>
+
+#include "../include/vts-browser/timingStatistics.hpp"
+
+namespace vts
+{
+
+// rolling window of time samples
+//   samples may be added from any thread
+class TimingHistogram : private Immovable
+{
+public:
+    void add(double ms);
+    void summarize(TimingStatistics &result) const;
+
+private:
+    float samples[TimingStatistics::WindowSize];
+    uint32 count = 0; // total samples added
+    mutable std::mutex mut;
+};
+
+// measures the time until the end of the scope
+//   adds it as a sample to the histogram or sums it to the accumulator
+class ScopedTimer : private Immovable
+{
+public:
+    explicit ScopedTimer(TimingHistogram &histogram);
+    explicit ScopedTimer(double &accumulator);
+    ~ScopedTimer();
+
+private:
+    std::chrono::steady_clock::time_point start;
+    TimingHistogram *const histogram = nullptr;
+    double *const accumulator = nullptr;
+};
+
+} // namespace vts
+
+#endif
@@ -45,6 +45,8 @@ namespace vts
         [MarshalAs(UnmanagedType.I1)] public bool renderAtmosphere;
         [MarshalAs(UnmanagedType.I1)] public bool renderPolygonEdges;
         [MarshalAs(UnmanagedType.I1)] public bool geodataHysteresis;
+        [MarshalAs(UnmanagedType.I1)] public bool debugDepthFeedback;
+        [MarshalAs(UnmanagedType.I1)] public bool batchSurfaces;
         [MarshalAs(UnmanagedType.I1)] public bool colorToTargetFrameBuffer;
         [MarshalAs(UnmanagedType.I1)] public bool colorToTexture;
     }
@@ -448,18 +448,34 @@ bool gpuTypeInteger(GpuTypeEnum type)
 void Texture::load(ResourceInfo &info, vts::GpuTextureSpec &spec,
     const std::string &debugId)
 {
-    assert(spec.buffer.size() == spec.width * spec.height
-           * spec.components * gpuTypeSize(spec.type)
+    assert(spec.buffer.size() == spec.expectedSize()
            || spec.buffer.size() == 0);
 
+    const uint32 levels = std::max(spec.mipmapLevels, 1u);
     clear();
     glGenTextures(1, &id);
     glBindTexture(GL_TEXTURE_2D, id);
-    glTexImage2D(GL_TEXTURE_2D, 0, findInternalFormat(spec),
-                 spec.width, spec.height, 0,
-                 findFormat(spec), (GLenum)spec.type, spec.buffer.data());
+    const char *data = spec.buffer.data();
+    for (uint32 l = 0; l < levels; l++)
+    {
+        uint32 w = std::max(spec.width >> l, 1u);
+        uint32 h = std::max(spec.height >> l, 1u);
+        if (spec.compressed())
+            glCompressedTexImage2D(GL_TEXTURE_2D, l, spec.internalFormat,
+                w, h, 0, spec.levelSize(l), data);
+        else
+            glTexImage2D(GL_TEXTURE_2D, l, findInternalFormat(spec),
+                w, h, 0, findFormat(spec), (GLenum)spec.type, data);
+        if (data)
+            data += spec.levelSize(l);
+    }
+    GpuTextureSpec::FilterMode filterMode = spec.filterMode;
+    if (levels > 1)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    else if (spec.compressed())
+        filterMode = magFilter(filterMode); // mipmaps cannot be generated
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-        (GLenum)spec.filterMode);
+        (GLenum)filterMode);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
         (GLenum)magFilter(spec.filterMode));
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
@@ -474,13 +490,14 @@ void Texture::load(ResourceInfo &info, vts::GpuTextureSpec &spec,
                         maxAnisotropySamples);
     }
 
-    switch (spec.filterMode)
+    switch (filterMode)
     {
     case GpuTextureSpec::FilterMode::Nearest:
     case GpuTextureSpec::FilterMode::Linear:
         break;
     default:
-        glGenerateMipmap(GL_TEXTURE_2D);
+        if (levels == 1)
+            glGenerateMipmap(GL_TEXTURE_2D);
         break;
     }
 
@@ -771,6 +788,13 @@ void UniformBuffer::bindToIndex(uint32 index)
     glBindBufferBase(GL_UNIFORM_BUFFER, index, ubo);
 }
 
+void UniformBuffer::bindToIndex(uint32 index,
+    std::size_t offset, std::size_t size)
+{
+    bindInit();
+    glBindBufferRange(GL_UNIFORM_BUFFER, index, ubo, offset, size);
+}
+
 void UniformBuffer::load(const void *data, std::size_t size, uint32 usage)
 {
     assert(ubo != 0);
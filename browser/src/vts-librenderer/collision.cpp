@@ -0,0 +1,176 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "collision.hpp"
+
+namespace vts { namespace renderer
+{
+
+namespace
+{
+    Rect ndcToPixels(const Rect &r, uint32 width, uint32 height)
+    {
+        vec2f s = vec2f(width, height);
+        return Rect(r.a.cwiseProduct(s), r.b.cwiseProduct(s));
+    }
+
+    bool test(const std::vector<Circle> &a, const Rect &b)
+    {
+        for (const auto &ra : a)
+            if (overlaps(ra, b))
+                return true;
+        return false;
+    }
+
+    // the screen is split into cells of about this size
+    const float cellPixels = 32;
+    const uint32 maxCells = 256;
+}
+
+void CollisionItem::assign(const Rect &r, uint32 width, uint32 height)
+{
+    rect = r;
+    pixels = ndcToPixels(r, width, height);
+    glyphs.clear();
+}
+
+void CollisionItem::addGlyph(const Rect &glyph, uint32 width, uint32 height)
+{
+    glyphs.push_back(r2c(ndcToPixels(glyph, width, height)));
+}
+
+bool collides(const CollisionItem &a, const CollisionItem &b)
+{
+    if (!overlaps(a.rect, b.rect))
+        return false;
+
+    const auto &ra = a.glyphs;
+    const auto &rb = b.glyphs;
+
+    if (ra.empty() && rb.empty())
+        return true;
+
+    if (ra.empty() != rb.empty())
+    {
+        if (ra.empty())
+            return test(rb, a.pixels);
+        else
+            return test(ra, b.pixels);
+    }
+
+    assert(!ra.empty() && !rb.empty());
+    for (const auto &ca : ra)
+    {
+        if (!overlaps(ca, b.pixels))
+            continue;
+        for (const auto &cb : rb)
+            if (overlaps(ca, cb))
+                return true;
+    }
+    return false;
+}
+
+void CollisionGrid::clear(uint32 width, uint32 height)
+{
+    items.clear();
+    stamps.clear();
+    query = 0;
+    uint32 c = std::min(std::max(uint32(width / cellPixels), 1u), maxCells);
+    uint32 r = std::min(std::max(uint32(height / cellPixels), 1u), maxCells);
+    if (c != columns || r != rows)
+    {
+        columns = c;
+        rows = r;
+        cells.clear();
+        cells.resize(columns * rows);
+    }
+    else
+    {
+        for (auto &it : cells)
+            it.clear();
+    }
+}
+
+void CollisionGrid::range(const Rect &r, uint32 &x0, uint32 &y0,
+    uint32 &x1, uint32 &y1) const
+{
+    // clamping keeps overlapping rects in shared cells,
+    //   items outside of the screen end up in the border cells
+    const auto &cell = [](float v, uint32 count) -> uint32
+    {
+        v = (v + 1) * 0.5f * count;
+        v = std::min(std::max(v, 0.f), count - 1.f);
+        return (uint32)v;
+    };
+    x0 = cell(r.a[0], columns);
+    x1 = cell(r.b[0], columns);
+    y0 = cell(r.a[1], rows);
+    y1 = cell(r.b[1], rows);
+}
+
+bool CollisionGrid::test(const CollisionItem &item)
+{
+    assert(item.rect.valid());
+    if (items.empty())
+        return false;
+    if (++query == 0)
+    {
+        std::fill(stamps.begin(), stamps.end(), 0);
+        query = 1;
+    }
+    uint32 x0, y0, x1, y1;
+    range(item.rect, x0, y0, x1, y1);
+    for (uint32 y = y0; y <= y1; y++)
+    {
+        for (uint32 x = x0; x <= x1; x++)
+        {
+            for (uint32 i : cells[y * columns + x])
+            {
+                if (stamps[i] == query)
+                    continue;
+                stamps[i] = query;
+                if (collides(item, items[i]))
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+void CollisionGrid::insert(CollisionItem &&item)
+{
+    assert(item.rect.valid());
+    uint32 index = (uint32)items.size();
+    uint32 x0, y0, x1, y1;
+    range(item.rect, x0, y0, x1, y1);
+    for (uint32 y = y0; y <= y1; y++)
+        for (uint32 x = x0; x <= x1; x++)
+            cells[y * columns + x].push_back(index);
+    items.push_back(std::move(item));
+    stamps.push_back(0);
+}
+
+} } // namespace vts renderer
@@ -0,0 +1,77 @@
+/**
+ * Copyright (c) 2020 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COLLISION_HPP_k3w9d1vq7z
+#define COLLISION_HPP_k3w9d1vq7z
+
+#include <vector>
+
+#include "shapes.hpp"
+
+namespace vts { namespace renderer
+{
+
+struct CollisionItem
+{
+    Rect rect; // ndc space (-1..1)
+    Rect pixels; // rect in pixels
+    std::vector<Circle> glyphs; // pixels, empty means the whole rect
+
+    void assign(const Rect &rect, uint32 width, uint32 height);
+    void addGlyph(const Rect &glyph, uint32 width, uint32 height);
+};
+
+bool collides(const CollisionItem &a, const CollisionItem &b);
+
+// screen-space uniform grid of accepted items
+//   avoids testing each candidate against all previously accepted items
+class CollisionGrid
+{
+public:
+    void clear(uint32 width, uint32 height);
+
+    // true if the item collides with any inserted item
+    bool test(const CollisionItem &item);
+
+    void insert(CollisionItem &&item);
+
+    uint32 size() const { return (uint32)items.size(); }
+
+private:
+    void range(const Rect &r, uint32 &x0, uint32 &y0,
+        uint32 &x1, uint32 &y1) const;
+
+    std::vector<CollisionItem> items;
+    std::vector<std::vector<uint32>> cells;
+    std::vector<uint32> stamps; // last query that visited the item
+    uint32 columns = 0;
+    uint32 rows = 0;
+    uint32 query = 0;
+};
+
+} } // namespace vts renderer
+
+#endif
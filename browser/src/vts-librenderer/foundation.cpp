@@ -46,6 +46,7 @@ namespace vts { namespace renderer
 
 uint32 maxAntialiasingSamples = 1;
 float maxAnisotropySamples = 0.f;
+uint32 uniformBufferOffsetAlignment = 256;
 
 void checkGlImpl(const char *name)
 {
@@ -210,6 +211,12 @@ void loadGlFunctions(GLADloadproc functionLoader)
     maxAntialiasingSamples = 0;
     glGetIntegerv(GL_MAX_SAMPLES, (GLint*)&maxAntialiasingSamples);
 
+    uniformBufferOffsetAlignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT,
+        (GLint*)&uniformBufferOffsetAlignment);
+    if (uniformBufferOffsetAlignment == 0)
+        uniformBufferOffsetAlignment = 256;
+
     checkGlImpl("load gl extensions and attributes");
 
     vts::log(vts::LogLevel::info2, std::string("OpenGL vendor: ")
@@ -224,6 +231,8 @@ void loadGlFunctions(GLADloadproc functionLoader)
         std::stringstream ss;
         ss << "GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT: " << maxAnisotropySamples
             << ", GL_MAX_SAMPLES: " << maxAntialiasingSamples
+            << ", GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT: "
+            << uniformBufferOffsetAlignment
             << ", GL_KHR_debug: " << GLAD_GL_KHR_debug;
         vts::log(vts::LogLevel::info1, ss.str());
     }
@@ -167,69 +167,6 @@ vec3f GeodataJob::worldUp() const
     return g->points[itemIndex].worldUp;
 }
 
-namespace
-{
-    Rect ndcToPixels(const RenderViewImpl *impl, const Rect &r)
-    {
-        vec2f s = vec2f(impl->width, impl->height);
-        return Rect(r.a.cwiseProduct(s), r.b.cwiseProduct(s));
-    }
-}
-
-bool RenderViewImpl::collides(const GeodataJob &a, const GeodataJob &b)
-{
-    if (!overlaps(a.collisionRect, b.collisionRect))
-        return false;
-
-    const auto &getSubs = [this](const GeodataJob &a) -> std::vector<Circle>
-    {
-        if (a.g->texts.empty())
-            return {};
-        assert(a.itemIndex != (uint32)-1);
-        const auto &src = a.g->texts[a.itemIndex].collisionGlyphsRects;
-        std::vector<Circle> result;
-        result.reserve(src.size());
-        for (const auto &it : src)
-            result.push_back(r2c(ndcToPixels(this, it)));
-        return result;
-    };
-    const auto &ra = getSubs(a);
-    const auto &rb = getSubs(b);
-
-    if (ra.empty() && rb.empty())
-        return true;
-
-    const auto &test = [](const std::vector<Circle> &a, const Rect &b)
-    {
-        for (const auto &ra : a)
-            if (overlaps(ra, b))
-                return true;
-        return false;
-    };
-
-    const Rect pra = ndcToPixels(this, a.collisionRect);
-    const Rect prb = ndcToPixels(this, b.collisionRect);
-
-    if (ra.empty() != rb.empty())
-    {
-        if (ra.empty())
-            return test(rb, pra);
-        else
-            return test(ra, prb);
-    }
-
-    assert(!ra.empty() && !rb.empty());
-    for (const auto &ca : ra)
-    {
-        if (!overlaps(ca, prb))
-            continue;
-        for (const auto &cb : rb)
-            if (overlaps(ca, cb))
-                return true;
-    }
-    return false;
-}
-
 bool RenderViewImpl::geodataTestVisibility(
     const float visibility[4],
     const vec3 &pos, const vec3f &up)
@@ -843,6 +780,7 @@ void RenderViewImpl::filterJobsByResolvingCollisions()
 {
     const float pixels = width * height;
     uint32 index = 0;
+    collisionGrid.clear(width, height);
     std::vector<GeodataJob> result;
     result.reserve(geodataJobs.size());
     for (auto &it : geodataJobs)
@@ -853,19 +791,20 @@ void RenderViewImpl::filterJobsByResolvingCollisions()
             continue;
         if (it.collisionRect.valid())
         {
-            bool ok = true;
-            for (const auto &r : result)
+            CollisionItem c;
+            c.assign(it.collisionRect, width, height);
+            if (!it.g->texts.empty())
             {
-                if (!r.collisionRect.valid())
-                    continue;
-                if (collides(it, r))
-                {
-                    ok = false;
-                    break;
-                }
+                assert(it.itemIndex != (uint32)-1);
+                const auto &src = it.g->texts[it.itemIndex]
+                    .collisionGlyphsRects;
+                c.glyphs.reserve(src.size());
+                for (const auto &r : src)
+                    c.addGlyph(r, width, height);
             }
-            if (!ok)
+            if (collisionGrid.test(c))
                 continue;
+            collisionGrid.insert(std::move(c));
         }
         if (!std::isnan(limitFactor))
             index++;
@@ -155,6 +155,7 @@ public:
     void clear();
     void bind(); // used for uploading the data
     void bindToIndex(uint32 index); // used for rendering
+    void bindToIndex(uint32 index, std::size_t offset, std::size_t size);
     void load(const void *data, std::size_t size, uint32 usage);
     void load(const Buffer &buffer, uint32 usage);
 
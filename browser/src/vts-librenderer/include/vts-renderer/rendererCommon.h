@@ -73,6 +73,11 @@ typedef struct vtsCRenderOptionsBase
     bool geodataHysteresis;
     bool debugDepthFeedback;
 
+    // upload the uniforms of all surfaces in single buffer per pass
+    //   and skip redundant bindings of meshes and textures
+    // disable to fall back to the per-draw uploads
+    bool batchSurfaces;
+
     // where to copy the result (and resolve multisampling)
     bool colorToTargetFrameBuffer;
     bool colorToTexture; // accessible as RenderVariables::colorReadTexId
@@ -35,6 +35,19 @@
 namespace vts { namespace renderer
 {
 
+namespace
+{
+
+// lightweight draws have the raw pointers only
+//   and custom draws (eg. from applications) may have the shared pointers only
+template<class T>
+T *userData(void *raw, const std::shared_ptr<void> &shared)
+{
+    return (T*)(raw ? raw : shared.get());
+}
+
+} // namespace
+
 void clearGlState()
 {
     glDisable(GL_CULL_FACE);
@@ -133,13 +146,9 @@ UniformBuffer *RenderViewImpl::useDisposableUbo(uint32 bindIndex,
     return ubo;
 }
 
-void RenderViewImpl::drawSurface(const DrawSurfaceTask &t, bool wireframeSlow)
+void RenderViewImpl::surfaceUniforms(const DrawSurfaceTask &t,
+    Texture *tex, Texture *mask, void *output) const
 {
-    Texture *tex = (Texture*)t.texColor.get();
-    Mesh *m = (Mesh*)t.mesh.get();
-    if (!m || !tex)
-        return;
-
     struct mat3x4f
     {
         vec4f data[3];
@@ -160,15 +169,18 @@ void RenderViewImpl::drawSurface(const DrawSurfaceTask &t, bool wireframeSlow)
         vec4f uvClip;
         vec4f color;
         vec4si32 flags; // mask, monochromatic, flat shading, uv source, lodBlendingWithDithering, ... frameIndex
-    } data;
+    };
+    static_assert(sizeof(UboSurface) == UboSurfaceSize,
+        "invalid UboSurface size");
 
+    UboSurface &data = *(UboSurface*)output;
     data.p = proj.cast<float>();
     data.mv = rawToMat4(t.mv);
     data.uvMat = mat3x4f(rawToMat3(t.uvm));
     data.uvClip = rawToVec4(t.uvClip);
     data.color = rawToVec4(t.color);
     sint32 flags = 0;
-    if (t.texMask)
+    if (mask)
         flags |= 1 << 0;
     if (tex->getGrayscale())
         flags |= 1 << 1;
@@ -187,13 +199,24 @@ void RenderViewImpl::drawSurface(const DrawSurfaceTask &t, bool wireframeSlow)
             data.color[3] *= t.blendingCoverage;
     }
     data.flags = vec4si32(flags, 0, 0, frameIndex);
+}
 
-    useDisposableUbo(1, data)->setDebugId("UboSurface");
+void RenderViewImpl::drawSurface(const DrawSurfaceTask &t, bool wireframeSlow)
+{
+    Texture *tex = userData<Texture>(t.texColorPtr, t.texColor);
+    Mesh *m = userData<Mesh>(t.meshPtr, t.mesh);
+    Texture *mask = userData<Texture>(t.texMaskPtr, t.texMask);
+    if (!m || !tex)
+        return;
 
-    if (t.texMask)
+    alignas(16) unsigned char data[UboSurfaceSize];
+    surfaceUniforms(t, tex, mask, data);
+    useDisposableUbo(1, data, UboSurfaceSize)->setDebugId("UboSurface");
+
+    if (mask)
     {
         glActiveTexture(GL_TEXTURE0 + 1);
-        ((Texture*)t.texMask.get())->bind();
+        mask->bind();
         glActiveTexture(GL_TEXTURE0 + 0);
     }
     tex->bind();
@@ -205,9 +228,80 @@ void RenderViewImpl::drawSurface(const DrawSurfaceTask &t, bool wireframeSlow)
         m->dispatch();
 }
 
+void RenderViewImpl::drawSurfaces(const std::vector<DrawSurfaceTask> &tasks)
+{
+    if (!options.batchSurfaces)
+    {
+        for (const DrawSurfaceTask &t : tasks)
+            drawSurface(t);
+        return;
+    }
+
+    // pack the uniforms of all the draws
+    const uint32 a = std::max(uniformBufferOffsetAlignment, 16u);
+    const uint32 stride = (UboSurfaceSize + a - 1) / a * a;
+    surfacesUniforms.resize(tasks.size() * stride);
+    uint32 count = 0;
+    for (const DrawSurfaceTask &t : tasks)
+    {
+        Texture *tex = userData<Texture>(t.texColorPtr, t.texColor);
+        Mesh *m = userData<Mesh>(t.meshPtr, t.mesh);
+        if (!m || !tex)
+            continue;
+        Texture *mask = userData<Texture>(t.texMaskPtr, t.texMask);
+        surfaceUniforms(t, tex, mask,
+            surfacesUniforms.data() + count++ * stride);
+    }
+    if (count == 0)
+        return;
+
+    // single upload for the entire pass
+    UniformBuffer *ubo = uboCacheLarge.get();
+    ubo->bind();
+    ubo->load(surfacesUniforms.data(), count * stride, GL_DYNAMIC_DRAW);
+    ubo->setDebugId("UboSurfaces");
+
+    // the draws keep their order (front to back or blending)
+    //   and only repeated bindings are skipped
+    Mesh *lastMesh = nullptr;
+    Texture *lastTex = nullptr;
+    Texture *lastMask = nullptr;
+    uint32 index = 0;
+    for (const DrawSurfaceTask &t : tasks)
+    {
+        Texture *tex = userData<Texture>(t.texColorPtr, t.texColor);
+        Mesh *m = userData<Mesh>(t.meshPtr, t.mesh);
+        if (!m || !tex)
+            continue;
+        Texture *mask = userData<Texture>(t.texMaskPtr, t.texMask);
+        ubo->bindToIndex(1, index++ * stride, UboSurfaceSize);
+        if (mask && mask != lastMask)
+        {
+            glActiveTexture(GL_TEXTURE0 + 1);
+            mask->bind();
+            glActiveTexture(GL_TEXTURE0 + 0);
+            lastMask = mask;
+        }
+        if (tex != lastTex)
+        {
+            tex->bind();
+            lastTex = tex;
+        }
+        if (m != lastMesh)
+        {
+            m->bind();
+            lastMesh = m;
+        }
+        m->dispatch();
+    }
+    assert(index == count);
+    CHECK_GL("draw surfaces");
+}
+
 void RenderViewImpl::drawInfographics(const DrawInfographicsTask &t)
 {
-    Mesh *m = (Mesh*)t.mesh.get();
+    Mesh *m = userData<Mesh>(t.meshPtr, t.mesh);
+    Texture *tex = userData<Texture>(t.texColorPtr, t.texColor);
     if (!m)
         return;
 
@@ -224,7 +318,7 @@ void RenderViewImpl::drawInfographics(const DrawInfographicsTask &t)
     data.color = rawToVec4(t.color);
     data.flags = vec4f(
         t.type,
-        !!t.texColor,
+        !!tex,
         t.type ? 0 : 1,
         0
     );
@@ -233,11 +327,8 @@ void RenderViewImpl::drawInfographics(const DrawInfographicsTask &t)
 
     useDisposableUbo(1, data)->setDebugId("UboInfographics");
 
-    if (t.texColor)
-    {
-        Texture *tex = (Texture*)t.texColor.get();
+    if (tex)
         tex->bind();
-    }
 
     m->bind();
     m->dispatch();
@@ -437,8 +528,7 @@ void RenderViewImpl::renderValid()
         glDepthFunc(GL_LEQUAL);
         context->shaderSurface->bind();
         enableClipDistance(true);
-        for (const DrawSurfaceTask &t : draws->opaque)
-            drawSurface(t);
+        drawSurfaces(draws->opaque);
         enableClipDistance(false);
         CHECK_GL("rendered opaque");
     }
@@ -479,8 +569,7 @@ void RenderViewImpl::renderValid()
         glDepthMask(GL_FALSE);
         context->shaderSurface->bind();
         enableClipDistance(true);
-        for (const DrawSurfaceTask &t : draws->transparent)
-            drawSurface(t);
+        drawSurfaces(draws->transparent);
         enableClipDistance(false);
         glDepthMask(GL_TRUE);
         glDisable(GL_POLYGON_OFFSET_FILL);
@@ -37,6 +37,7 @@
 #include "include/vts-renderer/renderer.hpp"
 
 #include "shapes.hpp"
+#include "collision.hpp"
 
 namespace vts
 {
@@ -124,6 +125,7 @@ struct GeodataJob
 
 extern uint32 maxAntialiasingSamples;
 extern float maxAnisotropySamples;
+extern uint32 uniformBufferOffsetAlignment;
 
 void clearGlState();
 void enableClipDistance(bool enable);
@@ -149,8 +151,10 @@ public:
     DepthBuffer depthBuffer;
     UboCache uboCacheSmall;
     UboCache uboCacheLarge;
+    std::vector<unsigned char> surfacesUniforms; // reused between frames
     std::vector<GeodataJob> geodataJobs;
     std::unordered_map<std::string, GeodataJob> hysteresisJobs;
+    CollisionGrid collisionGrid;
     CameraDraws *draws;
     const MapCelestialBody *body;
     Texture *atmosphereDensityTexture;
@@ -172,6 +176,9 @@ public:
     bool projected;
     bool lodBlendingWithDithering;
 
+    // size of the uniform block in the surface shader
+    static const uint32 UboSurfaceSize = 224;
+
     RenderViewImpl(Camera *camera, RenderView *api,
         RenderContextImpl *context);
 
@@ -181,7 +188,10 @@ public:
     UniformBuffer *useDisposableUbo(uint32 bindIndex, const T &value)
     { return useDisposableUbo(bindIndex, (void*)&value, sizeof(value)); }
 
+    void surfaceUniforms(const DrawSurfaceTask &t,
+        Texture *tex, Texture *mask, void *output) const;
     void drawSurface(const DrawSurfaceTask &t, bool wireframeSlow = false);
+    void drawSurfaces(const std::vector<DrawSurfaceTask> &tasks);
     void drawInfographics(const DrawInfographicsTask &t);
     void updateFramebuffers();
     void updateAtmosphereBuffer();
@@ -191,7 +201,6 @@ public:
     void renderValid();
     void renderEntry();
 
-    bool collides(const GeodataJob &a, const GeodataJob &b);
     bool geodataTestVisibility(
         const float visibility[4],
         const vec3 &pos, const vec3f &up);
@@ -57,6 +57,7 @@ RenderOptions::RenderOptions()
     renderAtmosphere = true;
     geodataHysteresis = true;
     debugDepthFeedback = true;
+    batchSurfaces = true;
     colorToTargetFrameBuffer = true;
 }
 